@@ -0,0 +1,171 @@
+#!/usr/bin/env python3
+"""Minimal FastCGI responder that runs Python CGI scripts in-process.
+
+Used as cgi_path for a location with cgi_workers, e.g.
+
+    location /cgi-bin {
+        cgi_extension .py;
+        cgi_path ./cgi-bin/fcgi_responder.py;
+        cgi_workers 2 4;
+    }
+
+webserv starts it with a listening socket as fd 0 (FCGI_LISTENSOCK_FILENO).
+Each connection carries one request: the script named by SCRIPT_FILENAME
+runs with the CGI variables in os.environ, the request body on stdin and
+stdout captured into STDOUT records. Compiled scripts are kept until their
+mtime changes, so only the first request pays for compiling.
+"""
+import io
+import os
+import socket
+import struct
+import sys
+import traceback
+
+FCGI_BEGIN_REQUEST = 1
+FCGI_END_REQUEST = 3
+FCGI_PARAMS = 4
+FCGI_STDIN = 5
+FCGI_STDOUT = 6
+FCGI_STDERR = 7
+FCGI_REQUEST_COMPLETE = 0
+FCGI_UNKNOWN_ROLE = 3
+FCGI_RESPONDER = 1
+HEADER = struct.Struct("!BBHHBx")
+MAX_CONTENT = 65535
+
+_compiled = {}
+
+
+def read_exact(conn, size):
+    data = b""
+    while len(data) < size:
+        chunk = conn.recv(size - len(data))
+        if not chunk:
+            raise EOFError
+        data += chunk
+    return data
+
+
+def read_record(conn):
+    version, rtype, request_id, length, padding = HEADER.unpack(
+        read_exact(conn, HEADER.size))
+    content = read_exact(conn, length) if length else b""
+    if padding:
+        read_exact(conn, padding)
+    return rtype, request_id, content
+
+
+def send_stream(conn, rtype, request_id, data):
+    for pos in range(0, len(data), MAX_CONTENT):
+        chunk = data[pos:pos + MAX_CONTENT]
+        conn.sendall(HEADER.pack(1, rtype, request_id, len(chunk), 0) + chunk)
+
+
+def end_request(conn, request_id, app_status, protocol_status):
+    body = struct.pack("!IB3x", app_status, protocol_status)
+    conn.sendall(HEADER.pack(1, FCGI_END_REQUEST, request_id, len(body), 0) +
+                 body)
+
+
+def decode_params(data):
+    params = {}
+    pos = 0
+    while pos < len(data):
+        lengths = []
+        for _ in range(2):
+            if data[pos] & 0x80:
+                lengths.append(struct.unpack("!I", data[pos:pos + 4])[0] &
+                               0x7fffffff)
+                pos += 4
+            else:
+                lengths.append(data[pos])
+                pos += 1
+        name = data[pos:pos + lengths[0]].decode("latin-1")
+        pos += lengths[0]
+        value = data[pos:pos + lengths[1]].decode("latin-1")
+        pos += lengths[1]
+        params[name] = value
+    return params
+
+
+def load(path):
+    mtime = os.stat(path).st_mtime_ns
+    cached = _compiled.get(path)
+    if cached and cached[0] == mtime:
+        return cached[1]
+    with open(path, "rb") as f:
+        code = compile(f.read(), path, "exec")
+    _compiled[path] = (mtime, code)
+    return code
+
+
+def run_script(params, body):
+    """Runs one CGI script and returns (stdout bytes, stderr bytes, status)."""
+    saved = (dict(os.environ), sys.stdin, sys.stdout, sys.stderr, sys.argv)
+    out = io.BytesIO()
+    err = io.StringIO()
+    # kept here so the wrappers do not close the buffers when sys.* is restored
+    stdin = io.TextIOWrapper(io.BytesIO(body), encoding="utf-8")
+    stdout = io.TextIOWrapper(out, encoding="utf-8", write_through=True)
+    status = 0
+    try:
+        os.environ.clear()
+        os.environ.update(params)
+        path = params.get("SCRIPT_FILENAME", "")
+        sys.argv = [path]
+        sys.stdin, sys.stdout, sys.stderr = stdin, stdout, err
+        exec(load(path), {"__name__": "__main__", "__file__": path})
+    except SystemExit as e:
+        status = e.code if isinstance(e.code, int) else 0
+    except Exception:
+        traceback.print_exc(file=err)
+        status = 1
+    finally:
+        stdout.flush()
+        os.environ.clear()
+        os.environ.update(saved[0])
+        sys.stdin, sys.stdout, sys.stderr, sys.argv = saved[1:]
+    data = out.getvalue()
+    return data, err.getvalue().encode("utf-8"), status
+
+
+def serve(conn):
+    request_id = None
+    params = b""
+    body = b""
+    while True:
+        rtype, rid, content = read_record(conn)
+        if rtype == FCGI_BEGIN_REQUEST:
+            request_id = rid
+            role = struct.unpack("!H", content[:2])[0]
+            if role != FCGI_RESPONDER:
+                end_request(conn, rid, 0, FCGI_UNKNOWN_ROLE)
+                return
+        elif rtype == FCGI_PARAMS:
+            params += content
+        elif rtype == FCGI_STDIN:
+            if not content:
+                break
+            body += content
+    out, err, status = run_script(decode_params(params), body)
+    send_stream(conn, FCGI_STDOUT, request_id, out)
+    if err:
+        send_stream(conn, FCGI_STDERR, request_id, err)
+    end_request(conn, request_id, status & 0xffffffff, FCGI_REQUEST_COMPLETE)
+
+
+def main():
+    listener = socket.socket(fileno=0)
+    while True:
+        conn, _ = listener.accept()
+        try:
+            serve(conn)
+        except (EOFError, OSError):
+            pass  # the server gave up on this request
+        finally:
+            conn.close()
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,113 @@
+#ifndef ASSETCACHE_HPP
+#define ASSETCACHE_HPP
+
+#include <cstddef>
+#include <list>
+#include <map>
+#include <string>
+#include <vector>
+#include "OpenFileCache.hpp"
+
+// AssetCache の統計
+struct AssetCacheStats {
+  unsigned long hits;       // ファイルに触れずに応答できた回数
+  unsigned long misses;     // キャッシュになかった (または古かった) 回数
+  unsigned long evictions;  // 容量超過で捨てた回数
+  AssetCacheStats() : hits(0), misses(0), evictions(0) {}
+};
+
+/*
+ * CachedAsset Class
+ * 責務:
+ * 1. 静的ファイル1つ分のボディと、組み立て済みの 200 ヘッダブロックを持つ
+ * 2. 参照カウントで AssetCache と送信中の HttpResponse から共有される
+ *
+ * ヘッダブロックには Connection 行を含めない。接続ごとに値が変わるので、
+ * 送信時に headerSplit() の位置へ差し込む (ヘッダは名前順に並ぶため)。
+ */
+class CachedAsset {
+ public:
+  CachedAsset(const std::string& path, const OpenFileCache::Info& info);
+
+  void retain();
+  void release();  // 最後の参照が外れたら自身を破棄する
+
+  const std::string& path() const;
+  bool matches(const OpenFileCache::Info& info) const;  // ファイルが同じか
+  const std::vector<char>& header() const;
+  // header() の元になったヘッダ (Connection・Content-Length を除く)
+  const std::map<std::string, std::string>& fields() const;
+  size_t headerSplit() const;  // Connection 行を差し込む位置
+  const std::vector<char>& body() const;
+  size_t footprint() const;  // 予算計算用のバイト数
+
+ private:
+  friend class AssetCache;
+
+  std::string _path;
+  time_t _mtime;
+  long _mtimeNsec;
+  off_t _size;
+  ino_t _ino;
+  std::map<std::string, std::string> _fields;
+  std::vector<char> _header;
+  size_t _headerSplit;
+  std::vector<char> _body;
+  size_t _refs;
+
+  ~CachedAsset();
+  // Orthodox Canonical Form (コピー禁止)
+  CachedAsset(const CachedAsset&);
+  CachedAsset& operator=(const CachedAsset&);
+};
+
+/*
+ * AssetCache Class
+ * 責務:
+ * 1. 小さくよく使われる静的ファイルを、ヘッダ組み立て済みの応答として保持する
+ * 2. 合計バイト数の予算を超えたら最も使われていないものから捨てる (LRU)
+ * 3. OpenFileCache の stat 結果 (mtime・サイズ) と照合し、古いものは捨てる
+ *
+ * maxBytes が 0 なら何も保持しない。
+ */
+class AssetCache {
+ public:
+  AssetCache(size_t maxBytes, size_t maxFileSize);
+  ~AssetCache();
+
+  // info・headers と一致するエントリを返す (なければ NULL)。使い続けるなら
+  // retain()。同じファイルでも location によってヘッダが変わるので照合する
+  CachedAsset* lookup(const std::string& path, const OpenFileCache::Info& info,
+                      const std::map<std::string, std::string>& headers);
+  // このサイズのファイルを保持できるか
+  bool accepts(off_t size) const;
+  // body (中身は取り込まれる) と headers からエントリを作って登録する
+  CachedAsset* insert(const std::string& path, const OpenFileCache::Info& info,
+                      std::vector<char>& body,
+                      const std::map<std::string, std::string>& headers);
+  void invalidate(const std::string& path);
+  void clear();
+
+  const AssetCacheStats& stats() const;
+  size_t size() const;
+  size_t bytes() const;  // 保持しているバイト数
+
+ private:
+  typedef std::list<CachedAsset*> LruList;  // 先頭ほど最近使った
+  typedef std::map<std::string, LruList::iterator> Index;
+
+  size_t _maxBytes;
+  size_t _maxFileSize;
+  size_t _bytes;
+  LruList _lru;
+  Index _index;
+  AssetCacheStats _stats;
+
+  void _erase(LruList::iterator it);
+
+  // Orthodox Canonical Form (コピー禁止)
+  AssetCache(const AssetCache&);
+  AssetCache& operator=(const AssetCache&);
+};
+
+#endif
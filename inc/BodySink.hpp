@@ -0,0 +1,80 @@
+#ifndef BODYSINK_HPP
+#define BODYSINK_HPP
+
+#include <sys/types.h>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// 一時ファイルへの退避の統計 (プロセス全体)
+struct BodySinkStats {
+  unsigned long spills;        // 一時ファイルに退避したボディの数
+  unsigned long spilledBytes;  // 一時ファイルに書いたバイト数
+  unsigned long renames;       // 保存先へ rename だけで移せた回数
+  BodySinkStats() : spills(0), spilledBytes(0), renames(0) {}
+};
+
+/*
+ * BodySink Class
+ * 責務:
+ * 1. デコード済みのリクエストボディを受け取って保持する
+ * 2. 上限 (client_body_buffer_size) まではメモリに、超えたら一時ファイルに置く
+ * 3. 保存先 (アップロード先) へ書き出す。一時ファイルなら rename で移す
+ *
+ * 一時ファイルは client_body_temp_path に作り、clear() / 破棄で削除する。
+ * saveTo() で rename した後のファイルは保存先のものなので削除しない。
+ * CGI へ流し込む場合は書き終えた分を discard() でメモリから捨てる
+ * (位置は size() と同じくボディ先頭からのバイト数のまま)。
+ * splice(2) で CGI へ直接渡した分は skip() で位置だけ進める。
+ */
+class BodySink {
+ public:
+  BodySink();
+  ~BodySink();
+
+  // 全ての BodySink に適用する設定 (起動時に main から呼ぶ)
+  static void configure(size_t memoryLimit, const std::string& tempDir);
+  static const BodySinkStats& stats();
+
+  // data を末尾に追加する。一時ファイルへの書き込みに失敗したら false
+  bool append(const char* data, size_t len);
+  void clear();
+  void swap(BodySink& other);
+
+  size_t size() const;
+  bool empty() const;
+  bool isSpilled() const;  // 一時ファイルに退避済みか
+  // メモリ上のボディ (isSpilled() なら空)
+  const std::vector<char>& memory() const;
+
+  // offset からのボディを fd へ書く (最大 maxLen)。write(2) と同じ戻り値
+  ssize_t writeTo(int fd, size_t offset, size_t maxLen) const;
+  // ボディを path に保存する。成功で 0、失敗で HTTP ステータス
+  int saveTo(const std::string& path);
+  // offset より前のメモリ上のボディを捨てる (一時ファイルなら何もしない)
+  void discard(size_t offset);
+  // 保持せずに渡した len バイトをボディとして数える
+  // 全て discard() 済みのメモリ上のボディでなければ false
+  bool skip(size_t len);
+
+ private:
+  std::vector<char> _memory;
+  int _fd;                // 一時ファイル (-1 ならメモリ上)
+  std::string _tempPath;  // 削除すべき一時ファイルのパス
+  size_t _size;
+  size_t _base;  // _memory / 一時ファイルの先頭のボディ内の位置
+
+  static size_t _memoryLimit;
+  static std::string _tempDir;
+  static BodySinkStats _stats;
+
+  bool _spill();
+  bool _writeFile(const char* data, size_t len);
+  void _dropFile();
+
+  // Orthodox Canonical Form (コピー禁止)
+  BodySink(const BodySink&);
+  BodySink& operator=(const BodySink&);
+};
+
+#endif
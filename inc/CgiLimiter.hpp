@@ -0,0 +1,76 @@
+#ifndef CGILIMITER_HPP
+#define CGILIMITER_HPP
+
+#include <cstddef>
+#include <deque>
+#include "Config.hpp"
+#include "TimerWheel.hpp"
+
+class Client;
+
+// 同時実行数の制限の統計 (location ごと)
+struct CgiLimitStats {
+  unsigned long started;       // 実行枠を割り当てた数
+  unsigned long queued;        // 空きを待たせた数
+  unsigned long rejected;      // 待ち行列が満杯で 503 を返した数
+  unsigned long abandoned;     // 起動する前に待つのをやめた数 (期限切れ・切断)
+  size_t maxDepth;             // 待ち行列の最大の長さ
+  TimerWheel::Msec waitTotal;  // 枠を得るまで待った時間の合計 (ms)
+  TimerWheel::Msec waitMax;    // 枠を得るまで待った時間の最大 (ms)
+  CgiLimitStats()
+      : started(0),
+        queued(0),
+        rejected(0),
+        abandoned(0),
+        maxDepth(0),
+        waitTotal(0),
+        waitMax(0) {}
+};
+
+/*
+ * CgiLimiter Class
+ * 責務:
+ * 1. location で同時に実行する CGI を max_concurrency 個までに制限する
+ * 2. 上限に達している間のリクエストを到着順に queue_size 個まで待たせる
+ * 3. 待ち行列の長さと待ち時間を記録する
+ *
+ * 枠は CGI を起動する前に acquire() で取り、応答を終えたら release() で返す。
+ * 返した側 (Client) が resume() で次の Client を取り出して起動させる。
+ * 待っている間の期限 (cgi_queue_timeout) は Client のタイマーで扱う。
+ */
+class CgiLimiter {
+ public:
+  explicit CgiLimiter(const CgiLimitConfig& config);
+  ~CgiLimiter();
+
+  // 待っている Client がなく、空きがあれば枠を取る
+  bool acquire();
+  void release();
+
+  // --- 空きを待つ Client (FIFO) ---
+  bool wait(Client* client);  // 満杯なら false (503 を返す)
+  void cancel(Client* client);
+  // 空きがあれば先頭の Client に枠を渡して取り出す (なければ NULL)
+  Client* resume();
+  size_t waiting() const;
+
+  size_t running() const;
+  const CgiLimitStats& stats() const;
+
+ private:
+  struct Waiter {
+    Client* client;
+    TimerWheel::Msec since;  // 待ち始めた時刻
+  };
+
+  CgiLimitConfig _config;
+  size_t _running;
+  std::deque<Waiter> _waiting;
+  CgiLimitStats _stats;
+
+  // Orthodox Canonical Form (コピー禁止)
+  CgiLimiter(const CgiLimiter&);
+  CgiLimiter& operator=(const CgiLimiter&);
+};
+
+#endif
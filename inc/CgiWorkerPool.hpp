@@ -0,0 +1,82 @@
+#ifndef CGIWORKERPOOL_HPP
+#define CGIWORKERPOOL_HPP
+
+#include <sys/types.h>
+#include <cstddef>
+#include <deque>
+#include <string>
+#include <vector>
+#include "Config.hpp"
+
+class Client;
+
+// 常駐ワーカーの統計 (プールごと)
+struct CgiPoolStats {
+  unsigned long requests;  // ワーカーに渡したリクエストの数
+  unsigned long spawned;   // 起動したワーカーの数
+  unsigned long recycled;  // 上限・異常終了で入れ替えたワーカーの数
+  unsigned long queued;    // 全て使用中で待たせたリクエストの数
+  CgiPoolStats() : requests(0), spawned(0), recycled(0), queued(0) {}
+};
+
+/*
+ * CgiWorkerPool Class
+ * 責務:
+ * 1. cgi_path を FastCGI アプリケーションとして起動しておく (min 〜 max 個)
+ * 2. 空いているワーカーを1リクエストに貸し出し、Unix ソケットで接続する
+ * 3. max_requests を処理したワーカー・途中で切られたワーカーを入れ替える
+ * 4. 全て使用中の間は、空くのを待つ Client を到着順に並べておく
+ *
+ * ワーカーには FastCGI の慣例どおり fd 0 に listen 済みのソケットを渡す
+ * (php-cgi などはそのまま動く)。ソケットは抽象名前空間に作るので、
+ * ファイルの後始末は要らない。
+ * 待ち行列の Client は、解放した側 (Client) が nextWaiting() で取り出して
+ * 処理を再開させる。
+ */
+class CgiWorkerPool {
+ public:
+  struct Worker {
+    pid_t pid;
+    std::string address;     // 抽象名前空間のソケット名 (先頭の '\0' を含む)
+    bool busy;               // リクエストに貸し出し中
+    unsigned long requests;  // このプロセスが処理したリクエスト数
+  };
+
+  CgiWorkerPool(const std::string& command, const CgiWorkerConfig& config);
+  ~CgiWorkerPool();  // 全てのワーカーを終了させる
+
+  // 空いているワーカーを貸し出す (足りなければ max まで起動する)
+  // 全て使用中なら NULL
+  Worker* acquire();
+  // ワーカーに接続したソケット (non-blocking) を返す。失敗なら -1
+  // ワーカーが落ちていれば起動し直してもう一度試す
+  int connect(Worker* worker);
+  // reusable でなければ (応答が途中で終わった) ワーカーを入れ替える
+  void release(Worker* worker, bool reusable);
+
+  // --- 空きを待つ Client (FIFO) ---
+  void wait(Client* client);
+  void cancel(Client* client);
+  Client* nextWaiting();  // 先頭を取り出す (いなければ NULL)
+  size_t waiting() const;
+
+  size_t size() const;
+  const CgiPoolStats& stats() const;
+
+ private:
+  std::string _command;
+  CgiWorkerConfig _config;
+  std::vector<Worker*> _workers;
+  std::deque<Client*> _waiting;
+  CgiPoolStats _stats;
+  unsigned long _serial;  // ソケット名の通し番号
+
+  bool _spawn(Worker* worker);
+  void _stop(Worker* worker);
+
+  // Orthodox Canonical Form (コピー禁止)
+  CgiWorkerPool(const CgiWorkerPool&);
+  CgiWorkerPool& operator=(const CgiWorkerPool&);
+};
+
+#endif
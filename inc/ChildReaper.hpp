@@ -0,0 +1,100 @@
+#ifndef CHILDREAPER_HPP
+#define CHILDREAPER_HPP
+
+#include <signal.h>
+#include <spawn.h>
+#include <sys/types.h>
+#include <cstddef>
+#include <map>
+#include <vector>
+#include "Defines.hpp"
+#include "TimerWheel.hpp"
+
+class Client;
+
+// 子プロセスの回収の統計 (プロセス全体)
+struct ReaperStats {
+  unsigned long reaped;      // 回収した子プロセスの数
+  unsigned long terminated;  // SIGTERM を送った数
+  unsigned long killed;      // 猶予内に終わらず SIGKILL を送った数
+  ReaperStats() : reaped(0), terminated(0), killed(0) {}
+};
+
+/*
+ * ChildReaper Class
+ * 責務:
+ * 1. SIGCHLD を signalfd で受け取り、終了した子プロセスを WNOHANG で回収する
+ *    (イベントループを waitpid で止めない)
+ * 2. 終了を待っている Client に終了ステータスを返す
+ * 3. 止める子プロセスに SIGTERM を送り、猶予内に終わらなければ SIGKILL を送る
+ *
+ * SIGCHLD はプロセス全体のものなので、動作中のものは1つだけ (active())。
+ * 生成中は SIGCHLD をブロックする。子プロセスには spawn() で元のシグナル
+ * マスクを渡す。回収するのは watch() / terminate() で渡された pid だけで、
+ * 他の子プロセス (マスターのワーカーなど) には触れない。
+ * active() がなければ (イベントループの外) Client は従来どおり同期的に回収する。
+ */
+class ChildReaper {
+ public:
+  // 終了した (または待つのをやめた) 子プロセスの通知
+  struct Exit {
+    Client* client;
+    int status;  // waitpid のステータス。終了を待たずに止めたなら -1
+  };
+
+  explicit ChildReaper(TimerWheel::Msec exitWaitMs = CGI_EXIT_WAIT_MS,
+                       TimerWheel::Msec killGraceMs = CGI_KILL_GRACE_MS);
+  ~ChildReaper();  // 残っている子プロセスを SIGKILL して回収する
+
+  static ChildReaper* active();  // 動作中のもの (なければ NULL)
+  static const ReaperStats& stats();
+
+  // SIGCHLD をブロックしていないシグナルマスクで posix_spawn する
+  static int spawn(pid_t* pid, const char* path,
+                   const posix_spawn_file_actions_t* actions, char** argv,
+                   char** envp);
+
+  // signalfd (epoll に EPOLLIN で登録する)
+  int getFd() const;
+
+  // pid の終了を待ち、終了したら client に通知する
+  // exitWaitMs 以内に終わらなければ terminate() して -1 を通知する
+  void watch(pid_t pid, Client* client);
+  // pid に SIGTERM を送って回収する (通知なし。終了済みならすぐ回収する)
+  void terminate(pid_t pid);
+
+  // signalfd を読み、終了した子プロセスを回収する
+  void processEvents(std::vector<Exit>& exits);
+  // SIGKILL までの猶予などの期限切れを処理する
+  void expire(TimerWheel::Msec nowMs, std::vector<Exit>& exits);
+  int nextTimeout() const;  // 次に expire() を呼ぶべきまでの ms (-1 ならなし)
+
+  size_t size() const;  // 回収待ちの子プロセスの数
+
+ private:
+  struct Child {
+    TimerWheel::Timer timer;  // owner は this
+    pid_t pid;
+    Client* client;  // 終了を待っている Client (NULL なら止めている途中)
+    bool killed;     // SIGKILL を送った
+  };
+
+  int _fd;
+  sigset_t _savedMask;  // 生成前のシグナルマスク
+  TimerWheel _timers;
+  TimerWheel::Msec _exitWaitMs;
+  TimerWheel::Msec _killGraceMs;
+  std::map<pid_t, Child*> _children;
+
+  static ChildReaper* _active;
+  static ReaperStats _stats;
+
+  void _terminate(Child* child);
+  void _remove(Child* child);
+
+  // Orthodox Canonical Form (コピー禁止)
+  ChildReaper(const ChildReaper&);
+  ChildReaper& operator=(const ChildReaper&);
+};
+
+#endif
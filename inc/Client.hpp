@@ -6,14 +6,27 @@
 #include <sys/types.h>  // pid_t
 #include <unistd.h>     // close
 #include <ctime>
+#include <deque>
 #include <string>
+#include "CgiLimiter.hpp"
+#include "CgiWorkerPool.hpp"
 #include "Config.hpp"
 #include "Defines.hpp"
 #include "Http.hpp"
+#include "Pool.hpp"
+#include "TimerWheel.hpp"
 
 // 前方宣言 (循環参照回避)
 class EpollUtils;
 struct EpollContext;
+class FastCgiRequest;
+
+// splice(2) で中継した CGI のボディの統計 (プロセス全体)
+struct SpliceStats {
+  unsigned long toCgi;    // ソケットから stdin パイプへ渡したバイト数
+  unsigned long fromCgi;  // stdout パイプからソケットへ渡したバイト数
+  SpliceStats() : toCgi(0), fromCgi(0) {}
+};
 
 /*
  * Client Class
@@ -23,6 +36,40 @@ struct EpollContext;
  * 3. 状態遷移の管理 (ConnState)
  * 4. epoll イベントの操作 (EpollUtils 経由)
  * 5. CGI 関連情報の管理
+ * 6. 状態に応じたタイムアウト (TimerWheel) の設定
+ * 7. HTTP/1.1 パイプライン (応答中に届いた後続リクエストの先読み)
+ * 8. CGI へのリクエストボディのストリーミング
+ *
+ * 応答は req の1件ずつ順番に返す。後続リクエストは PIPELINE_MAX_DEPTH 件まで
+ * 先読みキューでパースしておき、キューが埋まったら EPOLLIN を外して止める。
+ *
+ * CGI への POST はヘッダーを受信した時点で起動し、ボディは届いた分から
+ * stdin パイプへ書く。書き切れていないボディが CGI_STDIN_BUFFER_SIZE を
+ * 超えたら EPOLLIN を外し、パイプが空くまでソケットからの受信を止める。
+ *
+ * CGI の出力はヘッダー (空行まで) が揃った時点で応答ヘッダーを送り始め、
+ * ボディは届いた分から送る (Content-Length がなければ chunked)。
+ * 未送信の出力が CGI_STDOUT_BUFFER_SIZE を超えたら stdout パイプの読み込みを
+ * 止め、ソケットへ送れた分だけ再開する。
+ *
+ * cgi_workers が有効な location では CGI を起動せず、常駐ワーカーに FastCGI で
+ * 渡す。接続したソケットを複製して stdin / stdout パイプと同じ扱いにし、
+ * 書く時にレコードに包み、読んだものからは STDOUT の中身だけを取り出す。
+ * 全てのワーカーが使用中なら、空くまでプールの待ち行列に並ぶ。
+ *
+ * cgi_max_concurrency が有効な location では、実行枠 (CgiLimiter) を取って
+ * から CGI を起動する。上限に達していれば起動せずに待ち行列に並び、
+ * cgi_queue_timeout までに枠が空かなければ 503 を返す。
+ *
+ * Content-Length の決まったボディは splice(2) でソケットとパイプの間を直接
+ * 中継し、ユーザー空間にコピーしない。ヘッダーは従来どおり読んで解析し、
+ * chunked・gzip・FastCGI のようにバイト列に手を加えるものはバッファ経由。
+ * 相手側が詰まったら (EAGAIN でも読めるデータが残っている) 読む側の監視を
+ * 外し、書く側の EPOLLOUT で再開する。
+ *
+ * 起動した CGI は出力が終わっても、終了ステータスが分かるまで応答を
+ * 完了させない。回収は ChildReaper が SIGCHLD を受けて行い、イベントループを
+ * waitpid で止めない。シグナルで終了した CGI の応答は打ち切る。
  */
 class Client {
  public:
@@ -32,6 +79,11 @@ class Client {
   Client(int fd, int port, const std::string& ip, EpollUtils* epoll);
   ~Client();
 
+  // --- メモリプール (接続ごとの malloc を避ける) ---
+  static SlabPool& pool();
+  static void* operator new(size_t size);
+  static void operator delete(void* ptr, size_t size);
+
   // --- 基本情報 ---
   int getFd() const;
   int getListenPort() const;
@@ -42,27 +94,54 @@ class Client {
   void setState(ConnState newState);
 
   // --- タイムアウト管理 ---
-  void updateTimestamp();
-  bool isTimedOut(time_t timeout_sec) const;
+  // タイマーを登録するホイールと期限設定 (未設定ならタイムアウトなし)
+  void setTimers(TimerWheel* timers, const TimeoutConfig* timeouts);
+  void updateTimestamp();  // 送受信があった時に呼ぶ (期限を再設定)
+  TimeoutPhase getTimeoutPhase() const;  // 設定中のタイマーのフェーズ
 
   // --- 状態遷移メソッド (epoll 操作を内部で行う) ---
   // RequestHandler はこれらを呼ぶだけで OK
 
   void readyToWrite();  // WRITING_RESPONSE へ遷移 + EPOLLOUT 設定
   void readyToRead();   // リクエスト待ちへ遷移 + EPOLLIN 設定 (Keep-Alive)
-  int startCgi(const std::string& scriptPath,
-               const std::string& execPath);  // CGI 実行開始
+  // CGI 実行開始 (limiter があれば枠を取ってから起動し、上限なら空くまで待つ)
+  int startCgi(const std::string& scriptPath, const std::string& execPath,
+               CgiLimiter* limiter = NULL);
+  // 常駐ワーカーで CGI を実行する (全て使用中なら空くまで待つ)
+  int startFastCgi(CgiWorkerPool* pool, const std::string& scriptPath);
   void readyToCgiWrite();  // POST: stdinパイプへの書き込み準備 (EPOLLOUT)
-  void readyToCgiRead();   // GET/POST: stdoutパイプからの読み込み準備 (EPOLLIN)
+  void readyToCgiRead();   // GET/POST: stdinパイプを閉じて出力を待つ
+  // 受信済みのボディを stdin パイプへ書く (CGI_STDIN の EPOLLOUT で呼ぶ)
+  void writeCgiInput();
+  // ボディの残りをソケットから stdin パイプへ splice で渡す段階か
+  bool isSplicingCgiInput() const;
+  // ソケットから stdin パイプへ splice する
+  // (ソケットのエラーは CGI を止め、接続はソケットのイベントで閉じる)
+  void spliceCgiInput();
+  // 応答ボディを stdout パイプからソケットへ splice で送る段階か
+  bool isSplicingCgiOutput() const;
+  // stdout パイプからソケットへ splice する (エラーの扱いは同上)
+  void spliceCgiOutput();
+  static const SpliceStats& spliceStats();
 
-  void finishCgi();  // CGI 完了処理
+  void finishCgi();  // CGI 完了処理 (終了を待つ場合は onCgiExit() で完了)
+  // 出力の終わった CGI が終了した (ChildReaper から。status が -1 なら不明)
+  void onCgiExit(int status);
+  void abortCgi(int statusCode);  // CGI を停止してエラーレスポンスを返す
   void markClose();  // 接続終了マーク
+  // ソケット・タイマー・CGI を解放する (オブジェクトの解放は後で行う)
+  void closeConnection();
 
   // --- CGI 情報アクセス (main.cpp から使用) ---
   pid_t getCgiPid() const;
   int getCgiStdoutFd() const;
   int getCgiStdinFd() const;
+  // stdout から読んだ出力 (ヘッダーが揃ったら応答を送り始める)
   void appendCgiOutput(const char* buf, size_t len);
+  // FastCGI の END_REQUEST を受け取った (EOF を待たずに finishCgi() してよい)
+  bool isCgiDone() const;
+  // 応答を送信した後に呼ぶ (CGI 出力の読み込み再開・監視イベントの更新)
+  void afterSend();
   const std::string& getCgiOutput() const;
 
   // CGI stdin オフセット管理 (部分書き込み対応)
@@ -81,6 +160,18 @@ class Client {
   // --- トランザクション完了後のリセット（Keep-Alive対応）---
   void reset();
 
+  // --- パイプライン (HTTP/1.1) ---
+  // 応答の処理中に届いたデータを後続リクエストとして先読みする
+  // (len == 0 なら req の後ろに残っているデータだけを切り出す)
+  void readAhead(const char* data, size_t len);
+  // 応答の送信完了後に次のリクエストへ進む。先読み済みのものがあれば req へ
+  // 移す (完了済みならすぐ処理できる)。接続を閉じるべき場合は false
+  bool nextRequest();
+  size_t getPipelineDepth() const;  // 先読みキューの件数
+  void setKeepAlive(bool keepAlive);
+  bool isKeepAlive() const;
+  void closeInput();  // 相手が送信側を閉じた (処理中・先読み済みの応答は返す)
+
  private:
   int _fd;  // 接続済みソケットFD
   std::string _ip;
@@ -90,18 +181,77 @@ class Client {
   EpollContext* _context;  // 自身の EpollContext
 
   ConnState _state;
-  time_t _lastActivity;  // タイムアウト判定用
+
+  // --- タイムアウト ---
+  TimerWheel* _timers;             // 登録先 (参照, NULL ならタイムアウトなし)
+  const TimeoutConfig* _timeouts;  // フェーズごとの期限 (参照)
+  TimerWheel::Timer _timer;        // owner は this
+  TimeoutPhase _timerPhase;        // _timer を設定したフェーズ
 
   // --- CGI 関連 ---
   pid_t _cgi_pid;           // CGI の子プロセス ID (初期値 -1)
   int _cgi_stdout_fd;       // CGI stdout パイプ (初期値 -1)
   int _cgi_stdin_fd;        // CGI stdin パイプ (初期値 -1)
+  EpollContext* _cgi_stdout_ctx;   // stdout パイプの Context (Client が所有)
+  EpollContext* _cgi_stdin_ctx;    // stdin パイプの Context (Client が所有)
+  unsigned int _cgi_stdout_events;  // stdout パイプに登録中のイベント
+  unsigned int _cgi_stdin_events;   // stdin パイプに登録中のイベント
   std::string _cgi_output;  // CGI 出力バッファ
   size_t
       _cgi_stdin_offset;  // CGI stdin 書き込み済みオフセット (部分書き込み対応)
+  CgiWorkerPool* _cgi_pool;  // 常駐ワーカーで実行中・待機中のプール
+  CgiWorkerPool::Worker* _cgi_worker;  // 借りているワーカー (待機中は NULL)
+  FastCgiRequest* _fcgi;               // ワーカーとのレコードの読み書き
+  std::string _cgi_script;  // ワーカー・実行枠を待つ間のスクリプトパス
+  CgiLimiter* _cgi_limiter;  // 実行枠を取っている・待っている制限
+  bool _cgi_queued;          // 実行枠の空きを待っている
+  std::string _cgi_exec;     // 実行枠を待つ間のインタプリタ
+  bool _cgi_stdin_full;   // splice: stdin パイプが詰まった (EPOLLOUT 待ち)
+  bool _cgi_splice_full;  // splice: ソケットが詰まった (EPOLLOUT 待ち)
+  static SpliceStats _spliceStats;
+
+  // --- パイプライン ---
+  std::deque<HttpRequest*> _pipeline;  // 先読みしたリクエスト (先頭が次)
+  bool _keepAlive;    // 現在の応答の後も接続を維持するか
+  bool _inputClosed;  // 相手が送信側を閉じた (これ以上受信しない)
+  unsigned int _events;  // epoll に登録中のイベント
 
   // --- CGI 内部ヘルパー ---
+  void _completeCgi(int status);  // 終了ステータスに応じて応答を完了させる
   void _cleanupCgi();
+  void _closeCgiStdout();
+  void _closeCgiStdin();
+  // 書くボディがある間だけ stdin パイプの EPOLLOUT を監視する
+  void _updateCgiStdin();
+  // 未送信の出力が少ない間だけ stdout パイプの EPOLLIN を監視する
+  void _updateCgiStdout();
+  void _watchCgiPipe(int fd, EpollContext* ctx, unsigned int& current,
+                     unsigned int events);
+  void _startCgiResponse(size_t bodyStart);
+  void _relayCgiOutput(const char* buf, size_t len);
+  void _watchCgiStdout();
+  int _spawnCgi(const std::string& scriptPath, const std::string& execPath);
+  int _connectCgiWorker(CgiWorkerPool::Worker* worker);
+  // 空いたワーカーを待っている Client に順番に渡す
+  static void _resumeCgiWaiting(CgiWorkerPool* pool);
+  // 空いた実行枠を待っている Client に順番に渡して起動させる
+  static void _resumeCgiQueue(CgiLimiter* limiter);
+  bool _isCgiRunning() const;  // CGI を実行中か、ワーカー・実行枠を待っている
+  bool _isWaitingCgiStart() const;  // ワーカーか実行枠の空きを待っている
+  // 処理を始めた req のボディがまだ届いている (CGI へのストリーミング中)
+  bool _isStreamingBody() const;
+  void _onBodyData();  // ストリーミング中にボディが届いた
+
+  // --- パイプライン内部ヘルパー ---
+  HttpRequest& _pipelineTail();
+  void _fillPipeline();
+  void _clearPipeline();
+  bool _canReadAhead() const;
+  void _updateEvents();  // 状態に合わせて epoll の監視イベントを設定し直す
+
+  // --- タイムアウト内部ヘルパー ---
+  TimeoutPhase _currentPhase() const;
+  void _armTimer();
 
   // Orthodox Canonical Form (コピー禁止)
   Client(const Client&);
@@ -6,6 +6,72 @@
 #include <vector>
 #include "Defines.hpp"
 
+/**
+ * @brief 応答のその場 gzip 圧縮の設定 (locationごと)
+ *
+ * CGI の出力と autoindex のように、メモリ上で組み立てた応答ボディが対象。
+ */
+struct GzipConfig {
+  bool enabled;                    ///< 圧縮の有効/無効
+  size_t min_length;               ///< これより短いボディは圧縮しない
+  std::vector<std::string> types;  ///< 圧縮する MIME タイプ ("*" で全て)
+  int level;                       ///< 圧縮レベル (1-9)
+
+  /**
+   * @brief デフォルトコンストラクタ
+   *
+   * デフォルト値:
+   * - enabled: false
+   * - min_length: DEFAULT_GZIP_MIN_LENGTH (20)
+   * - types: ["text/html"]
+   * - level: DEFAULT_GZIP_COMP_LEVEL (1)
+   */
+  GzipConfig();
+};
+
+/**
+ * @brief CGI を常駐ワーカー (FastCGI) で実行する設定 (locationごと)
+ *
+ * 有効な location では cgi_path を FastCGI のアプリケーションとして起動して
+ * おき、リクエストごとにプロセスを起動しない。
+ */
+struct CgiWorkerConfig {
+  size_t min_workers;          ///< 常に起動しておくワーカー数
+  size_t max_workers;          ///< 同時に起動するワーカーの上限 (0 で無効)
+  unsigned long max_requests;  ///< この数を処理したら入れ替える (0 で無制限)
+
+  /**
+   * @brief デフォルトコンストラクタ
+   *
+   * デフォルト値:
+   * - min_workers: 0
+   * - max_workers: 0 (無効: リクエストごとに起動する)
+   * - max_requests: 0 (無制限)
+   */
+  CgiWorkerConfig();
+};
+
+/**
+ * @brief 起動する CGI の同時実行数の制限 (locationごと)
+ *
+ * 上限に達している間のリクエストは CGI を起動せずに到着順に待たせ、
+ * 待ち行列も満杯なら 503 を返す。常駐ワーカーの location は
+ * cgi_workers の max で制限されるので対象外。
+ */
+struct CgiLimitConfig {
+  size_t max_concurrency;  ///< 同時に実行する CGI の上限 (0 で無制限)
+  size_t queue_size;       ///< 空きを待てるリクエスト数 (0 なら待たずに 503)
+
+  /**
+   * @brief デフォルトコンストラクタ
+   *
+   * デフォルト値:
+   * - max_concurrency: 0 (無制限)
+   * - queue_size: DEFAULT_CGI_QUEUE_SIZE (64)
+   */
+  CgiLimitConfig();
+};
+
 /**
  * @brief Locationブロックの設定を保持する構造体
  *
@@ -21,8 +87,13 @@ struct LocationConfig {
       allow_methods;          ///< 許可するHTTPメソッド (GET, POST, DELETE)
   std::string cgi_extension;  ///< CGI拡張子 (ex: ".py")
   std::string cgi_path;       ///< CGI実行パス (ex: "/usr/bin/python3")
+  CgiWorkerConfig cgi_workers;  ///< 常駐ワーカーで CGI を実行する設定
+  CgiLimitConfig cgi_limit;     ///< 起動する CGI の同時実行数の制限
   std::string upload_path;    ///< アップロード先ディレクトリ (ex: "/uploads")
   bool autoindex;             ///< ディレクトリリスティングの有効/無効
+  std::vector<std::string>
+      precompressed;  ///< 圧縮済みファイルを探すエンコーディング (ex: "br", "gzip")
+  GzipConfig gzip;  ///< 動的な応答の gzip 圧縮
   std::pair<int, std::string>
       return_redirect;  ///< リダイレクト設定 (status, URL)
 
@@ -33,6 +104,10 @@ struct LocationConfig {
    * - path: "/"
    * - index: "index.html"
    * - autoindex: false
+   * - precompressed: [] (無効)
+   * - gzip: 無効
+   * - cgi_workers: 無効
+   * - cgi_limit: 無制限
    * - allow_methods: [GET]
    */
   LocationConfig();
@@ -78,6 +153,84 @@ struct ServerConfig {
   const LocationConfig* getLocation(const std::string& path) const;
 };
 
+/**
+ * @brief 接続フェーズごとのタイムアウト設定 (単位: ミリ秒)
+ *
+ * nginxの *_timeout ディレクティブに相当する。
+ * header / keepalive / cgi はフェーズ開始からの期限、
+ * body / send は最後の送受信からの無通信期限として扱う。
+ */
+struct TimeoutConfig {
+  unsigned long client_header_timeout;  ///< リクエストヘッダ受信完了までの期限
+  unsigned long client_body_timeout;    ///< ボディ受信の無通信期限
+  unsigned long keepalive_timeout;      ///< Keep-Alive 待機の期限
+  unsigned long send_timeout;           ///< レスポンス送信の無通信期限
+  unsigned long cgi_timeout;            ///< CGI 実行の期限
+  unsigned long cgi_queue_timeout;      ///< CGI の実行枠を待つ期限
+
+  /**
+   * @brief デフォルトコンストラクタ
+   *
+   * デフォルト値:
+   * - cgi_queue_timeout: DEFAULT_CGI_QUEUE_TIMEOUT_MS (10秒)
+   * - その他: DEFAULT_TIMEOUT_MS (60秒)
+   */
+  TimeoutConfig();
+};
+
+/**
+ * @brief 静的ファイルの open / stat 結果キャッシュの設定
+ *
+ * nginxの open_file_cache / open_file_cache_valid に相当する。
+ */
+struct FileCacheConfig {
+  size_t max_entries;     ///< 保持するパスの最大数 (0 で無効)
+  unsigned long valid_ms;  ///< エントリを再検証せずに使う期間 (ミリ秒)
+
+  /**
+   * @brief デフォルトコンストラクタ
+   *
+   * デフォルト値:
+   * - max_entries: DEFAULT_OPEN_FILE_CACHE_MAX (256)
+   * - valid_ms: DEFAULT_OPEN_FILE_CACHE_VALID_MS (30秒)
+   */
+  FileCacheConfig();
+};
+
+/**
+ * @brief 小さな静的ファイルを応答ごと保持するメモリキャッシュの設定
+ */
+struct AssetCacheConfig {
+  size_t max_bytes;      ///< 保持する合計バイト数 (0 で無効)
+  size_t max_file_size;  ///< 保持するファイル1つの最大サイズ
+
+  /**
+   * @brief デフォルトコンストラクタ
+   *
+   * デフォルト値:
+   * - max_bytes: DEFAULT_ASSET_CACHE_SIZE (4MB)
+   * - max_file_size: DEFAULT_ASSET_CACHE_MAX_FILE (64KB)
+   */
+  AssetCacheConfig();
+};
+
+/**
+ * @brief リクエストボディの置き場所の設定
+ */
+struct ClientBodyConfig {
+  size_t buffer_size;     ///< メモリに置くボディの上限 (超えたら一時ファイル)
+  std::string temp_path;  ///< 一時ファイルを作るディレクトリ
+
+  /**
+   * @brief デフォルトコンストラクタ
+   *
+   * デフォルト値:
+   * - buffer_size: DEFAULT_CLIENT_BODY_BUFFER_SIZE (64KB)
+   * - temp_path: DEFAULT_CLIENT_BODY_TEMP_PATH ("/tmp")
+   */
+  ClientBodyConfig();
+};
+
 /**
  * @brief 全体の設定を管理するクラス
  *
@@ -119,6 +272,12 @@ class MainConfig {
   const ServerConfig* getServer(const std::string& host, int port) const;
 
   std::vector<ServerConfig> servers;  ///< Server設定リスト
+  int worker_processes;  ///< ワーカープロセス数 (デフォルト: 1)
+  int accept_budget;  ///< 1回のEPOLLINでacceptする最大接続数 (デフォルト: 64)
+  TimeoutConfig timeouts;  ///< フェーズごとのタイムアウト
+  FileCacheConfig open_file_cache;  ///< 静的ファイルのキャッシュ設定
+  AssetCacheConfig asset_cache;     ///< 静的ファイルの応答キャッシュ設定
+  ClientBodyConfig client_body;     ///< リクエストボディの置き場所
 
  private:
   // コピー禁止: MainConfigは設定の単一インスタンスとして使用する想定
@@ -12,6 +12,13 @@
  * トークナイザと再帰下降パーサを使用。
  *
  * サポートするディレクティブ:
+ * - worker_processes (トップレベル)
+ * - accept_budget (トップレベル)
+ * - client_header_timeout / client_body_timeout / keepalive_timeout /
+ *   send_timeout / cgi_timeout / cgi_queue_timeout (トップレベル)
+ * - open_file_cache / open_file_cache_valid (トップレベル)
+ * - asset_cache_size / asset_cache_max_file (トップレベル)
+ * - client_body_buffer_size / client_body_temp_path (トップレベル)
  * - server { }
  * - listen
  * - server_name
@@ -21,10 +28,14 @@
  * - location { }
  * - index
  * - autoindex
+ * - precompressed
+ * - gzip / gzip_min_length / gzip_types / gzip_comp_level
  * - allowed_methods
  * - upload_path
  * - cgi_extension
  * - cgi_path
+ * - cgi_workers / cgi_worker_max_requests
+ * - cgi_max_concurrency / cgi_queue_size
  * - return (リダイレクト)
  */
 class ConfigParser {
@@ -124,6 +135,55 @@ class ConfigParser {
    */
   void _parseLocationBlock(ServerConfig& server);
 
+  // ============================================================================
+  // パーサ（トップレベル ディレクティブ）
+  // ============================================================================
+
+  /**
+   * @brief worker_processesディレクティブをパース
+   *
+   * 正の整数または "auto" (オンラインCPU数) を受け付ける。
+   *
+   * @param config パース結果を格納するMainConfig
+   */
+  void _parseWorkerProcessesDirective(MainConfig& config);
+
+  /**
+   * @brief accept_budgetディレクティブをパース
+   * @param config パース結果を格納するMainConfig
+   */
+  void _parseAcceptBudgetDirective(MainConfig& config);
+
+  /**
+   * @brief *_timeout ディレクティブをパース
+   * @param name ディレクティブ名 (エラーメッセージ用)
+   * @param timeout_ms パース結果を格納する変数 (ミリ秒)
+   */
+  void _parseTimeoutDirective(const std::string& name,
+                              unsigned long& timeout_ms);
+
+  /**
+   * @brief open_file_cacheディレクティブをパース
+   *
+   * 最大エントリ数 (正の整数) または "off" を受け付ける。
+   *
+   * @param config パース結果を格納するMainConfig
+   */
+  void _parseOpenFileCacheDirective(MainConfig& config);
+
+  /**
+   * @brief サイズを取るトップレベルディレクティブをパース
+   * @param name ディレクティブ名 (エラーメッセージ用)
+   * @param bytes パース結果を格納する変数 (バイト)
+   */
+  void _parseSizeDirective(const std::string& name, size_t& bytes);
+
+  /**
+   * @brief client_body_temp_pathディレクティブをパース
+   * @param config パース結果を格納するMainConfig
+   */
+  void _parseClientBodyTempPathDirective(MainConfig& config);
+
   // ============================================================================
   // パーサ（server ディレクティブ）
   // ============================================================================
@@ -194,6 +254,27 @@ class ConfigParser {
    */
   void _parseAutoindexDirective(LocationConfig& location);
 
+  /**
+   * @brief precompressedディレクティブをパース
+   *
+   * "precompressed gzip br;" のように .gz / .br を探すエンコーディングを
+   * 優先順に並べる。"precompressed off;" で無効。
+   * @param location パース結果を格納するLocationConfig
+   */
+  void _parsePrecompressedDirective(LocationConfig& location);
+
+  /**
+   * @brief gzip系ディレクティブをパース
+   *
+   * - gzip on|off
+   * - gzip_min_length <サイズ>
+   * - gzip_types <MIMEタイプ>... ("*" で全て)
+   * - gzip_comp_level <1-9>
+   * @param name ディレクティブ名
+   * @param location パース結果を格納するLocationConfig
+   */
+  void _parseGzipDirective(const std::string& name, LocationConfig& location);
+
   /**
    * @brief allowed_methodsディレクティブをパース
    * @param location パース結果を格納するLocationConfig
@@ -218,6 +299,28 @@ class ConfigParser {
    */
   void _parseCgiPathDirective(LocationConfig& location);
 
+  /**
+   * @brief CGI の常駐ワーカー系ディレクティブをパース
+   *
+   * - cgi_workers <最小数> <最大数> | off
+   * - cgi_worker_max_requests <数> (0 で無制限)
+   * @param name ディレクティブ名
+   * @param location パース結果を格納するLocationConfig
+   */
+  void _parseCgiWorkersDirective(const std::string& name,
+                                 LocationConfig& location);
+
+  /**
+   * @brief CGI の同時実行数の制限ディレクティブをパース
+   *
+   * - cgi_max_concurrency <数> (0 で無制限)
+   * - cgi_queue_size <数> (0 なら待たせずに 503)
+   * @param name ディレクティブ名
+   * @param location パース結果を格納するLocationConfig
+   */
+  void _parseCgiLimitDirective(const std::string& name,
+                               LocationConfig& location);
+
   /**
    * @brief returnディレクティブをパース（リダイレクト）
    * @param location パース結果を格納するLocationConfig
@@ -239,6 +342,17 @@ class ConfigParser {
    */
   size_t _parseSize(const std::string& size_str) const;
 
+  /**
+   * @brief 時間文字列をミリ秒に変換
+   *
+   * "30" -> 30000, "30s" -> 30000, "500ms" -> 500, "2m" -> 120000
+   *
+   * @param time_str 時間文字列
+   * @return ミリ秒
+   * @throw std::runtime_error 不正な形式、または 0 の場合
+   */
+  unsigned long _parseDuration(const std::string& time_str) const;
+
   /**
    * @brief 文字列が数値かどうか判定
    * @param str 判定する文字列
@@ -246,6 +360,14 @@ class ConfigParser {
    */
   bool _isNumber(const std::string& str) const;
 
+  /**
+   * @brief 文字列を正の整数として解釈する
+   * @param str 判定する文字列
+   * @param value 出力用の値
+   * @return 1以上のintに収まる数値ならtrue
+   */
+  bool _tryParsePositiveInt(const std::string& str, int& value) const;
+
   /**
    * @brief エラーメッセージを生成
    * @param message エラー内容
@@ -0,0 +1,75 @@
+#ifndef CONNECTIONTABLE_HPP
+#define CONNECTIONTABLE_HPP
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// 前方宣言 (循環参照回避)
+class Client;
+class EpollUtils;
+class TimerWheel;
+struct TimeoutConfig;
+
+/*
+ * ConnectionTable Class
+ * 責務:
+ * 1. fd をインデックスとする接続テーブル (RLIMIT_NOFILE 分を事前確保)
+ * 2. Client とその EpollContext の所有 (生成・epoll 登録・解放)
+ * 3. 生存中の接続を密な配列で保持し、全接続の走査を連続領域で行う
+ * 4. 生成した Client へのタイマー (TimerWheel) の割り当て
+ *
+ * 検索・追加・削除は全て O(1)。削除は密な配列の末尾要素との入れ替えで行う。
+ *
+ * 同じ epoll_wait の結果に削除した接続のイベントが残っているかもしれないので、
+ * remove() は接続を閉じて EpollContext を retire するだけにし、Client と
+ * Context の解放は1周の最後の releaseRetired() で行う。
+ */
+class ConnectionTable {
+ public:
+  // timers が NULL の場合、Client にタイムアウトを設定しない
+  explicit ConnectionTable(EpollUtils* epoll, TimerWheel* timers = NULL,
+                           const TimeoutConfig* timeouts = NULL);
+  ~ConnectionTable();  // 残っている接続を全て解放する
+
+  // Client と EpollContext を生成し、EPOLLIN で epoll に登録する
+  // 失敗時は fd を閉じて NULL を返す (登録済みの fd の場合は閉じずに NULL)
+  Client* add(int fd, int port, const std::string& ip);
+
+  // fd に対応する Client を返す (未登録なら NULL)
+  Client* get(int fd) const;
+
+  // epoll から外して fd を閉じる (Client と EpollContext の解放は後で)
+  void remove(int fd);
+  // remove() した Client を解放する (イベントループの1周の最後に呼ぶ)
+  void releaseRetired();
+
+  // --- 走査用 ---
+  // 0 <= index < size() の範囲で生存中の Client を返す
+  // remove() で順序が入れ替わるため、削除しながら走査する場合は末尾から回す
+  size_t size() const;
+  Client* at(size_t index) const;
+
+  size_t capacity() const;
+
+ private:
+  struct Slot {
+    Client* client;     // NULL なら空き
+    size_t denseIndex;  // _active 内の位置
+  };
+
+  std::vector<Slot> _slots;  // fd -> Slot
+  std::vector<int> _active;  // 生存中の fd (密な配列)
+  std::vector<Client*> _retired;  // remove() 済みで解放待ちの Client
+  EpollUtils* _epoll;
+  TimerWheel* _timers;
+  const TimeoutConfig* _timeouts;
+
+  bool _reserve(int fd);
+
+  // Orthodox Canonical Form (コピー禁止)
+  ConnectionTable(const ConnectionTable&);
+  ConnectionTable& operator=(const ConnectionTable&);
+};
+
+#endif
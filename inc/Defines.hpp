@@ -9,6 +9,26 @@
 #define MAX_HEADER_SIZE 16384
 #define MAX_LINE_SIZE 4096  // 1行の最大長（チャンクサイズ行、trailer等）
 #define DEFAULT_CLIENT_MAX_BODY_SIZE 1048576  // 1MB (1024 * 1024)
+#define DEFAULT_CLIENT_BODY_BUFFER_SIZE 65536  // これを超えるボディは一時ファイルへ
+#define DEFAULT_CLIENT_BODY_TEMP_PATH "/tmp"  // ボディの一時ファイルの置き場所
+#define DEFAULT_TIMEOUT_MS 60000  // 各フェーズのタイムアウト (60秒)
+#define DEFAULT_CGI_QUEUE_TIMEOUT_MS 10000  // CGI の実行枠を待つ期限 (10秒)
+#define DEFAULT_CGI_QUEUE_SIZE 64  // 実行枠の空きを待てるリクエスト数
+#define RETRY_AFTER_SEC 5  // 503 に付ける Retry-After (秒)
+#define PIPELINE_MAX_DEPTH 8  // 1接続で先読みするリクエストの最大数
+#define CGI_STDIN_BUFFER_SIZE 16384  // CGI へ未送信のボディがこれを超えたら受信を止める
+#define CGI_STDOUT_BUFFER_SIZE 65536  // 未送信の CGI 出力がこれを超えたら読まない
+#define CGI_SPLICE_CHUNK 65536  // 1回の splice で CGI と中継する最大 (パイプ容量)
+#define CGI_EXIT_WAIT_MS 1000  // stdout を閉じた CGI の終了を待つ時間
+#define CGI_KILL_GRACE_MS 2000  // SIGTERM から SIGKILL までの猶予
+#define DEFAULT_OPEN_FILE_CACHE_MAX 256  // open_file_cache の最大エントリ数
+#define DEFAULT_OPEN_FILE_CACHE_VALID_MS 30000  // エントリの再検証間隔 (30秒)
+#define DEFAULT_ASSET_CACHE_SIZE 4194304  // 応答キャッシュの合計 (4MB)
+#define DEFAULT_ASSET_CACHE_MAX_FILE 65536  // 応答キャッシュに載せる最大 (64KB)
+#define RANGE_MAX_COUNT 16  // 1リクエストで受け付ける Range の最大区間数
+#define DEFAULT_GZIP_MIN_LENGTH 20  // これより短い応答は圧縮しない
+#define DEFAULT_GZIP_COMP_LEVEL 1  // 速度優先の圧縮レベル
+#define GZIP_STREAM_CHUNK 16384  // 1回の deflate に渡す入力の最大
 
 // 多分これでいい
 enum HttpMethod { GET, HEAD, POST, DELETE, UNKNOWN_METHOD };
@@ -25,6 +45,17 @@ enum ConnState {
   CLOSE_CONNECTION  // 同上
 };
 
+// タイムアウトのフェーズ（どの期限を適用するか）
+enum TimeoutPhase {
+  TIMEOUT_NONE,
+  TIMEOUT_HEADER,     // リクエストヘッダ受信中
+  TIMEOUT_BODY,       // リクエストボディ受信中
+  TIMEOUT_KEEPALIVE,  // Keep-Alive で次のリクエスト待ち
+  TIMEOUT_SEND,       // レスポンス送信中
+  TIMEOUT_CGI,        // CGI 実行中
+  TIMEOUT_CGI_QUEUE   // CGI の実行枠の空き待ち
+};
+
 // 適当に変えてもらって
 enum ParseState {
   REQ_REQUEST_LINE,
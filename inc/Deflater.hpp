@@ -0,0 +1,49 @@
+#ifndef DEFLATER_HPP
+#define DEFLATER_HPP
+
+#include <zlib.h>
+#include <cstddef>
+#include <vector>
+
+// gzip 圧縮の統計 (プロセス全体)
+struct DeflateStats {
+  unsigned long streams;   // 圧縮した応答の数
+  unsigned long bytesIn;   // 圧縮前のバイト数
+  unsigned long bytesOut;  // 圧縮後のバイト数
+  unsigned long cpuUsec;   // deflate() に使った CPU 時間 (マイクロ秒)
+  DeflateStats() : streams(0), bytesIn(0), bytesOut(0), cpuUsec(0) {}
+};
+
+/*
+ * Deflater Class
+ * 責務:
+ * 1. zlib の z_stream を gzip 形式で包み、入力を少しずつ圧縮する
+ * 2. 圧縮に使った CPU 時間とバイト数を DeflateStats に積み上げる
+ *
+ * 1回の write() が出力するのは渡した入力の分だけ (zlib 内部に溜まった分は
+ * 次の write() で出てくる)。finish で gzip のトレーラまで書き出す。
+ */
+class Deflater {
+ public:
+  explicit Deflater(int level);
+  ~Deflater();
+
+  // data を圧縮して out の末尾に追加する。失敗したら false
+  bool write(const char* data, size_t len, bool finish,
+             std::vector<char>& out);
+
+  static const DeflateStats& stats();
+
+ private:
+  z_stream _stream;
+  bool _ready;     // deflateInit2() が成功したか
+  bool _finished;  // Z_STREAM_END まで書き出したか
+
+  static DeflateStats _stats;
+
+  // Orthodox Canonical Form (コピー禁止)
+  Deflater(const Deflater&);
+  Deflater& operator=(const Deflater&);
+};
+
+#endif
@@ -2,6 +2,8 @@
 #define EPOLLCONTEXT_HPP
 
 #include <cstddef>  // NULL
+#include <vector>
+#include "Pool.hpp"
 
 // 前方宣言 (循環参照回避)
 class Client;
@@ -18,7 +20,9 @@ struct EpollContext {
     LISTENER,    // リスナーソケット (accept 用)
     CLIENT,      // クライアントソケット (read/write 用)
     CGI_STDOUT,  // CGI の標準出力パイプ (read 用)
-    CGI_STDIN    // CGI の標準入力パイプ (write 用)
+    CGI_STDIN,   // CGI の標準入力パイプ (write 用)
+    FILE_WATCH,  // OpenFileCache の inotify fd (read 用)
+    CHILD_EXIT   // ChildReaper の signalfd (read 用)
   };
 
   FdType type;
@@ -27,6 +31,31 @@ struct EpollContext {
   Client* client;   // CLIENT, CGI_* の場合に有効
   int listen_port;  // LISTENER の場合に有効
 
+  // --- メモリプール (接続・CGI ごとの malloc を避ける) ---
+
+  static SlabPool& pool() {
+    static SlabPool pool(sizeof(EpollContext), 256);
+    return pool;
+  }
+  static void* operator new(size_t size) { return pool().allocate(size); }
+  static void operator delete(void* ptr, size_t size) {
+    pool().deallocate(ptr, size);
+  }
+
+  // --- 遅延解放 ---
+  // 同じ epoll_wait の結果に後続のイベントが残っているかもしれないので、
+  // 処理中に不要になった Context は client を外して1周の最後に解放する
+  static void retire(EpollContext* ctx) {
+    ctx->client = NULL;
+    retired().push_back(ctx);
+  }
+  static void releaseRetired() {
+    std::vector<EpollContext*>& list = retired();
+    for (size_t i = 0; i < list.size(); ++i)
+      delete list[i];
+    list.clear();
+  }
+
   // --- ファクトリメソッド ---
 
   // Listener 用
@@ -47,6 +76,24 @@ struct EpollContext {
     return ctx;
   }
 
+  // ファイル監視 (inotify) 用
+  static EpollContext* createFileWatch() {
+    EpollContext* ctx = new EpollContext();
+    ctx->type = FILE_WATCH;
+    ctx->client = NULL;
+    ctx->listen_port = 0;
+    return ctx;
+  }
+
+  // 子プロセスの終了通知 (signalfd) 用
+  static EpollContext* createChildExit() {
+    EpollContext* ctx = new EpollContext();
+    ctx->type = CHILD_EXIT;
+    ctx->client = NULL;
+    ctx->listen_port = 0;
+    return ctx;
+  }
+
   // CGI パイプ用 (stdout/stdin)
   static EpollContext* createCgiPipe(Client* c, FdType pipeType) {
     EpollContext* ctx = new EpollContext();
@@ -57,6 +104,11 @@ struct EpollContext {
   }
 
  private:
+  static std::vector<EpollContext*>& retired() {
+    static std::vector<EpollContext*> list;
+    return list;
+  }
+
   // デフォルトコンストラクタは private (ファクトリメソッドを使用)
   EpollContext() : type(LISTENER), client(NULL), listen_port(0) {}
 };
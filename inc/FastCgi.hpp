@@ -0,0 +1,68 @@
+#ifndef FASTCGI_HPP
+#define FASTCGI_HPP
+
+#include <sys/types.h>
+#include <cstddef>
+#include <string>
+#include "BodySink.hpp"
+
+/*
+ * FastCgiRequest Class
+ * 責務:
+ * 1. 常駐ワーカーへの1リクエスト分の FastCGI レコードを組み立てて送る
+ *    (BEGIN_REQUEST, PARAMS, STDIN)
+ * 2. ワーカーから届いたレコードを解いて STDOUT の中身を取り出す
+ *    (STDERR はログへ、END_REQUEST で完了)
+ *
+ * 接続はリクエストごとに張る (FCGI_KEEP_CONN なし) ので、リクエスト ID は
+ * 常に 1。STDIN の中身は BodySink から直接書くため、一時ファイルのボディも
+ * メモリにコピーせずに送れる。
+ */
+class FastCgiRequest {
+ public:
+  FastCgiRequest();
+
+  // BEGIN_REQUEST と PARAMS ("NAME=value" の配列) を送信待ちにする
+  void begin(char** envp);
+
+  // 送信待ちのレコードとボディ (offset 以降) を書けるだけ書き、offset を
+  // 進める。complete ならボディの後に入力の終わり (空の STDIN) を送る
+  // EAGAIN は成功扱い。書き込みに失敗したら false (errno を設定)
+  bool writeInput(int fd, const BodySink& body, size_t& offset,
+                  bool complete);
+  bool hasPendingInput() const;  // 書き途中のレコードがある
+  bool isInputDone() const;      // 入力の終わりまで送った
+
+  // 受信したデータを解き、STDOUT の中身を out の末尾に追加する
+  // 不正なレコードなら false
+  bool read(const char* data, size_t len, std::string& out);
+  bool isEnded() const;  // END_REQUEST を受け取った
+  int getAppStatus() const;
+
+ private:
+  // --- 送信 ---
+  std::string _out;    // 送信待ちのレコード (ヘッダーや PARAMS)
+  size_t _outOffset;   // _out の送信済みバイト数
+  size_t _recordLeft;  // 送信中の STDIN レコードに残っているボディの量
+  bool _endQueued;     // 空の STDIN を _out に積んだ
+  bool _inputDone;
+
+  // --- 受信 ---
+  unsigned char _header[8];  // 受信中のレコードヘッダー
+  size_t _headerLen;
+  unsigned char _type;
+  size_t _contentLeft;
+  size_t _paddingLeft;
+  std::string _record;  // STDOUT 以外のレコードの中身
+  bool _ended;
+  int _appStatus;
+
+  void _appendRecord(unsigned char type, const char* data, size_t len);
+  void _endRecord();
+
+  // Orthodox Canonical Form (コピー禁止)
+  FastCgiRequest(const FastCgiRequest&);
+  FastCgiRequest& operator=(const FastCgiRequest&);
+};
+
+#endif
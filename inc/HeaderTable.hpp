@@ -0,0 +1,80 @@
+#ifndef HEADERTABLE_HPP
+#define HEADERTABLE_HPP
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// よく使うリクエストヘッダー (パース時にスロット番号へ解決する)
+enum HeaderId {
+  HDR_HOST,
+  HDR_CONNECTION,
+  HDR_CONTENT_LENGTH,
+  HDR_CONTENT_TYPE,
+  HDR_TRANSFER_ENCODING,
+  HDR_ACCEPT,
+  HDR_ACCEPT_ENCODING,
+  HDR_COOKIE,
+  HDR_EXPECT,
+  HDR_IF_MODIFIED_SINCE,
+  HDR_IF_NONE_MATCH,
+  HDR_IF_RANGE,
+  HDR_RANGE,
+  HDR_USER_AGENT,
+  HDR_UNKNOWN,  // 上記以外 (番号ではなく名前で保持する)
+  HDR_COUNT = HDR_UNKNOWN
+};
+
+/*
+ * HeaderTable Class
+ * 責務:
+ * 1. リクエストヘッダーの保持 (名前は小文字で管理)
+ * 2. 既知のヘッダーは HeaderId のスロットで O(1) に参照する
+ * 3. 未知のヘッダーは小さな配列に入れて線形探索する
+ *
+ * clear() は文字列の領域を残すので、Keep-Alive で再利用すると
+ * 2回目以降のリクエストではほとんど確保が発生しない。
+ * 同じ名前のヘッダーが複数ある場合は後のものが優先される。
+ */
+class HeaderTable {
+ public:
+  HeaderTable();
+
+  // 名前 (大文字小文字を区別しない) から HeaderId を求める
+  static HeaderId lookup(const char* name, size_t len);
+  static const std::string& nameOf(HeaderId id);  // 小文字の正式名
+
+  // 未知のヘッダー名は小文字にして保持する
+  void set(const char* name, size_t nameLen, const char* value,
+           size_t valueLen);
+  void set(HeaderId id, const char* value, size_t valueLen);
+
+  // 値への参照 (存在しなければ空文字列)。確保は発生しない
+  const std::string& get(HeaderId id) const;
+  bool has(HeaderId id) const;
+
+  // 名前で探す (大文字小文字を区別しない)。存在しなければ NULL
+  const std::string* find(const std::string& name) const;
+
+  // --- 走査用 (0 <= index < size()) ---
+  size_t size() const;
+  const std::string& nameAt(size_t index) const;
+  const std::string& valueAt(size_t index) const;
+
+  void clear();
+  void swap(HeaderTable& other);  // 文字列の領域ごと入れ替える
+
+ private:
+  struct Field {
+    std::string name;
+    std::string value;
+  };
+
+  std::string _known[HDR_COUNT];
+  unsigned int _present;         // HeaderId ごとのビット
+  std::vector<HeaderId> _order;  // 存在する既知ヘッダー (走査用)
+  std::vector<Field> _unknown;   // 先頭 _unknownCount 個が有効
+  size_t _unknownCount;
+};
+
+#endif
@@ -1,13 +1,21 @@
 #ifndef HTTP_HPP
 #define HTTP_HPP
 
+#include <sys/types.h>  // off_t, ino_t
+#include <ctime>
+#include <sys/uio.h>    // struct iovec
 #include <fstream>
 #include <iostream>
 #include <map>
 #include <sstream>
 #include <vector>
+#include "BodySink.hpp"
 #include "Config.hpp"
 #include "Defines.hpp"
+#include "HeaderTable.hpp"
+
+class CachedAsset;
+class Deflater;
 
 // --- Error Codes ---
 enum ErrorCode {
@@ -21,7 +29,9 @@ enum ErrorCode {
   ERR_CONFLICTING_HEADERS,
   ERR_BODY_TOO_LARGE,
   ERR_INVALID_TRANSFER_ENCODING,
-  ERR_INVALID_CHUNK_FORMAT
+  ERR_INVALID_CHUNK_FORMAT,
+  ERR_INVALID_HEADER,  // ヘッダー名に token 以外の文字がある
+  ERR_BODY_STORAGE     // ボディの一時ファイルを作れない / 書けない
   // 必要に応じて追加
 };
 
@@ -30,7 +40,10 @@ enum ErrorCode {
 class HttpRequest {
  private:
   // 生データ管理
+  // _buffer[_readPos, size) が未処理データ。行ごとに erase せずカーソルを進める
   std::string _buffer;
+  size_t _readPos;  // 未処理データの先頭
+  size_t _scanPos;  // 行末 (\r\n) 探索の再開位置
   ParseState _parseState;
   ErrorCode _error;
 
@@ -43,8 +56,8 @@ class HttpRequest {
   std::string _path;
   std::string _query;
   std::string _version;  // HTTP/1.1
-  std::map<std::string, std::string> _headers;
-  std::vector<char> _body;
+  HeaderTable _headers;
+  BodySink _body;         // 大きいボディは一時ファイルに退避される
   size_t _contentLength;  // Content-Lengthヘッダーの値
   bool _isChunked;        // Transfer-Encoding: chunked かどうか
 
@@ -64,9 +77,16 @@ class HttpRequest {
   const ServerConfig* _config;
   const LocationConfig* _location;
 
+  // 入力バッファのカーソル操作
+  size_t available() const;  // 未処理データのバイト数
+  void consume(size_t n);    // 未処理データの先頭を n バイト進める
+  size_t findLineEnd();      // 次の "\r\n" の位置 (なければ npos)
+  void compactBuffer();      // 処理済み領域を詰める
+
   // 内部ヘルパー
   void parseRequestLine();
   void parseHeaders();
+  void finishHeaders();  // ヘッダー終了時の検証とボディ状態の決定
   void parseBody();               // ボディ解析のディスパッチャ
   void parseBodyContentLength();  // Content-Length ベースのボディ解析
   void parseBodyChunked();        // chunked ベースのボディ解析
@@ -87,16 +107,30 @@ class HttpRequest {
   // 状態確認
   bool isComplete() const;
   bool hasError() const;
+  bool isReadingBody() const;  // ヘッダー受信済みでボディ受信中か
+  size_t getUnparsedSize() const;  // 未処理の受信データのバイト数
+  // ボディのうちパーサーを通さずに受け取れるバイト数 (Content-Length の残り)
+  // chunked や、未処理の受信データが残っている間は 0
+  size_t getSpliceableBody() const;
+  // パーサーを通さずに (splice で) 渡した n バイトをボディとして数える
+  bool skipBody(size_t n);
 
   // Keep-Alive用にリセット
   void clear();
 
+  // --- パイプライン用 ---
+  void swap(HttpRequest& other);
+  // 完了後に残った後続リクエストのデータを next に feed して手放す
+  void moveUnparsedTo(HttpRequest& next);
+
   // Getter / Setter
   HttpMethod getMethod() const;
   std::string getPath() const;
   std::string getHeader(const std::string& key) const;
-  const std::map<std::string, std::string>& getHeaders() const;
-  const std::vector<char>& getBody() const;
+  const std::string& getHeader(HeaderId id) const;  // 確保なしで参照
+  const HeaderTable& getHeaders() const;
+  const BodySink& getBody() const;
+  BodySink& getBody();  // 保存先へ移すとき用
   size_t getContentLength() const;
   std::string getQuery() const;
   std::string getHttpVersion() const;
@@ -107,6 +141,12 @@ class HttpRequest {
   void setPath(const std::string& path);
 };
 
+// Range リクエストの1区間 (first, last ともに含むバイト位置)
+struct ByteRange {
+  off_t first;
+  off_t last;
+};
+
 // --- HTTP Response ---
 // ステータスコード等からレスポンスを生データ列に変換する
 class HttpResponse {
@@ -114,7 +154,6 @@ class HttpResponse {
   enum ResState {
     RES_HEADER,
     RES_BODY,
-    RES_FINISH,
     RES_DONE,
     RES_ERROR
   } _state;
@@ -123,7 +162,11 @@ class HttpResponse {
   std::string _statusMessage;
   std::map<std::string, std::string> _headers;
   std::vector<char> _body;
-  std::ifstream* _bodyFileStream;
+  int _bodyFd;          // ファイルボディの fd (-1 ならメモリ上の _body を使う)
+  off_t _bodyFileSize;  // ファイルボディの総バイト数
+  off_t _bodyOffset;    // 次に送信するファイル内オフセット
+  off_t _bodyEnd;       // 送信中の区間の終端 (含まない)
+  bool _useSendfile;    // true: 非chunkedのファイルボディを sendfile(2) で送る
   std::vector<char> _readBuffer;
   HttpMethod _requestMethod;
   std::string _errorMessage;
@@ -133,8 +176,57 @@ class HttpResponse {
   size_t _chunkSize;
 
   // 送信バッファ管理
-  std::vector<char> _responseBuffer;  // ヘッダ+ボディの完成形
-  size_t _sentBytes;                  // 送信済みバイト数
+  // レスポンスは writev(2) で送るセグメント列で表す。ボディはコピーせず
+  // _body / _readBuffer を直接指し、自前のバイト列はヘッダとチャンク枠だけ
+  std::vector<char> _responseBuffer;    // ヘッダ・チャンクサイズ行
+  std::vector<struct iovec> _segments;  // 送信順のセグメント
+  size_t _segIndex;                     // 送信中のセグメント
+  size_t _segOffset;    // _segments[_segIndex] 内の送信済みバイト数
+  size_t _sentBytes;    // セグメント列全体での送信済みバイト数
+  size_t _totalBytes;   // セグメント列全体のバイト数
+  mutable std::vector<char> _flatBuffer;  // getData() 用の連結コピー
+  mutable size_t _flatOrigin;             // _flatBuffer 先頭の送信位置
+  CachedAsset* _asset;  // セグメントが指している AssetCache のエントリ
+
+  // Range 応答 (206)。区間が2つ以上なら multipart/byteranges で送る
+  std::vector<ByteRange> _ranges;
+  size_t _rangeIndex;     // 送信中の区間
+  std::string _boundary;  // multipart の区切り文字列
+  std::string _partType;  // 各パートの Content-Type
+
+  // その場 gzip 圧縮。メモリ上のボディを GZIP_STREAM_CHUNK ずつ圧縮し、
+  // 送信の進み具合に合わせて chunked で送る
+  const GzipConfig* _gzip;  // 適用するポリシー (NULL なら圧縮しない)
+  bool _gzipAccepted;       // クライアントが gzip を受け付けるか
+  Deflater* _deflater;      // 圧縮中のストリーム
+  size_t _deflateOffset;    // 次に圧縮する _body 内の位置
+
+  // CGI 出力のストリーミング。build() の後に届いたボディを _streamBuffer に
+  // 溜め、送信中のセグメントを送り終えたら _body と入れ替えて送る
+  bool _streamed;                   // ボディを appendStream() で受け取る
+  bool _streamEnded;                // endStream() 済み
+  std::vector<char> _streamBuffer;  // まだセグメントにしていないボディ
+  size_t _streamRemaining;  // Content-Length のうち未受信 (chunked なら 0)
+  bool _useSplice;  // true: Content-Length のボディを splice(2) で直接送る
+
+  void _closeBodyFile();
+  void _resetSegments();
+  void _addSegment(const char* data, size_t len);
+  void _copySegments(const HttpResponse& other);
+  void _appendHeaderBlock();
+  bool _onlyConnectionHeader() const;
+  void _layoutAsset();
+  void _materializeAsset();
+  void _releaseAsset();
+  void _appendPartHeader(std::vector<char>& out, const ByteRange& range) const;
+  size_t _multipartLength() const;
+  bool _nextRange();
+  bool _compressible() const;
+  void _deflateNext();
+  void _stopCompression();
+  bool _parseCgiHeaders(const std::string& output,
+                        std::string::size_type& pos);
+  void _streamNext();
 
  public:
   HttpResponse();
@@ -150,12 +242,44 @@ class HttpResponse {
   void setBody(const std::vector<char>& body);
   bool setBodyFile(
       const std::string& filepath);  // ファイルを読み込んでBodyにする
+  // 開いてある fd をBodyにする (fd の所有権を受け取る)
+  bool setBodyFd(int fd, off_t size, const std::string& filepath);
+  // ファイルボディのうち ranges の区間だけを 206 で送る (setBodyFd の後に呼ぶ)
+  bool setBodyRanges(const std::vector<ByteRange>& ranges);
+  // 組み立て済みの応答をそのまま送る (build() は不要。呼んでも同じ結果)
+  // Connection 以外のヘッダが設定済みなら false (通常どおり build() する)
+  bool setCachedAsset(CachedAsset* asset);
   void setChunked(bool isChunked);
+  // ファイルボディを sendfile(2) で送るかどうか (ソケットに紐付く Client が設定)
+  void setSendfile(bool enable);
   // 将来HEADに対応する場合に必要になるので一応
   void setRequestMethod(HttpMethod method);
+  // メモリ上のボディを gzip で送るポリシー (NULL で無効)
+  // accepted: Accept-Encoding が gzip を受け付けるか
+  void setCompression(const GzipConfig* gzip, bool accepted);
 
   void parseCgiResponse(const std::string& output);
 
+  // CGI 出力をストリーミングで返す: ヘッダー部分 (空行まで) を解析し、
+  // build() の後はボディを届いた分から appendStream() で渡す
+  // Status が不正なら 502 を設定して false (通常どおり build() する)
+  bool beginStream(const std::string& cgiHeader);
+  void appendStream(const char* data, size_t len);
+  // ボディの終わり。Content-Length に足りなければ打ち切る (isError)
+  void endStream();
+  void abortStream();  // 送信途中の応答を打ち切る (isError)
+  bool isStreaming() const;
+  bool isStreamIdle() const;  // 続きのボディを待っている (送るものがない)
+  size_t getStreamBuffered() const;  // 受け取ったがまだ送っていないバイト数
+
+  // splice 経路: ヘッダ送信後、ストリームのボディを CGI のパイプから直接送る
+  // (Content-Length があり、chunked の枠も gzip も付けない応答だけ)
+  void setSplice(bool enable);
+  bool isSpliceBody() const;     // ボディを splice で送る応答か
+  bool isSplicePending() const;  // 送信中のセグメントがなく、splice で送る段階か
+  size_t getSpliceRemaining() const;
+  void advanceSplice(size_t n);  // nバイトを splice で送信完了
+
   // ErrorPage生成用
   void makeErrorResponse(int code, const ServerConfig* config = NULL);
 
@@ -163,17 +287,36 @@ class HttpResponse {
   void build();
 
   // epollループで使う送信メソッド
+  // 未送信のセグメントを最大 maxCount 個 iov に並べる (writev 用)
+  int getIovec(struct iovec* iov, int maxCount) const;
+  // 残り全体を連続領域で返す (セグメントが複数残っていれば連結コピー)
   const char* getData() const;
   size_t getRemainingSize() const;
-  void advance(size_t n);  // nバイト送信完了
+  void advance(size_t n);  // nバイト送信完了 (セグメントをまたいでよい)
   bool isDone() const;
   bool isError() const;
+
+  // sendfile 経路: ヘッダ送信後、ファイルボディを fd から直接送る
+  bool isSendfilePending() const;
+  int getBodyFd() const;
+  off_t getBodyOffset() const;
+  size_t getBodyRemaining() const;
+  void advanceBody(size_t n);  // nバイトを sendfile で送信完了
   std::string getErrorMessage() const;
 
   // ヘルパー関数
   static std::string getMimeType(const std::string& filepath);
   static std::string buildErrorHtml(int code, const std::string& message);
   static bool isBodyForbidden(int code);
+  // 検証子 (条件付き GET 用)
+  static std::string makeETag(ino_t ino, off_t size, time_t mtime);
+  static std::string formatHttpDate(time_t t);  // IMF-fixdate (GMT)
+  static bool parseHttpDate(const std::string& str, time_t& t);
+  // AssetCache 用に 200 のヘッダブロックを作る (Connection 行は除く)
+  // 戻り値は Connection 行を差し込む位置
+  static size_t buildCachedHeader(
+      const std::map<std::string, std::string>& headers,
+      size_t contentLength, std::vector<char>& out);
 
   //debug用: テスト時のみ有効化
 #ifdef ENABLE_TEST_FRIENDS
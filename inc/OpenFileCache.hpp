@@ -0,0 +1,94 @@
+#ifndef OPENFILECACHE_HPP
+#define OPENFILECACHE_HPP
+
+#include <sys/types.h>  // off_t, ino_t
+#include <cstddef>
+#include <ctime>
+#include <list>
+#include <map>
+#include <string>
+#include "Pool.hpp"
+#include "TimerWheel.hpp"
+
+/*
+ * OpenFileCache Class
+ * 責務:
+ * 1. パスごとの stat 結果 (有無・種類・サイズ・mtime・読み取り可否) と
+ *    通常ファイルの読み取り用 fd を保持する (nginx の open_file_cache 相当)
+ * 2. 件数の上限を超えたら最も使われていないものから捨てる (LRU)
+ * 3. inotify で親ディレクトリを監視し、変更のあったパスを無効化する
+ *
+ * エントリは valid 期限が切れると次の lookup で開き直す。inotify が使えない
+ * 環境ではこの期限だけが頼りになる。maxEntries が 0 なら常に直接調べる。
+ */
+class OpenFileCache {
+ public:
+  struct Info {
+    bool exists;    // パスが存在するか
+    bool isDir;     // ディレクトリか
+    bool readable;  // 読み取りで開けるか
+    off_t size;
+    time_t mtime;
+    long mtimeNsec;  // mtime のナノ秒部分 (同じ秒内の書き換え検出用)
+    ino_t ino;       // ETag 生成用
+    int fd;  // 通常ファイルの fd (キャッシュが所有する。-1 ならなし)
+
+    Info();
+  };
+
+  OpenFileCache(size_t maxEntries, TimerWheel::Msec validMs);
+  ~OpenFileCache();
+
+  // path の情報を返す (なければ open / fstat して登録する)
+  // fd を使い続ける場合は呼び出し側で複製すること
+  Info lookup(const std::string& path);
+
+  // path のエントリを捨てる (自分でファイルを書き換えた時に呼ぶ)
+  void invalidate(const std::string& path);
+  void clear();
+
+  // inotify の fd (epoll に EPOLLIN で登録する。-1 なら監視なし)
+  int getWatchFd() const;
+  // 溜まった inotify イベントを読み、該当するエントリを捨てる
+  void processEvents();
+
+  const PoolStats& stats() const;
+  size_t size() const;
+
+ private:
+  struct Entry {
+    std::string path;
+    std::string name;  // 親ディレクトリ内での名前 (inotify イベントとの照合用)
+    Info info;
+    TimerWheel::Msec validUntil;
+    int wd;  // 親ディレクトリの watch (-1 なら監視なし)
+  };
+  typedef std::list<Entry> LruList;  // 先頭ほど最近使った
+  typedef std::map<std::string, LruList::iterator> Index;
+
+  struct Watch {
+    std::string dir;
+    size_t refs;  // このディレクトリを親に持つエントリ数
+  };
+
+  size_t _maxEntries;
+  TimerWheel::Msec _validMs;
+  LruList _lru;
+  Index _index;
+  int _notifyFd;
+  std::map<int, Watch> _watches;        // wd -> ディレクトリ
+  std::map<std::string, int> _watchWd;  // ディレクトリ -> wd
+  PoolStats _stats;
+
+  static bool _probe(const std::string& path, bool keepFd, Info& info);
+  int _watch(const std::string& dir);
+  void _unwatch(int wd);
+  void _erase(LruList::iterator it);
+  void _invalidateWatch(int wd, const char* name);
+
+  // Orthodox Canonical Form (コピー禁止)
+  OpenFileCache(const OpenFileCache&);
+  OpenFileCache& operator=(const OpenFileCache&);
+};
+
+#endif
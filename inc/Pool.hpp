@@ -0,0 +1,75 @@
+#ifndef POOL_HPP
+#define POOL_HPP
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// プールのヒット / ミス統計
+struct PoolStats {
+  unsigned long hits;    // malloc せずに再利用できた回数
+  unsigned long misses;  // 新たに確保が必要だった回数
+  PoolStats() : hits(0), misses(0) {}
+};
+
+/*
+ * SlabPool Class
+ * 責務:
+ * 1. 固定サイズオブジェクトをスラブ単位でまとめて確保する
+ * 2. 解放されたオブジェクトをフリーリストで再利用する
+ *
+ * Client / EpollContext のクラス専用 operator new から使う。
+ * スラブはプール破棄時 (プロセス終了時) まで返却しない。
+ */
+class SlabPool {
+ public:
+  SlabPool(size_t objectSize, size_t objectsPerSlab);
+  ~SlabPool();
+
+  void* allocate(size_t size);  // 失敗時は std::bad_alloc
+  void deallocate(void* ptr, size_t size);
+
+  const PoolStats& stats() const;
+  size_t slabCount() const;
+
+ private:
+  struct FreeNode {
+    FreeNode* next;
+  };
+
+  size_t _objectSize;
+  size_t _objectsPerSlab;
+  FreeNode* _freeList;
+  std::vector<char*> _slabs;
+  PoolStats _stats;
+
+  void _grow();
+
+  // Orthodox Canonical Form (コピー禁止)
+  SlabPool(const SlabPool&);
+  SlabPool& operator=(const SlabPool&);
+};
+
+/*
+ * BufferPool
+ * 責務:
+ * 1. 破棄された HttpRequest / HttpResponse / Client のバッファ領域を保持する
+ * 2. 新しい接続のバッファに swap で引き渡し、確保し直しを避ける
+ *
+ * 中身は空にして保持し、大きすぎる領域はメモリを抱え込まないよう捨てる。
+ * acquire() は空のバッファに対して (コンストラクタから) 呼ぶ。
+ */
+class BufferPool {
+ public:
+  static void acquire(std::vector<char>& buf);
+  static void release(std::vector<char>& buf);
+  static void acquire(std::string& buf);
+  static void release(std::string& buf);
+
+  static const PoolStats& stats();
+
+ private:
+  BufferPool();
+};
+
+#endif
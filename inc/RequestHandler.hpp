@@ -9,8 +9,10 @@
 #include <cstring>
 #include <iomanip>
 #include <string>
+#include "AssetCache.hpp"
 #include "Client.hpp"
 #include "Config.hpp"
+#include "OpenFileCache.hpp"
 
 /*
  * RequestHandler Class
@@ -19,6 +21,11 @@
  * 2. 設定(Config)に基づき、パスの解決や権限チェックを行う
  * 3. 処理結果を HttpResponse に書き込む
  * 4. Client の状態遷移メソッドを呼び出す (epoll 操作は Client 内部で行われる)
+ * 5. 静的ファイルの open / stat 結果を OpenFileCache に保持する
+ * 6. 小さな静的ファイルは組み立て済みの応答を AssetCache に保持する
+ * 7. precompressed が有効な location では .gz / .br の圧縮済みファイルを返す
+ * 8. cgi_workers が有効な location の常駐ワーカー (CgiWorkerPool) を持つ
+ * 9. cgi_max_concurrency が有効な location の実行枠 (CgiLimiter) を持つ
  *
  * 注意:
  * - RequestHandler は EpollUtils を直接操作しない
@@ -31,9 +38,26 @@ class RequestHandler {
 
   // メインループから呼ばれる唯一のエントリーポイント
   void handle(Client* client);
+  // ヘッダーを受信した時点で handle() してよいか (CGI への POST)
+  // true ならボディは受信しながら CGI の stdin へ流す
+  bool streamsBody(Client* client);
+
+  // 静的ファイルキャッシュ (main の inotify イベント処理・統計表示用)
+  OpenFileCache& fileCache();
+  const AssetCache& assetCache() const;
+  // 全ての常駐ワーカーのプールの統計を合計したもの
+  CgiPoolStats cgiPoolStats() const;
+  // 全ての CGI の同時実行数の制限の統計を合計したもの (最大値は最大)
+  CgiLimitStats cgiLimitStats() const;
 
  private:
   const MainConfig& _config;
+  OpenFileCache _fileCache;
+  AssetCache _assetCache;
+  // location ごとの常駐ワーカー (設定は実行中に変わらないのでポインタで引く)
+  std::map<const LocationConfig*, CgiWorkerPool*> _cgiPools;
+  // location ごとの CGI の実行枠
+  std::map<const LocationConfig*, CgiLimiter*> _cgiLimiters;
 
   // --- Core Logic Helpers ---
 
@@ -52,8 +76,9 @@ class RequestHandler {
   // --- Method Handlers ---
   // 内部で client->readyToWrite() を呼んで状態遷移する
 
+  // isErrorPage: error_page への内部リダイレクト中 (条件付き GET を評価しない)
   int _handleGet(Client* client, const std::string& realPath,
-                 const LocationConfig* location);
+                 const LocationConfig* location, bool isErrorPage);
   int _handlePost(Client* client, const std::string& realPath,
                   const LocationConfig* location);
   int _handleDelete(Client* client, const std::string& realPath,
@@ -61,6 +86,21 @@ class RequestHandler {
 
   // --- Specific Features ---
 
+  // AssetCache から応答する (なければ読み込んで登録する)。できなければ false
+  bool _serveAsset(Client* client, const std::string& path,
+                   const OpenFileCache::Info& info,
+                   const std::map<std::string, std::string>& headers);
+  CachedAsset* _loadAsset(const std::string& path,
+                          const OpenFileCache::Info& info,
+                          const std::map<std::string, std::string>& headers);
+
+  // Accept-Encoding に合う事前圧縮ファイル (.gz / .br) を探す
+  // 見つかればそのエンコーディング名を返す (なければ空文字列)
+  std::string _findPrecompressed(const HttpRequest& req,
+                                 const LocationConfig& location,
+                                 const std::string& path,
+                                 OpenFileCache::Info& variantInfo);
+
   // CGIの実行処理 (内部で client->startCgi() を呼ぶ)
   int _handleCgi(Client* client, const std::string& scriptPath,
                  const LocationConfig* location);
@@ -0,0 +1,42 @@
+#ifndef SCAN_HPP
+#define SCAN_HPP
+
+#include <cstddef>
+
+/*
+ * Scan Class
+ * 責務:
+ * 1. リクエスト解析用のバイト走査 (CRLF / 区切り文字 / token 外の文字)
+ * 2. SSE2 / AVX2 カーネルと1バイトずつのスカラー版を実行時に切り替える
+ *
+ * 全て [begin, end) を走査し、見つからなければ end を返す。
+ * end より先のメモリは読まない。
+ */
+class Scan {
+ public:
+  enum Impl { SCALAR, SSE2, AVX2 };
+
+  // 最初の "\r\n" の '\r' の位置
+  static const char* findCrlf(const char* begin, const char* end);
+
+  // 最初の c の位置
+  static const char* findChar(const char* begin, const char* end, char c);
+
+  // 最初の token (RFC 9110 tchar) 以外の文字の位置
+  // ヘッダー名の走査では ':' (token 外) で止まる
+  static const char* findNonToken(const char* begin, const char* end);
+
+  // ASCII の大文字を小文字に変換する
+  static void toLower(char* data, size_t len);
+
+  // --- 実装の選択 (ベンチマーク・テスト用) ---
+  static Impl bestImpl();          // この CPU で使える最速の実装
+  static Impl impl();              // 現在使っている実装
+  static bool setImpl(Impl impl);  // CPU が対応していなければ false
+  static const char* implName(Impl impl);
+
+ private:
+  Scan();
+};
+
+#endif
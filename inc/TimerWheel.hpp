@@ -0,0 +1,76 @@
+#ifndef TIMERWHEEL_HPP
+#define TIMERWHEEL_HPP
+
+#include <cstddef>
+#include <vector>
+
+/*
+ * TimerWheel Class
+ * 責務:
+ * 1. 階層型タイミングホイールによるタイムアウト管理
+ * 2. タイマーの登録・再登録・解除を O(1) で行う
+ * 3. 次の期限から epoll_wait のタイムアウト値を算出する
+ *
+ * タイマーは利用側のオブジェクトに埋め込む侵入型リストのノード。
+ * 時刻は CLOCK_MONOTONIC のミリ秒で、TICK_MS 単位で丸められる
+ * (期限より早く発火することはなく、最大 1 tick 遅れる)。
+ */
+class TimerWheel {
+ public:
+  typedef unsigned long Msec;  // ms (64bit Linux では 64bit)
+
+  struct Timer {
+    Timer* prev;
+    Timer* next;
+    Msec expires;  // 期限 (ms)
+    void* owner;   // 期限切れ時の処理対象 (Client* など)
+
+    Timer();
+    bool isArmed() const;
+  };
+
+  static const Msec TICK_MS = 100;
+
+  explicit TimerWheel(Msec nowMs);
+  ~TimerWheel();
+
+  // CLOCK_MONOTONIC の現在時刻 (ms)
+  static Msec clock();
+
+  // ホイールの現在時刻を更新する (イベントループ1周につき1回)
+  void setNow(Msec nowMs);
+  Msec now() const;
+
+  // 現在時刻から timeoutMs 後に期限を設定する (登録済みなら付け替え)
+  void arm(Timer* timer, Msec timeoutMs);
+  void cancel(Timer* timer);
+
+  // 現在時刻までに期限切れになったタイマーを取り出す (解除済みになる)
+  void expire(std::vector<Timer*>& expired);
+
+  // 次に expire() を呼ぶべきまでの ms (タイマーがなければ -1)
+  int nextTimeout() const;
+
+  size_t size() const;
+
+ private:
+  static const int LEVELS = 4;
+  static const int SLOT_BITS = 6;
+  static const int SLOTS = 1 << SLOT_BITS;
+
+  Timer _slots[LEVELS][SLOTS];  // 各スロットの番兵ノード
+  Msec _now;                    // 現在時刻 (ms)
+  Msec _tick;                   // 次に処理する tick
+  size_t _size;
+
+  void _insert(Timer* timer);
+  void _unlink(Timer* timer);
+  int _cascade(int level);
+  static bool _isEmpty(const Timer& head);
+
+  // Orthodox Canonical Form (コピー禁止)
+  TimerWheel(const TimerWheel&);
+  TimerWheel& operator=(const TimerWheel&);
+};
+
+#endif
@@ -0,0 +1,162 @@
+#include "../inc/AssetCache.hpp"
+#include "../inc/Http.hpp"
+
+// ========================================
+// CachedAsset
+// ========================================
+
+CachedAsset::CachedAsset(const std::string& path,
+                         const OpenFileCache::Info& info)
+    : _path(path),
+      _mtime(info.mtime),
+      _mtimeNsec(info.mtimeNsec),
+      _size(info.size),
+      _ino(info.ino),
+      _headerSplit(0),
+      _refs(1) {}
+
+CachedAsset::~CachedAsset() {}
+
+void CachedAsset::retain() {
+  ++_refs;
+}
+
+void CachedAsset::release() {
+  if (--_refs == 0) {
+    delete this;
+  }
+}
+
+const std::string& CachedAsset::path() const {
+  return _path;
+}
+
+bool CachedAsset::matches(const OpenFileCache::Info& info) const {
+  return info.mtime == _mtime && info.mtimeNsec == _mtimeNsec &&
+         info.size == _size && info.ino == _ino;
+}
+
+const std::vector<char>& CachedAsset::header() const {
+  return _header;
+}
+
+const std::map<std::string, std::string>& CachedAsset::fields() const {
+  return _fields;
+}
+
+size_t CachedAsset::headerSplit() const {
+  return _headerSplit;
+}
+
+const std::vector<char>& CachedAsset::body() const {
+  return _body;
+}
+
+size_t CachedAsset::footprint() const {
+  return _header.size() + _body.size() + _path.size();
+}
+
+// ========================================
+// AssetCache
+// ========================================
+
+AssetCache::AssetCache(size_t maxBytes, size_t maxFileSize)
+    : _maxBytes(maxBytes), _maxFileSize(maxFileSize), _bytes(0) {}
+
+AssetCache::~AssetCache() {
+  clear();
+}
+
+CachedAsset* AssetCache::lookup(
+    const std::string& path, const OpenFileCache::Info& info,
+    const std::map<std::string, std::string>& headers) {
+  if (_maxBytes == 0) {
+    return NULL;
+  }
+  Index::iterator found = _index.find(path);
+  if (found == _index.end()) {
+    ++_stats.misses;
+    return NULL;
+  }
+  LruList::iterator it = found->second;
+  if (!(*it)->matches(info) || (*it)->fields() != headers) {
+    _erase(it);  // ファイルが書き換わった、または別のヘッダで使われた
+    ++_stats.misses;
+    return NULL;
+  }
+  _lru.splice(_lru.begin(), _lru, it);
+  ++_stats.hits;
+  return *it;
+}
+
+bool AssetCache::accepts(off_t size) const {
+  return _maxBytes > 0 && size >= 0 &&
+         static_cast<size_t>(size) <= _maxFileSize &&
+         static_cast<size_t>(size) <= _maxBytes;
+}
+
+CachedAsset* AssetCache::insert(
+    const std::string& path, const OpenFileCache::Info& info,
+    std::vector<char>& body,
+    const std::map<std::string, std::string>& headers) {
+  if (!accepts(static_cast<off_t>(body.size()))) {
+    return NULL;
+  }
+  invalidate(path);
+
+  CachedAsset* asset = new CachedAsset(path, info);
+  asset->_body.swap(body);
+  asset->_fields = headers;
+  asset->_fields.erase("Connection");
+  asset->_fields.erase("Content-Length");
+  asset->_headerSplit = HttpResponse::buildCachedHeader(
+      headers, asset->_body.size(), asset->_header);
+
+  size_t footprint = asset->footprint();
+  if (footprint > _maxBytes) {
+    asset->release();
+    return NULL;
+  }
+  while (!_lru.empty() && _bytes + footprint > _maxBytes) {
+    _erase(--_lru.end());
+    ++_stats.evictions;
+  }
+  _lru.push_front(asset);
+  _index[path] = _lru.begin();
+  _bytes += footprint;
+  return asset;
+}
+
+void AssetCache::invalidate(const std::string& path) {
+  Index::iterator found = _index.find(path);
+  if (found != _index.end()) {
+    _erase(found->second);
+  }
+}
+
+void AssetCache::clear() {
+  while (!_lru.empty()) {
+    _erase(_lru.begin());
+  }
+}
+
+const AssetCacheStats& AssetCache::stats() const {
+  return _stats;
+}
+
+size_t AssetCache::size() const {
+  return _index.size();
+}
+
+size_t AssetCache::bytes() const {
+  return _bytes;
+}
+
+// 送信中の応答が参照していれば、解放はその応答が終わるまで遅れる
+void AssetCache::_erase(LruList::iterator it) {
+  CachedAsset* asset = *it;
+  _bytes -= asset->footprint();
+  _index.erase(asset->path());
+  _lru.erase(it);
+  asset->release();
+}
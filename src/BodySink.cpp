@@ -0,0 +1,229 @@
+#include "../inc/BodySink.hpp"
+#include <fcntl.h>
+#include <sys/sendfile.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include "../inc/Defines.hpp"
+#include "../inc/Pool.hpp"
+
+namespace {
+
+// 保存に失敗した errno を HTTP ステータスにする
+int statusFromErrno(int err) {
+  if (err == EACCES)
+    return 403;  // Forbidden
+  if (err == ENOENT)
+    return 404;  // Parent directory missing
+  return 500;    // Internal Error
+}
+
+}  // namespace
+
+size_t BodySink::_memoryLimit = DEFAULT_CLIENT_BODY_BUFFER_SIZE;
+std::string BodySink::_tempDir = DEFAULT_CLIENT_BODY_TEMP_PATH;
+BodySinkStats BodySink::_stats;
+
+BodySink::BodySink() : _fd(-1), _size(0), _base(0) {
+  // 前の接続が使っていたボディ領域を再利用する
+  BufferPool::acquire(_memory);
+}
+
+BodySink::~BodySink() {
+  _dropFile();
+  BufferPool::release(_memory);
+}
+
+void BodySink::configure(size_t memoryLimit, const std::string& tempDir) {
+  _memoryLimit = memoryLimit;
+  _tempDir = tempDir;
+}
+
+const BodySinkStats& BodySink::stats() {
+  return _stats;
+}
+
+// Appends len bytes of decoded body.
+// Once the body would grow past the memory limit, what is held so far moves
+// to a temporary file and every later append goes straight to that file.
+// returns:
+//   bool: false when the temporary file cannot be created or written.
+bool BodySink::append(const char* data, size_t len) {
+  if (len == 0)
+    return true;
+  if (_fd < 0 && _memory.size() + len > _memoryLimit) {
+    if (!_spill())
+      return false;
+  }
+  if (_fd >= 0) {
+    if (!_writeFile(data, len))
+      return false;
+    _stats.spilledBytes += len;
+  } else {
+    _memory.insert(_memory.end(), data, data + len);
+  }
+  _size += len;
+  return true;
+}
+
+void BodySink::clear() {
+  _dropFile();
+  _memory.clear();
+  _size = 0;
+  _base = 0;
+}
+
+void BodySink::swap(BodySink& other) {
+  _memory.swap(other._memory);
+  std::swap(_fd, other._fd);
+  _tempPath.swap(other._tempPath);
+  std::swap(_size, other._size);
+  std::swap(_base, other._base);
+}
+
+size_t BodySink::size() const {
+  return _size;
+}
+
+bool BodySink::empty() const {
+  return _size == 0;
+}
+
+bool BodySink::isSpilled() const {
+  return _fd >= 0;
+}
+
+const std::vector<char>& BodySink::memory() const {
+  return _memory;
+}
+
+// Writes the body from offset to fd, at most maxLen bytes.
+// offset must not be before what has been discarded.
+// A spilled body is sent with sendfile(2), so it is not copied through
+// user space.
+// returns:
+//   ssize_t: bytes written, 0 at the end of the body, -1 with errno set.
+ssize_t BodySink::writeTo(int fd, size_t offset, size_t maxLen) const {
+  if (offset < _base) {
+    errno = EINVAL;  // 捨てた後の位置は書けない
+    return -1;
+  }
+  if (offset >= _size)
+    return 0;
+  size_t len = _size - offset;
+  if (len > maxLen)
+    len = maxLen;
+  if (_fd < 0)
+    return write(fd, &_memory[offset - _base], len);
+  off_t fileOffset = static_cast<off_t>(offset - _base);
+  return sendfile(fd, _fd, &fileOffset, len);
+}
+
+// Stores the body at path, replacing any existing file.
+// A spilled body is renamed into place when path is on the same file system;
+// otherwise it is copied with sendfile(2).
+// returns:
+//   int: 0 on success, or an HTTP status code (403, 404, 500) on failure.
+int BodySink::saveTo(const std::string& path) {
+  if (_fd >= 0 && !_tempPath.empty()) {
+    // mkstemp(3) は 0600 で作るので、通常のアップロードと同じ権限にする
+    fchmod(_fd, 0644);
+    if (rename(_tempPath.c_str(), path.c_str()) == 0) {
+      _tempPath.clear();
+      ++_stats.renames;
+      return 0;
+    }
+    if (errno != EXDEV)
+      return statusFromErrno(errno);
+  }
+
+  int out = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+  if (out < 0)
+    return statusFromErrno(errno);
+  size_t offset = 0;
+  while (offset < _size) {
+    ssize_t n = writeTo(out, offset, _size - offset);
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n <= 0) {
+      close(out);
+      return 500;
+    }
+    offset += static_cast<size_t>(n);
+  }
+  if (close(out) != 0)
+    return 500;
+  return 0;
+}
+
+// Drops the in-memory bytes before offset, once they have been handed on.
+// A spilled body keeps its file as is; only the memory part is released.
+void BodySink::discard(size_t offset) {
+  if (_fd >= 0 || offset <= _base)
+    return;
+  size_t len = std::min(offset - _base, _memory.size());
+  _memory.erase(_memory.begin(), _memory.begin() + len);
+  _base += len;
+}
+
+// Counts len bytes that went to the CGI without passing through the sink
+// (splice(2)), so that positions stay relative to the start of the body.
+bool BodySink::skip(size_t len) {
+  if (_fd >= 0 || _base != _size)
+    return false;
+  _size += len;
+  _base += len;
+  return true;
+}
+
+// Moves the in-memory part to a new temporary file in the temp directory.
+bool BodySink::_spill() {
+  std::string name = _tempDir;
+  if (name.empty() || name[name.size() - 1] != '/')
+    name += '/';
+  name += "webserv_body_XXXXXX";
+  std::vector<char> tmpl(name.begin(), name.end());
+  tmpl.push_back('\0');
+  int fd = mkstemp(&tmpl[0]);
+  if (fd < 0)
+    return false;
+  fcntl(fd, F_SETFD, FD_CLOEXEC);
+  _fd = fd;
+  _tempPath = &tmpl[0];
+  ++_stats.spills;
+  if (!_memory.empty()) {
+    if (!_writeFile(&_memory[0], _memory.size()))
+      return false;
+    _stats.spilledBytes += _memory.size();
+    _memory.clear();
+  }
+  return true;
+}
+
+bool BodySink::_writeFile(const char* data, size_t len) {
+  while (len > 0) {
+    ssize_t n = write(_fd, data, len);
+    if (n < 0) {
+      if (errno == EINTR)
+        continue;
+      return false;
+    }
+    data += n;
+    len -= static_cast<size_t>(n);
+  }
+  return true;
+}
+
+void BodySink::_dropFile() {
+  if (!_tempPath.empty()) {
+    unlink(_tempPath.c_str());
+    _tempPath.clear();
+  }
+  if (_fd >= 0) {
+    close(_fd);
+    _fd = -1;
+  }
+}
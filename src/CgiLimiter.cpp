@@ -0,0 +1,79 @@
+#include "../inc/CgiLimiter.hpp"
+
+CgiLimiter::CgiLimiter(const CgiLimitConfig& config)
+    : _config(config), _running(0) {}
+
+CgiLimiter::~CgiLimiter() {}
+
+// Takes a slot for a request that has just arrived.
+// A request never overtakes the ones already waiting, even if a slot
+// became free in the meantime, so the queue stays first come first served.
+bool CgiLimiter::acquire() {
+  if (!_waiting.empty() || _running >= _config.max_concurrency) {
+    return false;
+  }
+  ++_running;
+  ++_stats.started;
+  return true;
+}
+
+void CgiLimiter::release() {
+  if (_running > 0) {
+    --_running;
+  }
+}
+
+bool CgiLimiter::wait(Client* client) {
+  if (_waiting.size() >= _config.queue_size) {
+    ++_stats.rejected;
+    return false;
+  }
+  Waiter waiter;
+  waiter.client = client;
+  waiter.since = TimerWheel::clock();
+  _waiting.push_back(waiter);
+  ++_stats.queued;
+  if (_waiting.size() > _stats.maxDepth) {
+    _stats.maxDepth = _waiting.size();
+  }
+  return true;
+}
+
+void CgiLimiter::cancel(Client* client) {
+  for (std::deque<Waiter>::iterator it = _waiting.begin();
+       it != _waiting.end(); ++it) {
+    if (it->client == client) {
+      _waiting.erase(it);
+      ++_stats.abandoned;
+      return;
+    }
+  }
+}
+
+Client* CgiLimiter::resume() {
+  if (_waiting.empty() || _running >= _config.max_concurrency) {
+    return NULL;
+  }
+  Waiter waiter = _waiting.front();
+  _waiting.pop_front();
+  ++_running;
+  ++_stats.started;
+  TimerWheel::Msec waited = TimerWheel::clock() - waiter.since;
+  _stats.waitTotal += waited;
+  if (waited > _stats.waitMax) {
+    _stats.waitMax = waited;
+  }
+  return waiter.client;
+}
+
+size_t CgiLimiter::waiting() const {
+  return _waiting.size();
+}
+
+size_t CgiLimiter::running() const {
+  return _running;
+}
+
+const CgiLimitStats& CgiLimiter::stats() const {
+  return _stats;
+}
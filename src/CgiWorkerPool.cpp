@@ -0,0 +1,240 @@
+#include "../inc/CgiWorkerPool.hpp"
+#include "../inc/ChildReaper.hpp"
+#include <signal.h>
+#include <spawn.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+
+extern char** environ;
+
+namespace {
+
+// FastCGI アプリケーションが accept する listen ソケット (FCGI_LISTENSOCK_FILENO)
+const int FCGI_LISTENSOCK_FILENO = 0;
+
+socklen_t makeAddress(const std::string& name, struct sockaddr_un& addr) {
+  std::memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  size_t len = std::min(name.size(), sizeof(addr.sun_path));
+  std::memcpy(addr.sun_path, name.data(), len);
+  return static_cast<socklen_t>(offsetof(struct sockaddr_un, sun_path) + len);
+}
+
+}  // namespace
+
+CgiWorkerPool::CgiWorkerPool(const std::string& command,
+                             const CgiWorkerConfig& config)
+    : _command(command), _config(config), _serial(0) {
+  // min_workers は最初のリクエストより前に起動しておく
+  for (size_t i = 0; i < _config.min_workers; ++i) {
+    Worker* worker = new Worker();
+    if (!_spawn(worker)) {
+      delete worker;
+      break;
+    }
+    _workers.push_back(worker);
+  }
+}
+
+CgiWorkerPool::~CgiWorkerPool() {
+  for (size_t i = 0; i < _workers.size(); ++i) {
+    _stop(_workers[i]);
+    delete _workers[i];
+  }
+}
+
+CgiWorkerPool::Worker* CgiWorkerPool::acquire() {
+  Worker* worker = NULL;
+  for (size_t i = 0; i < _workers.size(); ++i) {
+    if (!_workers[i]->busy) {
+      worker = _workers[i];
+      break;
+    }
+  }
+  if (!worker) {
+    if (_workers.size() >= _config.max_workers) {
+      return NULL;
+    }
+    worker = new Worker();
+    if (!_spawn(worker)) {
+      delete worker;
+      return NULL;
+    }
+    _workers.push_back(worker);
+  }
+  worker->busy = true;
+  ++worker->requests;
+  ++_stats.requests;
+  return worker;
+}
+
+// Opens a connection to the worker's listening socket.
+// The socket is listening before the worker is spawned, so the connection
+// is queued even if the application has not reached accept() yet. A
+// refused connection means the process has exited (e.g. php-cgi after
+// PHP_FCGI_MAX_REQUESTS), so it is started again once.
+// returns:
+//   int: the connected non-blocking socket, or -1 with errno set.
+int CgiWorkerPool::connect(Worker* worker) {
+  for (int attempt = 0; attempt < 2; ++attempt) {
+    struct sockaddr_un addr;
+    socklen_t len = makeAddress(worker->address, addr);
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+      return -1;
+    }
+    if (::connect(fd, reinterpret_cast<struct sockaddr*>(&addr), len) == 0) {
+      return fd;
+    }
+    int err = errno;
+    close(fd);
+    if (attempt > 0 || (err != ECONNREFUSED && err != ENOENT)) {
+      errno = err;
+      return -1;
+    }
+    std::cerr << "[Warn] CGI worker " << worker->pid
+              << " is gone, restarting" << std::endl;
+    _stop(worker);
+    ++_stats.recycled;
+    if (!_spawn(worker)) {
+      return -1;
+    }
+    worker->busy = true;
+    worker->requests = 1;
+  }
+  return -1;
+}
+
+void CgiWorkerPool::release(Worker* worker, bool reusable) {
+  worker->busy = false;
+  bool spent = _config.max_requests > 0 &&
+               worker->requests >= _config.max_requests;
+  if (reusable && !spent) {
+    return;
+  }
+  // 上限に達した・応答が途中で終わったワーカーは入れ替える
+  // (途中なら前の応答の続きを書いているかもしれない)
+  ++_stats.recycled;
+  _stop(worker);
+  if (_workers.size() > _config.min_workers && _waiting.empty()) {
+    // 足りなくなったら acquire() で起動し直す
+    _workers.erase(std::find(_workers.begin(), _workers.end(), worker));
+    delete worker;
+    return;
+  }
+  if (!_spawn(worker)) {
+    _workers.erase(std::find(_workers.begin(), _workers.end(), worker));
+    delete worker;
+  }
+}
+
+void CgiWorkerPool::wait(Client* client) {
+  _waiting.push_back(client);
+  ++_stats.queued;
+}
+
+void CgiWorkerPool::cancel(Client* client) {
+  std::deque<Client*>::iterator it =
+      std::find(_waiting.begin(), _waiting.end(), client);
+  if (it != _waiting.end()) {
+    _waiting.erase(it);
+  }
+}
+
+Client* CgiWorkerPool::nextWaiting() {
+  if (_waiting.empty()) {
+    return NULL;
+  }
+  Client* client = _waiting.front();
+  _waiting.pop_front();
+  return client;
+}
+
+size_t CgiWorkerPool::waiting() const {
+  return _waiting.size();
+}
+
+size_t CgiWorkerPool::size() const {
+  return _workers.size();
+}
+
+const CgiPoolStats& CgiWorkerPool::stats() const {
+  return _stats;
+}
+
+// Starts one application process listening on a new abstract socket.
+// The process gets the listening socket as fd 0 and the server's own
+// environment; the CGI variables arrive per request as FastCGI params.
+bool CgiWorkerPool::_spawn(Worker* worker) {
+  std::ostringstream name;
+  name << '\0' << "webserv-fcgi-" << getpid() << "-" << ++_serial;
+  worker->address = name.str();
+  worker->pid = -1;
+  worker->busy = false;
+  worker->requests = 0;
+
+  int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (fd < 0) {
+    std::cerr << "[Error] CGI worker socket failed: " << strerror(errno)
+              << std::endl;
+    return false;
+  }
+  struct sockaddr_un addr;
+  socklen_t len = makeAddress(worker->address, addr);
+  if (bind(fd, reinterpret_cast<struct sockaddr*>(&addr), len) < 0 ||
+      listen(fd, SOMAXCONN) < 0) {
+    std::cerr << "[Error] CGI worker bind failed: " << strerror(errno)
+              << std::endl;
+    close(fd);
+    return false;
+  }
+
+  // fd は close-on-exec なので、fd 0 への dup2 だけでよい
+  char* argv[2];
+  argv[0] = const_cast<char*>(_command.c_str());
+  argv[1] = NULL;
+  pid_t pid = -1;
+  posix_spawn_file_actions_t actions;
+  int err = posix_spawn_file_actions_init(&actions);
+  if (err == 0) {
+    err = posix_spawn_file_actions_adddup2(&actions, fd,
+                                           FCGI_LISTENSOCK_FILENO);
+    if (err == 0) {
+      err = ChildReaper::spawn(&pid, _command.c_str(), &actions, argv,
+                               environ);
+    }
+    posix_spawn_file_actions_destroy(&actions);
+  }
+  if (err != 0) {
+    std::cerr << "[Error] CGI worker posix_spawn failed: " << _command << ": "
+              << strerror(err) << std::endl;
+    close(fd);
+    return false;
+  }
+  close(fd);  // listen ソケットはワーカーだけが持つ
+  worker->pid = pid;
+  ++_stats.spawned;
+  return true;
+}
+
+// イベントループの中では回収を ChildReaper に任せる (waitpid で止めない)
+void CgiWorkerPool::_stop(Worker* worker) {
+  if (worker->pid > 0) {
+    ChildReaper* reaper = ChildReaper::active();
+    if (reaper) {
+      reaper->terminate(worker->pid);
+    } else {
+      kill(worker->pid, SIGTERM);
+      waitpid(worker->pid, NULL, 0);
+    }
+    worker->pid = -1;
+  }
+}
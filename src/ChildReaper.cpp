@@ -0,0 +1,221 @@
+#include "../inc/ChildReaper.hpp"
+#include <sys/signalfd.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+
+ChildReaper* ChildReaper::_active = NULL;
+ReaperStats ChildReaper::_stats;
+
+// Blocks SIGCHLD and opens a signalfd for it.
+// Without a signalfd the reaper still works through expire(): children are
+// then only reaped when their timers run out, which keeps the loop
+// non-blocking at the cost of zombies living a little longer.
+ChildReaper::ChildReaper(TimerWheel::Msec exitWaitMs,
+                         TimerWheel::Msec killGraceMs)
+    : _fd(-1),
+      _timers(TimerWheel::clock()),
+      _exitWaitMs(exitWaitMs),
+      _killGraceMs(killGraceMs) {
+  sigset_t mask;
+  sigemptyset(&mask);
+  sigaddset(&mask, SIGCHLD);
+  sigprocmask(SIG_BLOCK, &mask, &_savedMask);
+  _fd = signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC);
+  if (_fd < 0) {
+    std::cerr << "[Warn] signalfd failed (" << strerror(errno)
+              << "): CGI children are reaped on timers only" << std::endl;
+  }
+  _active = this;
+}
+
+// 終了処理中なので待ってよい (ワーカーのイベントループは止まっている)
+ChildReaper::~ChildReaper() {
+  for (std::map<pid_t, Child*>::iterator it = _children.begin();
+       it != _children.end(); ++it) {
+    kill(it->first, SIGKILL);
+    waitpid(it->first, NULL, 0);
+    _timers.cancel(&it->second->timer);
+    delete it->second;
+  }
+  _children.clear();
+  if (_fd >= 0) {
+    close(_fd);
+  }
+  sigprocmask(SIG_SETMASK, &_savedMask, NULL);
+  if (_active == this) {
+    _active = NULL;
+  }
+}
+
+ChildReaper* ChildReaper::active() {
+  return _active;
+}
+
+const ReaperStats& ChildReaper::stats() {
+  return _stats;
+}
+
+// Starts path with posix_spawn(3), giving the child the signal mask without
+// SIGCHLD blocked (a CGI that runs its own children needs it).
+// returns:
+//   int: 0 on success, or the error number from posix_spawn.
+int ChildReaper::spawn(pid_t* pid, const char* path,
+                       const posix_spawn_file_actions_t* actions, char** argv,
+                       char** envp) {
+  sigset_t mask;
+  sigprocmask(SIG_BLOCK, NULL, &mask);
+  sigdelset(&mask, SIGCHLD);
+  posix_spawnattr_t attr;
+  int err = posix_spawnattr_init(&attr);
+  if (err != 0) {
+    return err;
+  }
+  err = posix_spawnattr_setsigmask(&attr, &mask);
+  if (err == 0) {
+    err = posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETSIGMASK);
+  }
+  if (err == 0) {
+    err = posix_spawn(pid, path, actions, &attr, argv, envp);
+  }
+  posix_spawnattr_destroy(&attr);
+  return err;
+}
+
+int ChildReaper::getFd() const {
+  return _fd;
+}
+
+void ChildReaper::watch(pid_t pid, Client* client) {
+  Child* child = new Child();
+  child->timer.owner = child;
+  child->pid = pid;
+  child->client = client;
+  child->killed = false;
+  _children[pid] = child;
+  _timers.setNow(TimerWheel::clock());
+  _timers.arm(&child->timer, _exitWaitMs);
+}
+
+void ChildReaper::terminate(pid_t pid) {
+  std::map<pid_t, Child*>::iterator it = _children.find(pid);
+  if (it != _children.end()) {
+    // 終了を待っていた Client はもう結果を必要としない
+    it->second->client = NULL;
+    if (waitpid(pid, NULL, WNOHANG) == pid) {
+      ++_stats.reaped;
+      _remove(it->second);
+    } else {
+      _terminate(it->second);
+    }
+    return;
+  }
+  pid_t ret = waitpid(pid, NULL, WNOHANG);
+  if (ret != 0) {
+    if (ret == pid) {
+      ++_stats.reaped;  // 終了済み (-1 なら回収済み)
+    }
+    return;
+  }
+  Child* child = new Child();
+  child->timer.owner = child;
+  child->pid = pid;
+  child->client = NULL;
+  child->killed = false;
+  _children[pid] = child;
+  _terminate(child);
+}
+
+// Drains the signalfd and reaps the watched children that have exited.
+// SIGCHLD is not queued per child, so every watched pid is polled with
+// WNOHANG; the list only holds CGIs that are exiting, so it stays short.
+void ChildReaper::processEvents(std::vector<Exit>& exits) {
+  // 通知は読み捨てる (どの子が終わったかは waitpid で調べる)
+  struct signalfd_siginfo info;
+  while (_fd >= 0 && read(_fd, &info, sizeof(info)) > 0) {
+    continue;
+  }
+  std::map<pid_t, Child*>::iterator it = _children.begin();
+  while (it != _children.end()) {
+    Child* child = it->second;
+    ++it;  // _remove() で消えても進めるように先に進める
+    int status = 0;
+    pid_t ret = waitpid(child->pid, &status, WNOHANG);
+    if (ret == 0 || (ret < 0 && errno == EINTR)) {
+      continue;
+    }
+    ++_stats.reaped;
+    if (child->client) {
+      Exit exit;
+      exit.client = child->client;
+      exit.status = (ret == child->pid) ? status : -1;
+      exits.push_back(exit);
+    }
+    _remove(child);
+  }
+}
+
+void ChildReaper::expire(TimerWheel::Msec nowMs, std::vector<Exit>& exits) {
+  _timers.setNow(nowMs);
+  std::vector<TimerWheel::Timer*> expired;
+  _timers.expire(expired);
+  for (size_t i = 0; i < expired.size(); ++i) {
+    Child* child = static_cast<Child*>(expired[i]->owner);
+    int status = 0;
+    pid_t ret = waitpid(child->pid, &status, WNOHANG);
+    if (ret != 0) {
+      // signalfd より先に期限が来た (signalfd がなければ常にここ)
+      ++_stats.reaped;
+      if (child->client) {
+        Exit exit;
+        exit.client = child->client;
+        exit.status = (ret == child->pid) ? status : -1;
+        exits.push_back(exit);
+      }
+      _remove(child);
+    } else if (child->client) {
+      // stdout を閉じたのに終わらない → 応答は完了させ、止めるのは後で
+      std::cerr << "[Warn] CGI still running after its output ended: pid="
+                << child->pid << std::endl;
+      Exit exit;
+      exit.client = child->client;
+      exit.status = -1;
+      exits.push_back(exit);
+      child->client = NULL;
+      _terminate(child);
+    } else if (!child->killed) {
+      std::cerr << "[Warn] child ignored SIGTERM, killing: pid=" << child->pid
+                << std::endl;
+      kill(child->pid, SIGKILL);
+      child->killed = true;
+      ++_stats.killed;
+      // SIGKILL は無視できないので、回収は SIGCHLD を待つ
+      _timers.arm(&child->timer, _killGraceMs);
+    } else {
+      _timers.arm(&child->timer, _killGraceMs);
+    }
+  }
+}
+
+int ChildReaper::nextTimeout() const {
+  return _timers.nextTimeout();
+}
+
+size_t ChildReaper::size() const {
+  return _children.size();
+}
+
+void ChildReaper::_terminate(Child* child) {
+  kill(child->pid, SIGTERM);
+  ++_stats.terminated;
+  _timers.setNow(TimerWheel::clock());
+  _timers.arm(&child->timer, _killGraceMs);
+}
+
+void ChildReaper::_remove(Child* child) {
+  _timers.cancel(&child->timer);
+  _children.erase(child->pid);
+  delete child;
+}
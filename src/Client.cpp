@@ -12,14 +12,21 @@
 /* ************************************************************************** */
 
 #include "../inc/Client.hpp"
+#include <fcntl.h>
+#include <spawn.h>
 #include <sys/epoll.h>
+#include <sys/ioctl.h>
 #include <sys/wait.h>
+#include <cerrno>
 #include <csignal>
+#include <algorithm>
 #include <cstring>
 #include <ctime>
 #include <iostream>
+#include "../inc/ChildReaper.hpp"
 #include "../inc/EpollContext.hpp"
 #include "../inc/EpollUtils.hpp"
+#include "../inc/FastCgi.hpp"
 
 namespace {
 
@@ -57,11 +64,11 @@ char** createCgiEnv(const Client& client, const std::string& realPath) {
   const HttpRequest& req = client.req;
   std::map<std::string, std::string> env;
 
-  std::string contentLength = req.getHeader("Content-Length");
+  const std::string& contentLength = req.getHeader(HDR_CONTENT_LENGTH);
   if (!contentLength.empty()) {
     env["CONTENT_LENGTH"] = contentLength;
   }
-  std::string contentType = req.getHeader("Content-Type");
+  const std::string& contentType = req.getHeader(HDR_CONTENT_TYPE);
   if (!contentType.empty()) {
     env["CONTENT_TYPE"] = contentType;
   }
@@ -97,7 +104,7 @@ char** createCgiEnv(const Client& client, const std::string& realPath) {
   env["SCRIPT_NAME"] = req.getPath();
   env["SCRIPT_FILENAME"] = realPath;
 
-  std::string serverName = req.getHeader("Host");
+  std::string serverName = req.getHeader(HDR_HOST);
   if (serverName.empty()) {
     serverName = client.getIp();
   } else {
@@ -110,13 +117,12 @@ char** createCgiEnv(const Client& client, const std::string& realPath) {
   env["SERVER_PROTOCOL"] = "HTTP/1.1";
   env["SERVER_SOFTWARE"] = "webserv/1.0";
 
-  const std::map<std::string, std::string>& headers = req.getHeaders();
-  for (std::map<std::string, std::string>::const_iterator it = headers.begin();
-       it != headers.end(); ++it) {
-    std::string key = toEnvKey(it->first);
+  const HeaderTable& headers = req.getHeaders();
+  for (size_t i = 0; i < headers.size(); ++i) {
+    std::string key = toEnvKey(headers.nameAt(i));
     if (key == "CONTENT_LENGTH" || key == "CONTENT_TYPE")
       continue;
-    env["HTTP_" + key] = it->second;
+    env["HTTP_" + key] = headers.valueAt(i);
   }
 
   char** envp = NULL;
@@ -167,21 +173,52 @@ bool setNonBlocking(int fd) {
   return true;
 }
 
-bool setCloseOnExec(int fd) {
-  if (fd < 0)
-    return false;
+// ストリーミング中にボディのパースに失敗した時の応答
+int bodyErrorStatus(ErrorCode err) {
+  switch (err) {
+    case ERR_BODY_TOO_LARGE:
+      return 413;  // Payload Too Large
+    case ERR_BODY_STORAGE:
+      return 500;  // Internal Server Error
+    default:
+      return 400;  // Bad Request
+  }
+}
 
-  int flags = fcntl(fd, F_GETFD);
-  if (flags == -1)
-    return false;
+// CGI 出力のヘッダーを終える空行を from 以降で探す
+// 戻り値はボディの先頭位置 (見つからなければ npos)
+size_t findCgiHeaderEnd(const std::string& output, size_t from) {
+  if (from == 0) {
+    // ヘッダーが1行もない
+    if (output.compare(0, 1, "\n") == 0)
+      return 1;
+    if (output.compare(0, 2, "\r\n") == 0)
+      return 2;
+  }
+  size_t pos = from;
+  while ((pos = output.find('\n', pos)) != std::string::npos) {
+    size_t next = pos + 1;
+    if (next < output.size() && output[next] == '\r')
+      ++next;
+    if (next < output.size() && output[next] == '\n')
+      return next + 1;
+    pos += 1;
+  }
+  return std::string::npos;
+}
 
-  if (fcntl(fd, F_SETFD, flags | FD_CLOEXEC) == -1)
-    return false;
-  return true;
+// Returns true when fd has bytes waiting to be read.
+// splice(2) with SPLICE_F_NONBLOCK fails with EAGAIN when either end would
+// block, so this tells a full destination from an empty source.
+bool hasReadableBytes(int fd) {
+  int n = 0;
+  return ioctl(fd, FIONREAD, &n) == 0 && n > 0;
 }
 
 }  // namespace
 
+SpliceStats Client::_spliceStats;
+
 // ========================================
 // コンストラクタ / デストラクタ
 // ========================================
@@ -193,18 +230,55 @@ Client::Client(int fd, int port, const std::string& ip, EpollUtils* epoll)
       _epoll(epoll),
       _context(NULL),
       _state(READING_REQUEST),
-      _lastActivity(std::time(NULL)),
+      _timers(NULL),
+      _timeouts(NULL),
+      _timer(),
+      _timerPhase(TIMEOUT_NONE),
       _cgi_pid(-1),
       _cgi_stdout_fd(-1),
       _cgi_stdin_fd(-1),
+      _cgi_stdout_ctx(NULL),
+      _cgi_stdin_ctx(NULL),
+      _cgi_stdout_events(0),
+      _cgi_stdin_events(0),
       _cgi_output(),
-      _cgi_stdin_offset(0) {}
+      _cgi_stdin_offset(0),
+      _cgi_pool(NULL),
+      _cgi_worker(NULL),
+      _fcgi(NULL),
+      _cgi_script(),
+      _cgi_limiter(NULL),
+      _cgi_queued(false),
+      _cgi_exec(),
+      _cgi_stdin_full(false),
+      _cgi_splice_full(false),
+      _pipeline(),
+      _keepAlive(true),
+      _inputClosed(false),
+      _events(EPOLLIN) {
+  BufferPool::acquire(_cgi_output);
+}
 
 Client::~Client() {
-  _cleanupCgi();
-  if (_fd >= 0) {
-    close(_fd);
-  }
+  closeConnection();
+  BufferPool::release(_cgi_output);
+}
+
+// ========================================
+// メモリプール
+// ========================================
+
+SlabPool& Client::pool() {
+  static SlabPool pool(sizeof(Client), 64);
+  return pool;
+}
+
+void* Client::operator new(size_t size) {
+  return pool().allocate(size);
+}
+
+void Client::operator delete(void* ptr, size_t size) {
+  pool().deallocate(ptr, size);
 }
 
 // ========================================
@@ -239,12 +313,23 @@ void Client::setState(ConnState newState) {
 // タイムアウト管理
 // ========================================
 
+void Client::setTimers(TimerWheel* timers, const TimeoutConfig* timeouts) {
+  if (_timers) {
+    _timers->cancel(&_timer);
+  }
+  _timers = timers;
+  _timeouts = timeouts;
+  _timer.owner = this;
+  _timerPhase = TIMEOUT_NONE;
+  _armTimer();
+}
+
 void Client::updateTimestamp() {
-  _lastActivity = std::time(NULL);
+  _armTimer();
 }
 
-bool Client::isTimedOut(time_t timeout_sec) const {
-  return (std::time(NULL) - _lastActivity) > timeout_sec;
+TimeoutPhase Client::getTimeoutPhase() const {
+  return _timerPhase;
 }
 
 // ========================================
@@ -253,59 +338,234 @@ bool Client::isTimedOut(time_t timeout_sec) const {
 
 void Client::readyToWrite() {
   _state = WRITING_RESPONSE;
-  if (_epoll && _context) {
-    _epoll->mod(_fd, _context, EPOLLOUT);
-  }
+  // 実ソケットに紐付いている場合のみファイルボディを sendfile(2) で送る
+  res.setSendfile(_epoll != NULL);
+  _armTimer();
+  _updateEvents();
 }
 
+// 最初のバイトを受信するまでは WAIT_REQUEST (keepalive_timeout を適用)
 void Client::readyToRead() {
-  _state = READING_REQUEST;
+  _state = WAIT_REQUEST;
   req.clear();
   res.clear();
-  if (_epoll && _context) {
-    _epoll->mod(_fd, _context, EPOLLIN);
-  }
+  _armTimer();
+  _updateEvents();
 }
 
 void Client::readyToCgiWrite() {
   _state = WAITING_CGI_INPUT;
-  if (_epoll && _cgi_stdin_fd != -1) {
+  _armTimer();
+  _updateEvents();
+  if (_epoll && _cgi_stdin_fd != -1 && !_cgi_stdin_ctx) {
     // CGI stdin 用の Context を作成
-    EpollContext* ctx =
-        EpollContext::createCgiPipe(this, EpollContext::CGI_STDIN);
-    _epoll->add(_cgi_stdin_fd, ctx, EPOLLOUT);
+    _cgi_stdin_ctx = EpollContext::createCgiPipe(this, EpollContext::CGI_STDIN);
+    _watchCgiPipe(_cgi_stdin_fd, _cgi_stdin_ctx, _cgi_stdin_events, EPOLLOUT);
   }
 }
 
 void Client::readyToCgiRead() {
-  _state = READING_CGI_OUTPUT;
+  // 出力のストリーミングが先に始まっていれば応答中のまま
+  if (_state != WRITING_RESPONSE) {
+    _state = READING_CGI_OUTPUT;
+  }
+  _closeCgiStdin();
+  _armTimer();
+  _updateEvents();
+}
 
-  if (_cgi_stdin_fd != -1) {
-    if (_epoll)
-      _epoll->del(_cgi_stdin_fd);
-    close(_cgi_stdin_fd);
-    _cgi_stdin_fd = -1;
+// Writes the part of the request body received so far to the CGI stdin pipe.
+// The body may still be arriving from the socket; stdin is closed (EOF for
+// the script) only after the whole body has been written.
+void Client::writeCgiInput() {
+  if (_cgi_stdin_fd == -1) {
+    return;
+  }
+  BodySink& body = req.getBody();
+  if (_fcgi) {
+    // ワーカーへはレコードに包んで送る (入力の終わりは空の STDIN レコード)
+    if (!_fcgi->writeInput(_cgi_stdin_fd, body, _cgi_stdin_offset,
+                           req.isComplete())) {
+      std::cerr << "CGI write error: " << strerror(errno) << std::endl;
+      body.discard(body.size());
+      readyToCgiRead();
+      return;
+    }
+    body.discard(_cgi_stdin_offset);
+    if (_fcgi->isInputDone()) {
+      readyToCgiRead();
+      return;
+    }
+  } else if (_cgi_stdin_offset < body.size()) {
+    ssize_t written = body.writeTo(_cgi_stdin_fd, _cgi_stdin_offset,
+                                   body.size() - _cgi_stdin_offset);
+    if (written < 0) {
+      if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) {
+        return;  // 次の EPOLLOUT を待つ
+      }
+      // スクリプトが stdin を読まずに閉じた → 残りのボディは捨てて出力を待つ
+      std::cerr << "CGI write error: " << strerror(errno) << std::endl;
+      body.discard(body.size());
+      readyToCgiRead();
+      return;
+    }
+    _cgi_stdin_offset += static_cast<size_t>(written);
+    // CGI に渡し終えた分はもう要らない
+    body.discard(_cgi_stdin_offset);
   }
 
-  if (_epoll && _cgi_stdout_fd != -1) {
-    // CGI stdout 用の Context を作成
-    EpollContext* ctx =
-        EpollContext::createCgiPipe(this, EpollContext::CGI_STDOUT);
-    _epoll->add(_cgi_stdout_fd, ctx, EPOLLIN);
+  if (!_fcgi && _cgi_stdin_offset >= body.size() && req.isComplete()) {
+    readyToCgiRead();  // 全て書き込み完了 → パイプを閉じる
+    return;
   }
+  _updateCgiStdin();
+  _updateEvents();  // 溜まっていたボディが減ったら受信を再開する
 }
 
+// Only once everything received through the parser has been written, so the
+// spliced bytes follow it in order. A spilled body keeps the buffered path.
+bool Client::isSplicingCgiInput() const {
+  if (!_epoll || _fcgi || _cgi_stdin_fd == -1 || _inputClosed ||
+      !_isStreamingBody()) {
+    return false;
+  }
+  const BodySink& body = req.getBody();
+  return req.getSpliceableBody() > 0 && _cgi_stdin_offset == body.size() &&
+         !body.isSpilled();
+}
+
+// Moves the rest of a Content-Length body from the socket straight into the
+// CGI stdin pipe with splice(2), so it is never copied into the server.
+// When the pipe is full, reading the socket stops until the pipe drains.
+// This also runs from CGI_STDIN events, so a socket error is handled like a
+// closed connection: the CGI is stopped and the socket is closed later from
+// its own event, never in the middle of the epoll_wait batch.
+void Client::spliceCgiInput() {
+  size_t len = std::min(req.getSpliceableBody(),
+                        static_cast<size_t>(CGI_SPLICE_CHUNK));
+  ssize_t n = splice(_fd, NULL, _cgi_stdin_fd, NULL, len,
+                     SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+  if (n > 0) {
+    _cgi_stdin_full = false;
+    _spliceStats.toCgi += static_cast<unsigned long>(n);
+    req.skipBody(static_cast<size_t>(n));
+    _cgi_stdin_offset += static_cast<size_t>(n);
+    _armTimer();  // ボディ受信中は期限を延長する
+    if (req.isComplete()) {
+      readyToCgiRead();  // 全て渡し終えた → パイプを閉じる
+      return;
+    }
+  } else if (n == 0) {
+    closeInput();  // ボディの途中で切られた
+    return;
+  } else if (errno == EAGAIN) {
+    // 読めるデータが残っていれば、詰まっているのはパイプの方
+    _cgi_stdin_full = hasReadableBytes(_fd);
+  } else if (errno == EPIPE) {
+    // スクリプトが stdin を読まずに閉じた → 残りのボディは受信して捨てる
+    std::cerr << "CGI write error: " << strerror(errno) << std::endl;
+    readyToCgiRead();
+    return;
+  } else if (errno != EINTR) {
+    // 受信できない → 続きは届かないので、切断された時と同じく CGI を止める
+    std::cerr << "splice() error: " << strerror(errno) << std::endl;
+    closeInput();
+    return;
+  }
+  _updateCgiStdin();
+  _updateEvents();
+}
+
+bool Client::isSplicingCgiOutput() const {
+  return _cgi_stdout_fd != -1 && !_fcgi && res.isSplicePending();
+}
+
+// Moves the CGI output for a Content-Length body from the stdout pipe
+// straight to the socket with splice(2). The headers and the body bytes
+// read along with them have already been sent through the buffered path.
+// When the socket is full, reading the pipe stops until EPOLLOUT.
+// On a socket error the response is aborted; the socket event then sees the
+// error and closes the connection.
+void Client::spliceCgiOutput() {
+  size_t len = std::min(res.getSpliceRemaining(),
+                        static_cast<size_t>(CGI_SPLICE_CHUNK));
+  ssize_t n = splice(_cgi_stdout_fd, NULL, _fd, NULL, len,
+                     SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+  if (n > 0) {
+    _cgi_splice_full = false;
+    _spliceStats.fromCgi += static_cast<unsigned long>(n);
+    res.advanceSplice(static_cast<size_t>(n));
+    _armTimer();  // 送信できたので send_timeout を延長する
+  } else if (n == 0) {
+    finishCgi();  // EOF (Content-Length に足りなければ打ち切られる)
+    return;
+  } else if (errno == EAGAIN) {
+    // 読めるデータが残っていれば、詰まっているのはソケットの方
+    _cgi_splice_full = hasReadableBytes(_cgi_stdout_fd);
+  } else if (errno != EINTR) {
+    std::cerr << "splice() error: " << strerror(errno) << std::endl;
+    abortCgi(502);  // 送信中の応答を打ち切る (EPOLLOUT で接続を閉じる)
+    return;
+  }
+  _updateCgiStdout();
+  _updateEvents();
+}
+
+const SpliceStats& Client::spliceStats() {
+  return _spliceStats;
+}
+
+// Starts the CGI, first taking a slot from limiter when the location has
+// cgi_max_concurrency. Without a free slot the request waits in the
+// limiter's queue instead of spawning; cgi_queue_timeout bounds the wait.
+// returns:
+//   int: 0 when started or queued, 503 when the queue is full, or another
+//        HTTP status code on failure.
 int Client::startCgi(const std::string& scriptPath,
-                     const std::string& execPath) {
+                     const std::string& execPath, CgiLimiter* limiter) {
+  if (!limiter) {
+    return _spawnCgi(scriptPath, execPath);
+  }
+  _cgi_limiter = limiter;
+  if (!limiter->acquire()) {
+    if (!limiter->wait(this)) {
+      _cgi_limiter = NULL;
+      return 503;  // Service Unavailable (待ち行列も満杯)
+    }
+    _cgi_queued = true;
+    _cgi_script = scriptPath;
+    _cgi_exec = execPath;
+    _state = WAITING_CGI_INPUT;
+    _armTimer();
+    _updateEvents();
+    return (0);
+  }
+  int status = _spawnCgi(scriptPath, execPath);
+  if (status != 0) {
+    _cgi_limiter = NULL;
+    limiter->release();
+    _resumeCgiQueue(limiter);
+  }
+  return status;
+}
+
+// Starts the CGI with posix_spawn(3) and connects its stdin/stdout pipes.
+// Unlike fork(), posix_spawn does not copy the server's page tables (glibc
+// uses CLONE_VM | CLONE_VFORK), so the cost stays flat as caches grow.
+// returns:
+//   int: 0 when started, or an HTTP status code on failure.
+int Client::_spawnCgi(const std::string& scriptPath,
+                      const std::string& execPath) {
   int pipe_in[2];
   int pipe_out[2];
 
-  if (pipe(pipe_in) < 0) {
+  // close-on-exec は作成と同時に付ける (他の CGI の起動に漏れないように)
+  if (pipe2(pipe_in, O_CLOEXEC) < 0) {
     std::cerr << "[Error] pipe creation failed: " << strerror(errno)
               << std::endl;
     return 500;  // internal server error
   }
-  if (pipe(pipe_out) < 0) {
+  if (pipe2(pipe_out, O_CLOEXEC) < 0) {
     close(pipe_in[0]);
     close(pipe_in[1]);
     std::cerr << "[Error] pipe creation failed: " << strerror(errno)
@@ -313,67 +573,48 @@ int Client::startCgi(const std::string& scriptPath,
     return 500;  // internal server error
   }
 
-  setCloseOnExec(pipe_in[0]);
-  setCloseOnExec(pipe_in[1]);
-  setCloseOnExec(pipe_out[0]);
-  setCloseOnExec(pipe_out[1]);
-
-  _cgi_pid = fork();
-  if (_cgi_pid < 0) {
-    std::cerr << "[Error] fork failed: " << strerror(errno) << std::endl;
+  // 環境変数と argv は親で用意する (子では何も確保しない)
+  char** env = createCgiEnv(*this, scriptPath);
+  if (!env) {
+    std::cerr << "[Error] Failed to create CGI environment" << std::endl;
     close(pipe_in[0]);
     close(pipe_in[1]);
     close(pipe_out[0]);
     close(pipe_out[1]);
     return 500;  // internal server error
   }
-
-  if (_cgi_pid == 0) {
-    close(_fd);
-    if (dup2(pipe_in[0], STDIN_FILENO) < 0) {
-      std::cerr << "[Error] dup2 stdin failed: " << strerror(errno)
-                << std::endl;
-      close(pipe_in[0]);
-      close(pipe_in[1]);
-      close(pipe_out[0]);
-      close(pipe_out[1]);
-      exit(1);
+  const std::string& program = execPath.empty() ? scriptPath : execPath;
+  char* argv[3];
+  argv[0] = const_cast<char*>(program.c_str());
+  argv[1] = execPath.empty() ? NULL : const_cast<char*>(scriptPath.c_str());
+  argv[2] = NULL;
+
+  // パイプは close-on-exec なので、stdin/stdout への dup2 だけでよい
+  posix_spawn_file_actions_t actions;
+  int err = posix_spawn_file_actions_init(&actions);
+  if (err == 0) {
+    err = posix_spawn_file_actions_adddup2(&actions, pipe_in[0], STDIN_FILENO);
+    if (err == 0) {
+      err = posix_spawn_file_actions_adddup2(&actions, pipe_out[1],
+                                             STDOUT_FILENO);
     }
-    if (dup2(pipe_out[1], STDOUT_FILENO) < 0) {
-      std::cerr << "[Error] dup2 stdout failed: " << strerror(errno)
-                << std::endl;
-      close(pipe_in[0]);
-      close(pipe_in[1]);
-      close(pipe_out[0]);
-      close(pipe_out[1]);
-      exit(1);
+    if (err == 0) {
+      err = ChildReaper::spawn(&_cgi_pid, program.c_str(), &actions, argv,
+                               env);
     }
+    posix_spawn_file_actions_destroy(&actions);
+  }
+  freeCgiEnv(env);
+  if (err != 0) {
+    std::cerr << "[Error] posix_spawn failed: " << program << ": "
+              << strerror(err) << std::endl;
+    _cgi_pid = -1;
     close(pipe_in[0]);
     close(pipe_in[1]);
     close(pipe_out[0]);
     close(pipe_out[1]);
-
-    char** env = createCgiEnv(*this, scriptPath);
-    if (!env) {
-      std::cerr << "[Error] Failed to create CGI environment" << std::endl;
-      exit(1);
-    }
-
-    char* argv[3];
-    if (!execPath.empty()) {
-      argv[0] = const_cast<char*>(execPath.c_str());
-      argv[1] = const_cast<char*>(scriptPath.c_str());
-      argv[2] = NULL;
-      execve(execPath.c_str(), argv, env);
-    } else {
-      argv[0] = const_cast<char*>(scriptPath.c_str());
-      argv[1] = NULL;
-      execve(scriptPath.c_str(), argv, env);
-    }
-
-    std::cerr << "[Error] execve failed: " << strerror(errno) << std::endl;
-    freeCgiEnv(env);
-    exit(1);
+    // 資源不足は 500、起動できないインタプリタ (ENOENT など) は 502
+    return (err == EAGAIN || err == ENOMEM) ? 500 : 502;
   }
 
   close(pipe_in[0]);
@@ -392,6 +633,8 @@ int Client::startCgi(const std::string& scriptPath,
   _cgi_stdin_offset = 0;
   _cgi_output.clear();
 
+  _watchCgiStdout();
+
   if (req.getMethod() == POST) {
     readyToCgiWrite();
   } else {
@@ -402,10 +645,73 @@ int Client::startCgi(const std::string& scriptPath,
   return (0);
 }
 
+// Runs the CGI on a persistent worker from pool instead of spawning one.
+// When every worker is busy the request waits in the pool's queue; the
+// cgi_timeout covers the wait as well, so a stuck pool ends in 504.
+// returns:
+//   int: 0 when started or queued, or an HTTP status code on failure.
+int Client::startFastCgi(CgiWorkerPool* pool, const std::string& scriptPath) {
+  _cgi_pool = pool;
+  _cgi_script = scriptPath;
+  CgiWorkerPool::Worker* worker = pool->acquire();
+  if (worker) {
+    return _connectCgiWorker(worker);
+  }
+  if (pool->size() == 0) {
+    _cgi_pool = NULL;
+    return 502;  // Bad Gateway (ワーカーを起動できない)
+  }
+  pool->wait(this);
+  _state = WAITING_CGI_INPUT;
+  _armTimer();
+  _updateEvents();
+  return (0);
+}
+
+// Called when the CGI output has ended (stdout EOF or FastCGI END_REQUEST).
+// A spawned CGI usually exits right after closing stdout; its exit status
+// decides how the response ends, so when it has not exited yet the
+// response is completed later from onCgiExit(). Outside the event loop
+// (no ChildReaper) it is stopped and reaped on the spot as before.
 void Client::finishCgi() {
-  res.parseCgiResponse(_cgi_output);
-  res.build();  // レスポンスバッファを構築
+  _closeCgiStdout();
+  int status = -1;
+  if (_cgi_pid > 0) {
+    pid_t ret = waitpid(_cgi_pid, &status, WNOHANG);
+    ChildReaper* reaper = ChildReaper::active();
+    if (ret == 0 && reaper) {
+      reaper->watch(_cgi_pid, this);
+      return;
+    }
+    if (ret == _cgi_pid) {
+      _cgi_pid = -1;
+    } else {
+      status = -1;  // 実行中 (_cleanupCgi で止める) か回収済み
+    }
+  }
+  _completeCgi(status);
+}
+
+void Client::onCgiExit(int status) {
+  if (_cgi_pid <= 0) {
+    return;  // 終了を受け取った後、同じ周回の中で CGI を打ち切り済み
+  }
+  _cgi_pid = -1;  // 回収済み (または ChildReaper が止める)
+  _completeCgi(status);
+}
+
+void Client::abortCgi(int statusCode) {
+  if (res.isStreaming()) {
+    // 応答の途中なのでエラー応答は返せない → 打ち切って接続を閉じる
+    _cleanupCgi();
+    _keepAlive = false;
+    res.abortStream();
+    _updateEvents();
+    return;
+  }
   _cleanupCgi();
+  res.makeErrorResponse(statusCode, req.getConfig());
+  res.build();
   readyToWrite();
 }
 
@@ -413,6 +719,23 @@ void Client::markClose() {
   _state = CLOSE_CONNECTION;
 }
 
+// Releases everything through which an event could still reach this client
+// (the socket, the timer, the CGI pipes and children), so that the object
+// can outlive the connection until the end of the epoll_wait batch.
+void Client::closeConnection() {
+  if (_timers) {
+    _timers->cancel(&_timer);
+  }
+  _cleanupCgi();
+  _clearPipeline();
+  if (_fd >= 0) {
+    close(_fd);
+    _fd = -1;
+  }
+  _context = NULL;
+  _state = CLOSE_CONNECTION;
+}
+
 // ========================================
 // CGI 情報アクセサ
 // ========================================
@@ -429,8 +752,52 @@ int Client::getCgiStdinFd() const {
   return _cgi_stdin_fd;
 }
 
+// Takes output read from the CGI stdout pipe.
+// Until the header block (up to the empty line) is complete the output is
+// buffered; then the response headers are sent and every later byte is
+// relayed to the client as it arrives.
 void Client::appendCgiOutput(const char* buf, size_t len) {
+  if (_fcgi) {
+    // FastCGI のレコードを解き、STDOUT の中身だけを応答へ回す
+    std::string out;
+    if (!_fcgi->read(buf, len, out)) {
+      abortCgi(502);  // Bad Gateway
+      return;
+    }
+    if (!out.empty()) {
+      _relayCgiOutput(out.data(), out.size());
+    }
+    return;
+  }
+  _relayCgiOutput(buf, len);
+}
+
+bool Client::isCgiDone() const {
+  return _fcgi && _fcgi->isEnded();
+}
+
+void Client::_relayCgiOutput(const char* buf, size_t len) {
+  if (res.isStreaming()) {
+    res.appendStream(buf, len);
+    _updateCgiStdout();
+    _updateEvents();
+    return;
+  }
+  size_t scanFrom = _cgi_output.size() < 2 ? 0 : _cgi_output.size() - 2;
   _cgi_output.append(buf, len);
+  size_t bodyStart = findCgiHeaderEnd(_cgi_output, scanFrom);
+  if (bodyStart == std::string::npos) {
+    if (_cgi_output.size() > MAX_HEADER_SIZE) {
+      abortCgi(502);  // Bad Gateway (ヘッダーが終わらない)
+    }
+    return;
+  }
+  _startCgiResponse(bodyStart);
+}
+
+void Client::afterSend() {
+  _updateCgiStdout();  // 送信で空いた分だけ CGI の出力を読む
+  _updateEvents();
 }
 
 const std::string& Client::getCgiOutput() const {
@@ -479,34 +846,499 @@ void Client::reset() {
   res.clear();
   _cleanupCgi();
   _state = WAIT_REQUEST;
-  updateTimestamp();
+  _armTimer();
+}
+
+// ========================================
+// パイプライン (HTTP/1.1)
+// ========================================
+
+void Client::readAhead(const char* data, size_t len) {
+  // ボディの途中で処理を始めた req (CGI) なら、これはその続き
+  bool streaming = _isStreamingBody();
+  HttpRequest& tail = _pipelineTail();
+  // パースエラー以降はリクエストの区切りが分からないので捨てる
+  if (len > 0 && !tail.hasError()) {
+    tail.feed(data, len);
+  }
+  if (streaming) {
+    _onBodyData();
+  }
+  _fillPipeline();
+  _updateEvents();
+}
+
+bool Client::nextRequest() {
+  res.clear();
+  _cleanupCgi();
+  if (_isStreamingBody()) {
+    return false;  // ボディの残りと次のリクエストの区切りが分からない
+  }
+  if (_pipeline.empty()) {
+    if (_inputClosed) {
+      return false;
+    }
+    readyToRead();
+    return true;
+  }
+
+  HttpRequest* next = _pipeline.front();
+  _pipeline.pop_front();
+  req.swap(*next);
+  delete next;
+  // キューが埋まっていた間に溜まったデータを切り出す
+  _fillPipeline();
+
+  if (req.isComplete() || req.hasError()) {
+    _state = PROCESSING;
+    return true;
+  }
+  if (_inputClosed) {
+    return false;  // 続きはもう届かない
+  }
+  _state = READING_REQUEST;
+  _armTimer();
+  _updateEvents();
+  return true;
+}
+
+size_t Client::getPipelineDepth() const {
+  return _pipeline.size();
+}
+
+void Client::setKeepAlive(bool keepAlive) {
+  _keepAlive = keepAlive;
+}
+
+bool Client::isKeepAlive() const {
+  return _keepAlive;
+}
+
+void Client::closeInput() {
+  _inputClosed = true;
+  if (_isStreamingBody()) {
+    // ボディの途中で切られた → 続きは届かないので CGI を止める
+    _keepAlive = false;
+    if (_isCgiRunning()) {
+      abortCgi(400);
+      return;
+    }
+  }
+  _updateEvents();
 }
 
 // ========================================
 // プライベートヘルパー
 // ========================================
 
+// 受信データを追加する先 (先読みキューが空なら処理中の req)
+HttpRequest& Client::_pipelineTail() {
+  return _pipeline.empty() ? req : *_pipeline.back();
+}
+
+// 完了したリクエストの後ろに残っているデータを次のリクエストとして切り出す
+// 1回の受信に複数のリクエストが含まれることがあるので、完了する限り繰り返す
+void Client::_fillPipeline() {
+  HttpRequest* tail = &_pipelineTail();
+  while (tail->isComplete() && tail->getUnparsedSize() > 0 &&
+         _pipeline.size() < PIPELINE_MAX_DEPTH) {
+    HttpRequest* next = new HttpRequest();
+    tail->moveUnparsedTo(*next);
+    _pipeline.push_back(next);
+    tail = next;
+  }
+}
+
+void Client::_clearPipeline() {
+  while (!_pipeline.empty()) {
+    delete _pipeline.front();
+    _pipeline.pop_front();
+  }
+}
+
+bool Client::_canReadAhead() const {
+  if (!_keepAlive || _inputClosed || _pipeline.size() >= PIPELINE_MAX_DEPTH) {
+    return false;
+  }
+  const HttpRequest& tail = _pipeline.empty() ? req : *_pipeline.back();
+  return !tail.hasError();
+}
+
+// 受信待ちの間は EPOLLIN、応答中は EPOLLOUT (+ 先読みできるなら EPOLLIN)
+// 先読みキューが埋まったら EPOLLIN を外す (レベルトリガで空回りしないように)
+// CGI へボディを流している間は、stdin へ書き切れていない分が溜まったら外す
+// (splice で渡している間は、stdin パイプが詰まったら外す)
+void Client::_updateEvents() {
+  if (!_epoll || !_context) {
+    return;
+  }
+  unsigned int events = 0;
+  if (_state == WAIT_REQUEST || _state == READING_REQUEST) {
+    events = EPOLLIN;
+  } else {
+    // CGI の続きの出力を待っている間は送るものがない
+    // splice で送る段階ではソケットが詰まった時だけ EPOLLOUT で空きを待つ
+    if (_state == WRITING_RESPONSE &&
+        (!res.isStreamIdle() || (_cgi_splice_full && isSplicingCgiOutput()))) {
+      events = EPOLLOUT;
+    }
+    if (_isStreamingBody()) {
+      size_t pending = 0;
+      if (_cgi_stdin_fd != -1 || _isWaitingCgiStart()) {
+        pending = req.getBody().size() - _cgi_stdin_offset;
+      }
+      bool pipeFull = _cgi_stdin_full && isSplicingCgiInput();
+      if (!_inputClosed && pending < CGI_STDIN_BUFFER_SIZE && !pipeFull) {
+        events |= EPOLLIN;
+      }
+    } else if (_canReadAhead()) {
+      events |= EPOLLIN;
+    }
+  }
+  if (events != _events) {
+    _epoll->mod(_fd, _context, events);
+    _events = events;
+  }
+}
+
+TimeoutPhase Client::_currentPhase() const {
+  switch (_state) {
+    case WAIT_REQUEST:
+      return TIMEOUT_KEEPALIVE;
+    case READING_REQUEST:
+    case PROCESSING:
+      return req.isReadingBody() ? TIMEOUT_BODY : TIMEOUT_HEADER;
+    case WAITING_CGI_INPUT:
+    case READING_CGI_OUTPUT:
+      // ボディを受信している間は client_body_timeout (受信ごとに延長)
+      if (_isStreamingBody()) {
+        return TIMEOUT_BODY;
+      }
+      return _cgi_queued ? TIMEOUT_CGI_QUEUE : TIMEOUT_CGI;
+    case WRITING_RESPONSE:
+      return TIMEOUT_SEND;
+    default:
+      return TIMEOUT_NONE;
+  }
+}
+
+// 現在のフェーズの期限でタイマーを設定し直す
+// header / keepalive / cgi はフェーズ開始からの期限なので、同じフェーズの
+// 間は延長しない (少しずつ送ってくる接続に居座られないようにする)
+void Client::_armTimer() {
+  if (!_timers || !_timeouts) {
+    return;
+  }
+  TimeoutPhase phase = _currentPhase();
+  if (phase == _timerPhase && _timer.isArmed() && phase != TIMEOUT_BODY &&
+      phase != TIMEOUT_SEND) {
+    return;
+  }
+
+  _timerPhase = phase;
+  switch (phase) {
+    case TIMEOUT_HEADER:
+      _timers->arm(&_timer, _timeouts->client_header_timeout);
+      break;
+    case TIMEOUT_BODY:
+      _timers->arm(&_timer, _timeouts->client_body_timeout);
+      break;
+    case TIMEOUT_KEEPALIVE:
+      _timers->arm(&_timer, _timeouts->keepalive_timeout);
+      break;
+    case TIMEOUT_SEND:
+      _timers->arm(&_timer, _timeouts->send_timeout);
+      break;
+    case TIMEOUT_CGI:
+      _timers->arm(&_timer, _timeouts->cgi_timeout);
+      break;
+    case TIMEOUT_CGI_QUEUE:
+      _timers->arm(&_timer, _timeouts->cgi_queue_timeout);
+      break;
+    default:
+      _timers->cancel(&_timer);
+      break;
+  }
+}
+
+// Ends the response once the CGI output and exit status are known.
+// A CGI killed by a signal (a crash, the OOM killer) may have stopped in the
+// middle of its output, so the response is aborted like a broken pipe. A
+// non-zero exit is only logged once the response has started, since many
+// scripts exit with the status of their last command.
+// status is the waitpid(2) status, or -1 when it is unknown.
+void Client::_completeCgi(int status) {
+  if (status != -1 && WIFSIGNALED(status)) {
+    std::cerr << "[Warn] CGI killed by signal " << WTERMSIG(status)
+              << std::endl;
+    abortCgi(502);
+    return;
+  }
+  bool failed = status != -1 && WEXITSTATUS(status) != 0;
+  if (failed) {
+    std::cerr << "[Warn] CGI exited with status " << WEXITSTATUS(status)
+              << std::endl;
+  }
+  if (res.isStreaming()) {
+    // ヘッダーとボディは送信中。終端を付けて応答を完了させる
+    res.endStream();
+    _cleanupCgi();
+    _updateEvents();
+    return;
+  }
+  if (failed) {
+    abortCgi(502);  // ヘッダーを出さずに失敗した
+    return;
+  }
+  // ヘッダーの区切りがないまま終わった → 出力全体から応答を作る
+  res.parseCgiResponse(_cgi_output);
+  res.build();  // レスポンスバッファを構築
+  _cleanupCgi();
+  readyToWrite();
+}
+
 void Client::_cleanupCgi() {
+  _closeCgiStdout();
+  _closeCgiStdin();
+  if (_cgi_pid > 0) {
+    ChildReaper* reaper = ChildReaper::active();
+    if (reaper) {
+      // SIGTERM を送り、回収 (と SIGKILL への切り替え) は ChildReaper に任せる
+      reaper->terminate(_cgi_pid);
+    } else if (waitpid(_cgi_pid, NULL, WNOHANG) == 0) {
+      kill(_cgi_pid, SIGTERM);
+      waitpid(_cgi_pid, NULL, 0);
+    }
+    _cgi_pid = -1;
+  }
+  if (_cgi_pool) {
+    CgiWorkerPool* pool = _cgi_pool;
+    _cgi_pool = NULL;
+    if (_cgi_worker) {
+      // END_REQUEST まで受け取ったワーカーだけを使い回す
+      pool->release(_cgi_worker, _fcgi && _fcgi->isEnded());
+      _cgi_worker = NULL;
+      _resumeCgiWaiting(pool);
+    } else {
+      pool->cancel(this);
+    }
+  }
+  if (_cgi_limiter) {
+    CgiLimiter* limiter = _cgi_limiter;
+    _cgi_limiter = NULL;
+    if (_cgi_queued) {
+      _cgi_queued = false;
+      limiter->cancel(this);
+    } else {
+      limiter->release();
+      _resumeCgiQueue(limiter);
+    }
+  }
+  delete _fcgi;
+  _fcgi = NULL;
+  _cgi_output.clear();
+  _cgi_stdin_offset = 0;
+  _cgi_stdin_full = false;
+  _cgi_splice_full = false;
+}
+
+void Client::_closeCgiStdout() {
   if (_cgi_stdout_fd != -1) {
-    if (_epoll)
-      _epoll->del(_cgi_stdout_fd);
+    _watchCgiPipe(_cgi_stdout_fd, _cgi_stdout_ctx, _cgi_stdout_events, 0);
     close(_cgi_stdout_fd);
     _cgi_stdout_fd = -1;
   }
+  if (_cgi_stdout_ctx) {
+    EpollContext::retire(_cgi_stdout_ctx);
+    _cgi_stdout_ctx = NULL;
+  }
+}
+
+void Client::_closeCgiStdin() {
   if (_cgi_stdin_fd != -1) {
-    if (_epoll)
-      _epoll->del(_cgi_stdin_fd);
+    _watchCgiPipe(_cgi_stdin_fd, _cgi_stdin_ctx, _cgi_stdin_events, 0);
     close(_cgi_stdin_fd);
     _cgi_stdin_fd = -1;
   }
-  if (_cgi_pid > 0) {
-    int ret = waitpid(_cgi_pid, NULL, WNOHANG);
-    if (ret == 0) {
-      kill(_cgi_pid, SIGTERM);
-      waitpid(_cgi_pid, NULL, 0);
+  if (_cgi_stdin_ctx) {
+    EpollContext::retire(_cgi_stdin_ctx);
+    _cgi_stdin_ctx = NULL;
+  }
+}
+
+void Client::_updateCgiStdin() {
+  if (!_cgi_stdin_ctx) {
+    return;
+  }
+  // ボディを書き終えたら完了時にパイプを閉じるため EPOLLOUT を待つ
+  // splice でパイプが詰まった時も、空いたらソケットから続きを渡す
+  const BodySink& body = req.getBody();
+  unsigned int events = 0;
+  if (_cgi_stdin_offset < body.size() || req.isComplete() ||
+      (_fcgi && _fcgi->hasPendingInput()) ||
+      (_cgi_stdin_full && isSplicingCgiInput())) {
+    events = EPOLLOUT;
+  }
+  _watchCgiPipe(_cgi_stdin_fd, _cgi_stdin_ctx, _cgi_stdin_events, events);
+}
+
+void Client::_updateCgiStdout() {
+  // 未送信の出力が溜まったら、ソケットへ送れるまで読まない
+  unsigned int events = EPOLLIN;
+  if (res.isSpliceBody()) {
+    // splice で送るボディは、先に送るものがなくソケットに空きがある時だけ
+    if (!res.isSplicePending() || _cgi_splice_full) {
+      events = 0;
     }
-    _cgi_pid = -1;
+  } else if (res.isStreaming() &&
+             res.getStreamBuffered() >= CGI_STDOUT_BUFFER_SIZE) {
+    events = 0;
+  }
+  _watchCgiPipe(_cgi_stdout_fd, _cgi_stdout_ctx, _cgi_stdout_events, events);
+}
+
+// 止めている間は epoll から外す (相手が閉じると EPOLLHUP / EPOLLERR は
+// 監視イベントに関係なく届き、レベルトリガで鳴り続けるため)
+void Client::_watchCgiPipe(int fd, EpollContext* ctx, unsigned int& current,
+                           unsigned int events) {
+  if (!ctx || fd == -1 || events == current) {
+    return;
+  }
+  if (current == 0) {
+    _epoll->add(fd, ctx, events);
+  } else if (events == 0) {
+    _epoll->del(fd);
+  } else {
+    _epoll->mod(fd, ctx, events);
+  }
+  current = events;
+}
+
+// CGI のヘッダーが揃った → 応答ヘッダーを送り始め、ボディは届いた分から流す
+void Client::_startCgiResponse(size_t bodyStart) {
+  if (!res.beginStream(_cgi_output.substr(0, bodyStart))) {
+    // Status ヘッダーが不正 (502 を設定済み)
+    res.build();
+    _cleanupCgi();
+    readyToWrite();
+    return;
+  }
+  // Content-Length のボディはパイプからソケットへ直接送る (実ソケットのみ)
+  res.setSplice(_epoll != NULL && !_fcgi);
+  res.build();
+  if (bodyStart < _cgi_output.size()) {
+    res.appendStream(_cgi_output.data() + bodyStart,
+                     _cgi_output.size() - bodyStart);
   }
   _cgi_output.clear();
+  readyToWrite();
+  _updateCgiStdout();
+}
+
+bool Client::_isStreamingBody() const {
+  if (_state == WAIT_REQUEST || _state == READING_REQUEST) {
+    return false;
+  }
+  return !req.isComplete() && !req.hasError();
+}
+
+void Client::_onBodyData() {
+  if (req.hasError()) {
+    // 上限超過など: ボディを最後まで渡せないので CGI を止める
+    _keepAlive = false;
+    if (_isCgiRunning()) {
+      abortCgi(bodyErrorStatus(req.getErrorCode()));
+    }
+    return;
+  }
+  if (_cgi_stdin_fd != -1) {
+    _updateCgiStdin();
+  } else if (!_isWaitingCgiStart()) {
+    // 渡す先がない (CGI が先に stdin を閉じた / 応答済み) ので捨てる
+    req.getBody().discard(req.getBody().size());
+  }
+  _armTimer();  // ボディ受信中は期限を延長し、完了したら CGI の期限にする
+}
+
+// stdin への書き込み中も出力を読む (パイプが詰まって止まらないように)
+void Client::_watchCgiStdout() {
+  if (_epoll) {
+    _cgi_stdout_ctx =
+        EpollContext::createCgiPipe(this, EpollContext::CGI_STDOUT);
+    _watchCgiPipe(_cgi_stdout_fd, _cgi_stdout_ctx, _cgi_stdout_events,
+                  EPOLLIN);
+  }
+}
+
+// Connects to a worker and queues the request records.
+// The socket is duplicated so that the write side and the read side can be
+// watched separately, just like the stdin and stdout pipes of a spawned CGI.
+// A worker that cannot be reached is given back to be restarted.
+// returns:
+//   int: 0 on success, or an HTTP status code on failure.
+int Client::_connectCgiWorker(CgiWorkerPool::Worker* worker) {
+  int fd = _cgi_pool->connect(worker);
+  int in = (fd < 0) ? -1 : fcntl(fd, F_DUPFD_CLOEXEC, 0);
+  char** env = (in < 0) ? NULL : createCgiEnv(*this, _cgi_script);
+  if (!env) {
+    std::cerr << "[Error] CGI worker connect failed: " << strerror(errno)
+              << std::endl;
+    if (fd >= 0) {
+      close(fd);
+    }
+    if (in >= 0) {
+      close(in);
+    }
+    _cgi_pool->release(worker, false);
+    _cgi_pool = NULL;
+    return 502;  // Bad Gateway
+  }
+
+  _cgi_worker = worker;
+  _cgi_stdout_fd = fd;
+  _cgi_stdin_fd = in;
   _cgi_stdin_offset = 0;
+  _cgi_output.clear();
+  _fcgi = new FastCgiRequest();
+  _fcgi->begin(env);
+  freeCgiEnv(env);
+
+  _watchCgiStdout();
+  // GET でも BEGIN_REQUEST / PARAMS と入力の終わりを送る
+  readyToCgiWrite();
+  return (0);
+}
+
+void Client::_resumeCgiWaiting(CgiWorkerPool* pool) {
+  while (pool->waiting() > 0) {
+    CgiWorkerPool::Worker* worker = pool->acquire();
+    if (!worker) {
+      return;
+    }
+    Client* next = pool->nextWaiting();
+    int status = next->_connectCgiWorker(worker);
+    if (status != 0) {
+      next->abortCgi(status);
+    }
+  }
+}
+
+// 起動に失敗した Client は abortCgi() で枠を返すので、その中からも呼ばれる
+void Client::_resumeCgiQueue(CgiLimiter* limiter) {
+  Client* next;
+  while ((next = limiter->resume()) != NULL) {
+    next->_cgi_queued = false;
+    int status = next->_spawnCgi(next->_cgi_script, next->_cgi_exec);
+    if (status != 0) {
+      next->abortCgi(status);
+    }
+  }
+}
+
+bool Client::_isCgiRunning() const {
+  return _cgi_pid > 0 || _cgi_pool != NULL || _cgi_limiter != NULL;
+}
+
+bool Client::_isWaitingCgiStart() const {
+  return (_cgi_pool != NULL && _cgi_worker == NULL) || _cgi_queued;
 }
@@ -1,5 +1,39 @@
 #include "Config.hpp"
 
+// ============================================================================
+// GzipConfig
+// ============================================================================
+
+/**
+ * @brief GzipConfigのデフォルトコンストラクタ
+ */
+GzipConfig::GzipConfig()
+    : enabled(false),
+      min_length(DEFAULT_GZIP_MIN_LENGTH),
+      level(DEFAULT_GZIP_COMP_LEVEL) {
+  types.push_back("text/html");
+}
+
+// ============================================================================
+// CgiWorkerConfig
+// ============================================================================
+
+/**
+ * @brief CgiWorkerConfigのデフォルトコンストラクタ
+ */
+CgiWorkerConfig::CgiWorkerConfig()
+    : min_workers(0), max_workers(0), max_requests(0) {}
+
+// ============================================================================
+// CgiLimitConfig
+// ============================================================================
+
+/**
+ * @brief CgiLimitConfigのデフォルトコンストラクタ
+ */
+CgiLimitConfig::CgiLimitConfig()
+    : max_concurrency(0), queue_size(DEFAULT_CGI_QUEUE_SIZE) {}
+
 // ============================================================================
 // LocationConfig
 // ============================================================================
@@ -71,6 +105,54 @@ const LocationConfig* ServerConfig::getLocation(const std::string& path) const {
   return best_match;
 }
 
+// ============================================================================
+// TimeoutConfig
+// ============================================================================
+
+/**
+ * @brief TimeoutConfigのデフォルトコンストラクタ
+ */
+TimeoutConfig::TimeoutConfig()
+    : client_header_timeout(DEFAULT_TIMEOUT_MS),
+      client_body_timeout(DEFAULT_TIMEOUT_MS),
+      keepalive_timeout(DEFAULT_TIMEOUT_MS),
+      send_timeout(DEFAULT_TIMEOUT_MS),
+      cgi_timeout(DEFAULT_TIMEOUT_MS),
+      cgi_queue_timeout(DEFAULT_CGI_QUEUE_TIMEOUT_MS) {}
+
+// ============================================================================
+// FileCacheConfig
+// ============================================================================
+
+/**
+ * @brief FileCacheConfigのデフォルトコンストラクタ
+ */
+FileCacheConfig::FileCacheConfig()
+    : max_entries(DEFAULT_OPEN_FILE_CACHE_MAX),
+      valid_ms(DEFAULT_OPEN_FILE_CACHE_VALID_MS) {}
+
+// ============================================================================
+// AssetCacheConfig
+// ============================================================================
+
+/**
+ * @brief AssetCacheConfigのデフォルトコンストラクタ
+ */
+AssetCacheConfig::AssetCacheConfig()
+    : max_bytes(DEFAULT_ASSET_CACHE_SIZE),
+      max_file_size(DEFAULT_ASSET_CACHE_MAX_FILE) {}
+
+// ============================================================================
+// ClientBodyConfig
+// ============================================================================
+
+/**
+ * @brief ClientBodyConfigのデフォルトコンストラクタ
+ */
+ClientBodyConfig::ClientBodyConfig()
+    : buffer_size(DEFAULT_CLIENT_BODY_BUFFER_SIZE),
+      temp_path(DEFAULT_CLIENT_BODY_TEMP_PATH) {}
+
 // ============================================================================
 // MainConfig
 // ============================================================================
@@ -78,7 +160,7 @@ const LocationConfig* ServerConfig::getLocation(const std::string& path) const {
 /**
  * @brief MainConfigのデフォルトコンストラクタ
  */
-MainConfig::MainConfig() {}
+MainConfig::MainConfig() : worker_processes(1), accept_budget(64) {}
 
 /**
  * @brief MainConfigのデストラクタ
@@ -1,4 +1,7 @@
 #include "ConfigParser.hpp"
+#include <unistd.h>
+#include <algorithm>
+#include <cctype>
 #include <fstream>
 #include <sstream>
 #include <stdexcept>
@@ -20,6 +23,18 @@ const int STATUS_CODE_MAX = 599;
 const int REDIRECT_CODE_MIN = 300;
 const int REDIRECT_CODE_MAX = 399;
 
+// ワーカープロセス数の上限
+const int WORKER_PROCESSES_MAX = 1024;
+
+// accept_budget の上限
+const int ACCEPT_BUDGET_MAX = 65536;
+
+// open_file_cache の上限
+const int OPEN_FILE_CACHE_MAX = 65536;
+
+// タイムアウトの上限 (1日, ミリ秒)
+const unsigned long TIMEOUT_MAX_MS = 24UL * 60 * 60 * 1000;
+
 // サイズ単位（バイト）
 const size_t KILOBYTE = 1024;
 const size_t MEGABYTE = 1024 * 1024;
@@ -46,13 +61,55 @@ void ConfigParser::parse(MainConfig& config) {
     std::string token = _peekToken();
     if (token == "server") {
       _parseServerBlock(config);
+    } else if (token == "worker_processes") {
+      _nextToken();
+      _parseWorkerProcessesDirective(config);
+    } else if (token == "accept_budget") {
+      _nextToken();
+      _parseAcceptBudgetDirective(config);
+    } else if (token == "client_header_timeout") {
+      _nextToken();
+      _parseTimeoutDirective(token, config.timeouts.client_header_timeout);
+    } else if (token == "client_body_timeout") {
+      _nextToken();
+      _parseTimeoutDirective(token, config.timeouts.client_body_timeout);
+    } else if (token == "keepalive_timeout") {
+      _nextToken();
+      _parseTimeoutDirective(token, config.timeouts.keepalive_timeout);
+    } else if (token == "send_timeout") {
+      _nextToken();
+      _parseTimeoutDirective(token, config.timeouts.send_timeout);
+    } else if (token == "cgi_timeout") {
+      _nextToken();
+      _parseTimeoutDirective(token, config.timeouts.cgi_timeout);
+    } else if (token == "cgi_queue_timeout") {
+      _nextToken();
+      _parseTimeoutDirective(token, config.timeouts.cgi_queue_timeout);
+    } else if (token == "open_file_cache") {
+      _nextToken();
+      _parseOpenFileCacheDirective(config);
+    } else if (token == "open_file_cache_valid") {
+      _nextToken();
+      _parseTimeoutDirective(token, config.open_file_cache.valid_ms);
+    } else if (token == "asset_cache_size") {
+      _nextToken();
+      _parseSizeDirective(token, config.asset_cache.max_bytes);
+    } else if (token == "asset_cache_max_file") {
+      _nextToken();
+      _parseSizeDirective(token, config.asset_cache.max_file_size);
+    } else if (token == "client_body_buffer_size") {
+      _nextToken();
+      _parseSizeDirective(token, config.client_body.buffer_size);
+    } else if (token == "client_body_temp_path") {
+      _nextToken();
+      _parseClientBodyTempPathDirective(config);
     } else if (token == "#") {
       // 通常はトークナイズ時（tokenize）でコメントが除去されるが、
       // 予期せぬ '#' トークンが残っていた場合に備えた防御的なチェック
       _nextToken();
     } else {
-      throw std::runtime_error(_makeError(
-          "expected 'server' directive at top level, got: " + token));
+      throw std::runtime_error(
+          _makeError("unknown top-level directive: " + token));
     }
   }
 }
@@ -232,6 +289,11 @@ void ConfigParser::_parseLocationBlock(ServerConfig& server) {
       _parseIndexDirective(location);
     } else if (directive == "autoindex") {
       _parseAutoindexDirective(location);
+    } else if (directive == "precompressed") {
+      _parsePrecompressedDirective(location);
+    } else if (directive == "gzip" || directive == "gzip_min_length" ||
+               directive == "gzip_types" || directive == "gzip_comp_level") {
+      _parseGzipDirective(directive, location);
     } else if (directive == "allowed_methods") {
       _parseAllowedMethodsDirective(location);
     } else if (directive == "upload_path") {
@@ -240,6 +302,12 @@ void ConfigParser::_parseLocationBlock(ServerConfig& server) {
       _parseCgiExtensionDirective(location);
     } else if (directive == "cgi_path") {
       _parseCgiPathDirective(location);
+    } else if (directive == "cgi_workers" ||
+               directive == "cgi_worker_max_requests") {
+      _parseCgiWorkersDirective(directive, location);
+    } else if (directive == "cgi_max_concurrency" ||
+               directive == "cgi_queue_size") {
+      _parseCgiLimitDirective(directive, location);
     } else if (directive == "return") {
       if (has_return) {
         throw std::runtime_error(_makeError("duplicate 'return' directive"));
@@ -256,6 +324,80 @@ void ConfigParser::_parseLocationBlock(ServerConfig& server) {
   server.locations.push_back(location);
 }
 
+// ============================================================================
+// パーサ（トップレベル ディレクティブ）
+// ============================================================================
+
+void ConfigParser::_parseWorkerProcessesDirective(MainConfig& config) {
+  std::string value = _nextToken();
+  int workers = 0;
+
+  if (value == "auto") {
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    workers = (cpus > 0) ? static_cast<int>(cpus) : 1;
+  } else if (!_tryParsePositiveInt(value, workers)) {
+    throw std::runtime_error(
+        _makeError("invalid worker_processes value: " + value));
+  }
+  if (workers > WORKER_PROCESSES_MAX) {
+    workers = WORKER_PROCESSES_MAX;
+  }
+  config.worker_processes = workers;
+  _skipSemicolon();
+}
+
+void ConfigParser::_parseAcceptBudgetDirective(MainConfig& config) {
+  std::string value = _nextToken();
+  int budget;
+  if (!_tryParsePositiveInt(value, budget) || budget > ACCEPT_BUDGET_MAX) {
+    throw std::runtime_error(
+        _makeError("invalid accept_budget value: " + value));
+  }
+  config.accept_budget = budget;
+  _skipSemicolon();
+}
+
+void ConfigParser::_parseTimeoutDirective(const std::string& name,
+                                          unsigned long& timeout_ms) {
+  std::string value = _nextToken();
+  if (value == ";") {
+    throw std::runtime_error(_makeError(name + " directive requires a value"));
+  }
+  timeout_ms = _parseDuration(value);
+  _skipSemicolon();
+}
+
+void ConfigParser::_parseOpenFileCacheDirective(MainConfig& config) {
+  std::string value = _nextToken();
+  int entries = 0;
+  if (value != "off" && (!_tryParsePositiveInt(value, entries) ||
+                         entries > OPEN_FILE_CACHE_MAX)) {
+    throw std::runtime_error(
+        _makeError("invalid open_file_cache value: " + value));
+  }
+  config.open_file_cache.max_entries = static_cast<size_t>(entries);
+  _skipSemicolon();
+}
+
+void ConfigParser::_parseSizeDirective(const std::string& name,
+                                       size_t& bytes) {
+  std::string value = _nextToken();
+  if (value == ";") {
+    throw std::runtime_error(_makeError(name + " directive requires a value"));
+  }
+  bytes = _parseSize(value);
+  _skipSemicolon();
+}
+
+void ConfigParser::_parseClientBodyTempPathDirective(MainConfig& config) {
+  if (_peekToken() == ";") {
+    throw std::runtime_error(
+        _makeError("client_body_temp_path directive requires a path"));
+  }
+  config.client_body.temp_path = _nextToken();
+  _skipSemicolon();
+}
+
 // ============================================================================
 // パーサ（server ディレクティブ）
 // ============================================================================
@@ -426,6 +568,76 @@ void ConfigParser::_parseAutoindexDirective(LocationConfig& location) {
   _skipSemicolon();
 }
 
+void ConfigParser::_parsePrecompressedDirective(LocationConfig& location) {
+  if (_peekToken() == ";") {
+    throw std::runtime_error(
+        _makeError("precompressed directive requires a value"));
+  }
+  location.precompressed.clear();
+  if (_peekToken() == "off") {
+    _nextToken();
+    _skipSemicolon();
+    return;
+  }
+  while (_hasMoreTokens() && _peekToken() != ";") {
+    std::string encoding = _nextToken();
+    if (encoding != "gzip" && encoding != "br") {
+      throw std::runtime_error(
+          _makeError("precompressed must be 'gzip', 'br' or 'off', got: " +
+                     encoding));
+    }
+    if (std::find(location.precompressed.begin(),
+                  location.precompressed.end(),
+                  encoding) == location.precompressed.end()) {
+      location.precompressed.push_back(encoding);
+    }
+  }
+  _skipSemicolon();
+}
+
+void ConfigParser::_parseGzipDirective(const std::string& name,
+                                       LocationConfig& location) {
+  if (_peekToken() == ";") {
+    throw std::runtime_error(_makeError(name + " directive requires a value"));
+  }
+  GzipConfig& gzip = location.gzip;
+  if (name == "gzip") {
+    std::string value = _nextToken();
+    if (value == "on") {
+      gzip.enabled = true;
+    } else if (value == "off") {
+      gzip.enabled = false;
+    } else {
+      throw std::runtime_error(
+          _makeError("gzip must be 'on' or 'off', got: " + value));
+    }
+  } else if (name == "gzip_min_length") {
+    gzip.min_length = _parseSize(_nextToken());
+  } else if (name == "gzip_types") {
+    gzip.types.clear();
+    while (_hasMoreTokens() && _peekToken() != ";") {
+      std::string type = _nextToken();
+      for (size_t i = 0; i < type.size(); ++i) {
+        type[i] = static_cast<char>(
+            std::tolower(static_cast<unsigned char>(type[i])));
+      }
+      if (std::find(gzip.types.begin(), gzip.types.end(), type) ==
+          gzip.types.end()) {
+        gzip.types.push_back(type);
+      }
+    }
+  } else {
+    std::string value = _nextToken();
+    int level;
+    if (!_tryParsePositiveInt(value, level) || level > 9) {
+      throw std::runtime_error(
+          _makeError("gzip_comp_level must be 1-9, got: " + value));
+    }
+    gzip.level = level;
+  }
+  _skipSemicolon();
+}
+
 void ConfigParser::_parseAllowedMethodsDirective(LocationConfig& location) {
   location.allow_methods.clear();
 
@@ -484,6 +696,59 @@ void ConfigParser::_parseCgiPathDirective(LocationConfig& location) {
   _skipSemicolon();
 }
 
+void ConfigParser::_parseCgiWorkersDirective(const std::string& name,
+                                             LocationConfig& location) {
+  if (_peekToken() == ";") {
+    throw std::runtime_error(_makeError(name + " directive requires a value"));
+  }
+  CgiWorkerConfig& workers = location.cgi_workers;
+  std::string value = _nextToken();
+  if (name == "cgi_worker_max_requests") {
+    int requests = 0;
+    if (value != "0" && !_tryParsePositiveInt(value, requests)) {
+      throw std::runtime_error(
+          _makeError("invalid cgi_worker_max_requests value: " + value));
+    }
+    workers.max_requests = static_cast<unsigned long>(requests);
+  } else if (value == "off") {
+    workers.min_workers = 0;
+    workers.max_workers = 0;
+  } else {
+    // cgi_workers <min> <max>
+    int min = 0;
+    int max = 0;
+    std::string maxValue = _nextToken();
+    if ((value != "0" && !_tryParsePositiveInt(value, min)) ||
+        !_tryParsePositiveInt(maxValue, max) || min > max) {
+      throw std::runtime_error(_makeError(
+          "cgi_workers must be '<min> <max>' with min <= max, got: " + value +
+          " " + maxValue));
+    }
+    workers.min_workers = static_cast<size_t>(min);
+    workers.max_workers = static_cast<size_t>(max);
+  }
+  _skipSemicolon();
+}
+
+void ConfigParser::_parseCgiLimitDirective(const std::string& name,
+                                           LocationConfig& location) {
+  if (_peekToken() == ";") {
+    throw std::runtime_error(_makeError(name + " directive requires a value"));
+  }
+  std::string value = _nextToken();
+  int count = 0;
+  if (value != "0" && !_tryParsePositiveInt(value, count)) {
+    throw std::runtime_error(
+        _makeError("invalid " + name + " value: " + value));
+  }
+  if (name == "cgi_max_concurrency") {
+    location.cgi_limit.max_concurrency = static_cast<size_t>(count);
+  } else {
+    location.cgi_limit.queue_size = static_cast<size_t>(count);
+  }
+  _skipSemicolon();
+}
+
 void ConfigParser::_parseReturnDirective(LocationConfig& location) {
   // return 301 http://example.com; 形式
   std::string code_str = _nextToken();
@@ -547,6 +812,32 @@ size_t ConfigParser::_parseSize(const std::string& size_str) const {
   return value * multiplier;
 }
 
+unsigned long ConfigParser::_parseDuration(const std::string& time_str) const {
+  unsigned long multiplier = 1000;  // 単位なしは秒
+  std::string num_str = time_str;
+
+  if (time_str.length() > 2 &&
+      time_str.compare(time_str.length() - 2, 2, "ms") == 0) {
+    multiplier = 1;
+    num_str = time_str.substr(0, time_str.length() - 2);
+  } else if (!time_str.empty() && time_str[time_str.length() - 1] == 's') {
+    num_str = time_str.substr(0, time_str.length() - 1);
+  } else if (!time_str.empty() && time_str[time_str.length() - 1] == 'm') {
+    multiplier = 60 * 1000;
+    num_str = time_str.substr(0, time_str.length() - 1);
+  }
+
+  if (!_isNumber(num_str)) {
+    throw std::runtime_error(_makeError("invalid time value: " + time_str));
+  }
+  std::istringstream iss(num_str);
+  unsigned long value;
+  if (!(iss >> value) || value == 0 || value > TIMEOUT_MAX_MS / multiplier) {
+    throw std::runtime_error(_makeError("invalid time value: " + time_str));
+  }
+  return value * multiplier;
+}
+
 bool ConfigParser::_tryParsePort(const std::string& str, int& port) const {
   if (str.empty()) {
     return false;
@@ -575,6 +866,15 @@ bool ConfigParser::_isNumber(const std::string& str) const {
   return true;
 }
 
+bool ConfigParser::_tryParsePositiveInt(const std::string& str,
+                                        int& value) const {
+  if (!_isNumber(str)) {
+    return false;
+  }
+  std::istringstream iss(str);
+  return (iss >> value) && value >= 1;
+}
+
 std::string ConfigParser::_makeError(const std::string& message) const {
   std::ostringstream oss;
   oss << _file_path << ":" << _last_line << ": " << message;
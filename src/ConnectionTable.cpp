@@ -0,0 +1,173 @@
+#include "../inc/ConnectionTable.hpp"
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <unistd.h>
+#include <algorithm>
+#include <iostream>
+#include <new>
+#include "../inc/Client.hpp"
+#include "../inc/EpollContext.hpp"
+#include "../inc/EpollUtils.hpp"
+
+namespace {
+
+// RLIMIT_NOFILE が無制限の場合に確保するスロット数の上限
+const size_t MAX_TABLE_SLOTS = 1048576;
+const size_t DEFAULT_TABLE_SLOTS = 1024;
+
+// Returns the number of fd slots to preallocate, based on the soft RLIMIT_NOFILE.
+size_t initialCapacity() {
+  struct rlimit rl;
+  if (getrlimit(RLIMIT_NOFILE, &rl) != 0) {
+    return DEFAULT_TABLE_SLOTS;
+  }
+  if (rl.rlim_cur == RLIM_INFINITY || rl.rlim_cur > MAX_TABLE_SLOTS) {
+    return MAX_TABLE_SLOTS;
+  }
+  return static_cast<size_t>(rl.rlim_cur);
+}
+
+}  // namespace
+
+// ========================================
+// コンストラクタ / デストラクタ
+// ========================================
+
+ConnectionTable::ConnectionTable(EpollUtils* epoll, TimerWheel* timers,
+                                 const TimeoutConfig* timeouts)
+    : _epoll(epoll), _timers(timers), _timeouts(timeouts) {
+  Slot empty;
+  empty.client = NULL;
+  empty.denseIndex = 0;
+  _slots.assign(initialCapacity(), empty);
+  _active.reserve(_slots.size());
+}
+
+ConnectionTable::~ConnectionTable() {
+  while (!_active.empty()) {
+    remove(_active.back());
+  }
+  releaseRetired();
+  EpollContext::releaseRetired();
+}
+
+// ========================================
+// 登録 / 検索 / 削除
+// ========================================
+
+Client* ConnectionTable::add(int fd, int port, const std::string& ip) {
+  if (get(fd) != NULL) {
+    // 登録済みの fd は既存の Client が所有しているので閉じない
+    return NULL;
+  }
+  if (fd < 0 || !_reserve(fd)) {
+    if (fd >= 0) {
+      close(fd);
+    }
+    return NULL;
+  }
+
+  Client* client = NULL;
+  EpollContext* ctx = NULL;
+  try {
+    client = new Client(fd, port, ip, _epoll);
+    ctx = EpollContext::createClient(client);
+    _active.push_back(fd);
+  } catch (const std::bad_alloc& e) {
+    std::cerr << "[Error] ConnectionTable::add: " << e.what() << std::endl;
+    delete ctx;
+    delete client;  // fd も close される
+    return NULL;
+  }
+  client->setContext(ctx);
+  if (_timers) {
+    client->setTimers(_timers, _timeouts);
+  }
+
+  _slots[fd].client = client;
+  _slots[fd].denseIndex = _active.size() - 1;
+
+  // epoll に登録 (EPOLLIN で読み込み待ち)
+  if (_epoll) {
+    _epoll->add(fd, ctx, EPOLLIN);
+  }
+  return client;
+}
+
+Client* ConnectionTable::get(int fd) const {
+  if (fd < 0 || static_cast<size_t>(fd) >= _slots.size()) {
+    return NULL;
+  }
+  return _slots[fd].client;
+}
+
+void ConnectionTable::remove(int fd) {
+  Client* client = get(fd);
+  if (!client) {
+    return;
+  }
+
+  // 密な配列から外す (末尾要素を空いた位置へ移動)
+  size_t index = _slots[fd].denseIndex;
+  int lastFd = _active.back();
+  _active[index] = lastFd;
+  _slots[lastFd].denseIndex = index;
+  _active.pop_back();
+  _slots[fd].client = NULL;
+
+  if (_epoll) {
+    _epoll->del(fd);
+  }
+  // 後続のイベントは client の外れた Context で読み飛ばされる
+  EpollContext::retire(client->getContext());
+  client->closeConnection();
+  _retired.push_back(client);
+}
+
+void ConnectionTable::releaseRetired() {
+  for (size_t i = 0; i < _retired.size(); ++i) {
+    delete _retired[i];
+  }
+  _retired.clear();
+}
+
+// ========================================
+// 走査
+// ========================================
+
+size_t ConnectionTable::size() const {
+  return _active.size();
+}
+
+Client* ConnectionTable::at(size_t index) const {
+  if (index >= _active.size()) {
+    return NULL;
+  }
+  return _slots[_active[index]].client;
+}
+
+size_t ConnectionTable::capacity() const {
+  return _slots.size();
+}
+
+// ========================================
+// プライベートヘルパー
+// ========================================
+
+// setrlimit で上限が引き上げられた場合に備え、必要ならテーブルを拡張する
+bool ConnectionTable::_reserve(int fd) {
+  size_t needed = static_cast<size_t>(fd) + 1;
+  if (needed <= _slots.size()) {
+    return true;
+  }
+  try {
+    Slot empty;
+    empty.client = NULL;
+    empty.denseIndex = 0;
+    _slots.resize(std::max(needed, _slots.size() * 2), empty);
+  } catch (const std::bad_alloc& e) {
+    std::cerr << "[Error] ConnectionTable: " << e.what() << std::endl;
+    return false;
+  }
+  return true;
+}
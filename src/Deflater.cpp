@@ -0,0 +1,82 @@
+#include "../inc/Deflater.hpp"
+#include <time.h>
+#include <cstring>
+
+namespace {
+
+// zlib に一度に渡す出力領域
+const size_t DEFLATE_OUT_CHUNK = 16384;
+
+// windowBits に 16 を足すと zlib ヘッダではなく gzip ヘッダになる
+const int GZIP_WINDOW_BITS = 15 + 16;
+
+long threadCpuUsec() {
+  struct timespec ts;
+  if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) != 0) {
+    return 0;
+  }
+  return ts.tv_sec * 1000000L + ts.tv_nsec / 1000;
+}
+
+}  // namespace
+
+DeflateStats Deflater::_stats;
+
+Deflater::Deflater(int level) : _ready(false), _finished(false) {
+  std::memset(&_stream, 0, sizeof(_stream));
+  if (level < Z_BEST_SPEED || level > Z_BEST_COMPRESSION) {
+    level = Z_DEFAULT_COMPRESSION;
+  }
+  _ready = (deflateInit2(&_stream, level, Z_DEFLATED, GZIP_WINDOW_BITS, 8,
+                         Z_DEFAULT_STRATEGY) == Z_OK);
+  if (_ready) {
+    ++_stats.streams;
+  }
+}
+
+Deflater::~Deflater() {
+  if (_ready) {
+    deflateEnd(&_stream);
+  }
+}
+
+// Compresses len bytes of data and appends the output to out.
+// The output buffer is grown DEFLATE_OUT_CHUNK bytes at a time, so a bounded
+// input slice gives a bounded output.
+// returns:
+//   bool: false when zlib reports an error or the stream is already finished.
+bool Deflater::write(const char* data, size_t len, bool finish,
+                     std::vector<char>& out) {
+  if (!_ready || _finished) {
+    return false;
+  }
+  long started = threadCpuUsec();
+  _stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data));
+  _stream.avail_in = static_cast<uInt>(len);
+  int flush = finish ? Z_FINISH : Z_NO_FLUSH;
+  size_t produced = 0;
+  int ret = Z_OK;
+  do {
+    size_t used = out.size();
+    out.resize(used + DEFLATE_OUT_CHUNK);
+    _stream.next_out = reinterpret_cast<Bytef*>(&out[used]);
+    _stream.avail_out = static_cast<uInt>(DEFLATE_OUT_CHUNK);
+    ret = deflate(&_stream, flush);
+    size_t have = DEFLATE_OUT_CHUNK - _stream.avail_out;
+    out.resize(used + have);
+    produced += have;
+    if (ret == Z_STREAM_ERROR) {
+      return false;
+    }
+  } while (_stream.avail_out == 0 || (finish && ret != Z_STREAM_END));
+
+  _stats.bytesIn += len;
+  _stats.bytesOut += produced;
+  _stats.cpuUsec += static_cast<unsigned long>(threadCpuUsec() - started);
+  _finished = (ret == Z_STREAM_END);
+  return true;
+}
+
+const DeflateStats& Deflater::stats() {
+  return _stats;
+}
@@ -7,7 +7,8 @@
 #include <stdexcept>
 
 EpollUtils::EpollUtils() {
-  this->_epoll_fd = epoll_create(1);
+  // CGI に継承させない
+  this->_epoll_fd = epoll_create1(EPOLL_CLOEXEC);
   if (this->_epoll_fd < 0) {
     std::cerr << "epoll_create failed: " << strerror(errno) << std::endl;
     throw std::runtime_error("Failed to create epoll instance");
@@ -0,0 +1,238 @@
+#include "../inc/FastCgi.hpp"
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+
+namespace {
+
+// FastCGI 1.0 のレコード種別・定数
+const unsigned char FCGI_VERSION_1 = 1;
+const unsigned char FCGI_BEGIN_REQUEST = 1;
+const unsigned char FCGI_END_REQUEST = 3;
+const unsigned char FCGI_PARAMS = 4;
+const unsigned char FCGI_STDIN = 5;
+const unsigned char FCGI_STDOUT = 6;
+const unsigned char FCGI_STDERR = 7;
+const unsigned char FCGI_RESPONDER = 1;
+const unsigned short FCGI_REQUEST_ID = 1;
+const size_t FCGI_HEADER_LEN = 8;
+const size_t FCGI_MAX_CONTENT = 65535;
+
+void appendHeader(std::string& out, unsigned char type, size_t len) {
+  char header[FCGI_HEADER_LEN];
+  header[0] = static_cast<char>(FCGI_VERSION_1);
+  header[1] = static_cast<char>(type);
+  header[2] = static_cast<char>((FCGI_REQUEST_ID >> 8) & 0xff);
+  header[3] = static_cast<char>(FCGI_REQUEST_ID & 0xff);
+  header[4] = static_cast<char>((len >> 8) & 0xff);
+  header[5] = static_cast<char>(len & 0xff);
+  header[6] = 0;  // padding
+  header[7] = 0;  // reserved
+  out.append(header, FCGI_HEADER_LEN);
+}
+
+// 名前と値の長さ: 127 以下なら1バイト、それ以上は最上位ビットを立てて4バイト
+void appendLength(std::string& out, size_t len) {
+  if (len < 128) {
+    out += static_cast<char>(len);
+    return;
+  }
+  out += static_cast<char>(((len >> 24) & 0x7f) | 0x80);
+  out += static_cast<char>((len >> 16) & 0xff);
+  out += static_cast<char>((len >> 8) & 0xff);
+  out += static_cast<char>(len & 0xff);
+}
+
+}  // namespace
+
+FastCgiRequest::FastCgiRequest()
+    : _out(),
+      _outOffset(0),
+      _recordLeft(0),
+      _endQueued(false),
+      _inputDone(false),
+      _headerLen(0),
+      _type(0),
+      _contentLeft(0),
+      _paddingLeft(0),
+      _record(),
+      _ended(false),
+      _appStatus(0) {
+  std::memset(_header, 0, sizeof(_header));
+}
+
+// Queues BEGIN_REQUEST and the PARAMS stream built from envp.
+// The name-value pairs are encoded into one buffer first and then cut into
+// records, since a pair may span a record boundary.
+void FastCgiRequest::begin(char** envp) {
+  char body[8];  // role (2バイト), flags, reserved
+  std::memset(body, 0, sizeof(body));
+  body[1] = static_cast<char>(FCGI_RESPONDER);  // flags は 0 (KEEP_CONN なし)
+  _appendRecord(FCGI_BEGIN_REQUEST, body, sizeof(body));
+
+  std::string params;
+  for (size_t i = 0; envp && envp[i] != NULL; ++i) {
+    const char* eq = std::strchr(envp[i], '=');
+    if (!eq) {
+      continue;
+    }
+    size_t nameLen = static_cast<size_t>(eq - envp[i]);
+    size_t valueLen = std::strlen(eq + 1);
+    appendLength(params, nameLen);
+    appendLength(params, valueLen);
+    params.append(envp[i], nameLen);
+    params.append(eq + 1, valueLen);
+  }
+  _appendRecord(FCGI_PARAMS, params.data(), params.size());
+  appendHeader(_out, FCGI_PARAMS, 0);  // PARAMS の終わり
+}
+
+// Writes queued records and then the body from offset as STDIN records.
+// Each record header is queued in _out and its content is written straight
+// from the BodySink, so a spilled body goes out with sendfile(2).
+// returns:
+//   bool: false on a write error other than EAGAIN (errno is kept).
+bool FastCgiRequest::writeInput(int fd, const BodySink& body, size_t& offset,
+                                bool complete) {
+  while (!_inputDone) {
+    if (_outOffset < _out.size()) {
+      ssize_t n = write(fd, _out.data() + _outOffset, _out.size() - _outOffset);
+      if (n < 0) {
+        if (errno == EINTR) {
+          continue;
+        }
+        return errno == EAGAIN || errno == EWOULDBLOCK;
+      }
+      _outOffset += static_cast<size_t>(n);
+      if (_outOffset < _out.size()) {
+        continue;
+      }
+      _out.clear();
+      _outOffset = 0;
+      if (_endQueued) {
+        _inputDone = true;
+      }
+    } else if (_recordLeft > 0) {
+      ssize_t n = body.writeTo(fd, offset, _recordLeft);
+      if (n < 0) {
+        if (errno == EINTR) {
+          continue;
+        }
+        return errno == EAGAIN || errno == EWOULDBLOCK;
+      }
+      if (n == 0) {
+        return true;
+      }
+      offset += static_cast<size_t>(n);
+      _recordLeft -= static_cast<size_t>(n);
+    } else if (offset < body.size()) {
+      _recordLeft = std::min(body.size() - offset, FCGI_MAX_CONTENT);
+      appendHeader(_out, FCGI_STDIN, _recordLeft);
+    } else if (complete) {
+      appendHeader(_out, FCGI_STDIN, 0);  // 入力の終わり
+      _endQueued = true;
+    } else {
+      return true;  // 続きのボディを待つ
+    }
+  }
+  return true;
+}
+
+bool FastCgiRequest::hasPendingInput() const {
+  return _outOffset < _out.size() || _recordLeft > 0;
+}
+
+bool FastCgiRequest::isInputDone() const {
+  return _inputDone;
+}
+
+// Decodes records from the worker as they arrive.
+// STDOUT content is handed on as soon as it is read, without waiting for the
+// whole record; other records are collected and handled at their end.
+// returns:
+//   bool: false on a record with an unknown protocol version.
+bool FastCgiRequest::read(const char* data, size_t len, std::string& out) {
+  while (len > 0 && !_ended) {
+    if (_headerLen < FCGI_HEADER_LEN) {
+      size_t n = std::min(FCGI_HEADER_LEN - _headerLen, len);
+      std::memcpy(_header + _headerLen, data, n);
+      _headerLen += n;
+      data += n;
+      len -= n;
+      if (_headerLen < FCGI_HEADER_LEN) {
+        break;
+      }
+      if (_header[0] != FCGI_VERSION_1) {
+        return false;
+      }
+      _type = _header[1];
+      _contentLeft = (static_cast<size_t>(_header[4]) << 8) | _header[5];
+      _paddingLeft = _header[6];
+      _record.clear();
+    } else if (_contentLeft > 0) {
+      size_t n = std::min(_contentLeft, len);
+      if (_type == FCGI_STDOUT) {
+        out.append(data, n);
+      } else {
+        _record.append(data, n);
+      }
+      _contentLeft -= n;
+      data += n;
+      len -= n;
+    } else {
+      size_t n = std::min(_paddingLeft, len);
+      _paddingLeft -= n;
+      data += n;
+      len -= n;
+    }
+    if (_headerLen == FCGI_HEADER_LEN && _contentLeft == 0 &&
+        _paddingLeft == 0) {
+      _endRecord();
+    }
+  }
+  return true;
+}
+
+bool FastCgiRequest::isEnded() const {
+  return _ended;
+}
+
+int FastCgiRequest::getAppStatus() const {
+  return _appStatus;
+}
+
+// content を最大長ごとのレコードに分けて _out に積む (空なら何もしない)
+void FastCgiRequest::_appendRecord(unsigned char type, const char* data,
+                                   size_t len) {
+  while (len > 0) {
+    size_t n = std::min(len, FCGI_MAX_CONTENT);
+    appendHeader(_out, type, n);
+    _out.append(data, n);
+    data += n;
+    len -= n;
+  }
+}
+
+void FastCgiRequest::_endRecord() {
+  if (_type == FCGI_END_REQUEST && _record.size() >= 5) {
+    const unsigned char* body =
+        reinterpret_cast<const unsigned char*>(_record.data());
+    _appStatus = static_cast<int>((static_cast<unsigned long>(body[0]) << 24) |
+                                  (body[1] << 16) | (body[2] << 8) | body[3]);
+    if (body[4] != 0) {
+      // FCGI_CANT_MPX_CONN / FCGI_OVERLOADED / FCGI_UNKNOWN_ROLE
+      std::cerr << "[Warn] FastCGI request rejected: protocol status "
+                << static_cast<int>(body[4]) << std::endl;
+    }
+    _ended = true;
+  } else if (_type == FCGI_STDERR && !_record.empty()) {
+    std::cerr << "[FastCGI] " << _record;
+    if (_record[_record.size() - 1] != '\n') {
+      std::cerr << std::endl;
+    }
+  }
+  _record.clear();
+  _headerLen = 0;
+}
@@ -0,0 +1,185 @@
+#include "../inc/HeaderTable.hpp"
+#include <strings.h>  // strncasecmp
+#include <algorithm>  // std::swap
+#include "../inc/Scan.hpp"
+
+namespace {
+
+// HeaderId と同じ順序
+const char* const KNOWN_NAMES[HDR_COUNT] = {
+    "host",
+    "connection",
+    "content-length",
+    "content-type",
+    "transfer-encoding",
+    "accept",
+    "accept-encoding",
+    "cookie",
+    "expect",
+    "if-modified-since",
+    "if-none-match",
+    "if-range",
+    "range",
+    "user-agent",
+};
+
+const std::string& emptyString() {
+  static const std::string empty;
+  return empty;
+}
+
+bool equalsIgnoreCase(const std::string& a, const char* b, size_t len) {
+  return a.size() == len && strncasecmp(a.data(), b, len) == 0;
+}
+
+}  // namespace
+
+// ========================================
+// コンストラクタ
+// ========================================
+
+HeaderTable::HeaderTable() : _present(0), _unknownCount(0) {}
+
+// ========================================
+// 名前の解決
+// ========================================
+
+// Resolves a header name to its slot. The table is fixed and small, and the
+// length check skips most entries, so this is a bounded constant cost.
+HeaderId HeaderTable::lookup(const char* name, size_t len) {
+  for (int i = 0; i < HDR_COUNT; ++i) {
+    const std::string& known = nameOf(static_cast<HeaderId>(i));
+    if (known.size() == len && strncasecmp(known.data(), name, len) == 0) {
+      return static_cast<HeaderId>(i);
+    }
+  }
+  return HDR_UNKNOWN;
+}
+
+const std::string& HeaderTable::nameOf(HeaderId id) {
+  static std::string names[HDR_COUNT];
+  if (names[0].empty()) {
+    for (int i = 0; i < HDR_COUNT; ++i) {
+      names[i] = KNOWN_NAMES[i];
+    }
+  }
+  if (id < 0 || id >= HDR_COUNT) {
+    return emptyString();
+  }
+  return names[id];
+}
+
+// ========================================
+// 追加
+// ========================================
+
+void HeaderTable::set(const char* name, size_t nameLen, const char* value,
+                      size_t valueLen) {
+  HeaderId id = lookup(name, nameLen);
+  if (id != HDR_UNKNOWN) {
+    set(id, value, valueLen);
+    return;
+  }
+
+  for (size_t i = 0; i < _unknownCount; ++i) {
+    if (equalsIgnoreCase(_unknown[i].name, name, nameLen)) {
+      _unknown[i].value.assign(value, valueLen);
+      return;
+    }
+  }
+  if (_unknownCount == _unknown.size()) {
+    _unknown.push_back(Field());
+  }
+  Field& field = _unknown[_unknownCount++];
+  field.name.assign(name, nameLen);
+  if (nameLen > 0) {
+    Scan::toLower(&field.name[0], nameLen);
+  }
+  field.value.assign(value, valueLen);
+}
+
+void HeaderTable::set(HeaderId id, const char* value, size_t valueLen) {
+  if (id < 0 || id >= HDR_COUNT) {
+    return;
+  }
+  unsigned int bit = 1u << id;
+  if ((_present & bit) == 0) {
+    _present |= bit;
+    _order.push_back(id);
+  }
+  _known[id].assign(value, valueLen);
+}
+
+// ========================================
+// 参照
+// ========================================
+
+const std::string& HeaderTable::get(HeaderId id) const {
+  if (!has(id)) {
+    return emptyString();
+  }
+  return _known[id];
+}
+
+bool HeaderTable::has(HeaderId id) const {
+  return id >= 0 && id < HDR_COUNT && (_present & (1u << id)) != 0;
+}
+
+const std::string* HeaderTable::find(const std::string& name) const {
+  HeaderId id = lookup(name.data(), name.size());
+  if (id != HDR_UNKNOWN) {
+    return has(id) ? &_known[id] : NULL;
+  }
+  for (size_t i = 0; i < _unknownCount; ++i) {
+    if (equalsIgnoreCase(_unknown[i].name, name.data(), name.size())) {
+      return &_unknown[i].value;
+    }
+  }
+  return NULL;
+}
+
+// ========================================
+// 走査
+// ========================================
+
+size_t HeaderTable::size() const {
+  return _order.size() + _unknownCount;
+}
+
+const std::string& HeaderTable::nameAt(size_t index) const {
+  if (index < _order.size()) {
+    return nameOf(_order[index]);
+  }
+  return _unknown[index - _order.size()].name;
+}
+
+const std::string& HeaderTable::valueAt(size_t index) const {
+  if (index < _order.size()) {
+    return _known[_order[index]];
+  }
+  return _unknown[index - _order.size()].value;
+}
+
+// 文字列の領域は残したまま空にする
+void HeaderTable::clear() {
+  for (size_t i = 0; i < _order.size(); ++i) {
+    _known[_order[i]].clear();
+  }
+  for (size_t i = 0; i < _unknownCount; ++i) {
+    _unknown[i].name.clear();
+    _unknown[i].value.clear();
+  }
+  _present = 0;
+  _order.clear();
+  _unknownCount = 0;
+}
+
+void HeaderTable::swap(HeaderTable& other) {
+  for (size_t i = 0; i < HDR_COUNT; ++i) {
+    _known[i].swap(other._known[i]);
+  }
+  std::swap(_present, other._present);
+  _order.swap(other._order);
+  _unknown.swap(other._unknown);
+  std::swap(_unknownCount, other._unknownCount);
+}
@@ -1,30 +1,47 @@
+#include <algorithm>  // std::swap
 #include <cctype>
+#include <cstring>
 #include "../inc/Http.hpp"
+#include "../inc/Pool.hpp"
+#include "../inc/Scan.hpp"
 
 // =============================================================================
 // ヘルパー関数: 文字列から HttpMethod への変換
 // =============================================================================
-static HttpMethod stringToMethod(const std::string& str) {
-  if (str == "GET") {
+static HttpMethod toMethod(const char* str, size_t len) {
+  if (len == 3 && std::memcmp(str, "GET", 3) == 0) {
     return GET;
-  } else if (str == "HEAD") {
+  } else if (len == 4 && std::memcmp(str, "HEAD", 4) == 0) {
     return HEAD;
-  } else if (str == "POST") {
+  } else if (len == 4 && std::memcmp(str, "POST", 4) == 0) {
     return POST;
-  } else if (str == "DELETE") {
+  } else if (len == 6 && std::memcmp(str, "DELETE", 6) == 0) {
     return DELETE;
   }
   return UNKNOWN_METHOD;
 }
 
+// =============================================================================
+// ヘルパー関数: 16進数1文字を数値に変換（不正な文字は -1）
+// =============================================================================
+static int hexValue(char c) {
+  if (c >= '0' && c <= '9') {
+    return c - '0';
+  } else if (c >= 'a' && c <= 'f') {
+    return c - 'a' + 10;
+  } else if (c >= 'A' && c <= 'F') {
+    return c - 'A' + 10;
+  }
+  return -1;
+}
+
 // =============================================================================
 // ヘルパー関数: 文字列を小文字に変換
 // =============================================================================
 static std::string toLower(const std::string& str) {
   std::string result = str;
-  for (std::string::size_type i = 0; i < result.size(); ++i) {
-    result[i] =
-        static_cast<char>(std::tolower(static_cast<unsigned char>(result[i])));
+  if (!result.empty()) {
+    Scan::toLower(&result[0], result.size());
   }
   return result;
 }
@@ -48,7 +65,9 @@ static bool isDigitsOnly(const std::string& str) {
 // Default Constructor
 // =============================================================================
 HttpRequest::HttpRequest()
-    : _parseState(REQ_REQUEST_LINE),
+    : _readPos(0),
+      _scanPos(0),
+      _parseState(REQ_REQUEST_LINE),
       _error(ERR_NONE),
       _headerCount(0),
       _totalHeaderSize(0),
@@ -60,13 +79,16 @@ HttpRequest::HttpRequest()
       _chunkBytesRead(0),
       _trailerCount(0),
       _config(NULL),
-      _location(NULL) {}
+      _location(NULL) {
+  // 前の接続が使っていた受信バッファを再利用する (ボディは BodySink が行う)
+  BufferPool::acquire(_buffer);
+}
 
 // =============================================================================
 // Destructor
 // =============================================================================
 HttpRequest::~HttpRequest() {
-  // 動的リソースは持っていないので特に何もしない
+  BufferPool::release(_buffer);
 }
 
 // =============================================================================
@@ -74,6 +96,8 @@ HttpRequest::~HttpRequest() {
 // =============================================================================
 void HttpRequest::clear() {
   _buffer.clear();
+  _readPos = 0;
+  _scanPos = 0;
   _parseState = REQ_REQUEST_LINE;
   _error = ERR_NONE;
 
@@ -96,11 +120,53 @@ void HttpRequest::clear() {
   _trailerCount = 0;
 }
 
+// =============================================================================
+// swap - 全メンバを入れ替える（パイプラインで先読みしたリクエストの昇格用）
+// =============================================================================
+void HttpRequest::swap(HttpRequest& other) {
+  _buffer.swap(other._buffer);
+  std::swap(_readPos, other._readPos);
+  std::swap(_scanPos, other._scanPos);
+  std::swap(_parseState, other._parseState);
+  std::swap(_error, other._error);
+  std::swap(_headerCount, other._headerCount);
+  std::swap(_totalHeaderSize, other._totalHeaderSize);
+  std::swap(_method, other._method);
+  _path.swap(other._path);
+  _query.swap(other._query);
+  _version.swap(other._version);
+  _headers.swap(other._headers);
+  _body.swap(other._body);
+  std::swap(_contentLength, other._contentLength);
+  std::swap(_isChunked, other._isChunked);
+  std::swap(_chunkState, other._chunkState);
+  std::swap(_currentChunkSize, other._currentChunkSize);
+  std::swap(_chunkBytesRead, other._chunkBytesRead);
+  std::swap(_trailerCount, other._trailerCount);
+  std::swap(_config, other._config);
+  std::swap(_location, other._location);
+}
+
+// =============================================================================
+// moveUnparsedTo - 完了後に届いている後続データを次のリクエストへ渡す
+// =============================================================================
+// パイプラインでは1回の recv に次のリクエストの先頭が含まれる。
+// 完了したリクエストの後ろに残ったバイト列を next に feed し、自分からは外す。
+void HttpRequest::moveUnparsedTo(HttpRequest& next) {
+  if (available() == 0) {
+    return;
+  }
+  next.feed(_buffer.data() + _readPos, available());
+  _buffer.resize(_readPos);
+  _scanPos = _readPos;
+}
+
 // =============================================================================
 // feed - データを追加しパースを進める（中枢関数）
 // =============================================================================
 bool HttpRequest::feed(const char* data, size_t size) {
-  // 1. バッファに追加
+  // 1. 処理済み領域を詰めてからバッファに追加
+  compactBuffer();
   _buffer.append(data, size);
 
   // 2. 状態に応じて進められるだけ進める
@@ -133,6 +199,45 @@ bool HttpRequest::isComplete() const {
   return (_parseState == REQ_COMPLETE);
 }
 
+// =============================================================================
+// isReadingBody - ヘッダーを受信し終え、ボディを受信中かどうか
+// =============================================================================
+bool HttpRequest::isReadingBody() const {
+  return (_parseState == REQ_BODY);
+}
+
+// =============================================================================
+// getUnparsedSize - まだパースしていない受信データのバイト数
+// =============================================================================
+size_t HttpRequest::getUnparsedSize() const {
+  return available();
+}
+
+// =============================================================================
+// getSpliceableBody - パーサーを通さずに受け取れるボディのバイト数
+// =============================================================================
+// Content-Length のボディは区切りを探す必要がないので、受信済みのデータを
+// 処理し終えていれば、残りはソケットから CGI へ直接 splice してよい。
+size_t HttpRequest::getSpliceableBody() const {
+  if (_parseState != REQ_BODY || _isChunked || available() > 0) {
+    return 0;
+  }
+  return _contentLength - _body.size();
+}
+
+// =============================================================================
+// skipBody - splice で渡した分をボディとして数える
+// =============================================================================
+bool HttpRequest::skipBody(size_t n) {
+  if (n > getSpliceableBody() || !_body.skip(n)) {
+    return false;
+  }
+  if (_body.size() == _contentLength) {
+    _parseState = REQ_COMPLETE;
+  }
+  return true;
+}
+
 // =============================================================================
 // hasError - パースエラーが発生したかどうか
 // =============================================================================
@@ -156,35 +261,106 @@ size_t HttpRequest::getMaxBodySize() const {
                            : DEFAULT_CLIENT_MAX_BODY_SIZE;
 }
 
+// =============================================================================
+// 入力バッファのカーソル操作
+// 未処理データは _buffer[_readPos, size) にあり、処理済み領域は feed() の
+// 先頭でまとめて詰める。行末の探索は _scanPos から再開するので、行が分割
+// 受信されても同じバイトを何度も走査しない。
+// =============================================================================
+size_t HttpRequest::available() const {
+  return _buffer.size() - _readPos;
+}
+
+void HttpRequest::consume(size_t n) {
+  _readPos += n;
+  _scanPos = _readPos;
+}
+
+// 未処理データ中の最初の "\r\n" の位置 (_buffer 内の絶対位置) を返す
+// 見つからなければ npos を返し、次回は今回の末尾から探索を再開する
+size_t HttpRequest::findLineEnd() {
+  size_t from = (_scanPos > _readPos) ? _scanPos : _readPos;
+  const char* begin = _buffer.data();
+  const char* end = begin + _buffer.size();
+  const char* crlf = Scan::findCrlf(begin + from, end);
+  if (crlf == end) {
+    // 末尾の '\r' は次の受信で '\n' と揃う可能性があるので残す
+    _scanPos = _buffer.size();
+    if (_scanPos > _readPos && _buffer[_scanPos - 1] == '\r') {
+      --_scanPos;
+    }
+    return std::string::npos;
+  }
+  return static_cast<size_t>(crlf - begin);
+}
+
+// 処理済み領域が未処理データ以上になった時だけ詰める
+// (移動量は消費済みバイト数で抑えられるので、全体で受信量に線形)
+void HttpRequest::compactBuffer() {
+  if (_readPos == 0) {
+    return;
+  }
+  if (_readPos >= _buffer.size()) {
+    _buffer.clear();
+  } else if (_readPos >= available()) {
+    _buffer.erase(0, _readPos);
+  } else {
+    return;
+  }
+  _scanPos -= _readPos;
+  _readPos = 0;
+}
+
 // =============================================================================
 // parseRequestLine - リクエストライン解析
 // =============================================================================
 void HttpRequest::parseRequestLine() {
-  // 1. _buffer から \r\n を探す
-  std::string::size_type pos = _buffer.find("\r\n");
-  if (pos == std::string::npos) {
+  // 1. 未処理データから \r\n を探す
+  std::string::size_type eol = findLineEnd();
+  // リクエストラインの前の空行は読み飛ばす (RFC 9112 2.2)
+  // パイプラインで前のリクエストのボディ後に CRLF が付いてくる場合がある
+  while (eol == _readPos) {
+    consume(2);
+    eol = findLineEnd();
+  }
+  if (eol == std::string::npos) {
     // 見つからなければ return（分割受信に備える）
     return;
   }
 
-  // 2. 1行取り出す → "GET /path?query HTTP/1.1"
-  std::string line = _buffer.substr(0, pos);
-  _buffer.erase(0, pos + 2);  // \r\n の2バイトも消す
+  // 2. 1行をバッファ上のまま参照する → "GET /path?query HTTP/1.1"
+  const char* p = _buffer.data() + _readPos;
+  const char* end = _buffer.data() + eol;
+  consume(eol - _readPos + 2);  // \r\n の2バイトも消費
 
-  // 3. スペース区切りで3つに分解
-  std::istringstream iss(line);
-  std::string methodStr, uri, versionStr;
-  iss >> methodStr >> uri >> versionStr;
+  // 3. 空白区切りで3つに分解（連続する空白は1つとみなす）
+  const char* tokenBegin[3];
+  const char* tokenEnd[3];
+  int count = 0;
+  while (count < 3) {
+    while (p < end && std::isspace(static_cast<unsigned char>(*p))) {
+      ++p;
+    }
+    if (p == end) {
+      break;
+    }
+    tokenBegin[count] = p;
+    while (p < end && !std::isspace(static_cast<unsigned char>(*p))) {
+      ++p;
+    }
+    tokenEnd[count] = p;
+    ++count;
+  }
 
   // 3つ取れたか確認
-  if (methodStr.empty() || uri.empty() || versionStr.empty()) {
+  if (count < 3) {
     _error = ERR_INVALID_METHOD;
     _parseState = REQ_ERROR;
     return;
   }
 
   // 4. メソッドを HttpMethod に変換
-  _method = stringToMethod(methodStr);
+  _method = toMethod(tokenBegin[0], tokenEnd[0] - tokenBegin[0]);
   if (_method == UNKNOWN_METHOD) {
     _error = ERR_INVALID_METHOD;
     _parseState = REQ_ERROR;
@@ -192,22 +368,25 @@ void HttpRequest::parseRequestLine() {
   }
 
   // 5. パスとクエリを分割（?の位置で）
-  std::string::size_type queryPos = uri.find('?');
-  if (queryPos == std::string::npos) {
-    _path = uri;
+  const char* uri = tokenBegin[1];
+  const char* uriEnd = tokenEnd[1];
+  const char* queryPos = Scan::findChar(uri, uriEnd, '?');
+  if (queryPos == uriEnd) {
+    _path.assign(uri, uriEnd);
     _query.clear();
   } else {
-    _path = uri.substr(0, queryPos);
-    _query = uri.substr(queryPos + 1);
+    _path.assign(uri, queryPos);
+    _query.assign(queryPos + 1, uriEnd);
   }
 
   // 6. バージョンをチェック
-  if (versionStr != "HTTP/1.1" && versionStr != "HTTP/1.0") {
+  _version.assign(tokenBegin[2], tokenEnd[2]);
+  if (_version != "HTTP/1.1" && _version != "HTTP/1.0") {
+    _version.clear();
     _error = ERR_INVALID_VERSION;
     _parseState = REQ_ERROR;
     return;
   }
-  _version = versionStr;
 
   // 成功 → ヘッダー解析へ
   _parseState = REQ_HEADERS;
@@ -221,75 +400,25 @@ void HttpRequest::parseHeaders() {
 
   // 全てのヘッダー行をループで処理
   while (true) {
-    // 1. \r\n を探す
-    std::string::size_type pos = _buffer.find("\r\n");
-    if (pos == std::string::npos) {
+    // 1. \r\n を探す（前回の探索位置から再開）
+    std::string::size_type eol = findLineEnd();
+    if (eol == std::string::npos) {
       // 見つからなければ return（分割受信に備える）
       return;
     }
+    size_t lineLength = eol - _readPos;
 
     // ヘッダーサイズチェック
-    _totalHeaderSize += pos + 2;
+    _totalHeaderSize += lineLength + 2;
     if (_totalHeaderSize > MAX_HEADER_SIZE) {
       setError(ERR_HEADER_TOO_LARGE);
       return;
     }
 
     // 2. 空行なら → ヘッダー終了、ボディへ遷移
-    if (pos == 0) {
-      _buffer.erase(0, 2);  // 空行 "\r\n" を消す
-
-      // HTTP/1.1 では Host ヘッダー必須
-      if (_version == "HTTP/1.1" && getHeader("host").empty()) {
-        setError(ERR_MISSING_HOST);
-        return;
-      }
-
-      // Content-Length と Transfer-Encoding の同時指定は禁止 (RFC 7230)
-      std::string contentLength = getHeader("Content-Length");
-      std::string transferEncoding = getHeader("Transfer-Encoding");
-      if (!contentLength.empty() && !transferEncoding.empty()) {
-        setError(ERR_CONFLICTING_HEADERS);
-        return;
-      }
-
-      // Content-Length の形式チェックとボディ状態の決定
-      if (!transferEncoding.empty()) {
-        // Transfer-Encoding が指定されている場合は "chunked" のみ許可
-        // RFC 7230: Transfer-Encoding の値は大文字小文字を区別しない
-        if (toLower(transferEncoding) == "chunked") {
-          _isChunked = true;
-          _parseState = REQ_BODY;
-        } else {
-          // "chunked" 以外はエラー (gzip, deflate 等は未サポート)
-          setError(ERR_INVALID_TRANSFER_ENCODING);
-          return;
-        }
-      } else if (contentLength.empty()) {
-        // Content-Length なし → ボディなし
-        _parseState = REQ_COMPLETE;
-      } else {
-        // Content-Length あり
-        // 数値かどうか確認
-        if (!isDigitsOnly(contentLength)) {
-          setError(ERR_CONTENT_LENGTH_FORMAT);
-          return;
-        }
-        // Content-Lengthの値をメンバ変数に代入
-        std::istringstream iss(contentLength);
-        iss >> _contentLength;
-        // オーバーフロー検出
-        if (iss.fail()) {
-          setError(ERR_CONTENT_LENGTH_FORMAT);
-          return;
-        }
-        // client_max_body_size との比較
-        if (_contentLength > getMaxBodySize()) {
-          setError(ERR_BODY_TOO_LARGE);
-          return;
-        }
-        _parseState = REQ_BODY;
-      }
+    if (lineLength == 0) {
+      consume(2);  // 空行 "\r\n" を消費
+      finishHeaders();
       return;
     }
 
@@ -300,30 +429,89 @@ void HttpRequest::parseHeaders() {
       return;
     }
 
-    // 3. 1行取り出す
-    std::string line = _buffer.substr(0, pos);
-    _buffer.erase(0, pos + 2);  // \r\n の2バイトも消す
+    // 3. 1行をバッファ上のまま参照する
+    const char* line = _buffer.data() + _readPos;
+    const char* lineEnd = line + lineLength;
+    consume(lineLength + 2);  // \r\n の2バイトも消費
 
     // 4. ":" で分割して key: value を取得
-    std::string::size_type colonPos = line.find(':');
-    if (colonPos == std::string::npos) {
-      // ":" がない → 不正なヘッダー（無視して次へ）
-      continue;
+    // ヘッダー名は token なので、token 以外の最初の文字が ':' のはず
+    const char* colon = Scan::findNonToken(line, lineEnd);
+    if (colon == lineEnd || *colon != ':' || colon == line) {
+      if (Scan::findChar(colon, lineEnd, ':') == lineEnd) {
+        // ":" がない → 不正なヘッダー（無視して次へ）
+        continue;
+      }
+      // 名前が空、名前の中や ":" の前に空白などがある (RFC 9112 5.1)
+      setError(ERR_INVALID_HEADER);
+      return;
     }
 
-    std::string key = toLower(line.substr(0, colonPos));
-    std::string value = line.substr(colonPos + 1);
-
     // 5. value の先頭空白をトリム
-    std::string::size_type start = value.find_first_not_of(" \t");
-    if (start != std::string::npos) {
-      value = value.substr(start);
-    } else {
-      value.clear();
+    const char* value = colon + 1;
+    while (value < lineEnd && (*value == ' ' || *value == '\t')) {
+      ++value;
     }
 
-    // 6. _headers に格納
-    _headers[key] = value;
+    // 6. _headers に格納（既知のヘッダーはスロットへ、それ以外は小文字化）
+    _headers.set(line, static_cast<size_t>(colon - line), value,
+                 static_cast<size_t>(lineEnd - value));
+  }
+}
+
+// =============================================================================
+// finishHeaders - ヘッダー終了時の検証とボディ状態の決定
+// =============================================================================
+void HttpRequest::finishHeaders() {
+  // HTTP/1.1 では Host ヘッダー必須
+  if (_version == "HTTP/1.1" && getHeader(HDR_HOST).empty()) {
+    setError(ERR_MISSING_HOST);
+    return;
+  }
+
+  // Content-Length と Transfer-Encoding の同時指定は禁止 (RFC 7230)
+  const std::string& contentLength = getHeader(HDR_CONTENT_LENGTH);
+  const std::string& transferEncoding = getHeader(HDR_TRANSFER_ENCODING);
+  if (!contentLength.empty() && !transferEncoding.empty()) {
+    setError(ERR_CONFLICTING_HEADERS);
+    return;
+  }
+
+  // Content-Length の形式チェックとボディ状態の決定
+  if (!transferEncoding.empty()) {
+    // Transfer-Encoding が指定されている場合は "chunked" のみ許可
+    // RFC 7230: Transfer-Encoding の値は大文字小文字を区別しない
+    if (toLower(transferEncoding) == "chunked") {
+      _isChunked = true;
+      _parseState = REQ_BODY;
+    } else {
+      // "chunked" 以外はエラー (gzip, deflate 等は未サポート)
+      setError(ERR_INVALID_TRANSFER_ENCODING);
+    }
+  } else if (contentLength.empty()) {
+    // Content-Length なし → ボディなし
+    _parseState = REQ_COMPLETE;
+  } else {
+    // Content-Length あり
+    // 数値かどうか確認
+    if (!isDigitsOnly(contentLength)) {
+      setError(ERR_CONTENT_LENGTH_FORMAT);
+      return;
+    }
+    // Content-Lengthの値をメンバ変数に代入
+    std::istringstream iss(contentLength);
+    iss >> _contentLength;
+    // オーバーフロー検出
+    if (iss.fail()) {
+      setError(ERR_CONTENT_LENGTH_FORMAT);
+      return;
+    }
+    // client_max_body_size との比較
+    if (_contentLength > getMaxBodySize()) {
+      setError(ERR_BODY_TOO_LARGE);
+      return;
+    }
+    _parseState = REQ_BODY;
   }
 }
 
@@ -353,15 +541,18 @@ void HttpRequest::parseBodyContentLength() {
   size_t remaining = _contentLength - currentBodySize;
 
   // バッファから読み取れる分を計算
-  size_t toRead = _buffer.size();
+  size_t toRead = available();
   if (toRead > remaining) {
     toRead = remaining;
   }
 
   // バッファからボディへ転送
   if (toRead > 0) {
-    _body.insert(_body.end(), _buffer.begin(), _buffer.begin() + toRead);
-    _buffer.erase(0, toRead);
+    if (!_body.append(_buffer.data() + _readPos, toRead)) {
+      setError(ERR_BODY_STORAGE);
+      return;
+    }
+    consume(toRead);
   }
 
   // ボディが完全に読み取れたかチェック
@@ -408,66 +599,56 @@ void HttpRequest::parseBodyChunked() {
 // 戻り値: true=進捗あり, false=データ不足で待機
 // =============================================================================
 bool HttpRequest::parseChunkSizeLine() {
-  // 1. \r\n を探す
-  std::string::size_type pos = _buffer.find("\r\n");
-  if (pos == std::string::npos) {
+  // 1. \r\n を探す（前回の探索位置から再開）
+  std::string::size_type eol = findLineEnd();
+  if (eol == std::string::npos) {
     // バッファが大きすぎる場合はエラー（無限に待たない）
-    if (_buffer.size() > MAX_LINE_SIZE) {
+    if (available() > MAX_LINE_SIZE) {
       setError(ERR_INVALID_CHUNK_FORMAT);
       return false;
     }
     return false;  // まだ行が揃っていない
   }
 
-  // 2. 16進数文字列を取得
-  std::string hexStr = _buffer.substr(0, pos);
-  _buffer.erase(0, pos + 2);
+  // 2. 16進数文字列をバッファ上のまま参照する
+  const char* hex = _buffer.data() + _readPos;
+  const char* hexEnd = _buffer.data() + eol;
+  consume(eol - _readPos + 2);
 
   // chunk-extension がある場合はセミコロン以降を無視 (RFC 7230)
-  std::string::size_type semiPos = hexStr.find(';');
-  if (semiPos != std::string::npos) {
-    hexStr = hexStr.substr(0, semiPos);
-  }
+  hexEnd = Scan::findChar(hex, hexEnd, ';');
 
   // 先頭と末尾の空白を除去 (RFC 7230 OWS対応)
-  while (!hexStr.empty() &&
-         std::isspace(static_cast<unsigned char>(hexStr[0]))) {
-    hexStr.erase(0, 1);
+  while (hex < hexEnd && std::isspace(static_cast<unsigned char>(*hex))) {
+    ++hex;
   }
-  while (!hexStr.empty() &&
-         std::isspace(static_cast<unsigned char>(hexStr[hexStr.size() - 1]))) {
-    hexStr.erase(hexStr.size() - 1);
+  while (hex < hexEnd &&
+         std::isspace(static_cast<unsigned char>(*(hexEnd - 1)))) {
+    --hexEnd;
   }
 
   // 空文字列チェック
-  if (hexStr.empty()) {
+  if (hex == hexEnd) {
     setError(ERR_INVALID_CHUNK_FORMAT);
     return false;
   }
 
-  // 不正な16進数文字チェック
-  for (std::string::size_type i = 0; i < hexStr.size(); ++i) {
-    char c = hexStr[i];
-    if (!((c >= '0' && c <= '9') || (c >= 'a' && c <= 'f') ||
-          (c >= 'A' && c <= 'F'))) {
-      setError(ERR_INVALID_CHUNK_FORMAT);
-      return false;
-    }
-  }
-
   // オーバーフロー防止: 16進数文字列の長さをチェック
   // size_t は最大16桁 (64bit) または 8桁 (32bit) の16進数
-  if (hexStr.size() > sizeof(size_t) * 2) {
+  if (static_cast<size_t>(hexEnd - hex) > sizeof(size_t) * 2) {
     setError(ERR_INVALID_CHUNK_FORMAT);
     return false;
   }
 
-  // 3. std::hex を使って16進数をパース
-  std::istringstream iss(hexStr);
-  iss >> std::hex >> _currentChunkSize;
-  if (iss.fail()) {
-    setError(ERR_INVALID_CHUNK_FORMAT);
-    return false;
+  // 3. 16進数をパース (不正な文字はエラー)
+  _currentChunkSize = 0;
+  for (; hex < hexEnd; ++hex) {
+    int digit = hexValue(*hex);
+    if (digit < 0) {
+      setError(ERR_INVALID_CHUNK_FORMAT);
+      return false;
+    }
+    _currentChunkSize = (_currentChunkSize << 4) | static_cast<size_t>(digit);
   }
 
   // 4. サイズ0なら終端チャンク
@@ -495,7 +676,7 @@ bool HttpRequest::parseChunkSizeLine() {
 // =============================================================================
 bool HttpRequest::parseChunkData() {
   // バッファが空なら待機
-  if (_buffer.empty()) {
+  if (available() == 0) {
     return false;
   }
 
@@ -503,14 +684,17 @@ bool HttpRequest::parseChunkData() {
   size_t remaining = _currentChunkSize - _chunkBytesRead;
 
   // バッファから読み取れる分を計算
-  size_t toRead = _buffer.size();
+  size_t toRead = available();
   if (toRead > remaining) {
     toRead = remaining;
   }
 
   // バッファからボディへ転送
-  _body.insert(_body.end(), _buffer.begin(), _buffer.begin() + toRead);
-  _buffer.erase(0, toRead);
+  if (!_body.append(_buffer.data() + _readPos, toRead)) {
+    setError(ERR_BODY_STORAGE);
+    return false;
+  }
+  consume(toRead);
   _chunkBytesRead += toRead;
 
   // このチャンクを読み終えたら CHUNK_DATA_CRLF へ
@@ -527,19 +711,19 @@ bool HttpRequest::parseChunkData() {
 // =============================================================================
 bool HttpRequest::parseChunkDataCRLF() {
   // \r\n の2バイトが必要
-  if (_buffer.size() < 2) {
+  if (available() < 2) {
     return false;
   }
 
   // \r\n を確認
-  if (_buffer[0] != '\r' || _buffer[1] != '\n') {
+  if (_buffer[_readPos] != '\r' || _buffer[_readPos + 1] != '\n') {
     // 不正なチャンクフォーマット
     setError(ERR_INVALID_CHUNK_FORMAT);
     return false;
   }
 
   // \r\n を消費して次のチャンクサイズ行へ
-  _buffer.erase(0, 2);
+  consume(2);
   _chunkState = CHUNK_SIZE_LINE;
   return true;
 }
@@ -551,20 +735,21 @@ bool HttpRequest::parseChunkDataCRLF() {
 bool HttpRequest::parseChunkFinalCRLF() {
   static const size_t MAX_TRAILER_LINES = 100;  // 最大trailer行数
 
-  // \r\n を探す
-  std::string::size_type pos = _buffer.find("\r\n");
-  if (pos == std::string::npos) {
+  // \r\n を探す（前回の探索位置から再開）
+  std::string::size_type eol = findLineEnd();
+  if (eol == std::string::npos) {
     // バッファが大きすぎる場合はエラー（無限に待たない）
-    if (_buffer.size() > MAX_LINE_SIZE) {
+    if (available() > MAX_LINE_SIZE) {
       setError(ERR_HEADER_TOO_LARGE);
       return false;
     }
     return false;  // まだ行が揃っていない
   }
+  size_t lineLength = eol - _readPos;
 
   // 空行なら完了 (trailerなしまたはtrailer終端)
-  if (pos == 0) {
-    _buffer.erase(0, 2);
+  if (lineLength == 0) {
+    consume(2);
     _parseState = REQ_COMPLETE;
     return true;
   }
@@ -577,8 +762,8 @@ bool HttpRequest::parseChunkFinalCRLF() {
   }
 
   // trailerの形式検証: RFC 7230 に従い field-name: field-value 形式
-  std::string line = _buffer.substr(0, pos);
-  if (line.find(':') == std::string::npos) {
+  const char* line = _buffer.data() + _readPos;
+  if (Scan::findChar(line, line + lineLength, ':') == line + lineLength) {
     // 不正なtrailer形式
     setError(ERR_HEADER_TOO_LARGE);
     return false;
@@ -586,7 +771,7 @@ bool HttpRequest::parseChunkFinalCRLF() {
 
   // trailer header をスキップ（無視）
   // RFC 7230: trailerは無視しても良い
-  _buffer.erase(0, pos + 2);
+  consume(lineLength + 2);
   return true;  // 次の行をチェックするためprogress=true
 }
 
@@ -602,19 +787,26 @@ std::string HttpRequest::getPath() const {
 }
 
 std::string HttpRequest::getHeader(const std::string& key) const {
-  std::map<std::string, std::string>::const_iterator it =
-      _headers.find(toLower(key));
-  if (it != _headers.end()) {
-    return it->second;
+  const std::string* value = _headers.find(key);
+  if (value != NULL) {
+    return *value;
   }
   return "";
 }
 
-const std::map<std::string, std::string>& HttpRequest::getHeaders() const {
+const std::string& HttpRequest::getHeader(HeaderId id) const {
+  return _headers.get(id);
+}
+
+const HeaderTable& HttpRequest::getHeaders() const {
   return _headers;
 }
 
-const std::vector<char>& HttpRequest::getBody() const {
+const BodySink& HttpRequest::getBody() const {
+  return _body;
+}
+
+BodySink& HttpRequest::getBody() {
   return _body;
 }
 
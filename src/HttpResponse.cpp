@@ -1,5 +1,14 @@
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
 #include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <iomanip>
+#include "../inc/AssetCache.hpp"
+#include "../inc/Deflater.hpp"
 #include "../inc/Http.hpp"
+#include "../inc/Pool.hpp"
 
 namespace {
 
@@ -25,6 +34,58 @@ std::string trim(const std::string& str) {
   return str.substr(first, last - first + 1);
 }
 
+// 送信セグメントから直接参照する静的なバイト列
+const char CRLF[] = "\r\n";
+const char LAST_CHUNK[] = "0\r\n\r\n";
+const char CRLF_LAST_CHUNK[] = "\r\n0\r\n\r\n";
+
+const char* const WEEKDAY_NAMES[7] = {"Sun", "Mon", "Tue", "Wed",
+                                     "Thu", "Fri", "Sat"};
+const char* const MONTH_NAMES[12] = {"Jan", "Feb", "Mar", "Apr", "May", "Jun",
+                                     "Jul", "Aug", "Sep", "Oct", "Nov", "Dec"};
+
+// チャンクサイズ行 1つ分の最大長 ("\r\n" + 16進数 + "\r\n")
+const size_t MAX_CHUNK_FRAMING = 2 + sizeof(size_t) * 2 + 2;
+
+void appendBytes(std::vector<char>& out, const char* data, size_t len) {
+  out.insert(out.end(), data, data + len);
+}
+
+void appendString(std::vector<char>& out, const std::string& str) {
+  out.insert(out.end(), str.begin(), str.end());
+}
+
+void appendHex(std::vector<char>& out, size_t value) {
+  char digits[sizeof(size_t) * 2];
+  size_t len = 0;
+  do {
+    digits[len++] = "0123456789abcdef"[value & 0xf];
+    value >>= 4;
+  } while (value != 0);
+  while (len > 0) {
+    out.push_back(digits[--len]);
+  }
+}
+
+void appendDecimal(std::vector<char>& out, int value) {
+  std::ostringstream ss;
+  ss << value;
+  appendString(out, ss.str());
+}
+
+// CGI のヘッダは小文字で入るので、大文字小文字を区別せずに探す
+// name は小文字で渡す
+std::map<std::string, std::string>::const_iterator findHeader(
+    const std::map<std::string, std::string>& headers,
+    const std::string& name) {
+  std::map<std::string, std::string>::const_iterator it = headers.begin();
+  for (; it != headers.end(); ++it) {
+    if (toLower(it->first) == name)
+      break;
+  }
+  return it;
+}
+
 bool parseHeaderLine(const std::string& line, std::string& key,
                      std::string& val) {
   std::string::size_type colonPos = line.find(':');
@@ -107,18 +168,127 @@ bool HttpResponse::isBodyForbidden(int code) {
   return (code >= 100 && code < 200) || code == 204 || code == 304;
 }
 
+// Builds a strong entity tag from the file identity: "<ino>-<size>-<mtime>" in hex.
+std::string HttpResponse::makeETag(ino_t ino, off_t size, time_t mtime) {
+  std::ostringstream ss;
+  ss << std::hex << '"' << static_cast<unsigned long>(ino) << '-'
+     << static_cast<unsigned long>(size) << '-'
+     << static_cast<unsigned long>(mtime) << '"';
+  return ss.str();
+}
+
+// Formats t as an IMF-fixdate ("Sun, 06 Nov 1994 08:49:37 GMT").
+// Implemented without the C time functions, like formatTime() in RequestHandler.
+std::string HttpResponse::formatHttpDate(time_t t) {
+  long secs = static_cast<long>(t);
+  long days = secs / 86400;
+  long rem = secs % 86400;
+  if (rem < 0) {
+    rem += 86400;
+    --days;
+  }
+  // 1970-01-01 は木曜日
+  int weekday = static_cast<int>(((days % 7) + 11) % 7);
+
+  // days-from-civil の逆変換 (3月始まりの暦で計算する)
+  long z = days + 719468;
+  long era = (z >= 0 ? z : z - 146096) / 146097;
+  long doe = z - era * 146097;
+  long yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+  long doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+  long mp = (5 * doy + 2) / 153;
+  int day = static_cast<int>(doy - (153 * mp + 2) / 5 + 1);
+  int month = static_cast<int>(mp < 10 ? mp + 3 : mp - 9);
+  long year = yoe + era * 400 + (month <= 2 ? 1 : 0);
+
+  std::ostringstream ss;
+  ss << std::setfill('0') << WEEKDAY_NAMES[weekday] << ", " << std::setw(2)
+     << day << ' ' << MONTH_NAMES[month - 1] << ' ' << std::setw(4) << year
+     << ' ' << std::setw(2) << rem / 3600 << ':' << std::setw(2)
+     << (rem / 60) % 60 << ':' << std::setw(2) << rem % 60 << " GMT";
+  return ss.str();
+}
+
+// Parses an IMF-fixdate. The obsolete RFC 850 / asctime forms are rejected,
+// which makes If-Modified-Since fall back to a full response.
+// returns:
+//   bool: false when str is not a valid IMF-fixdate.
+bool HttpResponse::parseHttpDate(const std::string& str, time_t& t) {
+  // "Sun, 06 Nov 1994 08:49:37 GMT"
+  if (str.size() != 29 || str.compare(3, 2, ", ") != 0 || str[7] != ' ' ||
+      str[11] != ' ' || str[16] != ' ' || str[19] != ':' || str[22] != ':' ||
+      str.compare(25, 4, " GMT") != 0)
+    return (false);
+  int month = -1;
+  for (int i = 0; i < 12; ++i) {
+    if (str.compare(8, 3, MONTH_NAMES[i]) == 0)
+      month = i + 1;
+  }
+  const size_t digits[] = {5, 6, 12, 13, 14, 15, 17, 18, 20, 21, 23, 24};
+  for (size_t i = 0; i < sizeof(digits) / sizeof(digits[0]); ++i) {
+    if (!std::isdigit(static_cast<unsigned char>(str[digits[i]])))
+      return (false);
+  }
+  if (month < 0)
+    return (false);
+  int day = (str[5] - '0') * 10 + (str[6] - '0');
+  long year = std::atoi(str.substr(12, 4).c_str());
+  int hour = (str[17] - '0') * 10 + (str[18] - '0');
+  int min = (str[20] - '0') * 10 + (str[21] - '0');
+  int sec = (str[23] - '0') * 10 + (str[24] - '0');
+  if (day < 1 || day > 31 || hour > 23 || min > 59 || sec > 60)
+    return (false);
+
+  // days-from-civil
+  long y = year - (month <= 2 ? 1 : 0);
+  long era = (y >= 0 ? y : y - 399) / 400;
+  long yoe = y - era * 400;
+  long doy = (153 * (month > 2 ? month - 3 : month + 9) + 2) / 5 + day - 1;
+  long doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+  long days = era * 146097 + doe - 719468;
+  t = static_cast<time_t>(days * 86400 + hour * 3600 + min * 60 + sec);
+  return (true);
+}
+
 HttpResponse::HttpResponse()
     : _state(RES_HEADER),
       _statusCode(200),
       _statusMessage("OK"),
-      _bodyFileStream(NULL),
+      _bodyFd(-1),
+      _bodyFileSize(0),
+      _bodyOffset(0),
+      _bodyEnd(0),
+      _useSendfile(false),
       _requestMethod(GET),
       _isChunked(false),
       _chunkSize(1024),
-      _sentBytes(0) {}
+      _segIndex(0),
+      _segOffset(0),
+      _sentBytes(0),
+      _totalBytes(0),
+      _flatOrigin(0),
+      _asset(NULL),
+      _rangeIndex(0),
+      _gzip(NULL),
+      _gzipAccepted(false),
+      _deflater(NULL),
+      _deflateOffset(0),
+      _streamed(false),
+      _streamEnded(false),
+      _streamRemaining(0),
+      _useSplice(false) {
+  // 前の接続が使っていた送信バッファ・ボディ領域を再利用する
+  BufferPool::acquire(this->_body);
+  BufferPool::acquire(this->_responseBuffer);
+}
 
 HttpResponse::~HttpResponse() {
-  delete this->_bodyFileStream;
+  this->_stopCompression();
+  this->_closeBodyFile();
+  this->_releaseAsset();
+  BufferPool::release(this->_body);
+  BufferPool::release(this->_readBuffer);
+  BufferPool::release(this->_responseBuffer);
 }
 
 HttpResponse::HttpResponse(const HttpResponse& other)
@@ -127,13 +297,37 @@ HttpResponse::HttpResponse(const HttpResponse& other)
       _statusMessage(other._statusMessage),
       _headers(other._headers),
       _body(other._body),
-      _bodyFileStream(NULL),
+      _bodyFd(-1),
+      _bodyFileSize(0),
+      _bodyOffset(0),
+      _bodyEnd(0),
+      _useSendfile(other._useSendfile),
       _requestMethod(other._requestMethod),
       _errorMessage(other._errorMessage),
       _isChunked(other._isChunked),
       _chunkSize(other._chunkSize),
       _responseBuffer(other._responseBuffer),
-      _sentBytes(other._sentBytes) {}
+      _segIndex(0),
+      _segOffset(0),
+      _sentBytes(0),
+      _totalBytes(0),
+      _flatOrigin(0),
+      _asset(other._asset),
+      _rangeIndex(0),
+      _gzip(other._gzip),
+      _gzipAccepted(other._gzipAccepted),
+      _deflater(NULL),
+      _deflateOffset(0),
+      _streamed(other._streamed),
+      _streamEnded(other._streamEnded),
+      _streamBuffer(other._streamBuffer),
+      _streamRemaining(other._streamRemaining),
+      _useSplice(other._useSplice) {
+  if (this->_asset)
+    this->_asset->retain();
+  this->_readBuffer = other._readBuffer;
+  this->_copySegments(other);
+}
 
 HttpResponse& HttpResponse::operator=(const HttpResponse& other) {
   if (this != &other) {
@@ -142,14 +336,29 @@ HttpResponse& HttpResponse::operator=(const HttpResponse& other) {
     this->_statusMessage = other._statusMessage;
     this->_headers = other._headers;
     this->_body = other._body;
-    delete this->_bodyFileStream;
-    this->_bodyFileStream = NULL;
+    this->_closeBodyFile();
+    this->_useSendfile = other._useSendfile;
     this->_requestMethod = other._requestMethod;
     this->_errorMessage = other._errorMessage;
     this->_isChunked = other._isChunked;
     this->_chunkSize = other._chunkSize;
+    this->_readBuffer = other._readBuffer;
     this->_responseBuffer = other._responseBuffer;
-    this->_sentBytes = other._sentBytes;
+    // 圧縮中のストリームは引き継がない (ポリシーだけコピーする)
+    this->_stopCompression();
+    this->_gzip = other._gzip;
+    this->_gzipAccepted = other._gzipAccepted;
+    this->_streamed = other._streamed;
+    this->_streamEnded = other._streamEnded;
+    this->_streamBuffer = other._streamBuffer;
+    this->_streamRemaining = other._streamRemaining;
+    this->_useSplice = other._useSplice;
+    // セグメントが共有のエントリを指すので参照を引き継ぐ
+    if (other._asset)
+      other._asset->retain();
+    this->_releaseAsset();
+    this->_asset = other._asset;
+    this->_copySegments(other);
   }
   return (*this);
 }
@@ -160,14 +369,24 @@ void HttpResponse::clear() {
   this->_statusMessage = "OK";
   this->_headers.clear();
   this->_body.clear();
-  delete this->_bodyFileStream;
-  this->_bodyFileStream = NULL;
+  this->_closeBodyFile();
+  this->_useSendfile = false;
   this->_requestMethod = GET;
   this->_errorMessage.clear();
   this->_isChunked = false;
   this->_chunkSize = 1024;
-  this->_responseBuffer.clear();
-  this->_sentBytes = 0;
+  this->_releaseAsset();
+  this->_ranges.clear();
+  this->_rangeIndex = 0;
+  this->_stopCompression();
+  this->_gzip = NULL;
+  this->_gzipAccepted = false;
+  this->_streamed = false;
+  this->_streamEnded = false;
+  this->_streamBuffer.clear();
+  this->_streamRemaining = 0;
+  this->_useSplice = false;
+  this->_resetSegments();
 }
 
 void HttpResponse::setStatusCode(int code) {
@@ -177,17 +396,21 @@ void HttpResponse::setStatusCode(int code) {
     statusMap[200] = "OK";
     statusMap[201] = "Created";
     statusMap[204] = "No Content";
+    statusMap[206] = "Partial Content";
     statusMap[301] = "Moved Permanently";
     statusMap[302] = "Found";
+    statusMap[304] = "Not Modified";
     statusMap[400] = "Bad Request";
     statusMap[401] = "Unauthorized";
     statusMap[403] = "Forbidden";
     statusMap[404] = "Not Found";
     statusMap[405] = "Method Not Allowed";
+    statusMap[416] = "Range Not Satisfiable";
     statusMap[500] = "Internal Server Error";
     statusMap[501] = "Not Implemented";
     statusMap[502] = "Bad Gateway";
     statusMap[503] = "Service Unavailable";
+    statusMap[504] = "Gateway Timeout";
   }
   if (statusMap.count(code)) {
     _statusMessage = statusMap[code];
@@ -201,31 +424,53 @@ void HttpResponse::setHeader(const std::string& key, const std::string& value) {
 }
 
 void HttpResponse::setBody(const std::string& body) {
+  _releaseAsset();
   _body.assign(body.begin(), body.end());
 }
 
 void HttpResponse::setBody(const std::vector<char>& body) {
+  _releaseAsset();
   _body = body;
 }
 
-// Sets the input filestream to _bodyFileStream. if there is no "Content-Type" in _headers, sets "Content-Type" based on extension.
+// Opens the file and keeps its fd as the response body. if there is no "Content-Type" in _headers, sets "Content-Type" based on extension.
+// The body is streamed later either by sendfile(2) or by pread() into _readBuffer.
 // inputs:
 //   filepath: input file's filepath
 // returns:
-//   bool: false when allocation fails, filepath is invalid or error occurs while reading, otherwise true.
+//   bool: false when filepath is invalid or its size cannot be determined, otherwise true.
 bool HttpResponse::setBodyFile(const std::string& filepath) {
-  if (this->_bodyFileStream) {
-    delete this->_bodyFileStream;
-    this->_bodyFileStream = NULL;
-  }
+  this->_closeBodyFile();
 
-  this->_bodyFileStream = new std::ifstream(
-      filepath.c_str(), std::ios_base::in | std::ios_base::binary);
-  if (!this->_bodyFileStream->is_open()) {
-    delete this->_bodyFileStream;
-    this->_bodyFileStream = NULL;
+  int fd = open(filepath.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0)
+    return (false);
+  struct stat st;
+  if (fstat(fd, &st) < 0) {
+    close(fd);
     return (false);
   }
+  return (this->setBodyFd(fd, st.st_size, filepath));
+}
+
+// Uses an already opened fd as the response body (e.g. one shared by OpenFileCache).
+// The response takes ownership of fd and closes it when done.
+// inputs:
+//   fd: readable fd of a regular file
+//   size: file size to send
+//   filepath: used only to guess "Content-Type"
+// returns:
+//   bool: false when fd is invalid, otherwise true.
+bool HttpResponse::setBodyFd(int fd, off_t size, const std::string& filepath) {
+  this->_closeBodyFile();
+  this->_releaseAsset();
+  if (fd < 0)
+    return (false);
+  this->_bodyFd = fd;
+  this->_bodyFileSize = size;
+  this->_bodyOffset = 0;
+  this->_bodyEnd = size;
+  this->_ranges.clear();
 
   // if there is no content-type in headers, sets extension automatically.
   if (!this->_headers.count("Content-Type"))
@@ -234,14 +479,62 @@ bool HttpResponse::setBodyFile(const std::string& filepath) {
   return (true);
 }
 
+// Limits the file body to the given byte ranges and turns the response into a
+// 206. build() sends one range with Content-Range, or several as
+// multipart/byteranges. Each range is read from its own offset, so nothing
+// before it is touched.
+// inputs:
+//   ranges: satisfiable ranges within the file, in the order to send them
+// returns:
+//   bool: false when there is no file body or ranges is empty.
+bool HttpResponse::setBodyRanges(const std::vector<ByteRange>& ranges) {
+  if (this->_bodyFd < 0 || ranges.empty())
+    return (false);
+  this->_ranges = ranges;
+  this->_rangeIndex = 0;
+  this->setStatusCode(206);
+  return (true);
+}
+
+// Serves a CachedAsset without formatting headers. build() keeps the asset as
+// long as the response is still a plain 200 (see _layoutAsset()).
+// returns:
+//   bool: false when headers other than "Connection" are already set.
+bool HttpResponse::setCachedAsset(CachedAsset* asset) {
+  if (!this->_onlyConnectionHeader())
+    return (false);
+  this->_closeBodyFile();
+  this->_body.clear();
+  asset->retain();
+  this->_releaseAsset();
+  this->_asset = asset;
+  this->setStatusCode(200);
+  this->_layoutAsset();
+  return (true);
+}
+
 void HttpResponse::setChunked(bool isChunked) {
   this->_isChunked = isChunked;
 }
 
+void HttpResponse::setSendfile(bool enable) {
+  this->_useSendfile = enable;
+}
+
+// Sets the on-the-fly gzip policy for an in-memory body.
+// When the body qualifies (see _compressible) but the client does not accept
+// gzip, build() still adds "Vary: Accept-Encoding".
+void HttpResponse::setCompression(const GzipConfig* gzip, bool accepted) {
+  this->_gzip = gzip;
+  this->_gzipAccepted = accepted;
+}
+
 void HttpResponse::setRequestMethod(HttpMethod method) {
   this->_requestMethod = method;
 }
 
+// Parses CGI output ("header lines, empty line, body") in place.
+// Header lines may end with "\r\n" or "\n". The body is copied into _body once.
 void HttpResponse::parseCgiResponse(const std::string& output) {
   if (output.empty()) {
     setStatusCode(502);  // Bad gateway
@@ -251,29 +544,136 @@ void HttpResponse::parseCgiResponse(const std::string& output) {
 
   setStatusCode(200);
 
-  std::string buffer = output;
-  std::string body;
+  std::string::size_type pos = 0;
+  if (!this->_parseCgiHeaders(output, pos))
+    return;
+  _body.assign(output.begin() + pos, output.end());
+}
 
-  while (true) {
-    std::string::size_type eolPos = buffer.find("\r\n");
-    std::string::size_type eolSize = 2;
-    if (eolPos == std::string::npos) {
-      eolPos = buffer.find("\n");
-      eolSize = 1;
-    }
+// Starts a streamed CGI response from its header block (up to and including
+// the empty line). build() then sends the headers, and the body is passed in
+// with appendStream() as the script writes it.
+// returns:
+//   bool: false when the Status header is invalid (a 502 body is set).
+bool HttpResponse::beginStream(const std::string& cgiHeader) {
+  setStatusCode(200);
+  std::string::size_type pos = 0;
+  if (!this->_parseCgiHeaders(cgiHeader, pos))
+    return (false);
+  this->_streamed = true;
+  this->_streamEnded = false;
+  this->_streamBuffer.clear();
+  return (true);
+}
+
+// Queues len more body bytes. They are sent as soon as the segments in
+// flight have been written; bytes past the script's Content-Length are
+// dropped.
+void HttpResponse::appendStream(const char* data, size_t len) {
+  if (!this->_streamed || this->_streamEnded || this->_state != RES_BODY)
+    return;  // HEAD など、ボディを送らない応答
+  if (!this->_isChunked) {
+    len = std::min(len, this->_streamRemaining);
+    this->_streamRemaining -= len;
+  }
+  if (len == 0)
+    return;
+  try {
+    this->_streamBuffer.insert(this->_streamBuffer.end(), data, data + len);
+  } catch (const std::bad_alloc& e) {
+    this->abortStream();
+    return;
+  }
+  if (this->_segIndex >= this->_segments.size())
+    this->_streamNext();
+}
+
+// Marks the end of the streamed body. A body shorter than the Content-Length
+// the script announced cannot be completed, so the response is aborted.
+void HttpResponse::endStream() {
+  if (!this->_streamed || this->_streamEnded || this->_state != RES_BODY)
+    return;
+  this->_streamEnded = true;
+  if (!this->_isChunked && this->_streamRemaining > 0) {
+    this->abortStream();
+    return;
+  }
+  if (this->_segIndex >= this->_segments.size())
+    this->_streamNext();
+}
+
+void HttpResponse::abortStream() {
+  this->_stopCompression();
+  this->_streamBuffer.clear();
+  this->_resetSegments();
+  this->_state = RES_ERROR;
+  this->_errorMessage = "Response body stream was cut short";
+}
 
+bool HttpResponse::isStreaming() const {
+  return (this->_streamed);
+}
+
+bool HttpResponse::isStreamIdle() const {
+  return (this->_streamed && this->_state == RES_BODY &&
+          this->_segIndex >= this->_segments.size());
+}
+
+size_t HttpResponse::getStreamBuffered() const {
+  return (this->_streamBuffer.size() + this->getRemainingSize());
+}
+
+void HttpResponse::setSplice(bool enable) {
+  this->_useSplice = enable;
+}
+
+// Returns true while the rest of the streamed body can go from the CGI pipe
+// to the socket with splice(2): the length is known and no chunk framing or
+// compression has to be added to the bytes.
+bool HttpResponse::isSpliceBody() const {
+  return (this->_useSplice && this->_streamed && !this->_streamEnded &&
+          this->_state == RES_BODY && !this->_isChunked &&
+          !this->_deflater && this->_streamRemaining > 0);
+}
+
+// Returns true when the headers and the buffered body have been sent, so the
+// next bytes must come from splice(2).
+bool HttpResponse::isSplicePending() const {
+  return (this->isSpliceBody() && this->_streamBuffer.empty() &&
+          this->_segIndex >= this->_segments.size());
+}
+
+size_t HttpResponse::getSpliceRemaining() const {
+  return (this->isSpliceBody() ? this->_streamRemaining : 0);
+}
+
+// Marks n bytes of the streamed body as sent by splice(2). The response still
+// ends with endStream(); output past the Content-Length is dropped as usual.
+void HttpResponse::advanceSplice(size_t n) {
+  this->_streamRemaining -= std::min(n, this->_streamRemaining);
+}
+
+// Parses the CGI header lines of output from pos up to the empty line and
+// leaves pos at the first body byte.
+// returns:
+//   bool: false when the Status header is invalid (a 502 body is set).
+bool HttpResponse::_parseCgiHeaders(const std::string& output,
+                                    std::string::size_type& pos) {
+  while (true) {
+    std::string::size_type eolPos = output.find('\n', pos);
     if (eolPos == std::string::npos) {
-      body = buffer;
+      // 区切りの空行がない → 残りは全てボディ
       break;
     }
-
-    if (eolPos == 0) {
-      buffer.erase(0, eolSize);
-      body = buffer;
+    std::string::size_type lineEnd = eolPos;
+    if (lineEnd > pos && output[lineEnd - 1] == '\r')
+      --lineEnd;
+    if (lineEnd == pos) {
+      pos = eolPos + 1;
       break;
     }
-    std::string line = buffer.substr(0, eolPos);
-    buffer.erase(0, eolPos + eolSize);
+    std::string line = output.substr(pos, lineEnd - pos);
+    pos = eolPos + 1;
 
     std::string key, val;
     if (!parseHeaderLine(line, key, val))
@@ -287,13 +687,13 @@ void HttpResponse::parseCgiResponse(const std::string& output) {
       } else {
         setStatusCode(502);  // Bad gateway
         setBody("CGI Error: Invalid Status header format");
-        return;
+        return (false);
       }
     } else {
       setHeader(keyLower, val);
     }
   }
-  setBody(body);
+  return (true);
 }
 
 void HttpResponse::makeErrorResponse(int code, const ServerConfig* config) {
@@ -305,25 +705,157 @@ void HttpResponse::makeErrorResponse(int code, const ServerConfig* config) {
       buildErrorHtml(this->_statusCode, this->_statusMessage);
   this->setBody(html_body);
   this->setHeader("Content-Type", "text/html");
+  if (code == 503) {
+    // 混雑による一時的な拒否なので、再試行までの秒数を伝える
+    std::ostringstream ss;
+    ss << RETRY_AFTER_SEC;
+    this->setHeader("Retry-After", ss.str());
+  }
 }
 
-// builds http response(status line, response header, response body) based on its attributes.
+// Appends the status line and the response headers to _responseBuffer.
 // status line: "HTTP/1.1 <status code> <status message>\r\n"
-// response header: "key: value\r\n" iteration
-// response body: body content
+// response header: "key: value\r\n" iteration, then an empty line
+void HttpResponse::_appendHeaderBlock() {
+  appendBytes(this->_responseBuffer, "HTTP/1.1 ", 9);
+  appendDecimal(this->_responseBuffer, this->_statusCode);
+  this->_responseBuffer.push_back(' ');
+  appendString(this->_responseBuffer, this->_statusMessage);
+  appendBytes(this->_responseBuffer, CRLF, 2);
+  for (std::map<std::string, std::string>::iterator it =
+           this->_headers.begin();
+       it != this->_headers.end(); ++it) {
+    appendString(this->_responseBuffer, it->first);
+    appendBytes(this->_responseBuffer, ": ", 2);
+    appendString(this->_responseBuffer, it->second);
+    appendBytes(this->_responseBuffer, CRLF, 2);
+  }
+  appendBytes(this->_responseBuffer, CRLF, 2);
+}
+
+// Serializes the header block of a 200 response for AssetCache.
+// "Connection" is left out because it differs per connection; the returned
+// offset is where its line belongs in name order.
+size_t HttpResponse::buildCachedHeader(
+    const std::map<std::string, std::string>& headers, size_t contentLength,
+    std::vector<char>& out) {
+  std::map<std::string, std::string> fields(headers);
+  fields.erase("Connection");
+  std::ostringstream lenSs;
+  lenSs << contentLength;
+  fields["Content-Length"] = lenSs.str();
+
+  const std::string connection = "Connection";
+  out.clear();
+  appendBytes(out, "HTTP/1.1 200 OK", 15);
+  appendBytes(out, CRLF, 2);
+  size_t split = out.size();
+  for (std::map<std::string, std::string>::const_iterator it = fields.begin();
+       it != fields.end(); ++it) {
+    appendString(out, it->first);
+    appendBytes(out, ": ", 2);
+    appendString(out, it->second);
+    appendBytes(out, CRLF, 2);
+    if (it->first < connection)
+      split = out.size();
+  }
+  appendBytes(out, CRLF, 2);
+  return (split);
+}
+
+// builds http response(status line, response header, response body) based on its attributes.
+// The response is kept as a list of segments for writev(2):
+//   plain:   [header block] [body]
+//   chunked: [header block] [size line] [part] ["\r\n" size line] [part] ...
+//            ["\r\n0\r\n\r\n"]
+// The body itself is never copied; segments point into _body.
 void HttpResponse::build() {
   try {
-    this->_responseBuffer.clear();
-    this->_sentBytes = 0;
-
-    if (this->_bodyFileStream && this->_bodyFileStream->is_open()) {
-      this->_bodyFileStream->clear();
-      this->_bodyFileStream->seekg(0, std::ios::beg);
-      if (this->_bodyFileStream->fail()) {
-        this->_state = RES_ERROR;
-        this->_errorMessage = "Failed to seek file stream";
+    if (this->_streamed && this->_state != RES_HEADER) {
+      return;  // ストリーミング中の応答は組み立て済み (送信が始まっている)
+    }
+    if (this->_asset) {
+      if (this->_statusCode == 200 && this->_onlyConnectionHeader()) {
+        this->_layoutAsset();
         return;
       }
+      // ステータスやヘッダが後から変わった → 通常のボディとして組み立て直す
+      this->_materializeAsset();
+    }
+    this->_resetSegments();
+
+    this->_bodyOffset = 0;
+    this->_bodyEnd = this->_bodyFileSize;
+
+    bool multipart = false;
+    if (!this->_ranges.empty() && this->_bodyFd >= 0) {
+      // Range 応答はファイルの区間をそのまま送る (chunked にしない)
+      this->_isChunked = false;
+      this->_rangeIndex = 0;
+      const ByteRange& first = this->_ranges[0];
+      if (this->_ranges.size() == 1) {
+        std::ostringstream rangeSs;
+        rangeSs << "bytes " << first.first << "-" << first.last << "/"
+                << this->_bodyFileSize;
+        this->_headers["Content-Range"] = rangeSs.str();
+        std::ostringstream lenSs;
+        lenSs << (first.last - first.first + 1);
+        this->_headers["Content-Length"] = lenSs.str();
+      } else {
+        static unsigned long boundaryCounter = 0;
+        std::ostringstream boundarySs;
+        boundarySs << std::setfill('0') << std::setw(20) << ++boundaryCounter;
+        this->_boundary = boundarySs.str();
+        this->_partType = this->_headers["Content-Type"];
+        this->_headers["Content-Type"] =
+            "multipart/byteranges; boundary=" + this->_boundary;
+        std::ostringstream lenSs;
+        lenSs << this->_multipartLength();
+        this->_headers["Content-Length"] = lenSs.str();
+        multipart = true;
+      }
+      this->_bodyOffset = first.first;
+      this->_bodyEnd = first.last + 1;
+    }
+
+    this->_stopCompression();
+    bool compress = this->_compressible();
+    if (compress) {
+      // 圧縮するかどうかで応答が変わるので、受け付けない相手にも Vary を返す
+      if (findHeader(this->_headers, "vary") == this->_headers.end())
+        this->_headers["Vary"] = "Accept-Encoding";
+      compress = this->_gzipAccepted;
+    }
+    if (compress) {
+      // 圧縮後の長さは送り終えるまで分からないので chunked で送る
+      std::map<std::string, std::string>::const_iterator it;
+      while ((it = findHeader(this->_headers, "content-length")) !=
+             this->_headers.end())
+        this->_headers.erase(it->first);
+      this->_headers["Content-Encoding"] = "gzip";
+      this->_isChunked = true;
+    }
+
+    if (this->_streamed && !compress) {
+      // CGI が Content-Length を返していればそのまま送り、なければ chunked
+      std::map<std::string, std::string>::const_iterator it =
+          findHeader(this->_headers, "content-length");
+      std::string length;
+      if (it != this->_headers.end()) {
+        length = trim(it->second);
+        this->_headers.erase(it->first);
+      }
+      char* end = NULL;
+      unsigned long value = std::strtoul(length.c_str(), &end, 10);
+      if (!length.empty() && *end == '\0' && length[0] != '-') {
+        std::ostringstream lenSs;
+        lenSs << value;
+        this->_headers["Content-Length"] = lenSs.str();
+        this->_streamRemaining = value;
+        this->_isChunked = false;
+      } else {
+        this->_isChunked = true;
+      }
     }
 
     // Complies to RFC 7230 Section 3.3: handles status codes that forbid message bodies
@@ -337,27 +869,9 @@ void HttpResponse::build() {
       this->_headers["Transfer-Encoding"] = "chunked";
     } else {
       if (!this->_headers.count("Content-Length")) {
-        if (this->_bodyFileStream && this->_bodyFileStream->is_open()) {
-          this->_bodyFileStream->seekg(0, std::ios::end);
-          if (this->_bodyFileStream->fail()) {
-            this->_state = RES_ERROR;
-            this->_errorMessage = "Failed to seek file to end";
-            return;
-          }
-          std::streampos endPos = this->_bodyFileStream->tellg();
-          if (endPos == std::streampos(-1)) {
-            this->_state = RES_ERROR;
-            this->_errorMessage = "Failed to determine file size";
-            return;
-          }
-          this->_bodyFileStream->seekg(0, std::ios::beg);
-          if (this->_bodyFileStream->fail()) {
-            this->_state = RES_ERROR;
-            this->_errorMessage = "Failed to seek file to beginning";
-            return;
-          }
+        if (this->_bodyFd >= 0) {
           std::ostringstream lenSs;
-          lenSs << endPos;
+          lenSs << this->_bodyFileSize;
           this->_headers["Content-Length"] = lenSs.str();
         } else {
           std::ostringstream lenSs;
@@ -372,61 +886,70 @@ void HttpResponse::build() {
       hasBody = false;
     }
 
-    // creates status line and response header string
-    std::ostringstream ss;
-    ss << "HTTP/1.1 " << this->_statusCode << " " << this->_statusMessage
-       << "\r\n";
-    for (std::map<std::string, std::string>::iterator it =
-             this->_headers.begin();
-         it != this->_headers.end(); ++it) {
-      ss << it->first << ": " << it->second << "\r\n";
+    this->_appendHeaderBlock();
+    if (multipart && hasBody)
+      this->_appendPartHeader(this->_responseBuffer, this->_ranges[0]);
+    size_t headerSize = this->_responseBuffer.size();
+
+    bool inlineChunks =
+        hasBody && this->_bodyFd < 0 && this->_isChunked && !compress;
+    if (inlineChunks) {
+      // チャンクサイズ行も _responseBuffer に置く。先に容量を確保して
+      // 以降の追記で再確保が起きない (セグメントのポインタが無効にならない)
+      // ようにする
+      size_t chunks = (this->_body.size() + this->_chunkSize - 1) /
+                      this->_chunkSize;
+      this->_responseBuffer.reserve(headerSize +
+                                    chunks * MAX_CHUNK_FRAMING);
     }
-    ss << "\r\n";
-
-    // insert status line and response header string to buffer
-    std::string statusLineAndHeader = ss.str();
-    this->_responseBuffer.insert(this->_responseBuffer.end(),
-                                 statusLineAndHeader.begin(),
-                                 statusLineAndHeader.end());
+    this->_addSegment(&this->_responseBuffer[0], headerSize);
 
     if (!hasBody) {
       this->_state = RES_DONE;
       return;
     }
 
-    if (this->_bodyFileStream && this->_bodyFileStream->is_open()) {
+    if (this->_bodyFd >= 0) {
+      this->_state = RES_BODY;
+    } else if (this->_streamed) {
+      // ボディは appendStream() で届いた分から送る
+      if (compress) {
+        this->_deflater = new Deflater(this->_gzip->level);
+        this->_deflateOffset = 0;
+        this->_body.clear();
+      }
+      this->_state = RES_BODY;
+    } else if (compress) {
+      // ボディは advance() がヘッダを送り終えるたびに少しずつ圧縮する
+      this->_deflater = new Deflater(this->_gzip->level);
+      this->_deflateOffset = 0;
       this->_state = RES_BODY;
     } else {
-      // insert response body to buffer
       if (this->_isChunked) {
         size_t offset = 0;
         while (offset < this->_body.size()) {
           size_t currentSize =
               std::min(this->_chunkSize, this->_body.size() - offset);
 
-          std::ostringstream currentSizeSs;
-          currentSizeSs << std::hex << currentSize << "\r\n";
-          std::string sizeSection = currentSizeSs.str();
-
-          this->_responseBuffer.insert(this->_responseBuffer.end(),
-                                       sizeSection.begin(), sizeSection.end());
-          this->_responseBuffer.insert(
-              this->_responseBuffer.end(), this->_body.begin() + offset,
-              this->_body.begin() + offset + currentSize);
-
-          const char* crlf = "\r\n";
-          this->_responseBuffer.insert(this->_responseBuffer.end(), crlf,
-                                       crlf + 2);
+          // 前のチャンクの "\r\n" とサイズ行をまとめて1セグメントにする
+          size_t lineStart = this->_responseBuffer.size();
+          if (offset > 0)
+            appendBytes(this->_responseBuffer, CRLF, 2);
+          appendHex(this->_responseBuffer, currentSize);
+          appendBytes(this->_responseBuffer, CRLF, 2);
+          this->_addSegment(&this->_responseBuffer[lineStart],
+                            this->_responseBuffer.size() - lineStart);
+          this->_addSegment(&this->_body[offset], currentSize);
 
           offset += currentSize;
         }
 
-        const char* endChunk = "0\r\n\r\n";
-        this->_responseBuffer.insert(this->_responseBuffer.end(), endChunk,
-                                     endChunk + 5);
-      } else {
-        this->_responseBuffer.insert(this->_responseBuffer.end(),
-                                     this->_body.begin(), this->_body.end());
+        if (this->_body.empty())
+          this->_addSegment(LAST_CHUNK, sizeof(LAST_CHUNK) - 1);
+        else
+          this->_addSegment(CRLF_LAST_CHUNK, sizeof(CRLF_LAST_CHUNK) - 1);
+      } else if (!this->_body.empty()) {
+        this->_addSegment(&this->_body[0], this->_body.size());
       }
       this->_state = RES_DONE;
     }
@@ -439,43 +962,95 @@ void HttpResponse::build() {
   }
 }
 
+int HttpResponse::getIovec(struct iovec* iov, int maxCount) const {
+  int count = 0;
+  for (size_t i = this->_segIndex;
+       i < this->_segments.size() && count < maxCount; ++i) {
+    iov[count] = this->_segments[i];
+    if (i == this->_segIndex) {
+      iov[count].iov_base =
+          static_cast<char*>(iov[count].iov_base) + this->_segOffset;
+      iov[count].iov_len -= this->_segOffset;
+    }
+    ++count;
+  }
+  return (count);
+}
+
+// Returns the unsent part of the response as one contiguous block.
+// Only when more than one segment is left, the segments are concatenated into
+// _flatBuffer (once per segment list). The write path uses getIovec() instead.
 const char* HttpResponse::getData() const {
-  if (this->_responseBuffer.empty() ||
-      this->_sentBytes >= this->_responseBuffer.size())
+  if (this->_segIndex >= this->_segments.size())
     return (NULL);
-  return (&this->_responseBuffer[this->_sentBytes]);
+  const struct iovec& current = this->_segments[this->_segIndex];
+  if (this->_segIndex + 1 == this->_segments.size())
+    return (static_cast<const char*>(current.iov_base) + this->_segOffset);
+
+  if (this->_flatBuffer.empty() || this->_sentBytes < this->_flatOrigin) {
+    this->_flatBuffer.clear();
+    this->_flatOrigin = this->_sentBytes;
+    for (size_t i = this->_segIndex; i < this->_segments.size(); ++i) {
+      const char* base = static_cast<const char*>(this->_segments[i].iov_base);
+      size_t len = this->_segments[i].iov_len;
+      if (i == this->_segIndex) {
+        base += this->_segOffset;
+        len -= this->_segOffset;
+      }
+      this->_flatBuffer.insert(this->_flatBuffer.end(), base, base + len);
+    }
+  }
+  return (&this->_flatBuffer[this->_sentBytes - this->_flatOrigin]);
 }
 
 size_t HttpResponse::getRemainingSize() const {
-  if (this->_sentBytes >= this->_responseBuffer.size()) {
-    return (0);
-  } else {
-    return (this->_responseBuffer.size() - this->_sentBytes);
-  }
+  return (this->_totalBytes - this->_sentBytes);
 }
 
 void HttpResponse::advance(size_t n) {
-  if (this->_sentBytes >= this->_responseBuffer.size() ||
-      this->_responseBuffer.size() - this->_sentBytes < n) {
-    this->_sentBytes = this->_responseBuffer.size();
-  } else {
-    this->_sentBytes += n;
+  // セグメントをまたいで送信位置を進める (残り以上は切り捨て)
+  while (n > 0 && this->_segIndex < this->_segments.size()) {
+    size_t left = this->_segments[this->_segIndex].iov_len - this->_segOffset;
+    if (n < left) {
+      this->_segOffset += n;
+      this->_sentBytes += n;
+      break;
+    }
+    n -= left;
+    this->_sentBytes += left;
+    ++this->_segIndex;
+    this->_segOffset = 0;
   }
-  if (this->_sentBytes < this->_responseBuffer.size()) {
+  if (this->_segIndex < this->_segments.size()) {
     return;
   }
 
-  this->_responseBuffer.clear();
-  this->_sentBytes = 0;
+  this->_resetSegments();
 
   if (this->_state == RES_DONE || this->_state == RES_ERROR) {
     return;
   }
 
   if (this->_state == RES_BODY) {
-    if (!this->_bodyFileStream || !this->_bodyFileStream->is_open()) {
+    if (this->_streamed) {
+      this->_streamNext();
+      return;
+    }
+    if (this->_deflater) {
+      this->_deflateNext();
+      return;
+    }
+    if (this->_bodyFd < 0) {
       this->_state = RES_ERROR;
-      this->_errorMessage = "File stream is not open";
+      this->_errorMessage = "Body file is not open";
+      return;
+    }
+    // sendfile 経路ではボディをバッファに詰めず、advanceBody() で進める
+    if (this->_useSendfile && !this->_isChunked) {
+      if (this->getBodyRemaining() == 0) {
+        this->_closeBodyFile();
+        this->_state = RES_DONE;
+      }
       return;
     }
 
@@ -489,80 +1064,59 @@ void HttpResponse::advance(size_t n) {
       }
     }
 
-    this->_bodyFileStream->read(&this->_readBuffer[0], this->_chunkSize);
-    std::streamsize bytesRead = this->_bodyFileStream->gcount();
-
-    if (this->_bodyFileStream->bad()) {
+    size_t toRead = std::min(this->_chunkSize, this->getBodyRemaining());
+    ssize_t bytesRead = 0;
+    if (toRead > 0) {
+      bytesRead = pread(this->_bodyFd, &this->_readBuffer[0], toRead,
+                        this->_bodyOffset);
+    }
+    if (bytesRead < 0) {
       this->_state = RES_ERROR;
       this->_errorMessage = "File read error occurred";
       return;
     }
+    this->_bodyOffset += bytesRead;
+    bool finished = (bytesRead == 0 || this->_bodyOffset >= this->_bodyEnd);
 
+    // 読んだ _readBuffer をそのまま送る (チャンクの場合はサイズ行と CRLF を挟む)
     if (bytesRead > 0) {
-      try {
-        if (this->_isChunked) {
-          std::ostringstream ss;
-          ss << std::hex << bytesRead << "\r\n";
-          std::string header = ss.str();
-
-          this->_responseBuffer.insert(this->_responseBuffer.end(),
-                                       header.begin(), header.end());
-          this->_responseBuffer.insert(this->_responseBuffer.end(),
-                                       this->_readBuffer.begin(),
-                                       this->_readBuffer.begin() + bytesRead);
-          const char* crlf = "\r\n";
-          this->_responseBuffer.insert(this->_responseBuffer.end(), crlf,
-                                       crlf + 2);
-        } else {
-          this->_responseBuffer.insert(this->_responseBuffer.end(),
-                                       this->_readBuffer.begin(),
-                                       this->_readBuffer.begin() + bytesRead);
-        }
-      } catch (const std::bad_alloc& e) {
-        this->_state = RES_ERROR;
-        this->_errorMessage = "Failed to allocate response buffer";
-        return;
-      } catch (const std::exception& e) {
-        this->_state = RES_ERROR;
-        this->_errorMessage = "Unexpected error during buffer operation";
-        return;
-      }
-    }
-    if (bytesRead < static_cast<std::streamsize>(this->_chunkSize) ||
-        this->_bodyFileStream->eof()) {
-      if (this->_bodyFileStream->is_open()) {
-        this->_bodyFileStream->close();
-      }
       if (this->_isChunked) {
-        this->_state = RES_FINISH;
-        if (bytesRead > 0)
+        try {
+          appendHex(this->_responseBuffer, static_cast<size_t>(bytesRead));
+          appendBytes(this->_responseBuffer, CRLF, 2);
+        } catch (const std::bad_alloc& e) {
+          this->_state = RES_ERROR;
+          this->_errorMessage = "Failed to allocate response buffer";
           return;
-      } else {
-        this->_state = RES_DONE;
-        return;
+        }
+        this->_addSegment(&this->_responseBuffer[0],
+                          this->_responseBuffer.size());
       }
-    } else {
+      this->_addSegment(&this->_readBuffer[0], static_cast<size_t>(bytesRead));
+    }
+    if (!finished) {
+      if (this->_isChunked)
+        this->_addSegment(CRLF, 2);
       return;
     }
-  }
-  if (this->_state == RES_FINISH) {
-    try {
-
-      const char* endChunk = "0\r\n\r\n";
-      this->_responseBuffer.insert(this->_responseBuffer.end(), endChunk,
-                                   endChunk + 5);
-      this->_state = RES_DONE;
-    } catch (const std::bad_alloc& e) {
-      this->_state = RES_ERROR;
-      this->_errorMessage = "Failed to allocate buffer for end chunk";
+    if (this->_nextRange())
       return;
+
+    this->_closeBodyFile();
+    if (this->_isChunked) {
+      // 最後のデータと終端チャンクを同じセグメント列で送る
+      if (bytesRead > 0)
+        this->_addSegment(CRLF_LAST_CHUNK, sizeof(CRLF_LAST_CHUNK) - 1);
+      else
+        this->_addSegment(LAST_CHUNK, sizeof(LAST_CHUNK) - 1);
     }
+    this->_state = RES_DONE;
   }
 }
 
 bool HttpResponse::isDone() const {
   return (this->_state == RES_DONE &&
-          this->_sentBytes >= this->_responseBuffer.size());
+          this->_segIndex >= this->_segments.size());
 }
 
 bool HttpResponse::isError() const {
@@ -572,3 +1126,354 @@ bool HttpResponse::isError() const {
 std::string HttpResponse::getErrorMessage() const {
   return this->_errorMessage;
 }
+
+// Returns true when the header part has been fully sent and the remaining file body
+// should be written with sendfile(2) instead of being copied into _responseBuffer.
+bool HttpResponse::isSendfilePending() const {
+  return (this->_useSendfile && !this->_isChunked &&
+          this->_state == RES_BODY && this->_bodyFd >= 0 &&
+          this->_segIndex >= this->_segments.size());
+}
+
+int HttpResponse::getBodyFd() const {
+  return this->_bodyFd;
+}
+
+off_t HttpResponse::getBodyOffset() const {
+  return this->_bodyOffset;
+}
+
+size_t HttpResponse::getBodyRemaining() const {
+  if (this->_bodyFd < 0 || this->_bodyOffset >= this->_bodyEnd)
+    return (0);
+  return (static_cast<size_t>(this->_bodyEnd - this->_bodyOffset));
+}
+
+// Marks n bytes of the file body as sent by sendfile(2).
+// Closes the file and finishes the response once the whole body has been sent.
+void HttpResponse::advanceBody(size_t n) {
+  size_t remaining = this->getBodyRemaining();
+  if (n > remaining)
+    n = remaining;
+  this->_bodyOffset += static_cast<off_t>(n);
+  if (this->getBodyRemaining() == 0) {
+    if (this->_nextRange())
+      return;
+    this->_closeBodyFile();
+    this->_state = RES_DONE;
+  }
+}
+
+// Drops the current segment list. Keeps the capacity of the owned buffers.
+void HttpResponse::_resetSegments() {
+  this->_responseBuffer.clear();
+  this->_segments.clear();
+  this->_segIndex = 0;
+  this->_segOffset = 0;
+  this->_sentBytes = 0;
+  this->_totalBytes = 0;
+  this->_flatBuffer.clear();
+  this->_flatOrigin = 0;
+}
+
+void HttpResponse::_addSegment(const char* data, size_t len) {
+  if (len == 0)
+    return;
+  struct iovec segment;
+  segment.iov_base = const_cast<char*>(data);
+  segment.iov_len = len;
+  this->_segments.push_back(segment);
+  this->_totalBytes += len;
+}
+
+// Copies the unsent segments of other, pointing them at this object's copies
+// of _responseBuffer / _body / _readBuffer. Static segments are shared.
+void HttpResponse::_copySegments(const HttpResponse& other) {
+  this->_segments.clear();
+  this->_segIndex = 0;
+  this->_segOffset = 0;
+  this->_sentBytes = 0;
+  this->_totalBytes = 0;
+  this->_flatBuffer.clear();
+  this->_flatOrigin = 0;
+
+  const std::vector<char>* sources[3] = {&other._responseBuffer, &other._body,
+                                         &other._readBuffer};
+  const std::vector<char>* targets[3] = {&this->_responseBuffer, &this->_body,
+                                         &this->_readBuffer};
+  for (size_t i = other._segIndex; i < other._segments.size(); ++i) {
+    const char* base = static_cast<const char*>(other._segments[i].iov_base);
+    size_t len = other._segments[i].iov_len;
+    if (i == other._segIndex) {
+      base += other._segOffset;
+      len -= other._segOffset;
+    }
+    for (size_t j = 0; j < 3; ++j) {
+      const std::vector<char>& src = *sources[j];
+      if (!src.empty() && base >= &src[0] && base < &src[0] + src.size()) {
+        base = &(*targets[j])[0] + (base - &src[0]);
+        break;
+      }
+    }
+    this->_addSegment(base, len);
+  }
+}
+
+bool HttpResponse::_onlyConnectionHeader() const {
+  size_t allowed = this->_headers.count("Connection");
+  return (this->_headers.size() == allowed);
+}
+
+// Lays out the segments of a cached response:
+//   [status line ..] [Connection line] [.. rest of header] [body]
+// Only the Connection line is formatted here; everything else points into
+// the shared asset.
+void HttpResponse::_layoutAsset() {
+  this->_resetSegments();
+  std::map<std::string, std::string>::const_iterator conn =
+      this->_headers.find("Connection");
+  if (conn != this->_headers.end()) {
+    appendString(this->_responseBuffer, conn->first);
+    appendBytes(this->_responseBuffer, ": ", 2);
+    appendString(this->_responseBuffer, conn->second);
+    appendBytes(this->_responseBuffer, CRLF, 2);
+  }
+  const std::vector<char>& header = this->_asset->header();
+  size_t split = this->_asset->headerSplit();
+  this->_addSegment(&header[0], split);
+  if (!this->_responseBuffer.empty())
+    this->_addSegment(&this->_responseBuffer[0], this->_responseBuffer.size());
+  this->_addSegment(&header[split], header.size() - split);
+
+  const std::vector<char>& body = this->_asset->body();
+  if (this->_requestMethod != HEAD && !body.empty())
+    this->_addSegment(&body[0], body.size());
+  this->_state = RES_DONE;
+}
+
+// Turns the cached response back into an ordinary body and headers.
+void HttpResponse::_materializeAsset() {
+  const std::map<std::string, std::string>& fields = this->_asset->fields();
+  for (std::map<std::string, std::string>::const_iterator it = fields.begin();
+       it != fields.end(); ++it) {
+    if (!this->_headers.count(it->first))
+      this->_headers[it->first] = it->second;
+  }
+  this->_body = this->_asset->body();
+  this->_releaseAsset();
+}
+
+// Appends the boundary and headers that precede one part of a
+// multipart/byteranges body.
+void HttpResponse::_appendPartHeader(std::vector<char>& out,
+                                     const ByteRange& range) const {
+  std::ostringstream ss;
+  ss << CRLF << "--" << this->_boundary << CRLF;
+  if (!this->_partType.empty())
+    ss << "Content-Type: " << this->_partType << CRLF;
+  ss << "Content-Range: bytes " << range.first << "-" << range.last << "/"
+     << this->_bodyFileSize << CRLF << CRLF;
+  appendString(out, ss.str());
+}
+
+// Content-Length of the multipart/byteranges body: every part header and
+// range, then the closing boundary.
+size_t HttpResponse::_multipartLength() const {
+  std::vector<char> part;
+  size_t total = 0;
+  for (size_t i = 0; i < this->_ranges.size(); ++i) {
+    part.clear();
+    this->_appendPartHeader(part, this->_ranges[i]);
+    const ByteRange& range = this->_ranges[i];
+    total += part.size() + static_cast<size_t>(range.last - range.first + 1);
+  }
+  return (total + 2 + 2 + this->_boundary.size() + 2 + 2);
+}
+
+// Called when the current range has been sent. For multipart responses,
+// queues the next part header and moves the file offset to that range, or
+// queues the closing boundary after the last part.
+// returns:
+//   bool: true when another range follows (the response stays in RES_BODY).
+bool HttpResponse::_nextRange() {
+  if (this->_ranges.size() < 2)
+    return (false);
+  // 直前のセグメントは送信済みか、_responseBuffer 以外を指している
+  size_t start = this->_responseBuffer.size();
+  if (++this->_rangeIndex < this->_ranges.size()) {
+    const ByteRange& range = this->_ranges[this->_rangeIndex];
+    this->_appendPartHeader(this->_responseBuffer, range);
+    this->_addSegment(&this->_responseBuffer[start],
+                      this->_responseBuffer.size() - start);
+    this->_bodyOffset = range.first;
+    this->_bodyEnd = range.last + 1;
+    return (true);
+  }
+  appendBytes(this->_responseBuffer, CRLF, 2);
+  appendBytes(this->_responseBuffer, "--", 2);
+  appendString(this->_responseBuffer, this->_boundary);
+  appendBytes(this->_responseBuffer, "--", 2);
+  appendBytes(this->_responseBuffer, CRLF, 2);
+  this->_addSegment(&this->_responseBuffer[start],
+                    this->_responseBuffer.size() - start);
+  return (false);
+}
+
+// Returns true when the body may be sent gzip-compressed under _gzip:
+// an in-memory body of at least min_length bytes, not yet encoded, whose
+// Content-Type (parameters ignored) is listed in types or types has "*".
+bool HttpResponse::_compressible() const {
+  if (!this->_gzip || !this->_gzip->enabled)
+    return (false);
+  if (this->_bodyFd >= 0 || this->_asset || !this->_ranges.empty())
+    return (false);
+  if (isBodyForbidden(this->_statusCode) || this->_statusCode == 206)
+    return (false);
+  if (this->_streamed) {
+    // 長さは送り終えるまで分からない (CGI が Content-Length を返せば使う)
+    std::map<std::string, std::string>::const_iterator length =
+        findHeader(this->_headers, "content-length");
+    if (length != this->_headers.end() &&
+        std::strtoul(length->second.c_str(), NULL, 10) <
+            this->_gzip->min_length)
+      return (false);
+  } else if (this->_body.empty() ||
+             this->_body.size() < this->_gzip->min_length) {
+    return (false);
+  }
+  if (findHeader(this->_headers, "content-encoding") != this->_headers.end())
+    return (false);
+
+  std::map<std::string, std::string>::const_iterator type =
+      findHeader(this->_headers, "content-type");
+  std::string mime;
+  if (type != this->_headers.end())
+    mime = toLower(trim(type->second.substr(0, type->second.find(';'))));
+  const std::vector<std::string>& types = this->_gzip->types;
+  for (size_t i = 0; i < types.size(); ++i) {
+    if (types[i] == "*" || (!mime.empty() && types[i] == mime))
+      return (true);
+  }
+  return (false);
+}
+
+// Compresses the next slices of _body into _readBuffer and queues them as one
+// chunk. At most GZIP_STREAM_CHUNK input bytes are handed to zlib at a time;
+// slices are consumed until zlib emits output or the body ends.
+// The last call adds the terminating chunk and finishes the response.
+void HttpResponse::_deflateNext() {
+  const size_t slice = GZIP_STREAM_CHUNK;
+  // ストリーミング中は終わりが届くまで圧縮ストリームを閉じない
+  bool last = !this->_streamed ||
+              (this->_streamEnded && this->_streamBuffer.empty());
+  bool finished = false;
+  try {
+    this->_readBuffer.clear();
+    while (this->_readBuffer.empty() && !finished) {
+      size_t len = std::min(slice, this->_body.size() - this->_deflateOffset);
+      finished = last && (this->_deflateOffset + len == this->_body.size());
+      if (len == 0 && !finished)
+        break;  // 続きのボディを待つ
+      const char* data = len > 0 ? &this->_body[this->_deflateOffset] : "";
+      if (!this->_deflater->write(data, len, finished, this->_readBuffer)) {
+        this->_stopCompression();
+        this->_state = RES_ERROR;
+        this->_errorMessage = "Failed to compress response body";
+        return;
+      }
+      this->_deflateOffset += len;
+    }
+    if (!this->_readBuffer.empty()) {
+      appendHex(this->_responseBuffer, this->_readBuffer.size());
+      appendBytes(this->_responseBuffer, CRLF, 2);
+      this->_addSegment(&this->_responseBuffer[0],
+                        this->_responseBuffer.size());
+      this->_addSegment(&this->_readBuffer[0], this->_readBuffer.size());
+    }
+  } catch (const std::bad_alloc& e) {
+    this->_stopCompression();
+    this->_state = RES_ERROR;
+    this->_errorMessage = "Failed to allocate compression buffer";
+    return;
+  }
+  if (!finished) {
+    if (!this->_readBuffer.empty())
+      this->_addSegment(CRLF, 2);
+    return;
+  }
+  this->_stopCompression();
+  if (this->_readBuffer.empty())
+    this->_addSegment(LAST_CHUNK, sizeof(LAST_CHUNK) - 1);
+  else
+    this->_addSegment(CRLF_LAST_CHUNK, sizeof(CRLF_LAST_CHUNK) - 1);
+  this->_state = RES_DONE;
+}
+
+// Queues the body received since the last call: one chunk when chunked,
+// compressed when gzip applies. With nothing new the response stays in
+// RES_BODY without segments until appendStream() or endStream().
+void HttpResponse::_streamNext() {
+  this->_resetSegments();
+  if (this->_deflater) {
+    // 前回の分を圧縮し終えてから次の分に入れ替える
+    if (this->_deflateOffset >= this->_body.size() &&
+        !this->_streamBuffer.empty()) {
+      this->_body.swap(this->_streamBuffer);
+      this->_streamBuffer.clear();
+      this->_deflateOffset = 0;
+    }
+    this->_deflateNext();
+    return;
+  }
+
+  // 送信済みの _body と入れ替える (セグメントは新しい _body を指す)
+  bool hasData = !this->_streamBuffer.empty();
+  if (hasData) {
+    this->_body.swap(this->_streamBuffer);
+    this->_streamBuffer.clear();
+    if (this->_isChunked) {
+      try {
+        appendHex(this->_responseBuffer, this->_body.size());
+        appendBytes(this->_responseBuffer, CRLF, 2);
+      } catch (const std::bad_alloc& e) {
+        this->abortStream();
+        return;
+      }
+      this->_addSegment(&this->_responseBuffer[0],
+                        this->_responseBuffer.size());
+    }
+    this->_addSegment(&this->_body[0], this->_body.size());
+  }
+  if (!this->_streamEnded) {
+    if (hasData && this->_isChunked)
+      this->_addSegment(CRLF, 2);
+    return;
+  }
+  if (this->_isChunked) {
+    if (hasData)
+      this->_addSegment(CRLF_LAST_CHUNK, sizeof(CRLF_LAST_CHUNK) - 1);
+    else
+      this->_addSegment(LAST_CHUNK, sizeof(LAST_CHUNK) - 1);
+  }
+  this->_state = RES_DONE;
+}
+
+void HttpResponse::_stopCompression() {
+  delete this->_deflater;
+  this->_deflater = NULL;
+  this->_deflateOffset = 0;
+}
+
+void HttpResponse::_releaseAsset() {
+  if (this->_asset) {
+    this->_asset->release();
+    this->_asset = NULL;
+  }
+}
+
+void HttpResponse::_closeBodyFile() {
+  if (this->_bodyFd >= 0) {
+    close(this->_bodyFd);
+    this->_bodyFd = -1;
+  }
+}
@@ -0,0 +1,304 @@
+#include "../inc/OpenFileCache.hpp"
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cstring>
+#include <iostream>
+
+namespace {
+
+// 親ディレクトリで起きたら子のエントリを捨てるイベント
+const uint32_t WATCH_MASK = IN_ATTRIB | IN_CREATE | IN_DELETE | IN_MODIFY |
+                            IN_CLOSE_WRITE | IN_MOVED_FROM | IN_MOVED_TO |
+                            IN_DELETE_SELF | IN_MOVE_SELF | IN_ONLYDIR;
+
+// "a/b/c" -> ("a/b", "c"), "a/b/" -> ("a", "b"), "c" -> (".", "c")
+void splitPath(const std::string& path, std::string& dir, std::string& name) {
+  size_t end = path.size();
+  while (end > 1 && path[end - 1] == '/') {
+    --end;
+  }
+  size_t slash = (end == 0) ? std::string::npos : path.rfind('/', end - 1);
+  if (slash == std::string::npos) {
+    dir = ".";
+    name = path.substr(0, end);
+  } else {
+    dir = (slash == 0) ? "/" : path.substr(0, slash);
+    name = path.substr(slash + 1, end - slash - 1);
+  }
+}
+
+}  // namespace
+
+OpenFileCache::Info::Info()
+    : exists(false),
+      isDir(false),
+      readable(false),
+      size(0),
+      mtime(0),
+      mtimeNsec(0),
+      ino(0),
+      fd(-1) {}
+
+OpenFileCache::OpenFileCache(size_t maxEntries, TimerWheel::Msec validMs)
+    : _maxEntries(maxEntries), _validMs(validMs), _notifyFd(-1) {
+  if (_maxEntries == 0) {
+    return;
+  }
+  _notifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  if (_notifyFd < 0) {
+    // 監視なしでも valid 期限による再検証で動く
+    std::cerr << "[Warn] inotify_init1 failed (" << strerror(errno)
+              << "): open_file_cache relies on open_file_cache_valid"
+              << std::endl;
+  }
+}
+
+OpenFileCache::~OpenFileCache() {
+  clear();
+  if (_notifyFd >= 0) {
+    close(_notifyFd);
+  }
+}
+
+// ========================================
+// 参照・無効化
+// ========================================
+
+OpenFileCache::Info OpenFileCache::lookup(const std::string& path) {
+  Info info;
+  if (_maxEntries == 0) {
+    ++_stats.misses;
+    _probe(path, false, info);
+    return info;
+  }
+
+  TimerWheel::Msec now = TimerWheel::clock();
+  Index::iterator found = _index.find(path);
+  if (found != _index.end()) {
+    LruList::iterator it = found->second;
+    if (now < it->validUntil) {
+      _lru.splice(_lru.begin(), _lru, it);
+      ++_stats.hits;
+      return it->info;
+    }
+    _erase(it);  // 期限切れ → 開き直す
+  }
+  ++_stats.misses;
+
+  // 調べてから監視を始めると間の変更を取りこぼすので、先に監視する
+  std::string dir;
+  std::string name;
+  splitPath(path, dir, name);
+  int wd = -1;
+  if (_notifyFd >= 0) {
+    wd = _watch(dir);
+    if (wd < 0) {
+      // 親ディレクトリがない等で監視できない → キャッシュしない
+      _probe(path, false, info);
+      return info;
+    }
+  }
+  if (!_probe(path, true, info)) {
+    // fd 不足などの一時的な失敗は覚えない
+    if (wd >= 0) {
+      _unwatch(wd);
+    }
+    return info;
+  }
+
+  while (_index.size() >= _maxEntries) {
+    _erase(--_lru.end());
+  }
+  Entry entry;
+  entry.path = path;
+  entry.name = name;
+  entry.info = info;
+  entry.validUntil = now + _validMs;
+  entry.wd = wd;
+  _lru.push_front(entry);
+  _index[path] = _lru.begin();
+  return info;
+}
+
+void OpenFileCache::invalidate(const std::string& path) {
+  Index::iterator found = _index.find(path);
+  if (found != _index.end()) {
+    _erase(found->second);
+  }
+}
+
+void OpenFileCache::clear() {
+  while (!_lru.empty()) {
+    _erase(_lru.begin());
+  }
+}
+
+// ========================================
+// inotify
+// ========================================
+
+int OpenFileCache::getWatchFd() const {
+  return _notifyFd;
+}
+
+void OpenFileCache::processEvents() {
+  if (_notifyFd < 0) {
+    return;
+  }
+  char buf[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+  while (true) {
+    ssize_t n = read(_notifyFd, buf, sizeof(buf));
+    if (n <= 0) {
+      return;  // EAGAIN: 読み切った
+    }
+    const char* p = buf;
+    while (p < buf + n) {
+      const struct inotify_event* ev =
+          reinterpret_cast<const struct inotify_event*>(p);
+      if (ev->mask & IN_Q_OVERFLOW) {
+        clear();  // 取りこぼしがあるので全て捨てる
+      } else if (ev->mask & (IN_IGNORED | IN_DELETE_SELF | IN_MOVE_SELF)) {
+        _invalidateWatch(ev->wd, NULL);  // ディレクトリ自体が消えた・動いた
+      } else if (ev->len > 0) {
+        _invalidateWatch(ev->wd, ev->name);
+      }
+      p += sizeof(struct inotify_event) + ev->len;
+    }
+  }
+}
+
+// ========================================
+// 統計
+// ========================================
+
+const PoolStats& OpenFileCache::stats() const {
+  return _stats;
+}
+
+size_t OpenFileCache::size() const {
+  return _index.size();
+}
+
+// ========================================
+// プライベートヘルパー
+// ========================================
+
+// path を開いて調べる。keepFd なら通常ファイルの fd を info.fd に残す
+// 結果をキャッシュしてよい場合 true (fd 不足などの一時的な失敗は false)
+bool OpenFileCache::_probe(const std::string& path, bool keepFd, Info& info) {
+  info = Info();
+  struct stat st;
+  int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC | O_NONBLOCK);
+  if (fd >= 0) {
+    if (fstat(fd, &st) < 0) {
+      std::cerr << "[Warn] OpenFileCache: fstat failed for " << path << "("
+                << strerror(errno) << ")" << std::endl;
+      close(fd);
+      return false;
+    }
+    info.exists = true;
+    info.readable = true;
+    info.isDir = S_ISDIR(st.st_mode);
+    info.size = st.st_size;
+    info.mtime = st.st_mtime;
+    info.mtimeNsec = st.st_mtim.tv_nsec;
+    info.ino = st.st_ino;
+    if (keepFd && S_ISREG(st.st_mode)) {
+      info.fd = fd;
+    } else {
+      close(fd);
+    }
+    return true;
+  }
+
+  int openErr = errno;
+  if (openErr == ENOENT || openErr == ENOTDIR) {
+    return true;  // 存在しない
+  }
+  if (stat(path.c_str(), &st) != 0) {
+    std::cerr << "[Warn] OpenFileCache: stat failed for " << path << "("
+              << strerror(errno) << ")" << std::endl;
+    return false;
+  }
+  info.exists = true;
+  info.isDir = S_ISDIR(st.st_mode);
+  info.size = st.st_size;
+  info.mtime = st.st_mtime;
+  info.mtimeNsec = st.st_mtim.tv_nsec;
+  info.ino = st.st_ino;
+  if (openErr == EACCES || openErr == EPERM) {
+    return true;  // 存在するが読めない
+  }
+  // 開けなかった理由が権限以外 → 読めるものとして呼び出し側に開かせる
+  info.readable = true;
+  return false;
+}
+
+// dir の watch を参照する (なければ追加する)。失敗時は -1
+int OpenFileCache::_watch(const std::string& dir) {
+  std::map<std::string, int>::iterator found = _watchWd.find(dir);
+  int wd;
+  if (found != _watchWd.end()) {
+    wd = found->second;
+  } else {
+    wd = inotify_add_watch(_notifyFd, dir.c_str(), WATCH_MASK);
+    if (wd < 0) {
+      return -1;
+    }
+    // 別表記の同じディレクトリ ("www" と "www/") は同じ wd になる
+    _watchWd[dir] = wd;
+  }
+  std::map<int, Watch>::iterator watch = _watches.find(wd);
+  if (watch == _watches.end()) {
+    Watch w;
+    w.dir = dir;
+    w.refs = 0;
+    watch = _watches.insert(std::make_pair(wd, w)).first;
+  }
+  ++watch->second.refs;
+  return wd;
+}
+
+// watch の参照を外し、誰も使わなくなったら監視をやめる
+void OpenFileCache::_unwatch(int wd) {
+  std::map<int, Watch>::iterator watch = _watches.find(wd);
+  if (watch == _watches.end() || --watch->second.refs > 0) {
+    return;
+  }
+  inotify_rm_watch(_notifyFd, wd);
+  _watches.erase(watch);
+  std::map<std::string, int>::iterator it = _watchWd.begin();
+  while (it != _watchWd.end()) {
+    if (it->second == wd) {
+      _watchWd.erase(it++);
+    } else {
+      ++it;
+    }
+  }
+}
+
+void OpenFileCache::_erase(LruList::iterator it) {
+  if (it->info.fd >= 0) {
+    close(it->info.fd);
+  }
+  if (it->wd >= 0) {
+    _unwatch(it->wd);
+  }
+  _index.erase(it->path);
+  _lru.erase(it);
+}
+
+// wd のディレクトリ内の name (NULL なら全て) のエントリを捨てる
+// イベントはファイル更新時にしか来ないので、全件の走査で十分
+void OpenFileCache::_invalidateWatch(int wd, const char* name) {
+  LruList::iterator it = _lru.begin();
+  while (it != _lru.end()) {
+    LruList::iterator current = it++;
+    if (current->wd == wd && (name == NULL || current->name == name)) {
+      _erase(current);
+    }
+  }
+}
@@ -0,0 +1,165 @@
+#include "../inc/Pool.hpp"
+#include <new>
+
+namespace {
+
+// 1スラブあたりのオブジェクト境界 (malloc と同じアラインメントにする)
+const size_t SLAB_ALIGN = 2 * sizeof(void*);
+
+// BufferPool が保持するバッファ数の上限 (種類ごと)
+const size_t MAX_POOLED_BUFFERS = 256;
+
+// これより小さい領域 (SSO 相当) は保持する意味がない / 大きい領域は捨てる
+const size_t MIN_POOLED_CAPACITY = 32;
+const size_t MAX_POOLED_CAPACITY = 65536;
+
+// 空き領域を swap で出し入れするスタック
+// 要素は事前に確保しておき、push / pop で再確保が起きないようにする
+template <typename Buffer>
+class BufferStack {
+ public:
+  BufferStack() : _buffers(MAX_POOLED_BUFFERS), _count(0) {}
+
+  bool pop(Buffer& out) {
+    if (_count == 0) {
+      return false;
+    }
+    out.swap(_buffers[--_count]);
+    return true;
+  }
+
+  void push(Buffer& in) {
+    if (_count >= _buffers.size() || in.capacity() < MIN_POOLED_CAPACITY ||
+        in.capacity() > MAX_POOLED_CAPACITY) {
+      return;
+    }
+    in.clear();
+    _buffers[_count++].swap(in);
+  }
+
+ private:
+  std::vector<Buffer> _buffers;
+  size_t _count;
+};
+
+BufferStack<std::vector<char> >& vectorStack() {
+  static BufferStack<std::vector<char> > stack;
+  return stack;
+}
+
+BufferStack<std::string>& stringStack() {
+  static BufferStack<std::string> stack;
+  return stack;
+}
+
+PoolStats& bufferStats() {
+  static PoolStats stats;
+  return stats;
+}
+
+}  // namespace
+
+// ========================================
+// SlabPool
+// ========================================
+
+SlabPool::SlabPool(size_t objectSize, size_t objectsPerSlab)
+    : _objectSize(objectSize),
+      _objectsPerSlab(objectsPerSlab > 0 ? objectsPerSlab : 1),
+      _freeList(NULL) {
+  if (_objectSize < sizeof(FreeNode)) {
+    _objectSize = sizeof(FreeNode);
+  }
+  _objectSize = (_objectSize + SLAB_ALIGN - 1) / SLAB_ALIGN * SLAB_ALIGN;
+}
+
+SlabPool::~SlabPool() {
+  for (size_t i = 0; i < _slabs.size(); ++i) {
+    ::operator delete(_slabs[i]);
+  }
+}
+
+// Returns one object-sized block, carving a new slab when the free list is
+// empty. Requests larger than the slot size (a derived class) bypass the pool.
+void* SlabPool::allocate(size_t size) {
+  if (size > _objectSize) {
+    ++_stats.misses;
+    return ::operator new(size);
+  }
+  if (_freeList == NULL) {
+    ++_stats.misses;
+    _grow();
+  } else {
+    ++_stats.hits;
+  }
+  FreeNode* node = _freeList;
+  _freeList = node->next;
+  return node;
+}
+
+void SlabPool::deallocate(void* ptr, size_t size) {
+  if (ptr == NULL) {
+    return;
+  }
+  if (size > _objectSize) {
+    ::operator delete(ptr);
+    return;
+  }
+  FreeNode* node = static_cast<FreeNode*>(ptr);
+  node->next = _freeList;
+  _freeList = node;
+}
+
+const PoolStats& SlabPool::stats() const {
+  return _stats;
+}
+
+size_t SlabPool::slabCount() const {
+  return _slabs.size();
+}
+
+void SlabPool::_grow() {
+  _slabs.reserve(_slabs.size() + 1);  // push_back で失敗しないよう先に確保
+  char* slab =
+      static_cast<char*>(::operator new(_objectSize * _objectsPerSlab));
+  _slabs.push_back(slab);
+
+  // 先頭のオブジェクトから順に取り出されるよう、末尾から繋ぐ
+  for (size_t i = _objectsPerSlab; i-- > 0;) {
+    FreeNode* node = reinterpret_cast<FreeNode*>(slab + i * _objectSize);
+    node->next = _freeList;
+    _freeList = node;
+  }
+}
+
+// ========================================
+// BufferPool
+// ========================================
+
+void BufferPool::acquire(std::vector<char>& buf) {
+  if (vectorStack().pop(buf)) {
+    ++bufferStats().hits;
+  } else {
+    ++bufferStats().misses;
+  }
+}
+
+void BufferPool::release(std::vector<char>& buf) {
+  vectorStack().push(buf);
+}
+
+void BufferPool::acquire(std::string& buf) {
+  if (stringStack().pop(buf)) {
+    ++bufferStats().hits;
+  } else {
+    ++bufferStats().misses;
+  }
+}
+
+void BufferPool::release(std::string& buf) {
+  stringStack().push(buf);
+}
+
+const PoolStats& BufferPool::stats() {
+  return bufferStats();
+}
@@ -1,4 +1,9 @@
 #include "RequestHandler.hpp"
+#include <fcntl.h>
+#include <strings.h>
+#include <cctype>
+#include <cstdlib>
+#include <limits>
 
 namespace {
 
@@ -182,6 +187,280 @@ std::string formatTime(time_t timer) {
   return oss.str();
 }
 
+// Checks whether an If-None-Match field value lists etag.
+// Uses the weak comparison, so "W/" prefixes are ignored. "*" matches any file.
+//
+// Args:
+//   list: The If-None-Match field value (comma separated entity tags).
+//   etag: The entity tag of the current file.
+//
+// Returns:
+//   true if one of the listed tags matches.
+bool etagListMatches(const std::string& list, const std::string& etag) {
+  std::string::size_type pos = 0;
+  while (pos < list.size()) {
+    std::string::size_type end = list.find(',', pos);
+    if (end == std::string::npos) {
+      end = list.size();
+    }
+    std::string::size_type first = list.find_first_not_of(" \t", pos);
+    std::string::size_type last = list.find_last_not_of(" \t", end - 1);
+    if (first != std::string::npos && first < end && last >= first) {
+      std::string tag = list.substr(first, last - first + 1);
+      if (tag == "*") {
+        return true;
+      }
+      if (tag.compare(0, 2, "W/") == 0) {
+        tag.erase(0, 2);
+      }
+      if (tag == etag) {
+        return true;
+      }
+    }
+    pos = end + 1;
+  }
+  return false;
+}
+
+// Evaluates If-None-Match / If-Modified-Since for a GET or HEAD request.
+// If-Modified-Since is ignored when If-None-Match is present or the date
+// cannot be parsed (RFC 9110 13.2.2).
+//
+// Args:
+//   req: The request carrying the conditional headers.
+//   etag: The entity tag of the selected file.
+//   mtime: The modification time of the selected file.
+//
+// Returns:
+//   true if the client's copy is still valid and 304 should be sent.
+bool isNotModified(const HttpRequest& req, const std::string& etag,
+                   time_t mtime) {
+  if (req.getMethod() != GET && req.getMethod() != HEAD) {
+    return false;
+  }
+  if (req.getHeaders().has(HDR_IF_NONE_MATCH)) {
+    return etagListMatches(req.getHeader(HDR_IF_NONE_MATCH), etag);
+  }
+  if (req.getHeaders().has(HDR_IF_MODIFIED_SINCE)) {
+    time_t since;
+    if (HttpResponse::parseHttpDate(req.getHeader(HDR_IF_MODIFIED_SINCE),
+                                    since)) {
+      return mtime <= since;
+    }
+  }
+  return false;
+}
+
+// Parses a non-negative decimal byte position without overflowing off_t.
+//
+// Args:
+//   str: The digits to parse.
+//   value: Receives the parsed value.
+//
+// Returns:
+//   false if str is empty, has a non-digit, or is too large.
+bool parseBytePos(const std::string& str, off_t& value) {
+  if (str.empty()) {
+    return false;
+  }
+  const off_t limit = std::numeric_limits<off_t>::max();
+  value = 0;
+  for (std::string::const_iterator it = str.begin(); it != str.end(); ++it) {
+    if (!std::isdigit(static_cast<unsigned char>(*it))) {
+      return false;
+    }
+    off_t digit = *it - '0';
+    if (value > (limit - digit) / 10) {
+      return false;
+    }
+    value = value * 10 + digit;
+  }
+  return true;
+}
+
+// Parses a Range field value ("bytes=0-99,200-,-50") against a file.
+// Ranges starting beyond the end are dropped and the rest are clamped.
+//
+// Args:
+//   value: The Range field value.
+//   size: The size of the selected file.
+//   ranges: Receives the satisfiable ranges in request order.
+//
+// Returns:
+//   206 if ranges were found, 416 if none is satisfiable, or 0 when the
+//   header must be ignored (other unit, bad syntax, too many ranges).
+int parseRange(const std::string& value, off_t size,
+               std::vector<ByteRange>& ranges) {
+  ranges.clear();
+  if (value.size() < 6 || strncasecmp(value.c_str(), "bytes=", 6) != 0) {
+    return 0;
+  }
+  size_t specs = 0;
+  std::string::size_type pos = 6;
+  while (pos <= value.size()) {
+    std::string::size_type end = value.find(',', pos);
+    if (end == std::string::npos) {
+      end = value.size();
+    }
+    std::string spec = value.substr(pos, end - pos);
+    pos = end + 1;
+    std::string::size_type first = spec.find_first_not_of(" \t");
+    if (first == std::string::npos) {
+      continue;  // 空要素は許容する ("bytes=0-1,,5-6")
+    }
+    spec = spec.substr(first, spec.find_last_not_of(" \t") - first + 1);
+    if (++specs > RANGE_MAX_COUNT) {
+      return 0;
+    }
+    std::string::size_type dash = spec.find('-');
+    if (dash == std::string::npos) {
+      return 0;
+    }
+    ByteRange range;
+    off_t last;
+    if (dash == 0) {
+      // 末尾から n バイト
+      off_t suffix;
+      if (!parseBytePos(spec.substr(1), suffix)) {
+        return 0;
+      }
+      if (suffix == 0 || size == 0) {
+        continue;
+      }
+      range.first = suffix < size ? size - suffix : 0;
+      range.last = size - 1;
+    } else {
+      if (!parseBytePos(spec.substr(0, dash), range.first)) {
+        return 0;
+      }
+      if (dash + 1 == spec.size()) {
+        last = size - 1;
+      } else if (!parseBytePos(spec.substr(dash + 1), last) ||
+                 last < range.first) {
+        return 0;
+      }
+      if (range.first >= size) {
+        continue;
+      }
+      range.last = last < size ? last : size - 1;
+    }
+    ranges.push_back(range);
+  }
+  if (specs == 0) {
+    return 0;
+  }
+  return ranges.empty() ? 416 : 206;
+}
+
+// Evaluates If-Range: a Range is honoured only while the client's copy is
+// current. Entity tags use the strong comparison, so weak tags never match;
+// a date must equal Last-Modified exactly.
+//
+// Args:
+//   req: The request carrying If-Range.
+//   etag: The entity tag of the selected file.
+//   mtime: The modification time of the selected file.
+//
+// Returns:
+//   true if there is no If-Range or its validator matches.
+bool ifRangeMatches(const HttpRequest& req, const std::string& etag,
+                    time_t mtime) {
+  if (!req.getHeaders().has(HDR_IF_RANGE)) {
+    return true;
+  }
+  const std::string& value = req.getHeader(HDR_IF_RANGE);
+  if (!value.empty() && value[0] == '"') {
+    return value == etag;
+  }
+  time_t date;
+  return HttpResponse::parseHttpDate(value, date) && date == mtime;
+}
+
+// Maps a content-coding to the file name suffix of its precompressed variant.
+//
+// Args:
+//   encoding: "gzip" or "br".
+//
+// Returns:
+//   ".gz", ".br", or an empty string for unknown codings.
+std::string precompressedSuffix(const std::string& encoding) {
+  if (encoding == "gzip") {
+    return ".gz";
+  }
+  if (encoding == "br") {
+    return ".br";
+  }
+  return "";
+}
+
+// Looks up the quality value an Accept-Encoding field gives to a coding.
+// "x-gzip" counts as "gzip", and "*" applies when the coding is not listed.
+//
+// Args:
+//   acceptEncoding: The Accept-Encoding field value.
+//   coding: The content-coding to look for (lower case).
+//
+// Returns:
+//   The q value in [0, 1]; 0 when the coding is not acceptable.
+double encodingQuality(const std::string& acceptEncoding,
+                       const std::string& coding) {
+  double wildcard = 0.0;
+  std::string::size_type pos = 0;
+  while (pos < acceptEncoding.size()) {
+    std::string::size_type end = acceptEncoding.find(',', pos);
+    if (end == std::string::npos) {
+      end = acceptEncoding.size();
+    }
+    std::string item = acceptEncoding.substr(pos, end - pos);
+    pos = end + 1;
+
+    double q = 1.0;
+    std::string::size_type semi = item.find(';');
+    if (semi != std::string::npos) {
+      std::string::size_type qPos = item.find("q=", semi);
+      if (qPos != std::string::npos) {
+        q = std::strtod(item.c_str() + qPos + 2, NULL);
+      }
+      item.erase(semi);
+    }
+    std::string::size_type first = item.find_first_not_of(" \t");
+    if (first == std::string::npos) {
+      continue;
+    }
+    std::string name =
+        item.substr(first, item.find_last_not_of(" \t") - first + 1);
+    for (std::string::iterator it = name.begin(); it != name.end(); ++it) {
+      *it = static_cast<char>(std::tolower(static_cast<unsigned char>(*it)));
+    }
+    if (name == "x-gzip") {
+      name = "gzip";
+    }
+    if (name == coding) {
+      return q > 0.0 ? q : 0.0;
+    }
+    if (name == "*") {
+      wildcard = q > 0.0 ? q : 0.0;
+    }
+  }
+  return wildcard;
+}
+
+// Hands the location's gzip policy to the response of a body that is built
+// in memory (CGI output, autoindex). HttpResponse::build() decides whether
+// the body actually qualifies.
+//
+// Args:
+//   client: Pointer to the Client object.
+//   location: The matched LocationConfig (may be NULL).
+void applyGzip(Client* client, const LocationConfig* location) {
+  if (!location || !location->gzip.enabled) {
+    return;
+  }
+  const std::string& accept = client->req.getHeader(HDR_ACCEPT_ENCODING);
+  client->res.setCompression(&location->gzip,
+                             encodingQuality(accept, "gzip") > 0.0);
+}
+
 struct FileEntry {
   std::string name;
   bool isDir;
@@ -349,34 +628,6 @@ std::string resolveUploadPath(const HttpRequest& req,
   return realPath;
 }
 
-// Writes data to a file, overwriting if it exists.
-//
-// Args:
-//   path: The file path to write to.
-//   data: The content to write.
-//
-// Returns:
-//   0 on success, or an HTTP status code (403, 404, 500) on failure.
-int writeFile(const std::string& path, const std::vector<char>& data) {
-  std::ofstream ofs(path.c_str(), std::ios::binary | std::ios::trunc);
-  if (!ofs.is_open()) {
-    if (errno == EACCES)
-      return 403;  // Forbidden
-    if (errno == ENOENT)
-      return 404;  // Parent directory missing
-    return 500;    // Internal Error
-  }
-  if (!data.empty()) {
-    ofs.write(&data[0], data.size());
-  }
-  if (ofs.bad()) {
-    ofs.close();
-    return 500;
-  }
-  ofs.close();
-  return 0;
-}
-
 int removeFile(const std::string& path) {
   if (unlink(path.c_str()) == 0)
     return (0);
@@ -389,9 +640,78 @@ int removeFile(const std::string& path) {
 
 }  // namespace
 
-RequestHandler::RequestHandler(const MainConfig& config) : _config(config) {}
+RequestHandler::RequestHandler(const MainConfig& config)
+    : _config(config),
+      _fileCache(config.open_file_cache.max_entries,
+                 config.open_file_cache.valid_ms),
+      _assetCache(config.asset_cache.max_bytes,
+                  config.asset_cache.max_file_size) {
+  // 最初のリクエストを待たずに min_workers を起動しておく
+  for (size_t i = 0; i < config.servers.size(); ++i) {
+    const std::vector<LocationConfig>& locations = config.servers[i].locations;
+    for (size_t j = 0; j < locations.size(); ++j) {
+      const LocationConfig& location = locations[j];
+      if (location.cgi_workers.max_workers > 0 && !location.cgi_path.empty()) {
+        _cgiPools[&location] =
+            new CgiWorkerPool(location.cgi_path, location.cgi_workers);
+      } else if (location.cgi_limit.max_concurrency > 0) {
+        _cgiLimiters[&location] = new CgiLimiter(location.cgi_limit);
+      }
+    }
+  }
+}
+
+RequestHandler::~RequestHandler() {
+  for (std::map<const LocationConfig*, CgiWorkerPool*>::iterator it =
+           _cgiPools.begin();
+       it != _cgiPools.end(); ++it) {
+    delete it->second;
+  }
+  for (std::map<const LocationConfig*, CgiLimiter*>::iterator it =
+           _cgiLimiters.begin();
+       it != _cgiLimiters.end(); ++it) {
+    delete it->second;
+  }
+}
 
-RequestHandler::~RequestHandler() {}
+OpenFileCache& RequestHandler::fileCache() {
+  return _fileCache;
+}
+
+const AssetCache& RequestHandler::assetCache() const {
+  return _assetCache;
+}
+
+CgiPoolStats RequestHandler::cgiPoolStats() const {
+  CgiPoolStats total;
+  for (std::map<const LocationConfig*, CgiWorkerPool*>::const_iterator it =
+           _cgiPools.begin();
+       it != _cgiPools.end(); ++it) {
+    const CgiPoolStats& stats = it->second->stats();
+    total.requests += stats.requests;
+    total.spawned += stats.spawned;
+    total.recycled += stats.recycled;
+    total.queued += stats.queued;
+  }
+  return total;
+}
+
+CgiLimitStats RequestHandler::cgiLimitStats() const {
+  CgiLimitStats total;
+  for (std::map<const LocationConfig*, CgiLimiter*>::const_iterator it =
+           _cgiLimiters.begin();
+       it != _cgiLimiters.end(); ++it) {
+    const CgiLimitStats& stats = it->second->stats();
+    total.started += stats.started;
+    total.queued += stats.queued;
+    total.rejected += stats.rejected;
+    total.abandoned += stats.abandoned;
+    total.maxDepth = std::max(total.maxDepth, stats.maxDepth);
+    total.waitTotal += stats.waitTotal;
+    total.waitMax = std::max(total.waitMax, stats.waitMax);
+  }
+  return total;
+}
 
 // Main entry point for handling client requests.
 // Analyzes the request, identifies the appropriate configuration, resolve paths,
@@ -419,6 +739,9 @@ void RequestHandler::handle(Client* client) {
       case ERR_BODY_TOO_LARGE:
         statusCode = 413;  // Payload Too Large
         break;
+      case ERR_BODY_STORAGE:
+        statusCode = 500;  // Internal Server Error
+        break;
       default:
         statusCode = 400;  // Bad Request
         break;
@@ -477,16 +800,17 @@ void RequestHandler::handle(Client* client) {
     }
 
     if (_isCgiRequest(realPath, matchedLocation)) {
-      if (!_isFileExist(realPath)) {
+      if (!_fileCache.lookup(realPath).exists) {
         if (_handleError(client, 404))
           continue;  // Not found
         return;
       }
-      if (_handleCgi(client, realPath, matchedLocation) == 0) {
+      int cgiResult = _handleCgi(client, realPath, matchedLocation);
+      if (cgiResult == 0) {
         return;
       }
-      if (_handleError(client, 500))
-        continue;  // internal server error
+      if (_handleError(client, cgiResult))
+        continue;  // 500 / 502 (インタプリタを起動できない) / 503 (混雑)
       return;
     }
 
@@ -494,7 +818,8 @@ void RequestHandler::handle(Client* client) {
     switch (req.getMethod()) {
       case GET:
       case HEAD:
-        procResult = _handleGet(client, realPath, matchedLocation);
+        procResult = _handleGet(client, realPath, matchedLocation,
+                                finalStatusCode != 0);
         break;
       case POST:
         procResult = _handlePost(client, realPath, matchedLocation);
@@ -525,8 +850,40 @@ void RequestHandler::handle(Client* client) {
   client->readyToWrite();
 }
 
+// Decides whether a request can be handled before its body has arrived.
+// Only a POST to an existing CGI script qualifies: the script is started as
+// soon as the headers are parsed and reads the body while it is uploaded.
+// Anything else (errors included) waits for the whole body as before.
+//
+// Args:
+//   client: Pointer for the Client whose request headers have been parsed.
+//
+// Returns:
+//   true if handle() should be called now and the body streamed to the CGI.
+bool RequestHandler::streamsBody(Client* client) {
+  const HttpRequest& req = client->req;
+  if (req.hasError() || req.getMethod() != POST) {
+    return false;
+  }
+  const ServerConfig* server = _findServerConfig(client);
+  if (!server) {
+    return false;
+  }
+  const LocationConfig* location = _findLocationConfig(req, *server);
+  if (!location || location->return_redirect.first != 0) {
+    return false;
+  }
+  const std::vector<HttpMethod>& allowed = location->allow_methods;
+  if (std::find(allowed.begin(), allowed.end(), POST) == allowed.end()) {
+    return false;
+  }
+  std::string realPath = _resolvePath(req.getPath(), *server, location);
+  return _isCgiRequest(realPath, location) &&
+         _fileCache.lookup(realPath).exists;
+}
+
 const ServerConfig* RequestHandler::_findServerConfig(const Client* client) {
-  return _config.getServer(client->req.getHeader("Host"),
+  return _config.getServer(client->req.getHeader(HDR_HOST),
                            client->getListenPort());
 }
 
@@ -557,20 +914,25 @@ std::string RequestHandler::_resolvePath(const std::string& uri,
 
 // Handle GET requests.
 // Checks for file existence, permissions, and searches for index files if the path is a directory.
+// Static files carry ETag / Last-Modified, and a matching If-None-Match or
+// If-Modified-Since is answered with 304 before the file body is set up.
 //
 // Args:
 //   client: Pointer to the Client object.
 //   realPath: The resolved file system path.
 //   location: The matched LocationConfig.
+//   isErrorPage: true when serving an error_page (conditionals are ignored).
 int RequestHandler::_handleGet(Client* client, const std::string& realPath,
-                               const LocationConfig* location) {
+                               const LocationConfig* location,
+                               bool isErrorPage) {
   std::string pathToFile = realPath;
 
-  if (!_isFileExist(pathToFile)) {
+  OpenFileCache::Info info = _fileCache.lookup(pathToFile);
+  if (!info.exists) {
     return 404;  // Not found
   }
 
-  if (_isDirectory(pathToFile)) {
+  if (info.isDir) {
     std::string indexFile = "index.html";
     if (location && !location->index.empty()) {
       indexFile = location->index;
@@ -580,22 +942,99 @@ int RequestHandler::_handleGet(Client* client, const std::string& realPath,
       candidatePath += "/";
     }
     candidatePath += indexFile;
-    if (_isFileExist(candidatePath)) {
+    OpenFileCache::Info indexInfo = _fileCache.lookup(candidatePath);
+    if (indexInfo.exists) {
       pathToFile = candidatePath;
+      info = indexInfo;
     } else if (location && location->autoindex) {
+      applyGzip(client, location);
       return _generateAutoIndex(client, pathToFile);
     } else {
       return 403;  // Forbidden
     }
   }
-  if (_isDirectory(pathToFile)) {
+  if (info.isDir) {
     return 403;  // Forbidden
   }
-  if (!_checkPermission(pathToFile, "r")) {
+  if (!info.readable) {
     return 403;  // Forbidden
   }
-  if (client->res.setBodyFile(pathToFile)) {
-    client->res.setStatusCode(200);
+  // 事前圧縮されたファイル (.gz / .br) があればそちらを送る
+  std::string bodyPath = pathToFile;
+  std::string encoding;
+  bool vary = location && !location->precompressed.empty() && !isErrorPage;
+  if (vary) {
+    OpenFileCache::Info variantInfo;
+    encoding = _findPrecompressed(client->req, *location, pathToFile,
+                                  variantInfo);
+    if (!encoding.empty()) {
+      bodyPath = pathToFile + precompressedSuffix(encoding);
+      info = variantInfo;
+    }
+  }
+  std::string etag = HttpResponse::makeETag(info.ino, info.size, info.mtime);
+  std::string lastModified = HttpResponse::formatHttpDate(info.mtime);
+  if (!isErrorPage && isNotModified(client->req, etag, info.mtime)) {
+    client->res.setStatusCode(304);  // Not Modified
+    client->res.setHeader("ETag", etag);
+    client->res.setHeader("Last-Modified", lastModified);
+    if (vary) {
+      client->res.setHeader("Vary", "Accept-Encoding");
+    }
+    client->res.build();
+    client->readyToWrite();
+    return 0;
+  }
+  // Range は GET のみ (HEAD では無視して全体のヘッダを返す)
+  std::vector<ByteRange> ranges;
+  int rangeStatus = 0;
+  if (!isErrorPage && client->req.getMethod() == GET &&
+      client->req.getHeaders().has(HDR_RANGE) &&
+      ifRangeMatches(client->req, etag, info.mtime)) {
+    rangeStatus =
+        parseRange(client->req.getHeader(HDR_RANGE), info.size, ranges);
+  }
+  if (rangeStatus == 416) {
+    client->res.makeErrorResponse(416, NULL);
+    client->res.setHeader("Content-Range", "bytes */" + toString(info.size));
+    client->res.build();
+    client->readyToWrite();
+    return 0;
+  }
+
+  // Content-Type は元のファイル名から決める (圧縮済みでも同じ)
+  std::map<std::string, std::string> headers;
+  headers["Content-Type"] = HttpResponse::getMimeType(pathToFile);
+  headers["Accept-Ranges"] = "bytes";
+  headers["ETag"] = etag;
+  headers["Last-Modified"] = lastModified;
+  if (!encoding.empty()) {
+    headers["Content-Encoding"] = encoding;
+  }
+  if (vary) {
+    headers["Vary"] = "Accept-Encoding";
+  }
+  if (rangeStatus == 0 && _serveAsset(client, bodyPath, info, headers)) {
+    return 0;
+  }
+  for (std::map<std::string, std::string>::const_iterator it =
+           headers.begin();
+       it != headers.end(); ++it) {
+    client->res.setHeader(it->first, it->second);
+  }
+  // キャッシュの fd は共有なので複製して渡す (送信は offset 指定なので干渉しない)
+  int fd = -1;
+  if (info.fd >= 0) {
+    fd = fcntl(info.fd, F_DUPFD_CLOEXEC, 0);
+  }
+  bool opened = (fd >= 0) ? client->res.setBodyFd(fd, info.size, bodyPath)
+                          : client->res.setBodyFile(bodyPath);
+  if (opened) {
+    if (rangeStatus == 206) {
+      client->res.setBodyRanges(ranges);  // 206 Partial Content
+    } else {
+      client->res.setStatusCode(200);
+    }
     client->res.build();
     client->readyToWrite();
     return 0;
@@ -620,9 +1059,12 @@ int RequestHandler::_handlePost(Client* client, const std::string& realPath,
   if (_isDirectory(targetPath)) {
     return 403;  // Forbidden;
   }
-  int writeResult = writeFile(targetPath, client->req.getBody());
+  // 一時ファイルに退避済みのボディは rename で保存先へ移る
+  int writeResult = client->req.getBody().saveTo(targetPath);
   if (writeResult != 0)
     return writeResult;
+  _fileCache.invalidate(targetPath);
+  _assetCache.invalidate(targetPath);
 
   client->res.setStatusCode(201);  // Created
   client->res.setHeader("Location", client->req.getPath());
@@ -659,17 +1101,125 @@ int RequestHandler::_handleDelete(Client* client, const std::string& realPath,
   if (removeResult != 0) {
     return removeResult;
   }
+  _fileCache.invalidate(realPath);
+  _assetCache.invalidate(realPath);
   client->res.setStatusCode(204);  // No Content
   client->res.build();
   client->readyToWrite();
   return 0;
 }
 
+// Serves a small static file from AssetCache, loading it on a miss.
+// A hit touches neither the file system nor HttpResponse::build().
+// headers (everything but Content-Length) are only used to build a new entry.
+//
+// Returns:
+//   true if the response is ready, false to fall back to the file body path.
+bool RequestHandler::_serveAsset(
+    Client* client, const std::string& path, const OpenFileCache::Info& info,
+    const std::map<std::string, std::string>& headers) {
+  CachedAsset* asset = _assetCache.lookup(path, info, headers);
+  if (!asset && _assetCache.accepts(info.size)) {
+    asset = _loadAsset(path, info, headers);
+  }
+  if (!asset || !client->res.setCachedAsset(asset)) {
+    return false;
+  }
+  client->readyToWrite();
+  return true;
+}
+
+// Reads the whole file and registers it in AssetCache.
+// Uses the fd held by OpenFileCache when available.
+//
+// Returns:
+//   The new entry, or NULL if the file could not be read completely.
+CachedAsset* RequestHandler::_loadAsset(
+    const std::string& path, const OpenFileCache::Info& info,
+    const std::map<std::string, std::string>& headers) {
+  int fd = info.fd;
+  if (fd < 0) {
+    fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+      return NULL;
+    }
+  }
+  size_t size = static_cast<size_t>(info.size);
+  std::vector<char> body(size);
+  size_t done = 0;
+  while (done < size) {
+    ssize_t n = pread(fd, &body[done], size - done, static_cast<off_t>(done));
+    if (n <= 0) {
+      break;
+    }
+    done += static_cast<size_t>(n);
+  }
+  if (fd != info.fd) {
+    close(fd);
+  }
+  if (done != size) {
+    return NULL;  // 読んでいる間に縮んだ
+  }
+  return _assetCache.insert(path, info, body, headers);
+}
+
+// Chooses a precompressed variant of path for the request.
+// Among the codings enabled by the location's "precompressed" directive,
+// the one with the highest q value in Accept-Encoding whose file exists
+// wins; ties go to the order in the directive.
+//
+// Args:
+//   req: The request carrying Accept-Encoding.
+//   location: The matched LocationConfig.
+//   path: The resolved path of the original file.
+//   variantInfo: Receives the file information of the chosen variant.
+//
+// Returns:
+//   The chosen content-coding, or an empty string to send the original.
+std::string RequestHandler::_findPrecompressed(
+    const HttpRequest& req, const LocationConfig& location,
+    const std::string& path, OpenFileCache::Info& variantInfo) {
+  if (!req.getHeaders().has(HDR_ACCEPT_ENCODING)) {
+    return "";
+  }
+  const std::string& accept = req.getHeader(HDR_ACCEPT_ENCODING);
+  std::string chosen;
+  double best = 0.0;
+  for (std::vector<std::string>::const_iterator it =
+           location.precompressed.begin();
+       it != location.precompressed.end(); ++it) {
+    double q = encodingQuality(accept, *it);
+    if (q <= best) {
+      continue;
+    }
+    OpenFileCache::Info info =
+        _fileCache.lookup(path + precompressedSuffix(*it));
+    if (info.exists && !info.isDir && info.readable) {
+      chosen = *it;
+      best = q;
+      variantInfo = info;
+    }
+  }
+  return chosen;
+}
+
 int RequestHandler::_handleCgi(Client* client, const std::string& scriptPath,
                                const LocationConfig* location) {
   if (!location) {
     return 500;  // internal server error;
   }
+  applyGzip(client, location);
+  std::map<const LocationConfig*, CgiWorkerPool*>::const_iterator pool =
+      _cgiPools.find(location);
+  if (pool != _cgiPools.end()) {
+    return client->startFastCgi(pool->second, scriptPath);
+  }
+  std::map<const LocationConfig*, CgiLimiter*>::const_iterator limiter =
+      _cgiLimiters.find(location);
+  if (limiter != _cgiLimiters.end()) {
+    return client->startCgi(scriptPath, location->cgi_path,
+                            limiter->second);
+  }
   return client->startCgi(scriptPath, location->cgi_path);
 }
 
@@ -0,0 +1,351 @@
+#include "../inc/Scan.hpp"
+
+// SSE2 はコンパイル時に有効な場合のみ (x86_64 では常に有効)
+#if defined(__x86_64__) || (defined(__i386__) && defined(__SSE2__))
+#define SCAN_X86 1
+#include <immintrin.h>
+#else
+#define SCAN_X86 0
+#endif
+
+namespace {
+
+// ========================================
+// スカラー版
+// ========================================
+
+// tchar = "!" / "#" / "$" / "%" / "&" / "'" / "*" / "+" / "-" / "." /
+//         "^" / "_" / "`" / "|" / "~" / DIGIT / ALPHA
+bool isTokenChar(unsigned char c) {
+  if (c <= 0x20 || c >= 0x7F) {
+    return false;
+  }
+  switch (c) {
+    case '"':
+    case '(':
+    case ')':
+    case ',':
+    case '/':
+    case ':':
+    case ';':
+    case '<':
+    case '=':
+    case '>':
+    case '?':
+    case '@':
+    case '[':
+    case '\\':
+    case ']':
+    case '{':
+    case '}':
+      return false;
+    default:
+      return true;
+  }
+}
+
+const char* findCrlfScalar(const char* p, const char* end) {
+  for (; p + 1 < end; ++p) {
+    if (p[0] == '\r' && p[1] == '\n') {
+      return p;
+    }
+  }
+  return end;
+}
+
+const char* findCharScalar(const char* p, const char* end, char c) {
+  for (; p < end; ++p) {
+    if (*p == c) {
+      return p;
+    }
+  }
+  return end;
+}
+
+const char* findNonTokenScalar(const char* p, const char* end) {
+  for (; p < end; ++p) {
+    if (!isTokenChar(static_cast<unsigned char>(*p))) {
+      return p;
+    }
+  }
+  return end;
+}
+
+void toLowerScalar(char* p, size_t len) {
+  for (size_t i = 0; i < len; ++i) {
+    if (p[i] >= 'A' && p[i] <= 'Z') {
+      p[i] = static_cast<char>(p[i] + ('a' - 'A'));
+    }
+  }
+}
+
+#if SCAN_X86
+
+// ========================================
+// SSE2 版 (16バイトずつ)
+// ========================================
+
+// lo <= x <= hi (符号なし) のバイトを 0xFF にする
+inline __m128i inRange16(__m128i x, unsigned char lo, unsigned char hi) {
+  __m128i shifted = _mm_sub_epi8(x, _mm_set1_epi8(static_cast<char>(lo)));
+  __m128i over = _mm_subs_epu8(shifted,
+                               _mm_set1_epi8(static_cast<char>(hi - lo)));
+  return _mm_cmpeq_epi8(over, _mm_setzero_si128());
+}
+
+inline __m128i eq16(__m128i x, char c) {
+  return _mm_cmpeq_epi8(x, _mm_set1_epi8(c));
+}
+
+// token 以外のバイトを 0xFF にする
+inline __m128i nonToken16(__m128i x) {
+  __m128i bad = _mm_xor_si128(inRange16(x, 0x21, 0x7E),
+                              _mm_set1_epi8(static_cast<char>(0xFF)));
+  bad = _mm_or_si128(bad, eq16(x, '"'));
+  bad = _mm_or_si128(bad, inRange16(x, '(', ')'));
+  bad = _mm_or_si128(bad, eq16(x, ','));
+  bad = _mm_or_si128(bad, eq16(x, '/'));
+  bad = _mm_or_si128(bad, inRange16(x, ':', '@'));
+  bad = _mm_or_si128(bad, inRange16(x, '[', ']'));
+  bad = _mm_or_si128(bad, eq16(x, '{'));
+  bad = _mm_or_si128(bad, eq16(x, '}'));
+  return bad;
+}
+
+const char* findCrlfSse2(const char* p, const char* end) {
+  // p[i] == '\r' && p[i + 1] == '\n' を16箇所同時に判定する
+  for (; end - p >= 17; p += 16) {
+    __m128i cur = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+    __m128i next = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 1));
+    int mask = _mm_movemask_epi8(
+        _mm_and_si128(eq16(cur, '\r'), eq16(next, '\n')));
+    if (mask != 0) {
+      return p + __builtin_ctz(static_cast<unsigned int>(mask));
+    }
+  }
+  return findCrlfScalar(p, end);
+}
+
+const char* findCharSse2(const char* p, const char* end, char c) {
+  __m128i needle = _mm_set1_epi8(c);
+  for (; end - p >= 16; p += 16) {
+    __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+    int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(x, needle));
+    if (mask != 0) {
+      return p + __builtin_ctz(static_cast<unsigned int>(mask));
+    }
+  }
+  return findCharScalar(p, end, c);
+}
+
+const char* findNonTokenSse2(const char* p, const char* end) {
+  for (; end - p >= 16; p += 16) {
+    __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+    int mask = _mm_movemask_epi8(nonToken16(x));
+    if (mask != 0) {
+      return p + __builtin_ctz(static_cast<unsigned int>(mask));
+    }
+  }
+  return findNonTokenScalar(p, end);
+}
+
+void toLowerSse2(char* p, size_t len) {
+  size_t i = 0;
+  for (; i + 16 <= len; i += 16) {
+    __m128i* block = reinterpret_cast<__m128i*>(p + i);
+    __m128i x = _mm_loadu_si128(block);
+    __m128i upper = inRange16(x, 'A', 'Z');
+    x = _mm_add_epi8(x, _mm_and_si128(upper, _mm_set1_epi8(0x20)));
+    _mm_storeu_si128(block, x);
+  }
+  toLowerScalar(p + i, len - i);
+}
+
+// ========================================
+// AVX2 版 (32バイトずつ)
+// 実行時に CPU が対応している場合のみ呼ぶ
+// ========================================
+
+#define SCAN_AVX2 __attribute__((target("avx2")))
+
+SCAN_AVX2 inline __m256i inRange32(__m256i x, unsigned char lo,
+                                   unsigned char hi) {
+  __m256i shifted =
+      _mm256_sub_epi8(x, _mm256_set1_epi8(static_cast<char>(lo)));
+  __m256i over = _mm256_subs_epu8(
+      shifted, _mm256_set1_epi8(static_cast<char>(hi - lo)));
+  return _mm256_cmpeq_epi8(over, _mm256_setzero_si256());
+}
+
+SCAN_AVX2 inline __m256i eq32(__m256i x, char c) {
+  return _mm256_cmpeq_epi8(x, _mm256_set1_epi8(c));
+}
+
+SCAN_AVX2 inline __m256i nonToken32(__m256i x) {
+  __m256i bad = _mm256_xor_si256(inRange32(x, 0x21, 0x7E),
+                                 _mm256_set1_epi8(static_cast<char>(0xFF)));
+  bad = _mm256_or_si256(bad, eq32(x, '"'));
+  bad = _mm256_or_si256(bad, inRange32(x, '(', ')'));
+  bad = _mm256_or_si256(bad, eq32(x, ','));
+  bad = _mm256_or_si256(bad, eq32(x, '/'));
+  bad = _mm256_or_si256(bad, inRange32(x, ':', '@'));
+  bad = _mm256_or_si256(bad, inRange32(x, '[', ']'));
+  bad = _mm256_or_si256(bad, eq32(x, '{'));
+  bad = _mm256_or_si256(bad, eq32(x, '}'));
+  return bad;
+}
+
+SCAN_AVX2 const char* findCrlfAvx2(const char* p, const char* end) {
+  for (; end - p >= 33; p += 32) {
+    __m256i cur = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+    __m256i next =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + 1));
+    unsigned int mask = static_cast<unsigned int>(_mm256_movemask_epi8(
+        _mm256_and_si256(eq32(cur, '\r'), eq32(next, '\n'))));
+    if (mask != 0) {
+      return p + __builtin_ctz(mask);
+    }
+  }
+  return findCrlfSse2(p, end);
+}
+
+SCAN_AVX2 const char* findCharAvx2(const char* p, const char* end, char c) {
+  __m256i needle = _mm256_set1_epi8(c);
+  for (; end - p >= 32; p += 32) {
+    __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+    unsigned int mask = static_cast<unsigned int>(
+        _mm256_movemask_epi8(_mm256_cmpeq_epi8(x, needle)));
+    if (mask != 0) {
+      return p + __builtin_ctz(mask);
+    }
+  }
+  return findCharSse2(p, end, c);
+}
+
+SCAN_AVX2 const char* findNonTokenAvx2(const char* p, const char* end) {
+  for (; end - p >= 32; p += 32) {
+    __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+    unsigned int mask =
+        static_cast<unsigned int>(_mm256_movemask_epi8(nonToken32(x)));
+    if (mask != 0) {
+      return p + __builtin_ctz(mask);
+    }
+  }
+  return findNonTokenSse2(p, end);
+}
+
+SCAN_AVX2 void toLowerAvx2(char* p, size_t len) {
+  size_t i = 0;
+  for (; i + 32 <= len; i += 32) {
+    __m256i* block = reinterpret_cast<__m256i*>(p + i);
+    __m256i x = _mm256_loadu_si256(block);
+    __m256i upper = inRange32(x, 'A', 'Z');
+    x = _mm256_add_epi8(x, _mm256_and_si256(upper, _mm256_set1_epi8(0x20)));
+    _mm256_storeu_si256(block, x);
+  }
+  toLowerSse2(p + i, len - i);
+}
+
+#endif  // SCAN_X86
+
+// ========================================
+// 実行時ディスパッチ
+// ========================================
+
+struct Kernels {
+  Scan::Impl impl;
+  const char* (*findCrlf)(const char*, const char*);
+  const char* (*findChar)(const char*, const char*, char);
+  const char* (*findNonToken)(const char*, const char*);
+  void (*toLower)(char*, size_t);
+};
+
+Kernels makeKernels(Scan::Impl impl) {
+  Kernels k;
+  k.impl = Scan::SCALAR;
+  k.findCrlf = findCrlfScalar;
+  k.findChar = findCharScalar;
+  k.findNonToken = findNonTokenScalar;
+  k.toLower = toLowerScalar;
+#if SCAN_X86
+  if (impl == Scan::SSE2) {
+    k.impl = Scan::SSE2;
+    k.findCrlf = findCrlfSse2;
+    k.findChar = findCharSse2;
+    k.findNonToken = findNonTokenSse2;
+    k.toLower = toLowerSse2;
+  } else if (impl == Scan::AVX2) {
+    k.impl = Scan::AVX2;
+    k.findCrlf = findCrlfAvx2;
+    k.findChar = findCharAvx2;
+    k.findNonToken = findNonTokenAvx2;
+    k.toLower = toLowerAvx2;
+  }
+#else
+  (void)impl;
+#endif
+  return k;
+}
+
+Kernels& kernels() {
+  static Kernels k = makeKernels(Scan::bestImpl());
+  return k;
+}
+
+}  // namespace
+
+// ========================================
+// 公開インターフェース
+// ========================================
+
+const char* Scan::findCrlf(const char* begin, const char* end) {
+  return kernels().findCrlf(begin, end);
+}
+
+const char* Scan::findChar(const char* begin, const char* end, char c) {
+  return kernels().findChar(begin, end, c);
+}
+
+const char* Scan::findNonToken(const char* begin, const char* end) {
+  return kernels().findNonToken(begin, end);
+}
+
+void Scan::toLower(char* data, size_t len) {
+  kernels().toLower(data, len);
+}
+
+Scan::Impl Scan::bestImpl() {
+#if SCAN_X86
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2")) {
+    return AVX2;
+  }
+  if (__builtin_cpu_supports("sse2")) {
+    return SSE2;
+  }
+#endif
+  return SCALAR;
+}
+
+Scan::Impl Scan::impl() {
+  return kernels().impl;
+}
+
+bool Scan::setImpl(Impl impl) {
+  if (impl > bestImpl()) {
+    return false;
+  }
+  kernels() = makeKernels(impl);
+  return true;
+}
+
+const char* Scan::implName(Impl impl) {
+  switch (impl) {
+    case SSE2:
+      return "sse2";
+    case AVX2:
+      return "avx2";
+    default:
+      return "scalar";
+  }
+}
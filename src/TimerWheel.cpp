@@ -0,0 +1,218 @@
+#include "../inc/TimerWheel.hpp"
+#include <time.h>
+#include <climits>
+
+// ========================================
+// Timer
+// ========================================
+
+TimerWheel::Timer::Timer() : prev(NULL), next(NULL), expires(0), owner(NULL) {}
+
+bool TimerWheel::Timer::isArmed() const {
+  return next != NULL;
+}
+
+// ========================================
+// コンストラクタ / デストラクタ
+// ========================================
+
+TimerWheel::TimerWheel(Msec nowMs)
+    : _now(nowMs), _tick(nowMs / TICK_MS), _size(0) {
+  for (int level = 0; level < LEVELS; ++level) {
+    for (int slot = 0; slot < SLOTS; ++slot) {
+      _slots[level][slot].prev = &_slots[level][slot];
+      _slots[level][slot].next = &_slots[level][slot];
+    }
+  }
+}
+
+// 残っているタイマーは所有者側のオブジェクトなので、リンクを外すだけ
+TimerWheel::~TimerWheel() {
+  for (int level = 0; level < LEVELS; ++level) {
+    for (int slot = 0; slot < SLOTS; ++slot) {
+      Timer* head = &_slots[level][slot];
+      while (head->next != head) {
+        _unlink(head->next);
+      }
+    }
+  }
+}
+
+// ========================================
+// 時刻
+// ========================================
+
+TimerWheel::Msec TimerWheel::clock() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return static_cast<Msec>(ts.tv_sec) * 1000 +
+         static_cast<Msec>(ts.tv_nsec) / 1000000;
+}
+
+void TimerWheel::setNow(Msec nowMs) {
+  if (nowMs > _now) {
+    _now = nowMs;
+  }
+}
+
+TimerWheel::Msec TimerWheel::now() const {
+  return _now;
+}
+
+// ========================================
+// 登録 / 解除
+// ========================================
+
+void TimerWheel::arm(Timer* timer, Msec timeoutMs) {
+  if (timer->isArmed()) {
+    _unlink(timer);
+  }
+  timer->expires = _now + timeoutMs;
+  _insert(timer);
+}
+
+void TimerWheel::cancel(Timer* timer) {
+  if (timer->isArmed()) {
+    _unlink(timer);
+  }
+}
+
+size_t TimerWheel::size() const {
+  return _size;
+}
+
+// ========================================
+// 期限切れ処理
+// ========================================
+
+// Collects every timer whose tick has fully elapsed, cascading timers down
+// from the upper levels whenever the level-0 index wraps around.
+//
+// Args:
+//   expired: Output vector; expired timers are appended and left unarmed.
+void TimerWheel::expire(std::vector<Timer*>& expired) {
+  Msec nowTick = _now / TICK_MS;
+
+  // タイマーがなければ一気に進める
+  if (_size == 0) {
+    if (_tick < nowTick) {
+      _tick = nowTick;
+    }
+    return;
+  }
+
+  while (_tick < nowTick) {
+    int index = static_cast<int>(_tick & (SLOTS - 1));
+    if (index == 0) {
+      for (int level = 1; level < LEVELS; ++level) {
+        if (_cascade(level) != 0) {
+          break;
+        }
+      }
+    }
+
+    Timer* head = &_slots[0][index];
+    while (head->next != head) {
+      Timer* timer = head->next;
+      _unlink(timer);
+      expired.push_back(timer);
+    }
+    ++_tick;
+  }
+}
+
+// Returns how long epoll_wait may sleep before the next timer could fire.
+// Only level 0 is scanned (at most SLOTS slots); if it is empty up to the next
+// wrap-around, the wait ends at the wrap so that upper levels can cascade.
+int TimerWheel::nextTimeout() const {
+  if (_size == 0) {
+    return -1;
+  }
+
+  Msec target = _tick;
+  int index = static_cast<int>(_tick & (SLOTS - 1));
+  for (; index < SLOTS; ++index, ++target) {
+    if (!_isEmpty(_slots[0][index])) {
+      break;
+    }
+  }
+
+  // tick T は now >= (T + 1) * TICK_MS になった時点で処理される
+  Msec deadline = (target + 1) * TICK_MS;
+  if (deadline <= _now) {
+    return 0;
+  }
+  Msec wait = deadline - _now;
+  if (wait > static_cast<Msec>(INT_MAX)) {
+    return INT_MAX;
+  }
+  return static_cast<int>(wait);
+}
+
+// ========================================
+// プライベートヘルパー
+// ========================================
+
+// 期限までの tick 数に応じてレベルを選び、スロットの末尾に繋ぐ
+void TimerWheel::_insert(Timer* timer) {
+  Msec tick = timer->expires / TICK_MS;
+  if (tick < _tick) {
+    tick = _tick;
+  }
+  Msec delta = tick - _tick;
+
+  int level = 0;
+  while (level < LEVELS - 1 &&
+         delta >= (static_cast<Msec>(1) << (SLOT_BITS * (level + 1)))) {
+    ++level;
+  }
+  // 最上位レベルの範囲を超える期限は範囲の末尾に丸める
+  Msec maxDelta = (static_cast<Msec>(1) << (SLOT_BITS * LEVELS)) - 1;
+  if (delta > maxDelta) {
+    tick = _tick + maxDelta;
+  }
+
+  int slot = static_cast<int>((tick >> (SLOT_BITS * level)) & (SLOTS - 1));
+  Timer* head = &_slots[level][slot];
+  timer->prev = head->prev;
+  timer->next = head;
+  head->prev->next = timer;
+  head->prev = timer;
+  ++_size;
+}
+
+void TimerWheel::_unlink(Timer* timer) {
+  timer->prev->next = timer->next;
+  timer->next->prev = timer->prev;
+  timer->prev = NULL;
+  timer->next = NULL;
+  --_size;
+}
+
+// 上位レベルの現在スロットのタイマーを下位レベルへ振り直す
+// 戻り値: 処理したスロットのインデックス (0 ならさらに上位も振り直す)
+int TimerWheel::_cascade(int level) {
+  int index =
+      static_cast<int>((_tick >> (SLOT_BITS * level)) & (SLOTS - 1));
+  Timer* head = &_slots[level][index];
+
+  // 付け替え中に同じスロットへ戻らないよう、先にリストを切り離す
+  Timer* first = head->next;
+  Timer* last = head->prev;
+  head->next = head;
+  head->prev = head;
+  if (first != head) {
+    last->next = NULL;
+    for (Timer* timer = first; timer != NULL;) {
+      Timer* next = timer->next;
+      --_size;
+      _insert(timer);
+      timer = next;
+    }
+  }
+  return index;
+}
+
+bool TimerWheel::_isEmpty(const Timer& head) {
+  return head.next == &head;
+}
@@ -2,7 +2,9 @@
 #include <fcntl.h>
 #include <netinet/in.h>
 #include <signal.h>
+#include <sys/sendfile.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 #include <sys/wait.h>
 #include <unistd.h>
 #include <cerrno>
@@ -11,24 +13,38 @@
 #include <iostream>
 #include <map>
 
+#include "../inc/ChildReaper.hpp"
 #include "../inc/Client.hpp"
 #include "../inc/Config.hpp"
 #include "../inc/ConfigParser.hpp"
+#include "../inc/ConnectionTable.hpp"
+#include "../inc/Deflater.hpp"
 #include "../inc/EpollContext.hpp"
 #include "../inc/EpollUtils.hpp"
+#include "../inc/Pool.hpp"
 #include "../inc/RequestHandler.hpp"
+#include "../inc/TimerWheel.hpp"
 
 // 定数
 
 static const int MAX_EVENTS = 64;
-static const int TIMEOUT_MS = 1000;       // epoll_wait タイムアウト
-static const time_t CLIENT_TIMEOUT = 60;  // クライアントタイムアウト (秒)
 static const int RECV_BUFFER_SIZE = 4096;
+static const size_t SENDFILE_MAX_CHUNK = 1048576;  // 1回の sendfile 上限 (1MB)
+static const int IOV_BATCH = 64;  // 1回の writev に渡すセグメント数の上限
 
 // グローバル変数 (シグナルハンドラ用)
 
 static volatile sig_atomic_t g_running = 1;
 
+// accept ループの状態 (ワーカーごと)
+struct Acceptor {
+  int budget;              // 1回の EPOLLIN で accept する最大数
+  int reserveFd;           // fd 枯渇時に解放して接続を捌くための予備 fd
+  unsigned long accepted;  // accept に成功した数
+  unsigned long drained;   // EAGAIN でバックログを空にした回数
+  unsigned long rejected;  // fd 枯渇のため即 close した数
+};
+
 // ユーティリティ関数
 
 static void signalHandler(int sig) {
@@ -64,8 +80,9 @@ static std::string getClientIp(struct sockaddr_in* addr) {
 
 // Listener ソケット作成
 
-static int createListenerSocket(int port) {
-  int sock = socket(AF_INET, SOCK_STREAM, 0);
+// reusePort: 複数ワーカーが同じポートに bind し、カーネルに accept を分散させる
+static int createListenerSocket(int port, bool reusePort) {
+  int sock = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
   if (sock < 0) {
     std::cerr << "socket() failed: " << strerror(errno) << std::endl;
     return -1;
@@ -78,6 +95,14 @@ static int createListenerSocket(int port) {
     return -1;
   }
 
+  if (reusePort &&
+      setsockopt(sock, SOL_SOCKET, SO_REUSEPORT, &opt, sizeof(opt)) < 0) {
+    std::cerr << "setsockopt(SO_REUSEPORT) failed: " << strerror(errno)
+              << std::endl;
+    close(sock);
+    return -1;
+  }
+
   struct sockaddr_in addr;
   std::memset(&addr, 0, sizeof(addr));
   addr.sin_family = AF_INET;
@@ -107,250 +132,359 @@ static int createListenerSocket(int port) {
   return sock;
 }
 
+// fd 枯渇時: 予備 fd を一時的に解放して保留中の接続を1つ受け取り、即座に閉じる
+// (受け取らないとレベルトリガの EPOLLIN が鳴り続けてループが空回りする)
+// 戻り値: 接続を1つ捌けたら true
+static bool rejectWithReserveFd(int listener_fd, Acceptor& acceptor) {
+  if (acceptor.reserveFd < 0) {
+    return false;
+  }
+  close(acceptor.reserveFd);
+  acceptor.reserveFd = -1;
+
+  int conn_fd = accept(listener_fd, NULL, NULL);
+  if (conn_fd >= 0) {
+    close(conn_fd);
+    ++acceptor.rejected;
+  }
+  acceptor.reserveFd = open("/dev/null", O_RDONLY | O_CLOEXEC);
+  return conn_fd >= 0;
+}
+
 // イベントハンドラ
 
 static void handleListenerEvent(EpollContext* ctx, int listener_fd,
-                                EpollUtils& epoll,
-                                std::map<int, Client*>& clients) {
-  struct sockaddr_in client_addr;
-  socklen_t addr_len = sizeof(client_addr);
-
-  int conn_fd = accept(
-      listener_fd, reinterpret_cast<struct sockaddr*>(&client_addr), &addr_len);
-  if (conn_fd < 0) {
-    if (errno != EAGAIN && errno != EWOULDBLOCK) {
-      std::cerr << "accept() failed: " << strerror(errno) << std::endl;
+                                ConnectionTable& clients, Acceptor& acceptor) {
+  int port = ctx->listen_port;
+
+  // バックログを budget 件まで一気に捌く
+  for (int i = 0; i < acceptor.budget; ++i) {
+    struct sockaddr_in client_addr;
+    socklen_t addr_len = sizeof(client_addr);
+
+    int conn_fd = accept4(listener_fd,
+                          reinterpret_cast<struct sockaddr*>(&client_addr),
+                          &addr_len, SOCK_NONBLOCK | SOCK_CLOEXEC);
+    if (conn_fd < 0) {
+      if (errno == EAGAIN || errno == EWOULDBLOCK) {
+        ++acceptor.drained;
+        return;
+      }
+      if (errno == EINTR || errno == ECONNABORTED) {
+        continue;
+      }
+      if (errno == EMFILE || errno == ENFILE) {
+        if (rejectWithReserveFd(listener_fd, acceptor)) {
+          continue;
+        }
+      }
+      std::cerr << "accept4() failed: " << strerror(errno) << std::endl;
+      return;
     }
-    return;
-  }
+    ++acceptor.accepted;
 
-  if (!setNonBlocking(conn_fd)) {
-    std::cerr << "setNonBlocking() failed for client" << std::endl;
-    close(conn_fd);
-    return;
+    // Client と EpollContext を生成し、EPOLLIN で epoll に登録
+    clients.add(conn_fd, port, getClientIp(&client_addr));
   }
+}
 
-  std::string ip = getClientIp(&client_addr);
-  int port = ctx->listen_port;
+// 受信し終えたリクエスト (またはパースエラー) を RequestHandler に渡す
+static void processRequest(Client* client, RequestHandler& handler) {
+  // 同じ受信データに後続のリクエストが含まれていれば先読みキューへ移す
+  client->readAhead(NULL, 0);
 
-  // Client 作成 (内部で epoll.add() が呼ばれる)
-  Client* client = new Client(conn_fd, port, ip, &epoll);
+  if (client->req.hasError()) {
+    // パースエラー後はリクエストの区切りが分からないので接続を閉じる
+    client->setKeepAlive(false);
+  } else {
+    // Connection ヘッダーを設定 (build() の前に設定する必要がある)
+    const std::string& connection = client->req.getHeader(HDR_CONNECTION);
+    bool keepAlive;
 
-  // EpollContext を作成して Client に紐付け
-  EpollContext* client_ctx = EpollContext::createClient(client);
-  client->setContext(client_ctx);
+    if (client->req.getHttpVersion() == "HTTP/1.1") {
+      // HTTP/1.1 はデフォルトで keep-alive
+      keepAlive = (connection != "close");
+    } else {
+      // HTTP/1.0 はデフォルトで close
+      keepAlive = (connection == "keep-alive");
+    }
+    client->setKeepAlive(keepAlive);
+    client->res.setHeader("Connection", keepAlive ? "keep-alive" : "close");
+  }
 
-  // epoll に登録 (EPOLLIN で読み込み待ち)
-  epoll.add(conn_fd, client_ctx, EPOLLIN);
+  client->setState(PROCESSING);
+  handler.handle(client);
 
-  // クライアント管理マップに追加
-  clients[conn_fd] = client;
+  // handle() 内で client->readyToWrite() や client->startCgi() が呼ばれる
+  // → epoll の状態変更も Client 内部で完了済み
 }
 
-static void handleClientReadEvent(Client* client, EpollUtils& epoll,
-                                  RequestHandler& handler,
-                                  std::map<int, Client*>& clients) {
+static void handleClientReadEvent(Client* client, RequestHandler& handler,
+                                  ConnectionTable& clients) {
+  // CGI へのボディの残りはソケットから stdin パイプへ直接渡す (zero-copy)
+  if (client->isSplicingCgiInput()) {
+    client->spliceCgiInput();
+    return;
+  }
+
   char buf[RECV_BUFFER_SIZE];
   ssize_t n = recv(client->getFd(), buf, sizeof(buf), 0);
+  ConnState state = client->getState();
+  bool receiving = (state == WAIT_REQUEST || state == READING_REQUEST);
 
   if (n > 0) {
-    client->updateTimestamp();
-
-    // リクエストをフィード (パース)
-    bool complete = client->req.feed(buf, static_cast<size_t>(n));
-
-    // エラーチェック
-    if (client->req.hasError()) {
-      // パースエラー → エラーレスポンスを生成
-      client->setState(PROCESSING);
-      handler.handle(client);
+    if (!receiving) {
+      // 応答の処理中に届いた後続のリクエスト (パイプライン) は先読みしておく
+      client->readAhead(buf, static_cast<size_t>(n));
       return;
     }
 
-    if (complete) {
-      // Connection ヘッダーを設定 (build() の前に設定する必要がある)
-      std::string connection = client->req.getHeader("Connection");
-      std::string httpVersion = client->req.getHttpVersion();
+    // Keep-Alive 待機中に次のリクエストが届いた
+    if (state == WAIT_REQUEST) {
+      client->setState(READING_REQUEST);
+    }
 
-      if (httpVersion == "HTTP/1.1") {
-        // HTTP/1.1 はデフォルトで keep-alive
-        if (connection == "close") {
-          client->res.setHeader("Connection", "close");
-        } else {
-          client->res.setHeader("Connection", "keep-alive");
-        }
-      } else {
-        // HTTP/1.0 はデフォルトで close
-        if (connection == "keep-alive") {
-          client->res.setHeader("Connection", "keep-alive");
-        } else {
-          client->res.setHeader("Connection", "close");
-        }
-      }
+    // リクエストをフィード (パース)
+    bool inBody = client->req.isReadingBody();
+    bool complete = client->req.feed(buf, static_cast<size_t>(n));
 
-      // リクエスト完了 → RequestHandler で処理
-      client->setState(PROCESSING);
-      handler.handle(client);
+    // ヘッダー受信中 / ボディ受信中のどちらかでタイマーを設定し直す
+    client->updateTimestamp();
 
-      // handle() 内で client->readyToWrite() や client->startCgi() が呼ばれる
-      // → epoll の状態変更も Client 内部で完了済み
+    if (complete || client->req.hasError()) {
+      processRequest(client, handler);
+    } else if (!inBody && client->req.isReadingBody() &&
+               handler.streamsBody(client)) {
+      // CGI はボディを待たずに起動し、届いた分から stdin へ流す
+      processRequest(client, handler);
     }
   } else if (n == 0) {
-    // 接続終了
-    epoll.del(client->getFd());
-    clients.erase(client->getFd());
-    delete client->getContext();
-    delete client;
+    if (receiving) {
+      // 接続終了
+      clients.remove(client->getFd());
+    } else {
+      // 送信側だけ閉じられた → 処理中・先読み済みの応答を返してから閉じる
+      client->closeInput();
+    }
   } else {
     // エラー
     if (errno != EAGAIN && errno != EWOULDBLOCK) {
       std::cerr << "recv() error: " << strerror(errno) << std::endl;
-      epoll.del(client->getFd());
-      clients.erase(client->getFd());
-      delete client->getContext();
-      delete client;
+      clients.remove(client->getFd());
     }
   }
 }
 
-static void handleClientWriteEvent(Client* client, EpollUtils& epoll,
-                                   std::map<int, Client*>& clients) {
-  const char* data = client->res.getData();
-  size_t remaining = client->res.getRemainingSize();
+// 応答を送り終えた → Keep-Alive なら次のリクエストへ
+// (先読み済みなら順番にすぐ処理する)
+static void completeResponse(Client* client, RequestHandler& handler,
+                             ConnectionTable& clients) {
+  if (!client->isKeepAlive() || !client->nextRequest()) {
+    clients.remove(client->getFd());
+  } else if (client->req.isComplete() || client->req.hasError()) {
+    processRequest(client, handler);
+  }
+}
 
-  if (remaining == 0) {
+static void handleClientWriteEvent(Client* client, RequestHandler& handler,
+                                   ConnectionTable& clients) {
+  if (client->res.isError()) {
+    // 送信途中で打ち切られた応答 (CGI の出力が足りないなど)
+    std::cerr << "response error: " << client->res.getErrorMessage()
+              << std::endl;
+    clients.remove(client->getFd());
     return;
   }
 
-  ssize_t sent = send(client->getFd(), data, remaining, 0);
+  // CGI のボディを splice 中にソケットが空いた → パイプから続きを送る
+  if (client->isSplicingCgiOutput()) {
+    client->spliceCgiOutput();
+    if (client->getState() == WRITING_RESPONSE && client->res.isDone()) {
+      completeResponse(client, handler, clients);
+    }
+    return;
+  }
+
+  // ヘッダ送信後のファイルボディはページキャッシュから直接送る (zero-copy)
+  bool viaSendfile = client->res.isSendfilePending();
+  ssize_t sent;
+
+  if (viaSendfile) {
+    off_t offset = client->res.getBodyOffset();
+    size_t count = client->res.getBodyRemaining();
+    if (count > SENDFILE_MAX_CHUNK) {
+      count = SENDFILE_MAX_CHUNK;
+    }
+    sent = sendfile(client->getFd(), client->res.getBodyFd(), &offset, count);
+    if (sent == 0) {
+      // ファイルが途中で切り詰められた → Content-Length を満たせない
+      std::cerr << "sendfile() error: unexpected end of file" << std::endl;
+      clients.remove(client->getFd());
+      return;
+    }
+  } else {
+    // ヘッダ・ボディ・チャンク枠をコピーせずにまとめて送る
+    struct iovec iov[IOV_BATCH];
+    int count = client->res.getIovec(iov, IOV_BATCH);
+
+    if (count == 0) {
+      return;
+    }
+
+    sent = writev(client->getFd(), iov, count);
+  }
 
   if (sent > 0) {
     client->updateTimestamp();
-    client->res.advance(static_cast<size_t>(sent));
+    if (viaSendfile) {
+      client->res.advanceBody(static_cast<size_t>(sent));
+    } else {
+      client->res.advance(static_cast<size_t>(sent));
+    }
 
     // 全て送信完了したかチェック
     if (client->res.isDone()) {
-      // Keep-Alive チェック (Connection ヘッダーを確認)
-      std::string connection = client->req.getHeader("Connection");
-      bool keepAlive = false;
-
-      // HTTP/1.1 はデフォルトで Keep-Alive
-      if (connection.empty() || connection == "keep-alive") {
-        keepAlive = true;
-      } else if (connection == "close") {
-        keepAlive = false;
-      }
-
-      if (keepAlive) {
-        // 次のリクエストを待つ
-        client->reset();
-        client->readyToRead();
-      } else {
-        // 接続終了
-        epoll.del(client->getFd());
-        clients.erase(client->getFd());
-        delete client->getContext();
-        delete client;
-      }
+      completeResponse(client, handler, clients);
+    } else {
+      // まだ残りがある場合は次の EPOLLOUT を待つ
+      // (CGI の出力を中継中なら、空いた分の読み込みを再開する)
+      client->afterSend();
     }
-    // まだ残りがある場合は次の EPOLLOUT を待つ
   } else if (sent < 0) {
     if (errno != EAGAIN && errno != EWOULDBLOCK) {
-      std::cerr << "send() error: " << strerror(errno) << std::endl;
-      epoll.del(client->getFd());
-      clients.erase(client->getFd());
-      delete client->getContext();
-      delete client;
+      std::cerr << (viaSendfile ? "sendfile() error: " : "writev() error: ")
+                << strerror(errno) << std::endl;
+      clients.remove(client->getFd());
     }
   }
 }
 
-static void handleCgiStdoutEvent(EpollContext* ctx, EpollUtils& epoll) {
-  (void)epoll;  // 未使用パラメータ
+// CGI 用 Context は Client が所有する (finishCgi() などの後処理で解放される)
+// 出力はヘッダーが揃った時点から Client が応答として中継する
+static void handleCgiStdoutEvent(EpollContext* ctx, RequestHandler& handler,
+                                 ConnectionTable& clients) {
   Client* client = ctx->client;
+  if (client->isSplicingCgiOutput()) {
+    // Content-Length のボディはパイプからソケットへ直接送る (zero-copy)
+    // ソケットのエラーは応答を打ち切るだけで、接続はソケットのイベントで閉じる
+    // (完了した応答の後始末は completeResponse。解放は1周の最後)
+    client->spliceCgiOutput();
+    if (client->getState() == WRITING_RESPONSE && client->res.isDone()) {
+      completeResponse(client, handler, clients);
+    }
+    return;
+  }
   char buf[RECV_BUFFER_SIZE];
   ssize_t n = read(client->getCgiStdoutFd(), buf, sizeof(buf));
 
   if (n > 0) {
     client->appendCgiOutput(buf, static_cast<size_t>(n));
-  } else if (n == 0) {
-    // CGI 完了
-    // Client の finishCgi() で後処理 (内部で epoll 削除も行われる)
-    client->finishCgi();
-
-    // CGI 用 Context を解放
-    delete ctx;
-  } else {
-    if (errno != EAGAIN && errno != EWOULDBLOCK) {
-      std::cerr << "CGI read error: " << strerror(errno) << std::endl;
-      client->finishCgi();  // エラーでも後処理（内部でepoll削除される）
-      delete ctx;
+    // 常駐ワーカーは END_REQUEST で完了 (接続が閉じるのを待たない)
+    if (!client->isCgiDone()) {
+      return;
     }
+  } else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+    return;
+  } else if (n < 0) {
+    std::cerr << "CGI read error: " << strerror(errno) << std::endl;
+  }
+  // CGI 完了 (エラーでも後処理。内部で epoll 削除も行われる)
+  client->finishCgi();
+  // 中継した出力を全て送信済みなら、ここで応答が完了する
+  if (client->getState() == WRITING_RESPONSE && client->res.isDone()) {
+    completeResponse(client, handler, clients);
   }
 }
 
-static void handleCgiStdinEvent(EpollContext* ctx, EpollUtils& epoll) {
+static void handleCgiStdinEvent(EpollContext* ctx) {
   Client* client = ctx->client;
-
-  // POST ボディを CGI に書き込む
-  const std::vector<char>& body = client->req.getBody();
-  size_t offset = client->getCgiStdinOffset();
-
-  if (body.empty() || offset >= body.size()) {
-    // 書き込むデータがない or 全て書き込み完了
-    epoll.del(client->getCgiStdinFd());
-    close(client->getCgiStdinFd());
-    delete ctx;
+  if (client->isSplicingCgiInput()) {
+    // splice で詰まっていたパイプが空いた → ソケットから続きを渡す
+    // (ソケットのエラーは CGI を止めるだけで、接続はソケットのイベントで閉じる)
+    client->spliceCgiInput();
     return;
   }
+  // POST ボディを受信済みの分だけ CGI に書き込む
+  // (一時ファイルのボディは sendfile で送る)
+  client->writeCgiInput();
+}
 
-  // 残りのデータを書き込み
-  size_t remaining = body.size() - offset;
-  ssize_t written = write(client->getCgiStdinFd(), &body[offset], remaining);
-
-  if (written > 0) {
-    client->advanceCgiStdinOffset(static_cast<size_t>(written));
-
-    // 全て書き込み完了したかチェック
-    if (client->getCgiStdinOffset() >= body.size()) {
-      // 書き込み完了 → パイプを閉じる
-      epoll.del(client->getCgiStdinFd());
-      close(client->getCgiStdinFd());
-      delete ctx;
+// 出力の終わった CGI の終了ステータスで応答を完了させる
+// (イベントの処理を終えた後に呼ぶ。応答の完了で接続を閉じることがある)
+static void handleChildExits(const std::vector<ChildReaper::Exit>& exits,
+                             RequestHandler& handler,
+                             ConnectionTable& clients) {
+  for (size_t i = 0; i < exits.size(); ++i) {
+    Client* client = exits[i].client;
+    if (clients.get(client->getFd()) != client) {
+      continue;  // 終了を受け取った後、この周回の中で接続を閉じ済み
     }
-    // まだ残りがある場合は次の EPOLLOUT を待つ
-  } else if (written < 0) {
-    if (errno != EAGAIN && errno != EWOULDBLOCK) {
-      std::cerr << "CGI write error: " << strerror(errno) << std::endl;
-      epoll.del(client->getCgiStdinFd());
-      close(client->getCgiStdinFd());
-      delete ctx;
+    client->onCgiExit(exits[i].status);
+    if (client->getState() == WRITING_RESPONSE && client->res.isDone()) {
+      completeResponse(client, handler, clients);
     }
   }
 }
 
-static void checkTimeouts(std::map<int, Client*>& clients, EpollUtils& epoll) {
-  std::map<int, Client*>::iterator it = clients.begin();
-  while (it != clients.end()) {
-    Client* client = it->second;
-    if (client->isTimedOut(CLIENT_TIMEOUT)) {
-      epoll.del(client->getFd());
-      delete client->getContext();
-      delete client;
-      clients.erase(it++);
+// 期限切れのタイマーだけを処理する (接続数に依存しない)
+static void handleTimeouts(TimerWheel& timers, ConnectionTable& clients) {
+  std::vector<TimerWheel::Timer*> expired;
+  timers.expire(expired);
+
+  for (size_t i = 0; i < expired.size(); ++i) {
+    Client* client = static_cast<Client*>(expired[i]->owner);
+    if (client->getTimeoutPhase() == TIMEOUT_CGI) {
+      // CGI を止めて 504 を返す (送信には send_timeout が適用される)
+      std::cerr << "[Warn] CGI timed out: pid=" << client->getCgiPid()
+                << std::endl;
+      client->abortCgi(504);
+    } else if (client->getTimeoutPhase() == TIMEOUT_CGI_QUEUE) {
+      // 実行枠が空かなかった → 起動せずに 503 (Retry-After 付き) を返す
+      std::cerr << "[Warn] CGI queue wait timed out" << std::endl;
+      client->abortCgi(503);
     } else {
-      ++it;
+      clients.remove(client->getFd());
     }
   }
 }
 
+static void printPoolStats() {
+  const PoolStats& clientStats = Client::pool().stats();
+  const PoolStats& contextStats = EpollContext::pool().stats();
+  const PoolStats& bufferStats = BufferPool::stats();
+  std::cout << "Pool stats: client=" << clientStats.hits << "/"
+            << clientStats.misses << " context=" << contextStats.hits << "/"
+            << contextStats.misses << " buffer=" << bufferStats.hits << "/"
+            << bufferStats.misses << " (hit/miss)" << std::endl;
+}
+
+// 2つの nextTimeout() の早い方 (-1 はタイマーなし)
+static int earliestTimeout(int a, int b) {
+  if (a < 0) {
+    return b;
+  }
+  if (b < 0) {
+    return a;
+  }
+  return a < b ? a : b;
+}
+
 static void eventLoop(EpollUtils& epoll, RequestHandler& handler,
-                      std::map<int, Client*>& clients,
-                      std::map<int, int>& listener_fds) {
+                      ConnectionTable& clients, TimerWheel& timers,
+                      ChildReaper& reaper, std::map<int, int>& listener_fds,
+                      Acceptor& acceptor) {
   struct epoll_event events[MAX_EVENTS];
+  std::vector<ChildReaper::Exit> exits;
 
   while (g_running) {
-    int nfds = epoll.wait(events, MAX_EVENTS, TIMEOUT_MS);
+    exits.clear();  // SIGCHLD で回収した分をこの周回の最後まで溜める
+    // 次の期限まで待つ (タイマーがなければイベントが来るまで待つ)
+    int nfds = epoll.wait(events, MAX_EVENTS,
+                          earliestTimeout(timers.nextTimeout(),
+                                          reaper.nextTimeout()));
+
+    // イベント処理中に設定する期限の基準時刻 (1周につき1回だけ取得)
+    timers.setNow(TimerWheel::clock());
 
     if (nfds < 0) {
       if (errno == EINTR) {
@@ -368,63 +502,82 @@ static void eventLoop(EpollUtils& epoll, RequestHandler& handler,
         case EpollContext::LISTENER: {
           // 新規接続
           int listener_fd = listener_fds[ctx->listen_port];
-          handleListenerEvent(ctx, listener_fd, epoll, clients);
+          handleListenerEvent(ctx, listener_fd, clients, acceptor);
           break;
         }
 
+        // client が外れていれば、この周回の中で接続を閉じ済み
         case EpollContext::CLIENT: {
           Client* client = ctx->client;
-          if (events[i].events & EPOLLIN) {
-            handleClientReadEvent(client, epoll, handler, clients);
-          } else if (events[i].events & EPOLLOUT) {
-            handleClientWriteEvent(client, epoll, clients);
+          if (!client) {
+            break;
+          }
+          int fd = client->getFd();
+          uint32_t ev = events[i].events;
+          // 応答中も先読みのため EPOLLIN と EPOLLOUT が同時に来る
+          // 送信を先に進め、接続が残っていれば受信する
+          if (ev & EPOLLOUT) {
+            handleClientWriteEvent(client, handler, clients);
+          }
+          if ((ev & EPOLLIN) && ctx->client) {
+            handleClientReadEvent(client, handler, clients);
+          }
+          if (!(ev & (EPOLLIN | EPOLLOUT)) && (ev & (EPOLLHUP | EPOLLERR))) {
+            // 監視イベントを外している間に切断された
+            clients.remove(fd);
           }
           break;
         }
 
+        // client が外れていれば、この周回の中で CGI が後処理済み
         case EpollContext::CGI_STDOUT: {
-          handleCgiStdoutEvent(ctx, epoll);
+          if (ctx->client) {
+            handleCgiStdoutEvent(ctx, handler, clients);
+          }
           break;
         }
 
         case EpollContext::CGI_STDIN: {
-          handleCgiStdinEvent(ctx, epoll);
+          if (ctx->client) {
+            handleCgiStdinEvent(ctx);
+          }
+          break;
+        }
+
+        case EpollContext::FILE_WATCH: {
+          // 静的ファイルの変更 → キャッシュから外す
+          handler.fileCache().processEvents();
+          break;
+        }
+
+        case EpollContext::CHILD_EXIT: {
+          // SIGCHLD → 終了した CGI を回収する (応答の完了はループの後で)
+          reaper.processEvents(exits);
           break;
         }
       }
     }
 
-    // タイムアウトチェック
-    checkTimeouts(clients, epoll);
+    // 回収した CGI の応答を完了させる
+    handleChildExits(exits, handler, clients);
+    // タイムアウト処理
+    handleTimeouts(timers, clients);
+    // 終わらない CGI への SIGTERM / SIGKILL
+    exits.clear();
+    reaper.expire(timers.now(), exits);
+    handleChildExits(exits, handler, clients);
+
+    // この周回で閉じた接続と、不要になった Context を解放する
+    clients.releaseRetired();
+    EpollContext::releaseRetired();
   }
 }
 
-// メイン関数
-
-int main(int argc, char** argv) {
-  // シグナルハンドラ設定
-  signal(SIGINT, signalHandler);
-  signal(SIGTERM, signalHandler);
-  signal(SIGPIPE, SIG_IGN);  // SIGPIPE を無視
-
-  // 引数チェック
-  if (argc < 2) {
-    std::cerr << "Usage: " << argv[0] << " <config_file>" << std::endl;
-    return 1;
-  }
-
-  // 設定読み込み
-
-  MainConfig config;
-
-  try {
-    ConfigParser parser(argv[1]);
-    parser.parse(config);
-  } catch (const std::exception& e) {
-    std::cerr << "Config parse error: " << e.what() << std::endl;
-    return 1;
-  }
+// ワーカー
+// 各ワーカーは自前の epoll fd / clients / RequestHandler を持ち、
+// MainConfig は読み取り専用で共有する
 
+static int runWorker(const MainConfig& config, bool reusePort) {
   // epoll 初期化
 
   EpollUtils epoll;
@@ -453,8 +606,15 @@ int main(int argc, char** argv) {
   std::vector<EpollContext*> listener_contexts;
   for (size_t i = 0; i < unique_ports.size(); ++i) {
     int port = unique_ports[i];
-    int listener_fd = createListenerSocket(port);
+    int listener_fd = createListenerSocket(port, reusePort);
     if (listener_fd < 0) {
+      for (std::map<int, int>::iterator it = listener_fds.begin();
+           it != listener_fds.end(); ++it) {
+        close(it->second);
+      }
+      for (size_t j = 0; j < listener_contexts.size(); ++j) {
+        delete listener_contexts[j];
+      }
       return 1;
     }
     listener_fds[port] = listener_fd;
@@ -465,26 +625,99 @@ int main(int argc, char** argv) {
     epoll.add(listener_fd, listener_ctx, EPOLLIN);
   }
 
+  // 子プロセスの回収 (CGI・常駐ワーカーより後に破棄されるよう先に生成する)
+
+  ChildReaper reaper;
+  EpollContext* reaper_ctx = NULL;
+  if (reaper.getFd() >= 0) {
+    reaper_ctx = EpollContext::createChildExit();
+    epoll.add(reaper.getFd(), reaper_ctx, EPOLLIN);
+  }
+
   // RequestHandler 初期化
 
   RequestHandler handler(config);
+  BodySink::configure(config.client_body.buffer_size,
+                      config.client_body.temp_path);
+
+  // 静的ファイルキャッシュの変更監視 (inotify が使えなければ登録しない)
+  EpollContext* watch_ctx = NULL;
+  int watch_fd = handler.fileCache().getWatchFd();
+  if (watch_fd >= 0) {
+    watch_ctx = EpollContext::createFileWatch();
+    epoll.add(watch_fd, watch_ctx, EPOLLIN);
+  }
 
-  // Client 管理マップ
+  // タイムアウト管理 (Client より先に破棄されないよう先に生成する)
 
-  std::map<int, Client*> clients;
+  TimerWheel timers(TimerWheel::clock());
+
+  // Client 管理テーブル (fd インデックス)
+
+  ConnectionTable clients(&epoll, &timers, &config.timeouts);
+
+  // accept 状態 (予備 fd を確保しておく)
+  Acceptor acceptor;
+  acceptor.budget = config.accept_budget;
+  acceptor.reserveFd = open("/dev/null", O_RDONLY | O_CLOEXEC);
+  acceptor.accepted = 0;
+  acceptor.drained = 0;
+  acceptor.rejected = 0;
 
   // イベントループ開始
-  eventLoop(epoll, handler, clients, listener_fds);
+  eventLoop(epoll, handler, clients, timers, reaper, listener_fds, acceptor);
+
+  std::cout << "Accept stats: accepted=" << acceptor.accepted
+            << " drained=" << acceptor.drained
+            << " rejected=" << acceptor.rejected << std::endl;
+  printPoolStats();
+  const PoolStats& fileStats = handler.fileCache().stats();
+  std::cout << "File cache stats: " << fileStats.hits << "/"
+            << fileStats.misses << " (hit/miss)" << std::endl;
+  const AssetCacheStats& assetStats = handler.assetCache().stats();
+  std::cout << "Asset cache stats: hits=" << assetStats.hits
+            << " misses=" << assetStats.misses
+            << " evictions=" << assetStats.evictions << std::endl;
+  const BodySinkStats& bodyStats = BodySink::stats();
+  std::cout << "Body sink stats: spills=" << bodyStats.spills
+            << " bytes=" << bodyStats.spilledBytes
+            << " renames=" << bodyStats.renames << std::endl;
+  CgiPoolStats cgiStats = handler.cgiPoolStats();
+  if (cgiStats.spawned > 0) {
+    std::cout << "CGI worker stats: requests=" << cgiStats.requests
+              << " spawned=" << cgiStats.spawned
+              << " recycled=" << cgiStats.recycled
+              << " queued=" << cgiStats.queued << std::endl;
+  }
+  CgiLimitStats limitStats = handler.cgiLimitStats();
+  if (limitStats.started > 0 || limitStats.rejected > 0) {
+    unsigned long resumed = limitStats.queued - limitStats.abandoned;
+    std::cout << "CGI queue stats: started=" << limitStats.started
+              << " queued=" << limitStats.queued
+              << " rejected=" << limitStats.rejected
+              << " abandoned=" << limitStats.abandoned
+              << " max_depth=" << limitStats.maxDepth << " wait_avg_ms="
+              << (resumed > 0 ? limitStats.waitTotal / resumed : 0)
+              << " wait_max_ms=" << limitStats.waitMax << std::endl;
+  }
+  const ReaperStats& reaperStats = ChildReaper::stats();
+  std::cout << "CGI reaper stats: reaped=" << reaperStats.reaped
+            << " terminated=" << reaperStats.terminated
+            << " killed=" << reaperStats.killed << std::endl;
+  const SpliceStats& spliceStats = Client::spliceStats();
+  std::cout << "Splice stats: to_cgi=" << spliceStats.toCgi
+            << " from_cgi=" << spliceStats.fromCgi << std::endl;
+  const DeflateStats& gzipStats = Deflater::stats();
+  std::cout << "Gzip stats: streams=" << gzipStats.streams
+            << " in=" << gzipStats.bytesIn << " out=" << gzipStats.bytesOut
+            << " cpu_us=" << gzipStats.cpuUsec << std::endl;
+  if (acceptor.reserveFd >= 0) {
+    close(acceptor.reserveFd);
+  }
 
   // クリーンアップ
 
-  // クライアント解放
-  for (std::map<int, Client*>::iterator it = clients.begin();
-       it != clients.end(); ++it) {
-    delete it->second->getContext();
-    delete it->second;
-  }
-  clients.clear();
+  // クライアントは ConnectionTable のデストラクタで解放される
 
   // Listener 解放
   for (std::map<int, int>::iterator it = listener_fds.begin();
@@ -496,6 +729,240 @@ int main(int argc, char** argv) {
   for (size_t i = 0; i < listener_contexts.size(); ++i) {
     delete listener_contexts[i];
   }
+  delete watch_ctx;
+  delete reaper_ctx;
 
   return 0;
 }
+
+// マスタープロセス (worker_processes > 1 の場合のみ)
+// ワーカーを fork し、終了シグナルを全ワーカーへ転送する
+
+// すぐ落ちるワーカーの再起動は間隔を倍々に空ける
+static const TimerWheel::Msec RESPAWN_MIN_DELAY_MS = 100;
+static const TimerWheel::Msec RESPAWN_MAX_DELAY_MS = 10000;
+static const TimerWheel::Msec WORKER_STABLE_MS = 10000;  // これだけ動けば正常
+
+struct WorkerSlot {
+  pid_t pid;                      // -1 なら停止中
+  TimerWheel::Msec startedAt;     // 起動した時刻
+  TimerWheel::Msec respawnAt;     // 再起動する時刻 (0 なら予定なし)
+  TimerWheel::Msec respawnDelay;  // 直前の再起動で空けた間隔
+};
+
+static pid_t spawnWorker(const MainConfig& config, const sigset_t& mask) {
+  // 子プロセスに未出力のバッファが複製されないようにする
+  std::cout.flush();
+  std::cerr.flush();
+
+  pid_t pid = fork();
+  if (pid < 0) {
+    std::cerr << "fork() failed: " << strerror(errno) << std::endl;
+    return -1;
+  }
+  if (pid == 0) {
+    // マスターがブロックしたシグナルをワーカーでは受け取る
+    sigprocmask(SIG_SETMASK, &mask, NULL);
+    int status = 1;
+    try {
+      status = runWorker(config, true);
+    } catch (const std::exception& e) {
+      std::cerr << "Worker error: " << e.what() << std::endl;
+    }
+    std::exit(status);
+  }
+  std::cout << "Worker " << pid << " started" << std::endl;
+  return pid;
+}
+
+static void stopWorkers(const std::vector<WorkerSlot>& workers) {
+  for (size_t i = 0; i < workers.size(); ++i) {
+    if (workers[i].pid > 0) {
+      kill(workers[i].pid, SIGTERM);
+    }
+  }
+}
+
+// Schedules the restart of a crashed worker.
+// A worker that dies soon after it started (e.g. on every request or
+// while it initialises) waits twice as long as last time before the next
+// start, up to RESPAWN_MAX_DELAY_MS, so it cannot turn into a fork loop.
+static void scheduleRespawn(WorkerSlot& slot, TimerWheel::Msec now) {
+  if (now - slot.startedAt >= WORKER_STABLE_MS) {
+    slot.respawnDelay = 0;
+  } else if (slot.respawnDelay == 0) {
+    slot.respawnDelay = RESPAWN_MIN_DELAY_MS;
+  } else if (slot.respawnDelay * 2 < RESPAWN_MAX_DELAY_MS) {
+    slot.respawnDelay *= 2;
+  } else {
+    slot.respawnDelay = RESPAWN_MAX_DELAY_MS;
+  }
+  slot.respawnAt = now + slot.respawnDelay;
+}
+
+// Waits for one of the blocked signals, or until the next respawn is due.
+// returns:
+//   int: the signal number, or -1 on timeout or interruption.
+static int waitSignal(const sigset_t& signals,
+                      const std::vector<WorkerSlot>& workers, bool stopping) {
+  TimerWheel::Msec now = TimerWheel::clock();
+  TimerWheel::Msec wait = 0;
+  bool pending = false;
+  for (size_t i = 0; !stopping && i < workers.size(); ++i) {
+    if (workers[i].pid < 0 && workers[i].respawnAt != 0) {
+      TimerWheel::Msec left =
+          workers[i].respawnAt > now ? workers[i].respawnAt - now : 0;
+      if (!pending || left < wait) {
+        wait = left;
+      }
+      pending = true;
+    }
+  }
+  if (!pending) {
+    return sigwaitinfo(&signals, NULL);
+  }
+  struct timespec timeout;
+  timeout.tv_sec = static_cast<time_t>(wait / 1000);
+  timeout.tv_nsec = static_cast<long>(wait % 1000) * 1000000L;
+  return sigtimedwait(&signals, NULL, &timeout);
+}
+
+// The master blocks SIGINT, SIGTERM and SIGCHLD and takes them with
+// sigwaitinfo()/sigtimedwait(), so a signal that arrives while it forks or
+// reaps stays pending instead of being missed before the next wait.
+static int runMaster(const MainConfig& config) {
+  sigset_t signals;
+  sigset_t savedMask;
+  sigemptyset(&signals);
+  sigaddset(&signals, SIGINT);
+  sigaddset(&signals, SIGTERM);
+  sigaddset(&signals, SIGCHLD);
+  sigprocmask(SIG_BLOCK, &signals, &savedMask);
+
+  std::vector<WorkerSlot> workers(config.worker_processes);
+  size_t alive = 0;
+  int exitCode = 0;
+
+  for (size_t i = 0; i < workers.size(); ++i) {
+    workers[i].pid = -1;
+    workers[i].startedAt = TimerWheel::clock();
+    workers[i].respawnAt = 0;
+    workers[i].respawnDelay = 0;
+  }
+  for (size_t i = 0; g_running && i < workers.size(); ++i) {
+    workers[i].pid = spawnWorker(config, savedMask);
+    if (workers[i].pid < 0) {
+      g_running = 0;
+      exitCode = 1;
+      break;
+    }
+    ++alive;
+  }
+
+  bool stopping = !g_running;
+  if (stopping) {
+    stopWorkers(workers);
+  }
+  while (alive > 0 || !stopping) {
+    int sig = waitSignal(signals, workers, stopping);
+    if ((sig == SIGINT || sig == SIGTERM) && !stopping) {
+      // SIGINT/SIGTERM を受けたら全ワーカーへ転送
+      std::cout << "\nShutting down..." << std::endl;
+      g_running = 0;
+      stopping = true;
+      stopWorkers(workers);
+    }
+
+    TimerWheel::Msec now = TimerWheel::clock();
+    int status;
+    pid_t pid = 0;
+    while (alive > 0 && (pid = waitpid(-1, &status, WNOHANG)) > 0) {
+      size_t idx = workers.size();
+      for (size_t i = 0; i < workers.size(); ++i) {
+        if (workers[i].pid == pid) {
+          idx = i;
+          break;
+        }
+      }
+      if (idx == workers.size()) {
+        continue;
+      }
+      workers[idx].pid = -1;
+      --alive;
+
+      if (stopping) {
+        continue;
+      }
+      if (WIFSIGNALED(status)) {
+        // クラッシュしたワーカーは再起動する
+        scheduleRespawn(workers[idx], now);
+        std::cerr << "Worker " << pid << " killed by signal "
+                  << WTERMSIG(status) << ", respawning in "
+                  << workers[idx].respawnDelay << " ms" << std::endl;
+      } else {
+        // 起動失敗 (bind エラーなど) → 全体を停止
+        if (WEXITSTATUS(status) != 0) {
+          exitCode = 1;
+        }
+        stopping = true;
+        stopWorkers(workers);
+      }
+    }
+    if (pid < 0 && errno == ECHILD) {
+      break;  // 待つ子がいない
+    }
+
+    for (size_t i = 0; !stopping && i < workers.size(); ++i) {
+      if (workers[i].pid >= 0 || workers[i].respawnAt == 0 ||
+          workers[i].respawnAt > now) {
+        continue;
+      }
+      workers[i].respawnAt = 0;
+      workers[i].startedAt = now;
+      workers[i].pid = spawnWorker(config, savedMask);
+      if (workers[i].pid > 0) {
+        ++alive;
+      } else {
+        scheduleRespawn(workers[i], now);
+      }
+    }
+  }
+  sigprocmask(SIG_SETMASK, &savedMask, NULL);
+  return exitCode;
+}
+
+// メイン関数
+
+int main(int argc, char** argv) {
+  // シグナルハンドラ設定
+  struct sigaction sa;
+  std::memset(&sa, 0, sizeof(sa));
+  sa.sa_handler = signalHandler;
+  sigemptyset(&sa.sa_mask);
+  sigaction(SIGINT, &sa, NULL);
+  sigaction(SIGTERM, &sa, NULL);
+  signal(SIGPIPE, SIG_IGN);  // SIGPIPE を無視
+
+  // 引数チェック
+  if (argc < 2) {
+    std::cerr << "Usage: " << argv[0] << " <config_file>" << std::endl;
+    return 1;
+  }
+
+  // 設定読み込み
+
+  MainConfig config;
+
+  try {
+    ConfigParser parser(argv[1]);
+    parser.parse(config);
+  } catch (const std::exception& e) {
+    std::cerr << "Config parse error: " << e.what() << std::endl;
+    return 1;
+  }
+
+  if (config.worker_processes > 1) {
+    return runMaster(config);
+  }
+  return runWorker(config, false);
+}
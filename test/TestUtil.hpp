@@ -0,0 +1,84 @@
+#ifndef TESTUTIL_HPP
+#define TESTUTIL_HPP
+
+#include <limits.h>
+#include <unistd.h>
+#include <cstdlib>
+#include <string>
+#include "../inc/Http.hpp"
+
+/*
+ * テスト共通のヘルパー
+ * 各テストは1ファイル = 1実行ファイルなので、使わない関数で警告が出ないよう
+ * inline で定義する。
+ */
+
+// カレントディレクトリからの相対パスを絶対パスにする (CGI の root 用)
+inline std::string absPath(const std::string& relative) {
+  char cwd[PATH_MAX];
+  if (getcwd(cwd, sizeof(cwd)) == NULL)
+    return relative;
+  return std::string(cwd) + "/" + relative;
+}
+
+// 応答を送信し終えるまで読む
+// step ごとに advance() して部分送信を再現する。sendfile のボディは pread で読む
+inline std::string drain(HttpResponse& res, size_t step = std::string::npos) {
+  std::string out;
+  while (!res.isDone() && !res.isError()) {
+    if (res.isSendfilePending()) {
+      std::string part(res.getBodyRemaining(), '\0');
+      ssize_t n = pread(res.getBodyFd(), &part[0], part.size(),
+                        res.getBodyOffset());
+      if (n <= 0)
+        break;
+      out.append(part, 0, static_cast<size_t>(n));
+      res.advanceBody(static_cast<size_t>(n));
+      continue;
+    }
+    size_t n = res.getRemainingSize();
+    if (n == 0)
+      break;
+    if (n > step)
+      n = step;
+    out.append(res.getData(), n);
+    res.advance(n);
+  }
+  return out;
+}
+
+// 応答ヘッダーの値 (なければ空文字列)
+inline std::string headerValue(const std::string& res,
+                               const std::string& name) {
+  std::string key = "\r\n" + name + ": ";
+  std::string::size_type pos = res.find(key);
+  if (pos == std::string::npos)
+    return "";
+  pos += key.size();
+  return res.substr(pos, res.find("\r\n", pos) - pos);
+}
+
+// ヘッダーを除いたボディ
+inline std::string bodyOf(const std::string& res) {
+  std::string::size_type pos = res.find("\r\n\r\n");
+  return pos == std::string::npos ? "" : res.substr(pos + 4);
+}
+
+// chunked のボディを戻す (形式が壊れていれば "!")
+inline std::string dechunk(const std::string& body) {
+  std::string out;
+  std::string::size_type pos = 0;
+  while (true) {
+    std::string::size_type eol = body.find("\r\n", pos);
+    if (eol == std::string::npos)
+      return "!";
+    size_t size = std::strtoul(body.substr(pos, eol - pos).c_str(), NULL, 16);
+    pos = eol + 2;
+    if (size == 0)
+      return body.substr(pos) == "\r\n" ? out : "!";
+    out += body.substr(pos, size);
+    pos += size + 2;
+  }
+}
+
+#endif
@@ -0,0 +1,111 @@
+// CGI 起動方式のマイクロベンチマーク
+//
+// ビルド例:
+//   c++ -O2 -std=c++98 test/bench_cgi_spawn.cpp -o bench_cgi_spawn
+//   ./bench_cgi_spawn [RSS (MB) ...]   (省略時は 0 64 256 1024)
+//
+// サーバーのキャッシュや接続で RSS が増えた状態を、確保して書き込んだ
+// メモリで再現し、/bin/true を起動して終了を待つまでの時間を比べる
+// 1. fork + execve (従来の Client::startCgi)
+// 2. posix_spawn (現在の Client::startCgi)
+// 「起動」は親に制御が戻るまで、「往復」は waitpid で回収するまで
+#include <spawn.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+extern char** environ;
+
+static double now() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static const char* const PROGRAM = "/bin/true";
+
+static pid_t launchFork() {
+  char* argv[2];
+  argv[0] = const_cast<char*>(PROGRAM);
+  argv[1] = NULL;
+  pid_t pid = fork();
+  if (pid == 0) {
+    execve(PROGRAM, argv, environ);
+    _exit(127);
+  }
+  return pid;
+}
+
+static pid_t launchSpawn() {
+  char* argv[2];
+  argv[0] = const_cast<char*>(PROGRAM);
+  argv[1] = NULL;
+  posix_spawn_file_actions_t actions;
+  posix_spawn_file_actions_init(&actions);
+  // Client::startCgi と同じく stdin / stdout の dup2 を含める
+  posix_spawn_file_actions_adddup2(&actions, STDIN_FILENO, STDIN_FILENO);
+  posix_spawn_file_actions_adddup2(&actions, STDOUT_FILENO, STDOUT_FILENO);
+  pid_t pid = -1;
+  if (posix_spawn(&pid, PROGRAM, &actions, NULL, argv, environ) != 0) {
+    pid = -1;
+  }
+  posix_spawn_file_actions_destroy(&actions);
+  return pid;
+}
+
+static void bench(const char* name, pid_t (*launch)(), int iterations) {
+  double launchTotal = 0;
+  double roundTrip = now();
+  for (int i = 0; i < iterations; ++i) {
+    double t0 = now();
+    pid_t pid = launch();
+    launchTotal += now() - t0;
+    if (pid < 0) {
+      std::printf("  %-16s failed\n", name);
+      return;
+    }
+    waitpid(pid, NULL, 0);
+  }
+  roundTrip = now() - roundTrip;
+  std::printf("  %-16s launch %8.1f us  round trip %8.1f us\n", name,
+              launchTotal / iterations * 1e6, roundTrip / iterations * 1e6);
+}
+
+int main(int argc, char** argv) {
+  std::vector<size_t> sizes;
+  for (int i = 1; i < argc; ++i) {
+    sizes.push_back(std::strtoul(argv[i], NULL, 10));
+  }
+  if (sizes.empty()) {
+    size_t defaults[] = {0, 64, 256, 1024};
+    sizes.assign(defaults, defaults + 4);
+  }
+
+  std::vector<char*> ballast;
+  size_t resident = 0;
+  for (size_t i = 0; i < sizes.size(); ++i) {
+    // 1MB ずつ確保して書き込み、ページを実際に割り当てる
+    while (resident < sizes[i]) {
+      char* block = static_cast<char*>(std::malloc(1024 * 1024));
+      if (!block) {
+        std::printf("allocation failed at %lu MB\n",
+                    static_cast<unsigned long>(resident));
+        return 1;
+      }
+      std::memset(block, 1, 1024 * 1024);
+      ballast.push_back(block);
+      ++resident;
+    }
+    std::printf("RSS +%lu MB\n", static_cast<unsigned long>(resident));
+    bench("fork+execve", launchFork, 200);
+    bench("posix_spawn", launchSpawn, 200);
+  }
+  for (size_t i = 0; i < ballast.size(); ++i) {
+    std::free(ballast[i]);
+  }
+  return 0;
+}
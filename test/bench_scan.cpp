@@ -0,0 +1,152 @@
+// Scan カーネルのマイクロベンチマーク
+//
+// ビルド例:
+//   c++ -O2 -std=c++98 -I inc test/bench_scan.cpp src/Scan.cpp
+//       src/HttpRequest.cpp src/Pool.cpp src/Config.cpp -o bench_scan
+//
+// 1. ヘッダー走査: std::string::find + 1文字ずつの tolower (従来の実装) と
+//    Scan の各実装 (scalar / sse2 / avx2) で同じ処理を行い比較する
+// 2. HttpRequest::feed 全体を Scan の各実装で比較する
+//
+// コーパスは test_feed.cpp のリクエストと、large_header.cpp の巨大ヘッダー
+// (MAX_HEADER_SIZE に収まるよう 120 行に縮めたもの)
+#include <time.h>
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "../inc/Http.hpp"
+#include "../inc/Scan.hpp"
+
+static double now() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static std::string feedCorpus() {
+  return "POST /upload?x=1 HTTP/1.1\r\n"
+         "Host: localhost\r\n"
+         "X-Custom:   spaced value\r\n"
+         "Content-Length: 5\r\n"
+         "\r\n"
+         "hello";
+}
+
+static std::string largeHeaderCorpus() {
+  std::ostringstream oss;
+  oss << "GET / HTTP/1.1\r\n";
+  oss << "Host: localhost\r\n";
+  for (int i = 0; i < 120; ++i) {
+    oss << "X-Custom-Header-" << i << ": " << std::string(100, 'A') << "\r\n";
+  }
+  oss << "\r\n";
+  return oss.str();
+}
+
+// 従来の実装: 行ごとに find("\r\n") / find(':') / tolower
+static size_t legacyScan(const std::string& buf) {
+  size_t sum = 0;
+  std::string::size_type pos = 0;
+  while (true) {
+    std::string::size_type eol = buf.find("\r\n", pos);
+    if (eol == std::string::npos || eol == pos) {
+      break;
+    }
+    std::string line = buf.substr(pos, eol - pos);
+    std::string::size_type colon = line.find(':');
+    if (colon != std::string::npos) {
+      std::string key = line.substr(0, colon);
+      for (size_t i = 0; i < key.size(); ++i) {
+        key[i] = static_cast<char>(
+            std::tolower(static_cast<unsigned char>(key[i])));
+      }
+      sum += key.size();
+    }
+    pos = eol + 2;
+  }
+  return sum;
+}
+
+// Scan を使った同じ処理
+static size_t scanScan(const std::string& buf) {
+  size_t sum = 0;
+  const char* p = buf.data();
+  const char* end = p + buf.size();
+  char key[256];
+  while (true) {
+    const char* eol = Scan::findCrlf(p, end);
+    if (eol == end || eol == p) {
+      break;
+    }
+    const char* colon = Scan::findNonToken(p, eol);
+    if (colon != eol && *colon == ':' &&
+        static_cast<size_t>(colon - p) <= sizeof(key)) {
+      size_t len = static_cast<size_t>(colon - p);
+      std::copy(p, colon, key);
+      Scan::toLower(key, len);
+      sum += len;
+    }
+    p = eol + 2;
+  }
+  return sum;
+}
+
+static void report(const char* name, double seconds, size_t bytes,
+                   int iterations) {
+  double mbps = static_cast<double>(bytes) * iterations / seconds / 1e6;
+  std::printf("  %-24s %8.3f ms  %8.1f MB/s\n", name, seconds * 1e3, mbps);
+}
+
+static void benchCorpus(const char* title, const std::string& corpus,
+                        int iterations) {
+  std::printf("%s (%lu bytes x %d)\n", title,
+              static_cast<unsigned long>(corpus.size()), iterations);
+  volatile size_t sink = 0;
+
+  double t0 = now();
+  for (int i = 0; i < iterations; ++i) {
+    sink = sink + legacyScan(corpus);
+  }
+  report("scan: find+tolower", now() - t0, corpus.size(), iterations);
+
+  Scan::Impl impls[] = {Scan::SCALAR, Scan::SSE2, Scan::AVX2};
+  for (size_t k = 0; k < 3; ++k) {
+    if (!Scan::setImpl(impls[k])) {
+      continue;
+    }
+    std::string name = std::string("scan: ") + Scan::implName(impls[k]);
+    t0 = now();
+    for (int i = 0; i < iterations; ++i) {
+      sink = sink + scanScan(corpus);
+    }
+    report(name.c_str(), now() - t0, corpus.size(), iterations);
+  }
+
+  for (size_t k = 0; k < 3; ++k) {
+    if (!Scan::setImpl(impls[k])) {
+      continue;
+    }
+    std::string name = std::string("feed: ") + Scan::implName(impls[k]);
+    t0 = now();
+    for (int i = 0; i < iterations; ++i) {
+      HttpRequest req;
+      req.feed(corpus.data(), corpus.size());
+      sink = sink + req.getHeaders().size();
+    }
+    report(name.c_str(), now() - t0, corpus.size(), iterations);
+  }
+  Scan::setImpl(Scan::bestImpl());
+  (void)sink;
+}
+
+int main() {
+  std::cout << "best implementation: " << Scan::implName(Scan::bestImpl())
+            << std::endl;
+  benchCorpus("test_feed corpus", feedCorpus(), 200000);
+  benchCorpus("large_header corpus", largeHeaderCorpus(), 5000);
+  return 0;
+}
@@ -0,0 +1,163 @@
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include "../inc/AssetCache.hpp"
+#include "../inc/Http.hpp"
+#include "TestUtil.hpp"
+
+// 色付け用
+#define GREEN "\033[32m"
+#define RED "\033[31m"
+#define RESET "\033[0m"
+
+void printResult(const std::string& testName, bool success) {
+  if (success) {
+    std::cout << GREEN << "[PASS] " << testName << RESET << std::endl;
+  } else {
+    std::cout << RED << "[FAIL] " << testName << RESET << std::endl;
+    std::exit(1);
+  }
+}
+
+static OpenFileCache::Info makeInfo(off_t size, time_t mtime) {
+  OpenFileCache::Info info;
+  info.exists = true;
+  info.readable = true;
+  info.size = size;
+  info.mtime = mtime;
+  return info;
+}
+
+static std::map<std::string, std::string> typeHeaders(
+    const std::string& path) {
+  std::map<std::string, std::string> headers;
+  headers["Content-Type"] = HttpResponse::getMimeType(path);
+  return headers;
+}
+
+static CachedAsset* insertText(AssetCache& cache, const std::string& path,
+                               const std::string& text, time_t mtime) {
+  std::vector<char> body(text.begin(), text.end());
+  return cache.insert(path, makeInfo(text.size(), mtime), body,
+                      typeHeaders(path));
+}
+
+int main() {
+  std::cout << "=== Starting AssetCache Unit Test ===" << std::endl;
+
+  // ---------------------------------------------------------
+  // TEST 1: 登録と照合
+  // ---------------------------------------------------------
+  {
+    AssetCache cache(4096, 1024);
+    printResult("accepts small file", cache.accepts(100));
+    printResult("rejects large file", !cache.accepts(2048));
+
+    CachedAsset* asset =
+        insertText(cache, "/www/index.html", "<h1>hi</h1>", 10);
+    printResult("insert returns entry", asset != NULL);
+    std::map<std::string, std::string> headers =
+        typeHeaders("/www/index.html");
+    printResult("lookup hits",
+                cache.lookup("/www/index.html", makeInfo(11, 10), headers) ==
+                    asset);
+    std::map<std::string, std::string> other = headers;
+    other["Vary"] = "Accept-Encoding";
+    printResult("different headers miss",
+                cache.lookup("/www/index.html", makeInfo(11, 10), other) ==
+                    NULL);
+    insertText(cache, "/www/index.html", "<h1>hi</h1>", 10);
+    printResult("changed mtime misses",
+                cache.lookup("/www/index.html", makeInfo(11, 11), headers) ==
+                    NULL);
+    printResult("stale entry dropped", cache.size() == 0);
+    printResult("counters", cache.stats().hits == 1 &&
+                                cache.stats().misses == 2 &&
+                                cache.stats().evictions == 0);
+  }
+
+  // ---------------------------------------------------------
+  // TEST 2: バイト予算による LRU 追い出し
+  // ---------------------------------------------------------
+  {
+    std::string body(300, 'x');
+    AssetCache cache(1000, 1000);
+    insertText(cache, "/a", body, 1);
+    insertText(cache, "/b", body, 1);
+    std::map<std::string, std::string> headers = typeHeaders("/a");
+    cache.lookup("/a", makeInfo(300, 1), headers);  // a を最近使ったものにする
+    insertText(cache, "/c", body, 1);      // b が追い出される
+    printResult("budget respected", cache.bytes() <= 1000);
+    printResult("eviction counted", cache.stats().evictions == 1);
+    printResult("recent entry kept",
+                cache.lookup("/a", makeInfo(300, 1), headers));
+    printResult("old entry evicted",
+                !cache.lookup("/b", makeInfo(300, 1), headers));
+  }
+
+  // ---------------------------------------------------------
+  // TEST 3: 組み立て済み応答が build() と同じバイト列になる
+  // ---------------------------------------------------------
+  {
+    AssetCache cache(4096, 1024);
+    CachedAsset* asset = insertText(cache, "/www/style.css", "body{}", 5);
+
+    HttpResponse built;
+    built.setHeader("Connection", "keep-alive");
+    built.setStatusCode(200);
+    built.setHeader("Content-Type", HttpResponse::getMimeType("/style.css"));
+    built.setBody("body{}");
+    built.build();
+
+    HttpResponse cached;
+    cached.setHeader("Connection", "keep-alive");
+    printResult("setCachedAsset accepted", cached.setCachedAsset(asset));
+    printResult("same bytes as build()", drain(cached) == drain(built));
+
+    HttpResponse head;
+    head.setRequestMethod(HEAD);
+    head.setCachedAsset(asset);
+    std::string headOut = drain(head);
+    printResult("HEAD omits body",
+                headOut.find("body{}") == std::string::npos &&
+                    headOut.find("Content-Length: 6\r\n") !=
+                        std::string::npos);
+
+    HttpResponse custom;
+    custom.setHeader("Location", "/x");
+    printResult("extra headers fall back to build()",
+                !custom.setCachedAsset(asset));
+
+    // 後からステータスが変わった (error_page 経由) → 通常のボディで組み直す
+    HttpResponse rebuilt;
+    rebuilt.setCachedAsset(asset);
+    rebuilt.setStatusCode(404);
+    rebuilt.build();
+    std::string rebuiltOut = drain(rebuilt);
+    printResult("status change rebuilds",
+                rebuiltOut.find("HTTP/1.1 404 Not Found\r\n") == 0 &&
+                    rebuiltOut.find("Content-Type: text/css") !=
+                        std::string::npos &&
+                    rebuiltOut.substr(rebuiltOut.size() - 6) == "body{}");
+  }
+
+  // ---------------------------------------------------------
+  // TEST 4: 送信中の応答は追い出されたエントリを保持し続ける
+  // ---------------------------------------------------------
+  {
+    AssetCache cache(4096, 1024);
+    CachedAsset* asset = insertText(cache, "/www/a.txt", "payload", 1);
+    HttpResponse res;
+    res.setCachedAsset(asset);
+    cache.clear();
+    {
+      HttpResponse copy(res);  // コピーの破棄で参照が外れすぎないこと
+    }
+    std::string out = drain(res);
+    printResult("body survives eviction",
+                out.size() > 7 && out.substr(out.size() - 7) == "payload");
+  }
+
+  std::cout << "=== All AssetCache tests passed ===" << std::endl;
+  return 0;
+}
@@ -44,7 +44,7 @@ void test_ContentLength_Stored() {
   printResult("ContentLength_Stored: Value check",
               req.getContentLength() == 13);
 
-  std::vector<char> body = req.getBody();
+  std::vector<char> body = req.getBody().memory();
   std::string bodyStr(body.begin(), body.end());
   printResult("ContentLength_Stored: Body Content", bodyStr == "Hello, World!");
 }
@@ -100,7 +100,7 @@ void test_Body_Fragmented() {
   bool done3 = req.feed(chunk3, std::strlen(chunk3));
   printResult("Body_Fragmented: Chunk 3 Complete", done3 == true);
 
-  std::vector<char> body = req.getBody();
+  std::vector<char> body = req.getBody().memory();
   std::string bodyStr(body.begin(), body.end());
   printResult("Body_Fragmented: Body Content",
               bodyStr == "1234567890abcdefghij");
@@ -124,7 +124,7 @@ void test_Body_ExcessData() {
 
   printResult("Body_ExcessData: Parse Complete", completed == true);
 
-  std::vector<char> body = req.getBody();
+  std::vector<char> body = req.getBody().memory();
   std::string bodyStr(body.begin(), body.end());
   printResult("Body_ExcessData: Body is exactly 5 bytes", bodyStr == "Hello");
 }
@@ -211,7 +211,7 @@ void test_Body_BinaryData() {
 
   printResult("Body_BinaryData: Parse Complete", completed == true);
 
-  std::vector<char> body = req.getBody();
+  std::vector<char> body = req.getBody().memory();
   printResult("Body_BinaryData: Body Size", body.size() == 10);
 
   // NULL文字も含めて正しく保持されているか
@@ -353,7 +353,7 @@ void test_BodyExactLimit() {
   printResult("BodyExactLimit: Parse Complete", completed == true);
   printResult("BodyExactLimit: No Error", req.hasError() == false);
 
-  std::vector<char> body = req.getBody();
+  std::vector<char> body = req.getBody().memory();
   std::string bodyStr(body.begin(), body.end());
   printResult("BodyExactLimit: Body Content", bodyStr == "1234567890");
 }
@@ -443,7 +443,7 @@ void test_Chunked_Basic() {
   printResult("Chunked_Basic: Parse Complete", completed == true);
   printResult("Chunked_Basic: No Error", req.hasError() == false);
 
-  std::vector<char> body = req.getBody();
+  std::vector<char> body = req.getBody().memory();
   std::string bodyStr(body.begin(), body.end());
   printResult("Chunked_Basic: Body Content", bodyStr == "Hello");
 }
@@ -474,7 +474,7 @@ void test_Chunked_MultipleChunks() {
   printResult("Chunked_Multiple: Parse Complete", completed == true);
   printResult("Chunked_Multiple: No Error", req.hasError() == false);
 
-  std::vector<char> body = req.getBody();
+  std::vector<char> body = req.getBody().memory();
   std::string bodyStr(body.begin(), body.end());
   printResult("Chunked_Multiple: Body Content", bodyStr == "Hello World!");
 }
@@ -511,7 +511,7 @@ void test_Chunked_Fragmented() {
   bool done3 = req.feed(chunk3, std::strlen(chunk3));
   printResult("Chunked_Fragmented: Chunk 3 Complete", done3 == true);
 
-  std::vector<char> body = req.getBody();
+  std::vector<char> body = req.getBody().memory();
   std::string bodyStr(body.begin(), body.end());
   printResult("Chunked_Fragmented: Body Content", bodyStr == "Hello");
 }
@@ -538,7 +538,7 @@ void test_Chunked_WithExtension() {
   printResult("Chunked_Extension: Parse Complete", completed == true);
   printResult("Chunked_Extension: No Error", req.hasError() == false);
 
-  std::vector<char> body = req.getBody();
+  std::vector<char> body = req.getBody().memory();
   std::string bodyStr(body.begin(), body.end());
   printResult("Chunked_Extension: Body Content", bodyStr == "Hello");
 }
@@ -567,7 +567,7 @@ void test_Chunked_WithTrailer() {
   printResult("Chunked_Trailer: Parse Complete", completed == true);
   printResult("Chunked_Trailer: No Error", req.hasError() == false);
 
-  std::vector<char> body = req.getBody();
+  std::vector<char> body = req.getBody().memory();
   std::string bodyStr(body.begin(), body.end());
   printResult("Chunked_Trailer: Body Content", bodyStr == "Hello");
 }
@@ -702,7 +702,7 @@ void test_Chunked_UppercaseHex() {
   printResult("Chunked_UpperHex: Parse Complete", completed == true);
   printResult("Chunked_UpperHex: No Error", req.hasError() == false);
 
-  std::vector<char> body = req.getBody();
+  std::vector<char> body = req.getBody().memory();
   std::string bodyStr(body.begin(), body.end());
   printResult("Chunked_UpperHex: Body Content", bodyStr == "0123456789");
 }
@@ -729,7 +729,7 @@ void test_Chunked_CaseInsensitive() {
   printResult("Chunked_CaseInsensitive: Parse Complete", completed == true);
   printResult("Chunked_CaseInsensitive: No Error", req.hasError() == false);
 
-  std::vector<char> body = req.getBody();
+  std::vector<char> body = req.getBody().memory();
   std::string bodyStr(body.begin(), body.end());
   printResult("Chunked_CaseInsensitive: Body Content", bodyStr == "Hello");
 }
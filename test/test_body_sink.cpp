@@ -0,0 +1,222 @@
+#include <dirent.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include "../inc/BodySink.hpp"
+#include "../inc/Client.hpp"
+#include "../inc/Config.hpp"
+#include "../inc/Http.hpp"
+#include "../inc/RequestHandler.hpp"
+
+// 色付け用
+#define GREEN "\033[32m"
+#define RED "\033[31m"
+#define RESET "\033[0m"
+
+void printResult(const std::string& testName, bool success) {
+  if (success) {
+    std::cout << GREEN << "[PASS] " << testName << RESET << std::endl;
+  } else {
+    std::cout << RED << "[FAIL] " << testName << RESET << std::endl;
+    std::exit(1);
+  }
+}
+
+static const char* const TEMP_DIR = "test_sink_tmp";
+static const char* const UPLOAD_DIR = "test_sink_www";
+
+static std::string readFile(const std::string& path) {
+  std::ifstream ifs(path.c_str(), std::ios::binary);
+  std::ostringstream ss;
+  ss << ifs.rdbuf();
+  return ss.str();
+}
+
+// 一時ディレクトリに残っているファイルの数
+static int countTempFiles() {
+  int count = 0;
+  DIR* dir = opendir(TEMP_DIR);
+  if (!dir)
+    return -1;
+  while (struct dirent* entry = readdir(dir)) {
+    if (entry->d_name[0] != '.')
+      ++count;
+  }
+  closedir(dir);
+  return count;
+}
+
+static std::string drainPipe(int fd) {
+  std::string out;
+  char buf[4096];
+  ssize_t n;
+  while ((n = read(fd, buf, sizeof(buf))) > 0)
+    out.append(buf, static_cast<size_t>(n));
+  return out;
+}
+
+static std::string makeBody(size_t size) {
+  std::string body;
+  for (size_t i = 0; i < size; ++i)
+    body += static_cast<char>('a' + i % 26);
+  return body;
+}
+
+int main() {
+  std::cout << "=== Starting Body Sink Test ===" << std::endl;
+
+  mkdir(TEMP_DIR, 0755);
+  mkdir(UPLOAD_DIR, 0755);
+  BodySink::configure(16, TEMP_DIR);
+
+  // ---------------------------------------------------------
+  // TEST 1: メモリと一時ファイルの切り替え
+  // ---------------------------------------------------------
+  {
+    BodySink sink;
+    sink.append("0123456789", 10);
+    printResult("small body stays in memory",
+                !sink.isSpilled() && sink.memory().size() == 10);
+    sink.append("abcdefghij", 10);
+    printResult("spills past the limit",
+                sink.isSpilled() && sink.memory().empty() &&
+                    sink.size() == 20 && countTempFiles() == 1);
+
+    int fds[2];
+    if (pipe(fds) != 0)
+      return 1;
+    ssize_t n = sink.writeTo(fds[1], 5, 100);
+    close(fds[1]);
+    std::string piped = drainPipe(fds[0]);
+    close(fds[0]);
+    printResult("writeTo from offset", n == 15 && piped == "56789abcdefghij");
+
+    sink.clear();
+    printResult("clear removes temp file",
+                sink.empty() && countTempFiles() == 0);
+  }
+
+  // ---------------------------------------------------------
+  // TEST 2: 保存 (rename / メモリからの書き出し)
+  // ---------------------------------------------------------
+  {
+    std::string target = std::string(UPLOAD_DIR) + "/big.bin";
+    std::string body = makeBody(100);
+    {
+      BodySink sink;
+      sink.append(body.data(), body.size());
+      printResult("saveTo renames spilled body",
+                  sink.saveTo(target) == 0 && BodySink::stats().renames == 1);
+      printResult("saved content", readFile(target) == body);
+    }
+    printResult("renamed file survives sink",
+                readFile(target) == body && countTempFiles() == 0);
+
+    BodySink small;
+    small.append("tiny", 4);
+    std::string smallTarget = std::string(UPLOAD_DIR) + "/small.txt";
+    printResult("saveTo writes memory body",
+                small.saveTo(smallTarget) == 0 &&
+                    readFile(smallTarget) == "tiny");
+    printResult("missing directory gives 404",
+                small.saveTo(std::string(UPLOAD_DIR) + "/none/x") == 404);
+    unlink(target.c_str());
+    unlink(smallTarget.c_str());
+  }
+
+  // ---------------------------------------------------------
+  // TEST 3: HttpRequest のデコード結果が退避される
+  // ---------------------------------------------------------
+  {
+    std::string body = makeBody(1000);
+    std::ostringstream raw;
+    raw << "POST /up HTTP/1.1\r\nHost: localhost\r\n"
+        << "Content-Length: " << body.size() << "\r\n\r\n"
+        << body;
+    std::string wire = raw.str();
+    HttpRequest req;
+    for (size_t i = 0; i < wire.size(); i += 100)
+      req.feed(wire.data() + i, std::min<size_t>(100, wire.size() - i));
+    printResult("content-length body spilled",
+                req.isComplete() && req.getBody().isSpilled() &&
+                    req.getBody().size() == body.size());
+
+    HttpRequest chunked;
+    std::string wire2 =
+        "POST /up HTTP/1.1\r\nHost: localhost\r\n"
+        "Transfer-Encoding: chunked\r\n\r\n"
+        "a\r\n0123456789\r\na\r\nabcdefghij\r\n0\r\n\r\n";
+    chunked.feed(wire2.data(), wire2.size());
+    std::string saved = std::string(UPLOAD_DIR) + "/chunked.txt";
+    printResult("chunked body spilled",
+                chunked.isComplete() && chunked.getBody().isSpilled() &&
+                    chunked.getBody().saveTo(saved) == 0 &&
+                    readFile(saved) == "0123456789abcdefghij");
+    unlink(saved.c_str());
+  }
+
+  // ---------------------------------------------------------
+  // TEST 4: POST のアップロードが一時ファイルから保存される
+  // ---------------------------------------------------------
+  {
+    MainConfig config;
+    ServerConfig server;
+    server.listen_port = 8080;
+    server.server_names.push_back("localhost");
+    LocationConfig loc;
+    loc.path = "/";
+    loc.root = std::string("./") + UPLOAD_DIR;
+    loc.allow_methods.push_back(POST);
+    server.locations.push_back(loc);
+    config.servers.push_back(server);
+    RequestHandler handler(config);
+
+    std::string body = makeBody(5000);
+    std::ostringstream raw;
+    raw << "POST /upload.bin HTTP/1.1\r\nHost: localhost:8080\r\n"
+        << "Content-Length: " << body.size() << "\r\n\r\n"
+        << body;
+    std::string wire = raw.str();
+    Client client(999, 8080, "127.0.0.1", NULL);
+    client.req.feed(wire.data(), wire.size());
+    handler.handle(&client);
+    std::string target = std::string(UPLOAD_DIR) + "/upload.bin";
+    printResult("POST stores spilled body",
+                readFile(target) == body && countTempFiles() == 0);
+    unlink(target.c_str());
+  }
+
+  // ---------------------------------------------------------
+  // TEST 5: 書き終えた分を捨てる (CGI へのストリーミング)
+  // ---------------------------------------------------------
+  {
+    BodySink sink;
+    sink.append("0123456789", 10);
+    sink.discard(4);
+    printResult("discard drops the head",
+                sink.size() == 10 && sink.memory().size() == 6);
+
+    int fds[2];
+    if (pipe(fds) != 0)
+      return 1;
+    ssize_t before = sink.writeTo(fds[1], 2, 100);
+    sink.append("ab", 2);
+    ssize_t n = sink.writeTo(fds[1], 4, 100);
+    close(fds[1]);
+    std::string piped = drainPipe(fds[0]);
+    close(fds[0]);
+    printResult("offsets stay absolute",
+                before == -1 && n == 8 && piped == "456789ab");
+  }
+
+  rmdir(UPLOAD_DIR);
+  rmdir(TEMP_DIR);
+
+  std::cout << "=== All Body Sink tests passed ===" << std::endl;
+  return 0;
+}
@@ -0,0 +1,194 @@
+#include <poll.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include "../inc/CgiLimiter.hpp"
+#include "../inc/Client.hpp"
+#include "../inc/Config.hpp"
+#include "../inc/Http.hpp"
+#include "../inc/RequestHandler.hpp"
+#include "TestUtil.hpp"
+
+// 色付け用
+#define GREEN "\033[32m"
+#define RED "\033[31m"
+#define RESET "\033[0m"
+
+void printResult(const std::string& testName, bool success) {
+  if (success) {
+    std::cout << GREEN << "[PASS] " << testName << RESET << std::endl;
+  } else {
+    std::cout << RED << "[FAIL] " << testName << RESET << std::endl;
+    std::exit(1);
+  }
+}
+
+static const char* const WWW_DIR = "test_cgi_limit_www";
+
+static void startRequest(Client& client, RequestHandler& handler) {
+  std::string raw = "GET /slow.sh HTTP/1.1\r\nHost: localhost:8080\r\n\r\n";
+  client.req.feed(raw.data(), raw.size());
+  client.setState(PROCESSING);
+  handler.handle(&client);
+}
+
+// stdout を EOF まで読み、main と同じく finishCgi() する
+static std::string finishRequest(Client& client) {
+  int fd = client.getCgiStdoutFd();
+  struct pollfd pfd;
+  pfd.fd = fd;
+  pfd.events = POLLIN;
+  char buf[4096];
+  while (poll(&pfd, 1, 5000) > 0) {
+    ssize_t n = read(fd, buf, sizeof(buf));
+    if (n <= 0)
+      break;
+    client.appendCgiOutput(buf, static_cast<size_t>(n));
+  }
+  client.finishCgi();
+  return drain(client.res);
+}
+
+int main() {
+  std::cout << "=== Starting CGI Limit Test ===" << std::endl;
+
+  // ---------------------------------------------------------
+  // TEST 1: 枠と待ち行列
+  // ---------------------------------------------------------
+  {
+    CgiLimitConfig config;
+    config.max_concurrency = 2;
+    config.queue_size = 2;
+    CgiLimiter limiter(config);
+    Client* a = reinterpret_cast<Client*>(0x1);
+    Client* b = reinterpret_cast<Client*>(0x2);
+    Client* c = reinterpret_cast<Client*>(0x3);
+
+    printResult("slots up to max_concurrency",
+                limiter.acquire() && limiter.acquire() &&
+                    !limiter.acquire() && limiter.running() == 2);
+    printResult("queue up to queue_size",
+                limiter.wait(a) && limiter.wait(b) && !limiter.wait(c) &&
+                    limiter.waiting() == 2 && limiter.stats().rejected == 1);
+    printResult("no slot, no resume", limiter.resume() == NULL);
+
+    limiter.release();
+    printResult("newcomer does not overtake the queue",
+                !limiter.acquire() && limiter.running() == 1);
+    printResult("first come first served",
+                limiter.resume() == a && limiter.running() == 2);
+    limiter.cancel(b);
+    limiter.release();
+    printResult("cancelled waiter is skipped",
+                limiter.resume() == NULL && limiter.acquire() &&
+                    limiter.stats().abandoned == 1);
+    const CgiLimitStats& stats = limiter.stats();
+    printResult("stats recorded", stats.started == 4 && stats.queued == 2 &&
+                                      stats.maxDepth == 2);
+  }
+
+  // ---------------------------------------------------------
+  // Client: 上限に達したら起動せずに待つ
+  // ---------------------------------------------------------
+  mkdir(WWW_DIR, 0755);
+  {
+    std::ofstream ofs((std::string(WWW_DIR) + "/slow.sh").c_str());
+    ofs << "sleep 0.1\n"
+           "printf 'Content-Type: text/plain\\r\\n\\r\\nok'\n";
+  }
+
+  MainConfig config;
+  ServerConfig server;
+  server.listen_port = 8080;
+  server.server_names.push_back("localhost");
+  LocationConfig loc;
+  loc.path = "/";
+  loc.root = absPath(WWW_DIR);
+  loc.allow_methods.push_back(GET);
+  loc.cgi_extension = ".sh";
+  loc.cgi_path = "/bin/sh";
+  loc.cgi_limit.max_concurrency = 1;
+  loc.cgi_limit.queue_size = 2;
+  server.locations.push_back(loc);
+  config.servers.push_back(server);
+
+  {
+    RequestHandler handler(config);
+    TimerWheel timers(TimerWheel::clock());
+    TimeoutConfig timeouts;
+
+    // ---------------------------------------------------------
+    // TEST 2: 2つ目以降は待ち行列、溢れたら 503
+    // ---------------------------------------------------------
+    Client first(999, 8080, "127.0.0.1", NULL);
+    startRequest(first, handler);
+    Client second(998, 8080, "127.0.0.1", NULL);
+    second.setTimers(&timers, &timeouts);
+    startRequest(second, handler);
+    Client third(997, 8080, "127.0.0.1", NULL);
+    third.setTimers(&timers, &timeouts);
+    startRequest(third, handler);
+    printResult("first runs", first.getCgiPid() > 0);
+    printResult("second waits without spawning",
+                second.getCgiPid() == -1 &&
+                    second.getState() == WAITING_CGI_INPUT &&
+                    second.getTimeoutPhase() == TIMEOUT_CGI_QUEUE);
+
+    Client fourth(996, 8080, "127.0.0.1", NULL);
+    startRequest(fourth, handler);
+    std::string rejected = drain(fourth.res);
+    printResult("full queue gets 503 with Retry-After",
+                rejected.compare(0, 12, "HTTP/1.1 503") == 0 &&
+                    rejected.find("Retry-After: ") != std::string::npos &&
+                    fourth.getCgiPid() == -1);
+
+    // ---------------------------------------------------------
+    // TEST 3: 終わった枠は先頭の Client に渡る
+    // ---------------------------------------------------------
+    std::string out = finishRequest(first);
+    printResult("first answered", out.find("ok") != std::string::npos);
+    printResult("second started on release",
+                second.getCgiPid() > 0 && third.getCgiPid() == -1 &&
+                    second.getTimeoutPhase() == TIMEOUT_CGI);
+
+    // ---------------------------------------------------------
+    // TEST 4: 待ち行列の期限切れは 503 (main の handleTimeouts と同じ)
+    // ---------------------------------------------------------
+    third.abortCgi(503);
+    std::string expired = drain(third.res);
+    printResult("queue timeout answers 503",
+                expired.compare(0, 12, "HTTP/1.1 503") == 0 &&
+                    expired.find("Retry-After: ") != std::string::npos);
+    out = finishRequest(second);
+    printResult("second answered", out.find("ok") != std::string::npos);
+
+    CgiLimitStats stats = handler.cgiLimitStats();
+    printResult("limit stats", stats.started == 2 && stats.queued == 2 &&
+                                   stats.rejected == 1 &&
+                                   stats.abandoned == 1 &&
+                                   stats.maxDepth == 2);
+
+    // ---------------------------------------------------------
+    // TEST 5: 待っている間に破棄された Client
+    // ---------------------------------------------------------
+    Client* running = new Client(995, 8080, "127.0.0.1", NULL);
+    startRequest(*running, handler);
+    Client* gone = new Client(994, 8080, "127.0.0.1", NULL);
+    startRequest(*gone, handler);
+    delete gone;
+    delete running;
+    Client last(993, 8080, "127.0.0.1", NULL);
+    startRequest(last, handler);
+    printResult("slot freed by destroyed clients", last.getCgiPid() > 0);
+    finishRequest(last);
+  }
+
+  unlink((std::string(WWW_DIR) + "/slow.sh").c_str());
+  rmdir(WWW_DIR);
+
+  std::cout << "=== All CGI Limit tests passed ===" << std::endl;
+  return 0;
+}
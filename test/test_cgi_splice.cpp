@@ -0,0 +1,335 @@
+#include <fcntl.h>
+#include <sys/socket.h>  // socketpair
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include <cerrno>
+#include <csignal>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include "../inc/BodySink.hpp"
+#include "../inc/Client.hpp"
+#include "../inc/Config.hpp"
+#include "../inc/ConnectionTable.hpp"
+#include "../inc/EpollContext.hpp"
+#include "../inc/EpollUtils.hpp"
+#include "../inc/Http.hpp"
+#include "../inc/RequestHandler.hpp"
+#include "../inc/TimerWheel.hpp"
+#include "TestUtil.hpp"
+
+// 色付け用
+#define GREEN "\033[32m"
+#define RED "\033[31m"
+#define RESET "\033[0m"
+
+void printResult(const std::string& testName, bool success) {
+  if (success) {
+    std::cout << GREEN << "[PASS] " << testName << RESET << std::endl;
+  } else {
+    std::cout << RED << "[FAIL] " << testName << RESET << std::endl;
+    std::exit(1);
+  }
+}
+
+static const char* const WWW_DIR = "test_splice_www";
+static const size_t DATA_SIZE = 300000;  // パイプ容量 (64KB) より十分大きい
+
+static void writeFile(const std::string& name, const std::string& body) {
+  std::string path = std::string(WWW_DIR) + "/" + name;
+  std::ofstream ofs(path.c_str());
+  ofs << body;
+}
+
+// 位置ごとに値の変わるバイト列 (ずれや欠けを検出できるように)
+static std::string makeData(size_t size) {
+  std::string data(size, '\0');
+  for (size_t i = 0; i < size; ++i)
+    data[i] = static_cast<char>((i * 7 + i / 251) & 0xff);
+  return data;
+}
+
+static void setNonBlocking(int fd) {
+  fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+}
+
+// main の handleClientWriteEvent と同じ手順で送る
+static void onWritable(Client* client) {
+  if (client->isSplicingCgiOutput()) {
+    client->spliceCgiOutput();
+    return;
+  }
+  struct iovec iov[16];
+  int count = client->res.getIovec(iov, 16);
+  if (count == 0)
+    return;
+  ssize_t sent = writev(client->getFd(), iov, count);
+  if (sent > 0) {
+    client->res.advance(static_cast<size_t>(sent));
+    if (!client->res.isDone())
+      client->afterSend();
+  }
+}
+
+// main の handleClientReadEvent と同じ手順で受信する
+static void onReadable(Client* client, RequestHandler& handler) {
+  if (client->isSplicingCgiInput()) {
+    client->spliceCgiInput();
+    return;
+  }
+  char buf[4096];
+  ssize_t n = recv(client->getFd(), buf, sizeof(buf), 0);
+  if (n <= 0)
+    return;
+  ConnState state = client->getState();
+  if (state != WAIT_REQUEST && state != READING_REQUEST) {
+    client->readAhead(buf, static_cast<size_t>(n));
+    return;
+  }
+  bool complete = client->req.feed(buf, static_cast<size_t>(n));
+  if (complete || client->req.isReadingBody()) {
+    client->setState(PROCESSING);
+    handler.handle(client);
+  }
+}
+
+static void onCgiStdout(Client* client) {
+  if (client->isSplicingCgiOutput()) {
+    client->spliceCgiOutput();
+    return;
+  }
+  char buf[4096];
+  ssize_t n = read(client->getCgiStdoutFd(), buf, sizeof(buf));
+  if (n > 0) {
+    client->appendCgiOutput(buf, static_cast<size_t>(n));
+  } else if (n == 0 || errno != EAGAIN) {
+    client->finishCgi();
+  }
+}
+
+static void onCgiStdin(Client* client) {
+  if (client->isSplicingCgiInput())
+    client->spliceCgiInput();
+  else
+    client->writeCgiInput();
+}
+
+// epoll のイベントを1周分 Client に渡す
+static void dispatch(EpollUtils& epoll, RequestHandler& handler,
+                     Client* client) {
+  struct epoll_event events[8];
+  int nfds = epoll.wait(events, 8, 20);
+  for (int i = 0; i < nfds; ++i) {
+    EpollContext* ctx = static_cast<EpollContext*>(events[i].data.ptr);
+    if (!ctx->client)
+      continue;  // この周回で後処理済み
+    if (ctx->type == EpollContext::CLIENT) {
+      if (events[i].events & EPOLLOUT)
+        onWritable(client);
+      if (events[i].events & EPOLLIN)
+        onReadable(client, handler);
+    } else if (ctx->type == EpollContext::CGI_STDOUT) {
+      onCgiStdout(client);
+    } else if (ctx->type == EpollContext::CGI_STDIN) {
+      onCgiStdin(client);
+    }
+  }
+  EpollContext::releaseRetired();
+}
+
+// イベントループの代わり: peer から request を送り、応答を受け取る
+static std::string exchange(EpollUtils& epoll, RequestHandler& handler,
+                            Client* client, int peer,
+                            const std::string& request) {
+  std::string response;
+  size_t written = 0;
+  TimerWheel::Msec deadline = TimerWheel::clock() + 10000;
+  bool done = false;
+  while (TimerWheel::clock() < deadline) {
+    if (written < request.size()) {
+      ssize_t n = write(peer, request.data() + written,
+                        request.size() - written);
+      if (n > 0)
+        written += static_cast<size_t>(n);
+    }
+    char buf[65536];
+    ssize_t n;
+    while ((n = read(peer, buf, sizeof(buf))) > 0)
+      response.append(buf, static_cast<size_t>(n));
+    if (done)
+      break;
+    dispatch(epoll, handler, client);
+    done = client->getState() == WRITING_RESPONSE && client->res.isDone();
+  }
+  return response;
+}
+
+int main() {
+  std::cout << "=== Starting CGI Splice Test ===" << std::endl;
+  signal(SIGPIPE, SIG_IGN);
+
+  // ---------------------------------------------------------
+  // TEST 1: splice で渡した分をボディとして数える
+  // ---------------------------------------------------------
+  {
+    BodySink sink;
+    sink.append("ab", 2);
+    printResult("skip refused while bytes are held", !sink.skip(3));
+    sink.discard(2);
+    printResult("skip after discard",
+                sink.skip(3) && sink.size() == 5 && sink.memory().empty());
+
+    HttpRequest req;
+    std::string raw =
+        "POST /up HTTP/1.1\r\nHost: localhost\r\nContent-Length: 10\r\n\r\n"
+        "abc";
+    req.feed(raw.data(), raw.size());
+    req.getBody().discard(3);
+    printResult("spliceable rest of Content-Length",
+                req.getSpliceableBody() == 7);
+    printResult("skipBody past the length refused", !req.skipBody(8));
+    printResult("skipBody completes the request",
+                req.skipBody(7) && req.isComplete() &&
+                    req.getBody().size() == 10 &&
+                    req.getSpliceableBody() == 0);
+
+    HttpRequest chunked;
+    raw = "POST /up HTTP/1.1\r\nHost: localhost\r\n"
+          "Transfer-Encoding: chunked\r\n\r\n";
+    chunked.feed(raw.data(), raw.size());
+    printResult("chunked body is not spliceable",
+                chunked.isReadingBody() && chunked.getSpliceableBody() == 0);
+  }
+
+  mkdir(WWW_DIR, 0755);
+  std::string data = makeData(DATA_SIZE);
+  writeFile("data.bin", data);
+  std::string dataPath = absPath(std::string(WWW_DIR) + "/data.bin");
+  std::ostringstream length;
+  length << DATA_SIZE;
+  writeFile("download.sh", "printf 'Content-Type: application/octet-stream"
+                           "\\r\\nContent-Length: " +
+                               length.str() + "\\r\\n\\r\\n'\ncat '" +
+                               dataPath + "'\n");
+  writeFile("chunked.sh",
+            "printf 'Content-Type: application/octet-stream\\r\\n\\r\\n'\n"
+            "cat '" + dataPath + "'\n");
+  writeFile("echo.sh",
+            "printf \"Content-Type: application/octet-stream\\r\\n"
+            "Content-Length: $CONTENT_LENGTH\\r\\n\\r\\n\"\ncat\n");
+
+  MainConfig config;
+  ServerConfig server;
+  server.listen_port = 8080;
+  server.server_names.push_back("localhost");
+  LocationConfig loc;
+  loc.path = "/";
+  loc.root = absPath(WWW_DIR);
+  loc.allow_methods.push_back(GET);
+  loc.allow_methods.push_back(POST);
+  loc.cgi_extension = ".sh";
+  loc.cgi_path = "/bin/sh";
+  server.locations.push_back(loc);
+  config.servers.push_back(server);
+  RequestHandler handler(config);
+
+  EpollUtils epoll;
+  ConnectionTable table(&epoll);
+
+  // ---------------------------------------------------------
+  // TEST 2: Content-Length のボディはパイプからソケットへ splice
+  // ---------------------------------------------------------
+  {
+    int sv[2];
+    socketpair(AF_UNIX, SOCK_STREAM, 0, sv);
+    setNonBlocking(sv[0]);
+    setNonBlocking(sv[1]);
+    Client* client = table.add(sv[0], 8080, "127.0.0.1");
+    unsigned long before = Client::spliceStats().fromCgi;
+    std::string res = exchange(
+        epoll, handler, client, sv[1],
+        "GET /download.sh HTTP/1.1\r\nHost: localhost:8080\r\n\r\n");
+    printResult("download answered",
+                res.compare(0, 12, "HTTP/1.1 200") == 0 &&
+                    res.find("Content-Length: " + length.str()) !=
+                        std::string::npos);
+    printResult("spliced body is byte-exact", bodyOf(res) == data);
+    printResult("body went through splice",
+                Client::spliceStats().fromCgi - before > DATA_SIZE / 2);
+
+    // ---------------------------------------------------------
+    // TEST 3: chunked の枠を付ける応答はバッファ経由のまま
+    // ---------------------------------------------------------
+    client->nextRequest();
+    before = Client::spliceStats().fromCgi;
+    res = exchange(epoll, handler, client, sv[1],
+                   "GET /chunked.sh HTTP/1.1\r\nHost: localhost:8080\r\n\r\n");
+    printResult("chunked response not spliced",
+                res.find("Transfer-Encoding: chunked") != std::string::npos &&
+                    res.find("0\r\n\r\n") != std::string::npos &&
+                    Client::spliceStats().fromCgi == before);
+    table.remove(sv[0]);
+    close(sv[1]);
+  }
+
+  // ---------------------------------------------------------
+  // TEST 4: アップロードはソケットから stdin パイプへ splice
+  // ---------------------------------------------------------
+  {
+    int sv[2];
+    socketpair(AF_UNIX, SOCK_STREAM, 0, sv);
+    setNonBlocking(sv[0]);
+    setNonBlocking(sv[1]);
+    Client* client = table.add(sv[0], 8080, "127.0.0.1");
+    unsigned long toCgi = Client::spliceStats().toCgi;
+    unsigned long fromCgi = Client::spliceStats().fromCgi;
+    std::string res = exchange(
+        epoll, handler, client, sv[1],
+        "POST /echo.sh HTTP/1.1\r\nHost: localhost:8080\r\n"
+        "Content-Length: " + length.str() + "\r\n\r\n" + data);
+    printResult("upload echoed byte-exact",
+                res.compare(0, 12, "HTTP/1.1 200") == 0 &&
+                    bodyOf(res) == data);
+    printResult("upload went through splice",
+                Client::spliceStats().toCgi - toCgi > DATA_SIZE / 2 &&
+                    Client::spliceStats().fromCgi - fromCgi > DATA_SIZE / 2);
+    table.remove(sv[0]);
+    close(sv[1]);
+  }
+
+  // ---------------------------------------------------------
+  // TEST 5: splice 中の切断は応答を打ち切るだけ (接続はソケットのイベントで閉じる)
+  // ---------------------------------------------------------
+  {
+    int sv[2];
+    socketpair(AF_UNIX, SOCK_STREAM, 0, sv);
+    setNonBlocking(sv[0]);
+    Client* client = table.add(sv[0], 8080, "127.0.0.1");
+    std::string raw =
+        "GET /download.sh HTTP/1.1\r\nHost: localhost:8080\r\n\r\n";
+    write(sv[1], raw.data(), raw.size());
+    TimerWheel::Msec deadline = TimerWheel::clock() + 10000;
+    while (!client->isSplicingCgiOutput() && TimerWheel::clock() < deadline)
+      dispatch(epoll, handler, client);
+    close(sv[1]);
+    while (!client->res.isError() && TimerWheel::clock() < deadline)
+      dispatch(epoll, handler, client);
+    printResult("disconnect aborts the spliced response",
+                client->res.isError() && client->getCgiPid() == -1 &&
+                    client->getCgiStdoutFd() == -1 &&
+                    table.get(sv[0]) == client);
+    table.remove(sv[0]);
+  }
+
+  unlink((std::string(WWW_DIR) + "/data.bin").c_str());
+  unlink((std::string(WWW_DIR) + "/download.sh").c_str());
+  unlink((std::string(WWW_DIR) + "/chunked.sh").c_str());
+  unlink((std::string(WWW_DIR) + "/echo.sh").c_str());
+  rmdir(WWW_DIR);
+
+  std::cout << "=== All CGI Splice tests passed ===" << std::endl;
+  return 0;
+}
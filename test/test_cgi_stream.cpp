@@ -0,0 +1,254 @@
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include "../inc/Client.hpp"
+#include "../inc/Config.hpp"
+#include "../inc/Http.hpp"
+#include "../inc/RequestHandler.hpp"
+#include "TestUtil.hpp"
+
+// 色付け用
+#define GREEN "\033[32m"
+#define RED "\033[31m"
+#define RESET "\033[0m"
+
+void printResult(const std::string& testName, bool success) {
+  if (success) {
+    std::cout << GREEN << "[PASS] " << testName << RESET << std::endl;
+  } else {
+    std::cout << RED << "[FAIL] " << testName << RESET << std::endl;
+    std::exit(1);
+  }
+}
+
+static const char* const WWW_DIR = "test_stream_www";
+
+static void writeScript(const std::string& name, const std::string& body) {
+  std::string path = std::string(WWW_DIR) + "/" + name;
+  std::ofstream ofs(path.c_str());
+  ofs << body;
+}
+
+// stdout を EOF まで読んで応答を組み立てる (CGI_STDOUT の EPOLLIN 相当)
+static std::string collectResponse(Client& client) {
+  int fd = client.getCgiStdoutFd();
+  int flags = fcntl(fd, F_GETFL, 0);
+  fcntl(fd, F_SETFL, flags & ~O_NONBLOCK);
+  char buf[4096];
+  ssize_t n;
+  while ((n = read(fd, buf, sizeof(buf))) > 0)
+    client.appendCgiOutput(buf, static_cast<size_t>(n));
+  client.finishCgi();
+  return drain(client.res);
+}
+
+// main の handleClientReadEvent と同じ手順でヘッダーを受信する
+static bool receiveHeaders(Client& client, RequestHandler& handler,
+                           const std::string& raw) {
+  client.req.feed(raw.data(), raw.size());
+  if (!client.req.isReadingBody() || !handler.streamsBody(&client))
+    return false;
+  client.setState(PROCESSING);
+  handler.handle(&client);
+  return true;
+}
+
+int main() {
+  std::cout << "=== Starting CGI Body Streaming Test ===" << std::endl;
+
+  mkdir(WWW_DIR, 0755);
+  // stdin を全て読んでから出力する (ボディが揃う前に起動している前提)
+  writeScript("count.sh",
+              "printf 'Content-Type: text/plain\\r\\n\\r\\n'\n"
+              "wc -c | tr -d ' '\n");
+  writeScript("echo.sh",
+              "printf 'Content-Type: text/plain\\r\\n\\r\\n'\n"
+              "cat\n");
+  // 出力はテストから appendCgiOutput() で渡す
+  writeScript("silent.sh", "exit 0\n");
+  writeScript("static.txt", "plain");
+
+  MainConfig config;
+  ServerConfig server;
+  server.listen_port = 8080;
+  server.server_names.push_back("localhost");
+  LocationConfig loc;
+  loc.path = "/";
+  loc.root = absPath(WWW_DIR);
+  loc.allow_methods.push_back(GET);
+  loc.allow_methods.push_back(POST);
+  loc.cgi_extension = ".sh";
+  loc.cgi_path = "/bin/sh";
+  server.locations.push_back(loc);
+  config.servers.push_back(server);
+  RequestHandler handler(config);
+
+  // ---------------------------------------------------------
+  // TEST 1: ストリーミングするリクエストの判定
+  // ---------------------------------------------------------
+  {
+    Client client(999, 8080, "127.0.0.1", NULL);
+    std::string raw =
+        "POST /static.txt HTTP/1.1\r\nHost: localhost:8080\r\n"
+        "Content-Length: 5\r\n\r\n";
+    client.req.feed(raw.data(), raw.size());
+    printResult("non-CGI POST waits for body", !handler.streamsBody(&client));
+
+    Client missing(999, 8080, "127.0.0.1", NULL);
+    raw =
+        "POST /none.sh HTTP/1.1\r\nHost: localhost:8080\r\n"
+        "Content-Length: 5\r\n\r\n";
+    missing.req.feed(raw.data(), raw.size());
+    printResult("missing script waits for body",
+                !handler.streamsBody(&missing));
+  }
+
+  // ---------------------------------------------------------
+  // TEST 2: チャンクを受信しながら stdin へ流す
+  // ---------------------------------------------------------
+  {
+    Client client(999, 8080, "127.0.0.1", NULL);
+    std::string raw =
+        "POST /echo.sh HTTP/1.1\r\nHost: localhost:8080\r\n"
+        "Transfer-Encoding: chunked\r\n\r\n"
+        "5\r\nhello\r\n";
+    printResult("CGI starts on headers", receiveHeaders(client, handler, raw));
+    printResult("waiting for CGI input",
+                client.getState() == WAITING_CGI_INPUT &&
+                    client.getCgiPid() > 0 && !client.req.isComplete());
+
+    client.writeCgiInput();
+    printResult("written part is released",
+                client.getCgiStdinOffset() == 5 &&
+                    client.req.getBody().memory().empty() &&
+                    client.getCgiStdinFd() != -1);
+
+    std::string rest = "6\r\n world\r\n1\r\n!\r\n0\r\n\r\n";
+    client.readAhead(rest.data(), rest.size());
+    client.writeCgiInput();
+    printResult("stdin closed after last chunk",
+                client.req.isComplete() && client.getCgiStdinFd() == -1 &&
+                    client.getState() == READING_CGI_OUTPUT);
+    printResult("script read the whole body",
+                dechunk(bodyOf(collectResponse(client))) == "hello world!");
+  }
+
+  // ---------------------------------------------------------
+  // TEST 3: Content-Length のボディを少しずつ受信する
+  // ---------------------------------------------------------
+  {
+    std::string body;
+    for (size_t i = 0; i < 3 * CGI_STDIN_BUFFER_SIZE; ++i)
+      body += static_cast<char>('a' + i % 26);
+    Client client(999, 8080, "127.0.0.1", NULL);
+    std::string raw =
+        "POST /count.sh HTTP/1.1\r\nHost: localhost:8080\r\n"
+        "Content-Length: 49152\r\n\r\n";
+    printResult("count.sh streams", receiveHeaders(client, handler, raw));
+    for (size_t i = 0; i < body.size(); i += 4096) {
+      client.readAhead(body.data() + i, 4096);
+      client.writeCgiInput();
+    }
+    printResult("body never held whole",
+                !client.req.getBody().isSpilled() &&
+                    client.getCgiStdinFd() == -1);
+    printResult("script counted every byte",
+                dechunk(bodyOf(collectResponse(client))) == "49152\n");
+  }
+
+  // ---------------------------------------------------------
+  // TEST 4: 送信側が途中で閉じた
+  // ---------------------------------------------------------
+  {
+    Client client(999, 8080, "127.0.0.1", NULL);
+    std::string raw =
+        "POST /count.sh HTTP/1.1\r\nHost: localhost:8080\r\n"
+        "Content-Length: 100\r\n\r\npartial";
+    receiveHeaders(client, handler, raw);
+    client.closeInput();
+    printResult("truncated body aborts CGI",
+                client.getState() == WRITING_RESPONSE &&
+                    client.getCgiPid() == -1 && !client.isKeepAlive() &&
+                    drain(client.res).compare(0, 12, "HTTP/1.1 400") == 0);
+  }
+
+  // ---------------------------------------------------------
+  // TEST 5: CGI の出力を届いた分から送る
+  // ---------------------------------------------------------
+  {
+    HttpResponse res;
+    res.setStatusCode(200);
+    printResult("header accepted",
+                res.beginStream("Content-Type: text/plain\r\n"));
+    res.build();
+    std::string head = drain(res);
+    printResult("header sent before body",
+                head.find("Transfer-Encoding: chunked") != std::string::npos &&
+                    res.isStreamIdle() && !res.isDone());
+    res.appendStream("abc", 3);
+    std::string first = drain(res);
+    res.appendStream("de", 2);
+    res.endStream();
+    std::string rest = drain(res);
+    printResult("chunks relayed as they arrive",
+                first == "3\r\nabc\r\n" && res.isDone() &&
+                    dechunk(first + rest) == "abcde");
+
+    HttpResponse sized;
+    sized.setStatusCode(200);
+    sized.beginStream("Content-Length: 4\r\n");
+    sized.build();
+    sized.appendStream("wxyz", 4);
+    sized.endStream();
+    std::string out = drain(sized);
+    printResult("script length passed through",
+                out.find("Content-Length: 4\r\n") != std::string::npos &&
+                    out.find("chunked") == std::string::npos &&
+                    bodyOf(out) == "wxyz");
+
+    HttpResponse cut;
+    cut.setStatusCode(200);
+    cut.beginStream("Content-Length: 10\r\n");
+    cut.build();
+    cut.appendStream("short", 5);
+    cut.endStream();
+    printResult("short body is an error", cut.isError());
+  }
+
+  // ---------------------------------------------------------
+  // TEST 6: 終了を待たずに応答を始める
+  // ---------------------------------------------------------
+  {
+    Client client(999, 8080, "127.0.0.1", NULL);
+    std::string raw =
+        "GET /silent.sh HTTP/1.1\r\nHost: localhost:8080\r\n\r\n";
+    client.req.feed(raw.data(), raw.size());
+    client.setState(PROCESSING);
+    handler.handle(&client);
+    std::string header = "Content-Type: text/plain\n";
+    client.appendCgiOutput(header.data(), header.size());
+    printResult("waits for the blank line",
+                client.getState() == READING_CGI_OUTPUT);
+    std::string part = "\nfirst";
+    client.appendCgiOutput(part.data(), part.size());
+    printResult("response starts while CGI runs",
+                client.getState() == WRITING_RESPONSE &&
+                    client.getCgiPid() > 0 && client.res.isStreaming());
+    std::string out = collectResponse(client);
+    printResult("rest follows at EOF",
+                client.res.isDone() && dechunk(bodyOf(out)) == "first");
+  }
+
+  unlink((std::string(WWW_DIR) + "/count.sh").c_str());
+  unlink((std::string(WWW_DIR) + "/echo.sh").c_str());
+  unlink((std::string(WWW_DIR) + "/silent.sh").c_str());
+  unlink((std::string(WWW_DIR) + "/static.txt").c_str());
+  rmdir(WWW_DIR);
+
+  std::cout << "=== All CGI Body Streaming tests passed ===" << std::endl;
+  return 0;
+}
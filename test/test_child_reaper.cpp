@@ -0,0 +1,263 @@
+#include <poll.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "../inc/ChildReaper.hpp"
+#include "../inc/Client.hpp"
+#include "../inc/Config.hpp"
+#include "../inc/Http.hpp"
+#include "../inc/RequestHandler.hpp"
+#include "TestUtil.hpp"
+
+// 色付け用
+#define GREEN "\033[32m"
+#define RED "\033[31m"
+#define RESET "\033[0m"
+
+void printResult(const std::string& testName, bool success) {
+  if (success) {
+    std::cout << GREEN << "[PASS] " << testName << RESET << std::endl;
+  } else {
+    std::cout << RED << "[FAIL] " << testName << RESET << std::endl;
+    std::exit(1);
+  }
+}
+
+static const char* const WWW_DIR = "test_reaper_www";
+
+static void writeScript(const std::string& name, const std::string& body) {
+  std::string path = std::string(WWW_DIR) + "/" + name;
+  std::ofstream ofs(path.c_str());
+  ofs << body;
+}
+
+static pid_t spawnShell(const char* script) {
+  char sh[] = "/bin/sh";
+  char flag[] = "-c";
+  char* argv[] = {sh, flag, const_cast<char*>(script), NULL};
+  char* envp[] = {NULL};
+  pid_t pid = -1;
+  if (ChildReaper::spawn(&pid, "/bin/sh", NULL, argv, envp) != 0)
+    return -1;
+  return pid;
+}
+
+// イベントループの代わりに signalfd とタイマーを回す
+static std::vector<ChildReaper::Exit> runReaper(ChildReaper& reaper,
+                                                int maxMs) {
+  std::vector<ChildReaper::Exit> exits;
+  TimerWheel::Msec deadline = TimerWheel::clock() + maxMs;
+  while (exits.empty() && reaper.size() > 0 &&
+         TimerWheel::clock() < deadline) {
+    struct pollfd pfd;
+    pfd.fd = reaper.getFd();
+    pfd.events = POLLIN;
+    int timeout = reaper.nextTimeout();
+    poll(&pfd, 1, timeout < 0 || timeout > 50 ? 50 : timeout);
+    reaper.processEvents(exits);
+    reaper.expire(TimerWheel::clock(), exits);
+  }
+  return exits;
+}
+
+// stdout を EOF まで読み、main と同じく finishCgi() する
+static void readToEof(Client& client) {
+  int fd = client.getCgiStdoutFd();
+  struct pollfd pfd;
+  pfd.fd = fd;
+  pfd.events = POLLIN;
+  char buf[4096];
+  while (poll(&pfd, 1, 5000) > 0) {
+    ssize_t n = read(fd, buf, sizeof(buf));
+    if (n <= 0)
+      break;
+    client.appendCgiOutput(buf, static_cast<size_t>(n));
+  }
+  client.finishCgi();
+}
+
+int main() {
+  std::cout << "=== Starting Child Reaper Test ===" << std::endl;
+
+  // ---------------------------------------------------------
+  // TEST 1: 終了ステータスを非同期に受け取る
+  // ---------------------------------------------------------
+  {
+    ChildReaper reaper(1000, 200);
+    printResult("reaper is active", ChildReaper::active() == &reaper &&
+                                        reaper.getFd() >= 0);
+    Client owner(999, 8080, "127.0.0.1", NULL);
+    pid_t pid = spawnShell("sleep 0.1; exit 3");
+    reaper.watch(pid, &owner);
+    std::vector<ChildReaper::Exit> exits = runReaper(reaper, 3000);
+    printResult("exit status reported",
+                exits.size() == 1 && exits[0].client == &owner &&
+                    WIFEXITED(exits[0].status) &&
+                    WEXITSTATUS(exits[0].status) == 3);
+    printResult("child reaped", reaper.size() == 0 &&
+                                    waitpid(pid, NULL, WNOHANG) == -1);
+
+    // ---------------------------------------------------------
+    // TEST 2: SIGTERM で止める / 無視したら SIGKILL
+    // ---------------------------------------------------------
+    unsigned long killed = ChildReaper::stats().killed;
+    pid = spawnShell("sleep 10");
+    reaper.terminate(pid);
+    runReaper(reaper, 3000);
+    printResult("terminated without blocking",
+                reaper.size() == 0 && waitpid(pid, NULL, WNOHANG) == -1 &&
+                    ChildReaper::stats().killed == killed);
+
+    pid = spawnShell("trap '' TERM; sleep 10");
+    usleep(100000);  // trap を設定するまで待つ
+    reaper.terminate(pid);
+    runReaper(reaper, 3000);
+    printResult("SIGKILL after grace",
+                reaper.size() == 0 && waitpid(pid, NULL, WNOHANG) == -1 &&
+                    ChildReaper::stats().killed == killed + 1);
+
+    // ---------------------------------------------------------
+    // TEST 3: 終わらない子は待つのをやめて応答を完了させる
+    // ---------------------------------------------------------
+    ChildReaper quick(100, 200);
+    pid = spawnShell("exec >&-; sleep 10");
+    quick.watch(pid, &owner);
+    exits = runReaper(quick, 3000);
+    printResult("gave up waiting",
+                exits.size() == 1 && exits[0].status == -1 &&
+                    quick.size() == 1);
+    runReaper(quick, 3000);
+    printResult("then stopped", quick.size() == 0);
+
+    // SIGCHLD を読む前にタイマーが切れても、ステータスは本物を渡す
+    pid = spawnShell("exit 5");
+    quick.watch(pid, &owner);
+    usleep(300000);
+    exits.clear();
+    quick.expire(TimerWheel::clock(), exits);
+    printResult("exit status reported by the timer",
+                exits.size() == 1 && exits[0].status != -1 &&
+                    WIFEXITED(exits[0].status) &&
+                    WEXITSTATUS(exits[0].status) == 5 && quick.size() == 0);
+  }
+  printResult("inactive after destruction", ChildReaper::active() == NULL);
+
+  // ---------------------------------------------------------
+  // Client: 終了ステータスで応答を完了させる
+  // ---------------------------------------------------------
+  mkdir(WWW_DIR, 0755);
+  writeScript("ok.sh",
+              "printf 'Content-Type: text/plain\\r\\n\\r\\nbody'\n"
+              "exec >&-\n"
+              "sleep 0.2\n");
+  writeScript("crash.sh",
+              "printf 'Content-Type: text/plain\\r\\n\\r\\npartial'\n"
+              "exec >&-\n"
+              "sleep 0.2\n"
+              "kill -SEGV $$\n");
+  writeScript("fail.sh", "echo 'no header'\nexit 1\n");
+
+  MainConfig config;
+  ServerConfig server;
+  server.listen_port = 8080;
+  server.server_names.push_back("localhost");
+  LocationConfig loc;
+  loc.path = "/";
+  loc.root = absPath(WWW_DIR);
+  loc.allow_methods.push_back(GET);
+  loc.cgi_extension = ".sh";
+  loc.cgi_path = "/bin/sh";
+  server.locations.push_back(loc);
+  config.servers.push_back(server);
+  RequestHandler handler(config);
+
+  {
+    ChildReaper reaper(3000, 200);
+
+    // ---------------------------------------------------------
+    // TEST 4: 正常終了を待ってから応答を終える
+    // ---------------------------------------------------------
+    Client client(999, 8080, "127.0.0.1", NULL);
+    std::string raw = "GET /ok.sh HTTP/1.1\r\nHost: localhost:8080\r\n\r\n";
+    client.req.feed(raw.data(), raw.size());
+    client.setState(PROCESSING);
+    handler.handle(&client);
+    readToEof(client);
+    printResult("response waits for exit",
+                client.getCgiPid() > 0 && client.res.isStreaming() &&
+                    !client.res.isDone() && reaper.size() == 1);
+    std::vector<ChildReaper::Exit> exits = runReaper(reaper, 3000);
+    printResult("exit reported to client",
+                exits.size() == 1 && exits[0].client == &client &&
+                    exits[0].status == 0);
+    client.onCgiExit(exits[0].status);
+    std::string out = drain(client.res);
+    printResult("stream ended after clean exit",
+                client.res.isDone() && !client.res.isError() &&
+                    out.find("0\r\n\r\n") != std::string::npos &&
+                    client.isKeepAlive());
+
+    // ---------------------------------------------------------
+    // TEST 5: シグナルで落ちた CGI の応答は打ち切る
+    // ---------------------------------------------------------
+    Client crashed(998, 8080, "127.0.0.1", NULL);
+    raw = "GET /crash.sh HTTP/1.1\r\nHost: localhost:8080\r\n\r\n";
+    crashed.req.feed(raw.data(), raw.size());
+    crashed.setState(PROCESSING);
+    handler.handle(&crashed);
+    readToEof(crashed);
+    exits = runReaper(reaper, 3000);
+    printResult("crash reported",
+                exits.size() == 1 && WIFSIGNALED(exits[0].status));
+    crashed.onCgiExit(exits[0].status);
+    out = drain(crashed.res);
+    printResult("crashed stream aborted",
+                out.find("0\r\n\r\n") == std::string::npos &&
+                    !crashed.isKeepAlive());
+
+    // ---------------------------------------------------------
+    // TEST 6: ヘッダーなしで失敗した CGI は 502
+    // ---------------------------------------------------------
+    Client failed(997, 8080, "127.0.0.1", NULL);
+    raw = "GET /fail.sh HTTP/1.1\r\nHost: localhost:8080\r\n\r\n";
+    failed.req.feed(raw.data(), raw.size());
+    failed.setState(PROCESSING);
+    handler.handle(&failed);
+    readToEof(failed);
+    if (failed.getState() != WRITING_RESPONSE) {
+      exits = runReaper(reaper, 3000);
+      if (exits.size() == 1)
+        failed.onCgiExit(exits[0].status);
+    }
+    out = drain(failed.res);
+    printResult("failed exit is 502",
+                out.compare(0, 12, "HTTP/1.1 502") == 0);
+
+    // ---------------------------------------------------------
+    // TEST 7: 待っている間に破棄された Client
+    // ---------------------------------------------------------
+    Client* gone = new Client(996, 8080, "127.0.0.1", NULL);
+    raw = "GET /ok.sh HTTP/1.1\r\nHost: localhost:8080\r\n\r\n";
+    gone->req.feed(raw.data(), raw.size());
+    gone->setState(PROCESSING);
+    handler.handle(gone);
+    readToEof(*gone);
+    delete gone;
+    exits = runReaper(reaper, 3000);
+    printResult("no report for destroyed client",
+                exits.empty() && reaper.size() == 0);
+  }
+
+  unlink((std::string(WWW_DIR) + "/ok.sh").c_str());
+  unlink((std::string(WWW_DIR) + "/crash.sh").c_str());
+  unlink((std::string(WWW_DIR) + "/fail.sh").c_str());
+  rmdir(WWW_DIR);
+
+  std::cout << "=== All Child Reaper tests passed ===" << std::endl;
+  return 0;
+}
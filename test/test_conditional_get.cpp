@@ -0,0 +1,166 @@
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include "../inc/Client.hpp"
+#include "../inc/Config.hpp"
+#include "../inc/Http.hpp"
+#include "../inc/RequestHandler.hpp"
+#include "TestUtil.hpp"
+
+// 色付け用
+#define GREEN "\033[32m"
+#define RED "\033[31m"
+#define RESET "\033[0m"
+
+void printResult(const std::string& testName, bool success) {
+  if (success) {
+    std::cout << GREEN << "[PASS] " << testName << RESET << std::endl;
+  } else {
+    std::cout << RED << "[FAIL] " << testName << RESET << std::endl;
+    std::exit(1);
+  }
+}
+
+static void setupConfig(MainConfig& config) {
+  ServerConfig server;
+  server.listen_port = 8080;
+  server.server_names.push_back("localhost");
+  server.root = "./test_cond_www";
+
+  LocationConfig loc;
+  loc.path = "/";
+  loc.root = "./test_cond_www";
+  loc.allow_methods.push_back(GET);
+  loc.allow_methods.push_back(HEAD);
+  server.locations.push_back(loc);
+  config.servers.push_back(server);
+}
+
+// extra はヘッダ行 ("Name: value\r\n") の並び
+static std::string request(RequestHandler& handler, const std::string& method,
+                           const std::string& path, const std::string& extra) {
+  Client client(999, 8080, "127.0.0.1", NULL);
+  std::string raw = method + " " + path + " HTTP/1.1\r\n";
+  raw += "Host: localhost:8080\r\n" + extra + "\r\n";
+  client.req.feed(raw.c_str(), raw.size());
+  handler.handle(&client);
+
+  std::string out;
+  while (!client.res.isDone() && !client.res.isError()) {
+    size_t n = client.res.getRemainingSize();
+    if (n == 0)
+      break;
+    out.append(client.res.getData(), n);
+    client.res.advance(n);
+  }
+  return out;
+}
+
+int main() {
+  std::cout << "=== Starting Conditional GET Test ===" << std::endl;
+
+  // ---------------------------------------------------------
+  // TEST 1: HTTP-date の書式化と解析
+  // ---------------------------------------------------------
+  {
+    printResult("format epoch",
+                HttpResponse::formatHttpDate(0) ==
+                    "Thu, 01 Jan 1970 00:00:00 GMT");
+    printResult("format RFC example",
+                HttpResponse::formatHttpDate(784111777) ==
+                    "Sun, 06 Nov 1994 08:49:37 GMT");
+    time_t t = 0;
+    printResult("parse RFC example",
+                HttpResponse::parseHttpDate("Sun, 06 Nov 1994 08:49:37 GMT",
+                                            t) &&
+                    t == 784111777);
+    printResult("leap day round trip",
+                HttpResponse::parseHttpDate(
+                    HttpResponse::formatHttpDate(951782400), t) &&
+                    t == 951782400);
+    printResult("reject asctime form",
+                !HttpResponse::parseHttpDate("Sun Nov  6 08:49:37 1994", t));
+    printResult("reject bad month",
+                !HttpResponse::parseHttpDate("Sun, 06 Foo 1994 08:49:37 GMT",
+                                             t));
+  }
+
+  mkdir("test_cond_www", 0755);
+  {
+    std::ofstream ofs("test_cond_www/index.html");
+    ofs << "<h1>cached</h1>";
+  }
+  MainConfig config;
+  setupConfig(config);
+  RequestHandler handler(config);
+
+  // ---------------------------------------------------------
+  // TEST 2: 検証子の付与
+  // ---------------------------------------------------------
+  std::string full = request(handler, "GET", "/index.html", "");
+  std::string etag = headerValue(full, "ETag");
+  std::string lastModified = headerValue(full, "Last-Modified");
+  printResult("200 carries ETag",
+              full.find("HTTP/1.1 200 OK") == 0 && etag.size() > 2 &&
+                  etag[0] == '"');
+  printResult("200 carries Last-Modified", lastModified.size() == 29);
+
+  // ---------------------------------------------------------
+  // TEST 3: If-None-Match
+  // ---------------------------------------------------------
+  {
+    std::string res = request(handler, "GET", "/index.html",
+                              "If-None-Match: " + etag + "\r\n");
+    printResult("matching ETag gives 304",
+                res.find("HTTP/1.1 304 Not Modified") == 0);
+    printResult("304 has no body",
+                res.find("<h1>") == std::string::npos &&
+                    headerValue(res, "Content-Length").empty());
+    printResult("304 repeats validators", headerValue(res, "ETag") == etag);
+
+    res = request(handler, "GET", "/index.html",
+                  "If-None-Match: \"other\", W/" + etag + "\r\n");
+    printResult("weak match in list gives 304",
+                res.find("HTTP/1.1 304") == 0);
+
+    res = request(handler, "GET", "/index.html",
+                  "If-None-Match: \"other\"\r\n");
+    printResult("mismatch gives 200", res.find("HTTP/1.1 200") == 0);
+
+    res = request(handler, "HEAD", "/index.html", "If-None-Match: *\r\n");
+    printResult("HEAD with * gives 304", res.find("HTTP/1.1 304") == 0);
+  }
+
+  // ---------------------------------------------------------
+  // TEST 4: If-Modified-Since
+  // ---------------------------------------------------------
+  {
+    std::string res = request(handler, "GET", "/index.html",
+                              "If-Modified-Since: " + lastModified + "\r\n");
+    printResult("same date gives 304", res.find("HTTP/1.1 304") == 0);
+
+    res = request(handler, "GET", "/index.html",
+                  "If-Modified-Since: Thu, 01 Jan 1970 00:00:00 GMT\r\n");
+    printResult("older date gives 200", res.find("HTTP/1.1 200") == 0);
+
+    res = request(handler, "GET", "/index.html",
+                  "If-Modified-Since: yesterday\r\n");
+    printResult("invalid date ignored", res.find("HTTP/1.1 200") == 0);
+
+    // If-None-Match があれば If-Modified-Since は見ない
+    res = request(handler, "GET", "/index.html",
+                  "If-None-Match: \"other\"\r\nIf-Modified-Since: " +
+                      lastModified + "\r\n");
+    printResult("If-None-Match takes precedence",
+                res.find("HTTP/1.1 200") == 0);
+  }
+
+  unlink("test_cond_www/index.html");
+  rmdir("test_cond_www");
+
+  std::cout << "=== All Conditional GET tests passed ===" << std::endl;
+  return 0;
+}
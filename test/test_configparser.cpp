@@ -825,6 +825,449 @@ void test_listen_port_only() {
 // Main
 // ============================================================================
 
+void test_worker_processes() {
+  TEST("parse worker_processes directive");
+
+  const char* test_conf = "/tmp/test_workers.conf";
+  std::ofstream file(test_conf);
+  file << "worker_processes 4;\n";
+  file << "server {\n";
+  file << "    listen 8080;\n";
+  file << "}\n";
+  file.close();
+
+  MainConfig config;
+  ConfigParser parser(test_conf);
+  parser.parse(config);
+
+  ASSERT_EQ(4, config.worker_processes);
+  ASSERT_EQ(1u, config.servers.size());
+
+  PASS();
+}
+
+void test_worker_processes_invalid() {
+  TEST("worker_processes 0 throws error");
+
+  const char* test_conf = "/tmp/test_workers_invalid.conf";
+  std::ofstream file(test_conf);
+  file << "worker_processes 0;\n";
+  file << "server {\n";
+  file << "    listen 8080;\n";
+  file << "}\n";
+  file.close();
+
+  MainConfig config;
+  ConfigParser parser(test_conf);
+
+  bool caught = false;
+  try {
+    parser.parse(config);
+  } catch (const std::runtime_error& e) {
+    caught = true;
+    std::string msg = e.what();
+    ASSERT_TRUE(msg.find("worker_processes") != std::string::npos);
+  }
+  ASSERT_TRUE(caught);
+
+  PASS();
+}
+
+void test_accept_budget() {
+  TEST("parse accept_budget directive");
+
+  const char* test_conf = "/tmp/test_accept_budget.conf";
+  std::ofstream file(test_conf);
+  file << "accept_budget 16;\n";
+  file << "server {\n";
+  file << "    listen 8080;\n";
+  file << "}\n";
+  file.close();
+
+  MainConfig config;
+  ConfigParser parser(test_conf);
+  parser.parse(config);
+
+  ASSERT_EQ(16, config.accept_budget);
+
+  PASS();
+}
+
+void test_timeouts() {
+  TEST("parse *_timeout directives");
+
+  const char* test_conf = "/tmp/test_timeouts.conf";
+  std::ofstream file(test_conf);
+  file << "client_header_timeout 10;\n";
+  file << "client_body_timeout 20s;\n";
+  file << "keepalive_timeout 500ms;\n";
+  file << "send_timeout 2m;\n";
+  file << "server {\n";
+  file << "    listen 8080;\n";
+  file << "}\n";
+  file.close();
+
+  MainConfig config;
+  ConfigParser parser(test_conf);
+  parser.parse(config);
+
+  ASSERT_EQ(10000UL, config.timeouts.client_header_timeout);
+  ASSERT_EQ(20000UL, config.timeouts.client_body_timeout);
+  ASSERT_EQ(500UL, config.timeouts.keepalive_timeout);
+  ASSERT_EQ(120000UL, config.timeouts.send_timeout);
+  ASSERT_EQ(static_cast<unsigned long>(DEFAULT_TIMEOUT_MS),
+            config.timeouts.cgi_timeout);
+
+  PASS();
+}
+
+void test_timeout_invalid() {
+  TEST("cgi_timeout with invalid unit throws error");
+
+  const char* test_conf = "/tmp/test_timeout_invalid.conf";
+  std::ofstream file(test_conf);
+  file << "cgi_timeout 5h;\n";
+  file << "server {\n";
+  file << "    listen 8080;\n";
+  file << "}\n";
+  file.close();
+
+  MainConfig config;
+  ConfigParser parser(test_conf);
+
+  bool caught = false;
+  try {
+    parser.parse(config);
+  } catch (const std::runtime_error& e) {
+    caught = true;
+    std::string msg = e.what();
+    ASSERT_TRUE(msg.find("invalid time value") != std::string::npos);
+  }
+  ASSERT_TRUE(caught);
+
+  PASS();
+}
+
+void test_open_file_cache() {
+  TEST("parse open_file_cache directives");
+
+  const char* test_conf = "/tmp/test_open_file_cache.conf";
+  std::ofstream file(test_conf);
+  file << "open_file_cache 1000;\n";
+  file << "open_file_cache_valid 5s;\n";
+  file << "server {\n";
+  file << "    listen 8080;\n";
+  file << "}\n";
+  file.close();
+
+  MainConfig config;
+  ConfigParser parser(test_conf);
+  parser.parse(config);
+
+  ASSERT_EQ(static_cast<size_t>(1000), config.open_file_cache.max_entries);
+  ASSERT_EQ(5000UL, config.open_file_cache.valid_ms);
+
+  std::ofstream off(test_conf);
+  off << "open_file_cache off;\n";
+  off << "server {\n";
+  off << "    listen 8080;\n";
+  off << "}\n";
+  off.close();
+
+  MainConfig disabled;
+  ConfigParser offParser(test_conf);
+  offParser.parse(disabled);
+  ASSERT_EQ(static_cast<size_t>(0), disabled.open_file_cache.max_entries);
+
+  std::ofstream bad(test_conf);
+  bad << "open_file_cache -1;\n";
+  bad << "server {\n";
+  bad << "    listen 8080;\n";
+  bad << "}\n";
+  bad.close();
+
+  MainConfig invalid;
+  ConfigParser badParser(test_conf);
+  bool caught = false;
+  try {
+    badParser.parse(invalid);
+  } catch (const std::runtime_error& e) {
+    caught = true;
+    std::string msg = e.what();
+    ASSERT_TRUE(msg.find("invalid open_file_cache value") !=
+                std::string::npos);
+  }
+  ASSERT_TRUE(caught);
+
+  PASS();
+}
+
+void test_asset_cache() {
+  TEST("parse asset_cache_* directives");
+
+  const char* test_conf = "/tmp/test_asset_cache.conf";
+  std::ofstream file(test_conf);
+  file << "asset_cache_size 8m;\n";
+  file << "asset_cache_max_file 16k;\n";
+  file << "server {\n";
+  file << "    listen 8080;\n";
+  file << "}\n";
+  file.close();
+
+  MainConfig config;
+  ConfigParser parser(test_conf);
+  parser.parse(config);
+
+  ASSERT_EQ(static_cast<size_t>(8 * 1024 * 1024),
+            config.asset_cache.max_bytes);
+  ASSERT_EQ(static_cast<size_t>(16 * 1024), config.asset_cache.max_file_size);
+
+  PASS();
+}
+
+void test_precompressed() {
+  TEST("parse precompressed directive");
+
+  const char* test_conf = "/tmp/test_precompressed.conf";
+  std::ofstream file(test_conf);
+  file << "server {\n";
+  file << "    listen 8080;\n";
+  file << "    location /static {\n";
+  file << "        root www;\n";
+  file << "        precompressed br gzip br;\n";
+  file << "    }\n";
+  file << "    location / {\n";
+  file << "        precompressed off;\n";
+  file << "    }\n";
+  file << "}\n";
+  file.close();
+
+  MainConfig config;
+  ConfigParser parser(test_conf);
+  parser.parse(config);
+
+  const LocationConfig& loc = config.servers[0].locations[0];
+  ASSERT_EQ(2u, loc.precompressed.size());
+  ASSERT_EQ("br", loc.precompressed[0]);
+  ASSERT_EQ("gzip", loc.precompressed[1]);
+  ASSERT_TRUE(config.servers[0].locations[1].precompressed.empty());
+
+  std::ofstream bad(test_conf);
+  bad << "server {\n";
+  bad << "    listen 8080;\n";
+  bad << "    location / {\n";
+  bad << "        precompressed zstd;\n";
+  bad << "    }\n";
+  bad << "}\n";
+  bad.close();
+
+  MainConfig invalid;
+  ConfigParser badParser(test_conf);
+  bool caught = false;
+  try {
+    badParser.parse(invalid);
+  } catch (const std::runtime_error& e) {
+    caught = true;
+    std::string msg = e.what();
+    ASSERT_TRUE(msg.find("precompressed must be") != std::string::npos);
+  }
+  ASSERT_TRUE(caught);
+
+  PASS();
+}
+
+void test_gzip() {
+  TEST("parse gzip directives");
+
+  const char* test_conf = "/tmp/test_gzip.conf";
+  std::ofstream file(test_conf);
+  file << "server {\n";
+  file << "    listen 8080;\n";
+  file << "    location /cgi {\n";
+  file << "        gzip on;\n";
+  file << "        gzip_min_length 1k;\n";
+  file << "        gzip_types text/html Application/JSON text/html;\n";
+  file << "        gzip_comp_level 6;\n";
+  file << "    }\n";
+  file << "    location / {\n";
+  file << "    }\n";
+  file << "}\n";
+  file.close();
+
+  MainConfig config;
+  ConfigParser parser(test_conf);
+  parser.parse(config);
+
+  const GzipConfig& gzip = config.servers[0].locations[0].gzip;
+  ASSERT_TRUE(gzip.enabled);
+  ASSERT_EQ(1024u, gzip.min_length);
+  ASSERT_EQ(2u, gzip.types.size());
+  ASSERT_EQ("application/json", gzip.types[1]);
+  ASSERT_EQ(6, gzip.level);
+  const GzipConfig& defaults = config.servers[0].locations[1].gzip;
+  ASSERT_TRUE(!defaults.enabled);
+  ASSERT_EQ(1, defaults.level);
+  ASSERT_EQ("text/html", defaults.types[0]);
+
+  std::ofstream bad(test_conf);
+  bad << "server {\n";
+  bad << "    listen 8080;\n";
+  bad << "    location / {\n";
+  bad << "        gzip_comp_level 10;\n";
+  bad << "    }\n";
+  bad << "}\n";
+  bad.close();
+
+  MainConfig invalid;
+  ConfigParser badParser(test_conf);
+  bool caught = false;
+  try {
+    badParser.parse(invalid);
+  } catch (const std::runtime_error& e) {
+    caught = true;
+    std::string msg = e.what();
+    ASSERT_TRUE(msg.find("gzip_comp_level must be") != std::string::npos);
+  }
+  ASSERT_TRUE(caught);
+
+  PASS();
+}
+
+void test_client_body() {
+  TEST("parse client_body_* directives");
+
+  const char* test_conf = "/tmp/test_client_body.conf";
+  std::ofstream file(test_conf);
+  file << "client_body_buffer_size 128k;\n";
+  file << "client_body_temp_path /var/tmp/webserv;\n";
+  file << "server {\n";
+  file << "    listen 8080;\n";
+  file << "}\n";
+  file.close();
+
+  MainConfig config;
+  ConfigParser parser(test_conf);
+  parser.parse(config);
+
+  ASSERT_EQ(static_cast<size_t>(128 * 1024), config.client_body.buffer_size);
+  ASSERT_EQ("/var/tmp/webserv", config.client_body.temp_path);
+
+  MainConfig defaults;
+  ASSERT_EQ(static_cast<size_t>(DEFAULT_CLIENT_BODY_BUFFER_SIZE),
+            defaults.client_body.buffer_size);
+  ASSERT_EQ("/tmp", defaults.client_body.temp_path);
+
+  PASS();
+}
+
+void test_cgi_workers() {
+  TEST("parse cgi_workers directives");
+
+  const char* test_conf = "/tmp/test_cgi_workers.conf";
+  std::ofstream file(test_conf);
+  file << "server {\n";
+  file << "    listen 8080;\n";
+  file << "    location /app {\n";
+  file << "        cgi_path /usr/bin/php-cgi;\n";
+  file << "        cgi_workers 2 8;\n";
+  file << "        cgi_worker_max_requests 500;\n";
+  file << "    }\n";
+  file << "    location /cgi {\n";
+  file << "        cgi_path /bin/sh;\n";
+  file << "    }\n";
+  file << "}\n";
+  file.close();
+
+  MainConfig config;
+  ConfigParser parser(test_conf);
+  parser.parse(config);
+
+  const CgiWorkerConfig& workers = config.servers[0].locations[0].cgi_workers;
+  ASSERT_EQ(static_cast<size_t>(2), workers.min_workers);
+  ASSERT_EQ(static_cast<size_t>(8), workers.max_workers);
+  ASSERT_EQ(500UL, workers.max_requests);
+  ASSERT_EQ(static_cast<size_t>(0),
+            config.servers[0].locations[1].cgi_workers.max_workers);
+
+  std::ofstream bad(test_conf);
+  bad << "server {\n";
+  bad << "    listen 8080;\n";
+  bad << "    location /app {\n";
+  bad << "        cgi_workers 4 2;\n";
+  bad << "    }\n";
+  bad << "}\n";
+  bad.close();
+
+  MainConfig invalid;
+  ConfigParser badParser(test_conf);
+  bool caught = false;
+  try {
+    badParser.parse(invalid);
+  } catch (const std::runtime_error& e) {
+    caught = true;
+    std::string msg = e.what();
+    ASSERT_TRUE(msg.find("min <= max") != std::string::npos);
+  }
+  ASSERT_TRUE(caught);
+
+  PASS();
+}
+
+void test_cgi_limit() {
+  TEST("parse cgi concurrency limit directives");
+
+  const char* test_conf = "/tmp/test_cgi_limit.conf";
+  std::ofstream file(test_conf);
+  file << "cgi_queue_timeout 3s;\n";
+  file << "server {\n";
+  file << "    listen 8080;\n";
+  file << "    location /cgi-bin {\n";
+  file << "        cgi_path /bin/sh;\n";
+  file << "        cgi_max_concurrency 4;\n";
+  file << "        cgi_queue_size 0;\n";
+  file << "    }\n";
+  file << "    location /other {\n";
+  file << "        cgi_path /bin/sh;\n";
+  file << "    }\n";
+  file << "}\n";
+  file.close();
+
+  MainConfig config;
+  ConfigParser parser(test_conf);
+  parser.parse(config);
+
+  const CgiLimitConfig& limit = config.servers[0].locations[0].cgi_limit;
+  ASSERT_EQ(static_cast<size_t>(4), limit.max_concurrency);
+  ASSERT_EQ(static_cast<size_t>(0), limit.queue_size);
+  ASSERT_EQ(3000UL, config.timeouts.cgi_queue_timeout);
+  const CgiLimitConfig& other = config.servers[0].locations[1].cgi_limit;
+  ASSERT_EQ(static_cast<size_t>(0), other.max_concurrency);
+  ASSERT_EQ(static_cast<size_t>(DEFAULT_CGI_QUEUE_SIZE), other.queue_size);
+
+  std::ofstream bad(test_conf);
+  bad << "server {\n";
+  bad << "    listen 8080;\n";
+  bad << "    location /cgi-bin {\n";
+  bad << "        cgi_max_concurrency -1;\n";
+  bad << "    }\n";
+  bad << "}\n";
+  bad.close();
+
+  MainConfig invalid;
+  ConfigParser badParser(test_conf);
+  bool caught = false;
+  try {
+    badParser.parse(invalid);
+  } catch (const std::runtime_error& e) {
+    caught = true;
+    std::string msg = e.what();
+    ASSERT_TRUE(msg.find("cgi_max_concurrency") != std::string::npos);
+  }
+  ASSERT_TRUE(caught);
+
+  PASS();
+}
+
 int main() {
   std::cout << std::endl;
   std::cout << "========================================" << std::endl;
@@ -863,6 +1306,18 @@ int main() {
   test_listen_host_only();
   test_listen_localhost_only();
   test_listen_port_only();
+  test_worker_processes();
+  test_worker_processes_invalid();
+  test_accept_budget();
+  test_timeouts();
+  test_timeout_invalid();
+  test_open_file_cache();
+  test_asset_cache();
+  test_precompressed();
+  test_gzip();
+  test_client_body();
+  test_cgi_workers();
+  test_cgi_limit();
 
   std::cout << std::endl;
   std::cout << "========================================" << std::endl;
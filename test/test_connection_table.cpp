@@ -0,0 +1,146 @@
+#include <fcntl.h>       // fcntl
+#include <sys/epoll.h>   // epoll_event
+#include <sys/socket.h>  // socketpair
+#include <unistd.h>      // close
+#include <cstdio>        // perror
+#include <cstdlib>
+#include <iostream>
+#include "../inc/Client.hpp"
+#include "../inc/ConnectionTable.hpp"
+#include "../inc/EpollContext.hpp"
+#include "../inc/EpollUtils.hpp"
+
+// 色付け用
+#define GREEN "\033[32m"
+#define RED "\033[31m"
+#define RESET "\033[0m"
+
+void printResult(const std::string& testName, bool success) {
+  if (success) {
+    std::cout << GREEN << "[PASS] " << testName << RESET << std::endl;
+  } else {
+    std::cout << RED << "[FAIL] " << testName << RESET << std::endl;
+    std::exit(1);
+  }
+}
+
+// socketpair の片側を返す (もう片側は close 済み)
+int makeSocket() {
+  int sv[2];
+  if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv) < 0) {
+    perror("socketpair");
+    std::exit(1);
+  }
+  close(sv[1]);
+  return sv[0];
+}
+
+bool isClosed(int fd) {
+  return fcntl(fd, F_GETFD) < 0;
+}
+
+int main() {
+  std::cout << "=== Starting ConnectionTable Unit Test ===" << std::endl;
+
+  try {
+    EpollUtils epoll;
+    ConnectionTable table(&epoll);
+
+    // ---------------------------------------------------------
+    // TEST 1: 初期状態
+    // ---------------------------------------------------------
+    {
+      printResult("Empty table", table.size() == 0);
+      printResult("Capacity preallocated", table.capacity() > 0);
+    }
+
+    // ---------------------------------------------------------
+    // TEST 2: 追加と O(1) 検索
+    // ---------------------------------------------------------
+    int fd1 = makeSocket();
+    int fd2 = makeSocket();
+    int fd3 = makeSocket();
+    {
+      Client* c1 = table.add(fd1, 8080, "127.0.0.1");
+      Client* c2 = table.add(fd2, 8081, "127.0.0.2");
+      Client* c3 = table.add(fd3, 8082, "127.0.0.3");
+      printResult("Add returns Client", c1 && c2 && c3);
+      printResult("Size after add", table.size() == 3);
+      printResult("Lookup by fd", table.get(fd2) == c2);
+      printResult("Client owns context",
+                  c1->getContext() != NULL &&
+                      c1->getContext()->type == EpollContext::CLIENT &&
+                      c1->getContext()->client == c1);
+      printResult("Lookup unknown fd", table.get(fd3 + 100) == NULL);
+      printResult("Lookup negative fd", table.get(-1) == NULL);
+    }
+
+    // ---------------------------------------------------------
+    // TEST 3: 登録済み fd の二重登録は拒否される
+    // ---------------------------------------------------------
+    {
+      int dup = makeSocket();
+      Client* c = table.add(dup, 8080, "127.0.0.1");
+      Client* again = table.add(dup, 8080, "127.0.0.1");
+      printResult("Duplicate add rejected", c != NULL && again == NULL);
+      printResult("Existing entry kept", table.get(dup) == c && !isClosed(dup));
+      table.remove(dup);
+    }
+
+    // ---------------------------------------------------------
+    // TEST 4: 中間要素の削除 (密な配列の詰め替え)
+    // ---------------------------------------------------------
+    {
+      EpollContext* ctx = table.get(fd1)->getContext();
+      table.remove(fd1);
+      printResult("Size after remove", table.size() == 2);
+      printResult("Removed fd lookup", table.get(fd1) == NULL);
+      printResult("Removed fd closed", isClosed(fd1));
+      // 同じ周回に残ったイベントは client の外れた Context で読み飛ばす
+      printResult("Context retired until the end of the batch",
+                  ctx->type == EpollContext::CLIENT && ctx->client == NULL);
+      table.releaseRetired();
+      EpollContext::releaseRetired();
+      bool found2 = false;
+      bool found3 = false;
+      for (size_t i = 0; i < table.size(); ++i) {
+        Client* c = table.at(i);
+        if (c->getFd() == fd2)
+          found2 = true;
+        if (c->getFd() == fd3)
+          found3 = true;
+      }
+      printResult("Dense iteration after remove", found2 && found3);
+      printResult("Lookup still valid", table.get(fd3)->getFd() == fd3);
+      printResult("Out of range index", table.at(table.size()) == NULL);
+    }
+
+    // ---------------------------------------------------------
+    // TEST 5: 走査しながらの削除 (末尾から)
+    // ---------------------------------------------------------
+    {
+      for (size_t i = table.size(); i-- > 0;) {
+        table.remove(table.at(i)->getFd());
+      }
+      printResult("Remove all while iterating", table.size() == 0);
+      printResult("All fds closed", isClosed(fd2) && isClosed(fd3));
+    }
+
+    // ---------------------------------------------------------
+    // TEST 6: 削除済み fd の再利用
+    // ---------------------------------------------------------
+    {
+      int fd = makeSocket();
+      Client* c = table.add(fd, 8080, "127.0.0.1");
+      printResult("Reuse fd slot", c != NULL && table.get(fd) == c);
+      // 残りはデストラクタで解放される
+    }
+
+  } catch (const std::exception& e) {
+    std::cerr << RED << "[FATAL] Exception: " << e.what() << RESET << std::endl;
+    return 1;
+  }
+
+  std::cout << "=== All Tests Passed ===" << std::endl;
+  return 0;
+}
@@ -0,0 +1,228 @@
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include "../inc/CgiWorkerPool.hpp"
+#include "../inc/Client.hpp"
+#include "../inc/Config.hpp"
+#include "../inc/FastCgi.hpp"
+#include "../inc/Http.hpp"
+#include "../inc/RequestHandler.hpp"
+#include "TestUtil.hpp"
+
+// 色付け用
+#define GREEN "\033[32m"
+#define RED "\033[31m"
+#define RESET "\033[0m"
+
+void printResult(const std::string& testName, bool success) {
+  if (success) {
+    std::cout << GREEN << "[PASS] " << testName << RESET << std::endl;
+  } else {
+    std::cout << RED << "[FAIL] " << testName << RESET << std::endl;
+    std::exit(1);
+  }
+}
+
+static const char* const WWW_DIR = "test_fastcgi_www";
+
+static std::string record(unsigned char type, const std::string& content,
+                          unsigned char padding) {
+  std::string out;
+  out += static_cast<char>(1);
+  out += static_cast<char>(type);
+  out += static_cast<char>(0);
+  out += static_cast<char>(1);
+  out += static_cast<char>((content.size() >> 8) & 0xff);
+  out += static_cast<char>(content.size() & 0xff);
+  out += static_cast<char>(padding);
+  out += static_cast<char>(0);
+  return out + content + std::string(padding, '\0');
+}
+
+static void startRequest(Client& client, RequestHandler& handler,
+                         const std::string& raw) {
+  client.req.feed(raw.data(), raw.size());
+  client.setState(PROCESSING);
+  handler.handle(&client);
+}
+
+// main のイベントループと同じ順で入力を送り、END_REQUEST まで読む
+static std::string finishRequest(Client& client) {
+  while (client.getCgiStdinFd() != -1)
+    client.writeCgiInput();
+  int fd = client.getCgiStdoutFd();
+  int flags = fcntl(fd, F_GETFL, 0);
+  fcntl(fd, F_SETFL, flags & ~O_NONBLOCK);
+  char buf[4096];
+  ssize_t n;
+  while (!client.isCgiDone() && (n = read(fd, buf, sizeof(buf))) > 0)
+    client.appendCgiOutput(buf, static_cast<size_t>(n));
+  client.finishCgi();
+  return dechunk(bodyOf(drain(client.res)));
+}
+
+static std::string runRequest(RequestHandler& handler,
+                              const std::string& raw) {
+  Client client(999, 8080, "127.0.0.1", NULL);
+  startRequest(client, handler, raw);
+  return finishRequest(client);
+}
+
+int main() {
+  std::cout << "=== Starting FastCGI Worker Test ===" << std::endl;
+
+  // ---------------------------------------------------------
+  // TEST 1: リクエストのレコード
+  // ---------------------------------------------------------
+  {
+    int fds[2];
+    if (pipe(fds) < 0)
+      return 1;
+    char env0[] = "A=b";
+    char* envp[] = {env0, NULL};
+    BodySink body;
+    body.append("xyz", 3);
+    FastCgiRequest request;
+    request.begin(envp);
+    size_t offset = 0;
+    bool ok = request.writeInput(fds[1], body, offset, true);
+    close(fds[1]);
+    std::string wire;
+    char buf[256];
+    ssize_t n;
+    while ((n = read(fds[0], buf, sizeof(buf))) > 0)
+      wire.append(buf, static_cast<size_t>(n));
+    close(fds[0]);
+
+    std::string begin("\0\1\0\0\0\0\0\0", 8);
+    std::string expected = record(1, begin, 0) +
+                           record(4, std::string("\1\1Ab", 4), 0) +
+                           record(4, "", 0) + record(5, "xyz", 0) +
+                           record(5, "", 0);
+    printResult("records written in order",
+                ok && wire == expected && request.isInputDone() &&
+                    offset == 3 && !request.hasPendingInput());
+  }
+
+  // ---------------------------------------------------------
+  // TEST 2: 応答のレコードを1バイトずつ解く
+  // ---------------------------------------------------------
+  {
+    std::string end("\0\0\0\7\0\0\0\0", 8);
+    std::string wire = record(6, "Status: 200\r\n\r\nhi", 3) +
+                       record(7, "warning\n", 0) + record(6, "!", 0) +
+                       record(6, "", 0) + record(3, end, 0);
+    FastCgiRequest request;
+    std::string out;
+    bool ok = true;
+    for (size_t i = 0; i < wire.size() && ok; ++i)
+      ok = request.read(wire.data() + i, 1, out);
+    printResult("stdout split from padding and stderr",
+                ok && out == "Status: 200\r\n\r\nhi!");
+    printResult("end request carries app status",
+                request.isEnded() && request.getAppStatus() == 7);
+
+    FastCgiRequest bad;
+    std::string junk("\2\6\0\1\0\0\0\0", 8);
+    printResult("unknown version rejected",
+                !bad.read(junk.data(), junk.size(), out));
+  }
+
+  // ---------------------------------------------------------
+  // 常駐ワーカー (cgi-bin/fcgi_responder.py) を通す
+  // ---------------------------------------------------------
+  mkdir(WWW_DIR, 0755);
+  {
+    std::ofstream ofs((std::string(WWW_DIR) + "/pid.py").c_str());
+    ofs << "import os, sys\n"
+           "sys.stdout.write('Content-Type: text/plain\\r\\n\\r\\n')\n"
+           "sys.stdout.write(str(os.getpid()) + ':' + sys.stdin.read())\n";
+  }
+
+  MainConfig config;
+  ServerConfig server;
+  server.listen_port = 8080;
+  server.server_names.push_back("localhost");
+  LocationConfig loc;
+  loc.path = "/";
+  loc.root = absPath(WWW_DIR);
+  loc.allow_methods.push_back(GET);
+  loc.allow_methods.push_back(POST);
+  loc.cgi_extension = ".py";
+  loc.cgi_path = absPath("cgi-bin/fcgi_responder.py");
+  loc.cgi_workers.min_workers = 1;
+  loc.cgi_workers.max_workers = 1;
+  loc.cgi_workers.max_requests = 3;
+  server.locations.push_back(loc);
+  config.servers.push_back(server);
+
+  {
+    RequestHandler handler(config);
+    printResult("min_workers started up front",
+                handler.cgiPoolStats().spawned == 1);
+
+    // ---------------------------------------------------------
+    // TEST 3: 同じプロセスで続けて処理する
+    // ---------------------------------------------------------
+    std::string post =
+        "POST /pid.py HTTP/1.1\r\nHost: localhost:8080\r\n"
+        "Content-Length: 4\r\n\r\nping";
+    std::string first = runRequest(handler, post);
+    std::string pid = first.substr(0, first.find(':'));
+    printResult("body reaches the worker",
+                !pid.empty() && first == pid + ":ping");
+    std::string second = runRequest(
+        handler, "GET /pid.py HTTP/1.1\r\nHost: localhost:8080\r\n\r\n");
+    printResult("worker reused", second == pid + ":");
+
+    // ---------------------------------------------------------
+    // TEST 4: max_requests で入れ替える
+    // ---------------------------------------------------------
+    runRequest(handler, post);
+    std::string fourth = runRequest(handler, post);
+    printResult("recycled after max_requests",
+                handler.cgiPoolStats().recycled == 1 &&
+                    fourth.substr(0, fourth.find(':')) != pid &&
+                    handler.cgiPoolStats().spawned == 2);
+
+    // ---------------------------------------------------------
+    // TEST 5: 全て使用中なら到着順に待つ
+    // ---------------------------------------------------------
+    Client holder(999, 8080, "127.0.0.1", NULL);
+    startRequest(holder, handler, post);
+    Client waiter(998, 8080, "127.0.0.1", NULL);
+    startRequest(waiter, handler, post);
+    printResult("second request queued",
+                waiter.getState() == WAITING_CGI_INPUT &&
+                    waiter.getCgiStdoutFd() == -1 &&
+                    handler.cgiPoolStats().queued == 1);
+    std::string held = finishRequest(holder);
+    printResult("queued request resumes on release",
+                waiter.getCgiStdoutFd() != -1);
+    std::string resumed = finishRequest(waiter);
+    printResult("both answered by the same worker",
+                held == resumed && held.find(":ping") != std::string::npos);
+
+    // ---------------------------------------------------------
+    // TEST 6: 落ちたワーカーは起動し直す
+    // ---------------------------------------------------------
+    pid = held.substr(0, held.find(':'));
+    kill(std::atoi(pid.c_str()), SIGKILL);
+    usleep(100000);
+    std::string after = runRequest(handler, post);
+    printResult("dead worker restarted",
+                after.find(":ping") != std::string::npos &&
+                    after.substr(0, after.find(':')) != pid);
+  }
+
+  unlink((std::string(WWW_DIR) + "/pid.py").c_str());
+  rmdir(WWW_DIR);
+
+  std::cout << "=== All FastCGI Worker tests passed ===" << std::endl;
+  return 0;
+}
@@ -88,6 +88,74 @@ void test_feed_multiple_chunks() {
   printResult("feed_multiple_chunks", passed);
 }
 
+// =============================================================================
+// 1バイトずつ feed しても同じ結果になる（\r と \n の分割を含む）
+// =============================================================================
+void test_feed_byte_by_byte() {
+  HttpRequest req;
+
+  const char* data =
+      "POST /upload?x=1 HTTP/1.1\r\n"
+      "Host: localhost\r\n"
+      "X-Custom:   spaced value\r\n"
+      "Content-Length: 5\r\n"
+      "\r\n"
+      "hello";
+  size_t len = std::strlen(data);
+  bool result = false;
+  for (size_t i = 0; i < len; ++i) {
+    result = req.feed(data + i, 1);
+  }
+
+  bool passed = true;
+  passed = passed && result && !req.hasError();
+  passed = passed && (req.getMethod() == POST);
+  passed = passed && (req.getPath() == "/upload");
+  passed = passed && (req.getQuery() == "x=1");
+  passed = passed && (req.getHeader("x-custom") == "spaced value");
+  const std::vector<char>& body = req.getBody().memory();
+  passed = passed && (std::string(body.begin(), body.end()) == "hello");
+
+  printResult("feed_byte_by_byte", passed);
+}
+
+// =============================================================================
+// 多数の小さなチャンク（バッファの詰め直しを跨いでも壊れない）
+// =============================================================================
+void test_feed_many_chunks() {
+  HttpRequest req;
+
+  std::string head =
+      "POST /upload HTTP/1.1\r\n"
+      "Host: localhost\r\n"
+      "Transfer-Encoding: chunked\r\n"
+      "\r\n";
+  req.feed(head.c_str(), head.size());
+
+  std::string expected;
+  std::string wire;
+  for (int i = 0; i < 2000; ++i) {
+    char c = static_cast<char>('a' + i % 26);
+    expected += std::string(3, c);
+    wire += "3\r\n" + std::string(3, c) + "\r\n";
+  }
+  wire += "0\r\n\r\n";
+
+  // 7バイトずつ (行の途中で分割される) 送る
+  bool result = false;
+  for (size_t i = 0; i < wire.size(); i += 7) {
+    size_t n = (wire.size() - i < 7) ? wire.size() - i : 7;
+    result = req.feed(wire.data() + i, n);
+  }
+
+  bool passed = true;
+  passed = passed && result && !req.hasError();
+  const std::vector<char>& body = req.getBody().memory();
+  passed = passed && (std::string(body.begin(), body.end()) == expected);
+
+  printResult("feed_many_chunks", passed);
+}
+
 // =============================================================================
 // clearのテスト（Keep-Alive用リセット）
 // =============================================================================
@@ -138,6 +206,8 @@ int main() {
   test_feed_partial_request_line();
   test_feed_multiple_chunks();
   test_clear();
+  test_feed_byte_by_byte();
+  test_feed_many_chunks();
 
   std::cout << "----------------------------------------" << std::endl;
   test_complete_request_line();
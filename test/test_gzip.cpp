@@ -0,0 +1,187 @@
+#include <sys/stat.h>
+#include <unistd.h>
+#include <zlib.h>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include "../inc/Client.hpp"
+#include "../inc/Config.hpp"
+#include "../inc/Deflater.hpp"
+#include "../inc/Http.hpp"
+#include "../inc/RequestHandler.hpp"
+#include "TestUtil.hpp"
+
+// 色付け用
+#define GREEN "\033[32m"
+#define RED "\033[31m"
+#define RESET "\033[0m"
+
+void printResult(const std::string& testName, bool success) {
+  if (success) {
+    std::cout << GREEN << "[PASS] " << testName << RESET << std::endl;
+  } else {
+    std::cout << RED << "[FAIL] " << testName << RESET << std::endl;
+    std::exit(1);
+  }
+}
+
+static std::string gunzip(const std::string& data) {
+  z_stream zs;
+  std::memset(&zs, 0, sizeof(zs));
+  if (inflateInit2(&zs, 15 + 16) != Z_OK)
+    return "!";
+  zs.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data.data()));
+  zs.avail_in = static_cast<uInt>(data.size());
+  std::string out;
+  char buf[4096];
+  int ret;
+  do {
+    zs.next_out = reinterpret_cast<Bytef*>(buf);
+    zs.avail_out = sizeof(buf);
+    ret = inflate(&zs, Z_NO_FLUSH);
+    out.append(buf, sizeof(buf) - zs.avail_out);
+  } while (ret == Z_OK);
+  inflateEnd(&zs);
+  return ret == Z_STREAM_END ? out : "!";
+}
+
+static std::string cgiResponse(const GzipConfig* gzip, bool accepted,
+                               const std::string& output, HttpMethod method,
+                               size_t step) {
+  HttpResponse res;
+  res.setRequestMethod(method);
+  res.setCompression(gzip, accepted);
+  res.parseCgiResponse(output);
+  res.build();
+  return drain(res, step);
+}
+
+int main() {
+  std::cout << "=== Starting Gzip Streaming Test ===" << std::endl;
+
+  GzipConfig gzip;
+  gzip.enabled = true;
+  gzip.types.push_back("application/json");
+
+  // GZIP_STREAM_CHUNK を何度もまたぐ大きさのボディ
+  std::string big;
+  for (int i = 0; big.size() < 3 * GZIP_STREAM_CHUNK + 100; ++i) {
+    big += "<li>line ";
+    big += static_cast<char>('a' + i % 26);
+    big += "</li>\n";
+  }
+
+  // ---------------------------------------------------------
+  // TEST 1: CGI 出力の圧縮
+  // ---------------------------------------------------------
+  {
+    std::string cgi = "Content-Type: text/html; charset=utf-8\r\n\r\n" + big;
+    std::string res = cgiResponse(&gzip, true, cgi, GET, 1000);
+    printResult("Content-Encoding gzip",
+                headerValue(res, "Content-Encoding") == "gzip");
+    printResult("sent chunked",
+                headerValue(res, "Transfer-Encoding") == "chunked" &&
+                    headerValue(res, "Content-Length").empty());
+    printResult("Vary set", headerValue(res, "Vary") == "Accept-Encoding");
+    std::string packed = dechunk(bodyOf(res));
+    printResult("body is smaller", packed != "!" && packed.size() < big.size());
+    printResult("round trip", gunzip(packed) == big);
+
+    res = cgiResponse(&gzip, true, cgi, GET, 1 << 20);
+    printResult("round trip in one pass", gunzip(dechunk(bodyOf(res))) == big);
+
+    res = cgiResponse(&gzip, true,
+                      "Content-Type: application/json\n\n{\"k\": \"" + big +
+                          "\"}",
+                      GET, 4096);
+    printResult("whitelisted type", headerValue(res, "Content-Encoding") ==
+                                        "gzip");
+  }
+
+  // ---------------------------------------------------------
+  // TEST 2: 圧縮しないケース
+  // ---------------------------------------------------------
+  {
+    std::string cgi = "Content-Type: text/html\r\n\r\n" + big;
+    std::string res = cgiResponse(&gzip, false, cgi, GET, 1 << 20);
+    printResult("not accepted sends identity",
+                headerValue(res, "Content-Encoding").empty() &&
+                    bodyOf(res) == big &&
+                    headerValue(res, "Vary") == "Accept-Encoding");
+
+    res = cgiResponse(NULL, true, cgi, GET, 1 << 20);
+    printResult("no policy", headerValue(res, "Vary").empty() &&
+                                 bodyOf(res) == big);
+
+    res = cgiResponse(&gzip, true, "Content-Type: image/png\r\n\r\n" + big,
+                      GET, 1 << 20);
+    printResult("type not listed", headerValue(res, "Content-Encoding")
+                                       .empty());
+
+    res = cgiResponse(&gzip, true, "Content-Type: text/html\r\n\r\nshort",
+                      GET, 1 << 20);
+    printResult("below min_length", bodyOf(res) == "short");
+
+    std::string encoded = "Content-Type: text/html\r\nContent-Encoding: br\r\n";
+    res = cgiResponse(&gzip, true, encoded + "\r\n" + big, GET, 1 << 20);
+    printResult("already encoded", bodyOf(res) == big);
+
+    res = cgiResponse(&gzip, true, cgi, HEAD, 1 << 20);
+    printResult("HEAD keeps headers only",
+                headerValue(res, "Content-Encoding") == "gzip" &&
+                    bodyOf(res).empty());
+  }
+
+  // ---------------------------------------------------------
+  // TEST 3: autoindex と統計
+  // ---------------------------------------------------------
+  {
+    mkdir("test_gzip_www", 0755);
+    for (int i = 0; i < 20; ++i) {
+      std::string name = "test_gzip_www/file";
+      name += static_cast<char>('a' + i);
+      std::ofstream ofs(name.c_str());
+    }
+
+    MainConfig config;
+    ServerConfig server;
+    server.listen_port = 8080;
+    server.server_names.push_back("localhost");
+    LocationConfig loc;
+    loc.path = "/";
+    loc.root = "./test_gzip_www";
+    loc.index = "none.html";
+    loc.autoindex = true;
+    loc.gzip.enabled = true;
+    server.locations.push_back(loc);
+    config.servers.push_back(server);
+    RequestHandler handler(config);
+
+    unsigned long before = Deflater::stats().bytesIn;
+    Client client(999, 8080, "127.0.0.1", NULL);
+    std::string raw =
+        "GET / HTTP/1.1\r\nHost: localhost:8080\r\n"
+        "Accept-Encoding: deflate, gzip;q=0.5\r\n\r\n";
+    client.req.feed(raw.c_str(), raw.size());
+    handler.handle(&client);
+    std::string res = drain(client.res, 1 << 20);
+    std::string html = gunzip(dechunk(bodyOf(res)));
+    printResult("autoindex compressed",
+                headerValue(res, "Content-Encoding") == "gzip" &&
+                    html.find("filet") != std::string::npos);
+    printResult("stats count input",
+                Deflater::stats().bytesIn - before == html.size());
+
+    for (int i = 0; i < 20; ++i) {
+      std::string name = "test_gzip_www/file";
+      name += static_cast<char>('a' + i);
+      unlink(name.c_str());
+    }
+    rmdir("test_gzip_www");
+  }
+
+  std::cout << "=== All Gzip Streaming tests passed ===" << std::endl;
+  return 0;
+}
@@ -0,0 +1,118 @@
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include "../inc/HeaderTable.hpp"
+#include "../inc/Http.hpp"
+
+// 色付け用
+#define GREEN "\033[32m"
+#define RED "\033[31m"
+#define RESET "\033[0m"
+
+void printResult(const std::string& testName, bool success) {
+  if (success) {
+    std::cout << GREEN << "[PASS] " << testName << RESET << std::endl;
+  } else {
+    std::cout << RED << "[FAIL] " << testName << RESET << std::endl;
+    std::exit(1);
+  }
+}
+
+static void setHeader(HeaderTable& table, const char* name,
+                      const char* value) {
+  table.set(name, std::strlen(name), value, std::strlen(value));
+}
+
+int main() {
+  std::cout << "=== Starting HeaderTable Unit Test ===" << std::endl;
+
+  // ---------------------------------------------------------
+  // TEST 1: 既知ヘッダー名の解決
+  // ---------------------------------------------------------
+  {
+    printResult("lookup Host", HeaderTable::lookup("Host", 4) == HDR_HOST);
+    printResult("lookup is case-insensitive",
+                HeaderTable::lookup("cOnTeNt-LeNgTh", 14) ==
+                    HDR_CONTENT_LENGTH);
+    printResult("lookup unknown name",
+                HeaderTable::lookup("X-Custom", 8) == HDR_UNKNOWN);
+    printResult("lookup prefix is not a match",
+                HeaderTable::lookup("Hos", 3) == HDR_UNKNOWN);
+    printResult("nameOf returns lowercase name",
+                HeaderTable::nameOf(HDR_TRANSFER_ENCODING) ==
+                    "transfer-encoding");
+  }
+
+  // ---------------------------------------------------------
+  // TEST 2: 既知・未知ヘッダーの格納と参照
+  // ---------------------------------------------------------
+  {
+    HeaderTable table;
+    setHeader(table, "HOST", "example.com");
+    setHeader(table, "X-Request-Id", "abc");
+    printResult("Known header by id", table.get(HDR_HOST) == "example.com");
+    printResult("has() reflects presence",
+                table.has(HDR_HOST) && !table.has(HDR_COOKIE));
+    printResult("Absent header is empty", table.get(HDR_COOKIE).empty());
+    const std::string* v = table.find("x-request-id");
+    printResult("Unknown header by name", v != NULL && *v == "abc");
+    v = table.find("Host");
+    printResult("find() resolves known names",
+                v != NULL && *v == "example.com");
+    printResult("find() of missing name", table.find("x-none") == NULL);
+  }
+
+  // ---------------------------------------------------------
+  // TEST 3: 重複ヘッダーは後勝ち、走査順は出現順
+  // ---------------------------------------------------------
+  {
+    HeaderTable table;
+    setHeader(table, "Accept", "text/html");
+    setHeader(table, "X-A", "1");
+    setHeader(table, "accept", "*/*");
+    setHeader(table, "x-a", "2");
+    printResult("Duplicate known overwrites", table.get(HDR_ACCEPT) == "*/*");
+    printResult("Duplicate unknown overwrites",
+                table.find("X-A") != NULL && *table.find("X-A") == "2");
+    printResult("Duplicates are not counted twice", table.size() == 2);
+    bool names = table.size() == 2 && table.nameAt(0) == "accept" &&
+                 table.nameAt(1) == "x-a" && table.valueAt(1) == "2";
+    printResult("Iteration yields lowercase names", names);
+  }
+
+  // ---------------------------------------------------------
+  // TEST 4: clear() 後の再利用で領域が残る
+  // ---------------------------------------------------------
+  {
+    HeaderTable table;
+    std::string longValue(200, 'v');
+    setHeader(table, "User-Agent", longValue.c_str());
+    const char* before = table.get(HDR_USER_AGENT).data();
+    table.clear();
+    printResult("clear() empties the table",
+                table.size() == 0 && !table.has(HDR_USER_AGENT));
+    setHeader(table, "User-Agent", "curl");
+    printResult("Value storage is reused",
+                table.get(HDR_USER_AGENT) == "curl" &&
+                    table.get(HDR_USER_AGENT).data() == before);
+  }
+
+  // ---------------------------------------------------------
+  // TEST 5: HttpRequest 経由での参照
+  // ---------------------------------------------------------
+  {
+    HttpRequest req;
+    std::string raw =
+        "GET / HTTP/1.1\r\nhOsT: localhost\r\nX-Trace: 7\r\n\r\n";
+    req.feed(raw.c_str(), raw.size());
+    printResult("Request completes", req.isComplete());
+    printResult("getHeader(HeaderId)", req.getHeader(HDR_HOST) == "localhost");
+    printResult("getHeader(string) is case-insensitive",
+                req.getHeader("Host") == "localhost" &&
+                    req.getHeader("x-trace") == "7");
+  }
+
+  std::cout << "=== All HeaderTable tests passed ===" << std::endl;
+  return 0;
+}
@@ -0,0 +1,162 @@
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include "../inc/OpenFileCache.hpp"
+
+// 色付け用
+#define GREEN "\033[32m"
+#define RED "\033[31m"
+#define RESET "\033[0m"
+
+void printResult(const std::string& testName, bool success) {
+  if (success) {
+    std::cout << GREEN << "[PASS] " << testName << RESET << std::endl;
+  } else {
+    std::cout << RED << "[FAIL] " << testName << RESET << std::endl;
+    std::exit(1);
+  }
+}
+
+static const std::string DIR_PATH = "/tmp/webserv_ofc_test";
+
+static void writeFile(const std::string& path, const std::string& data) {
+  std::ofstream ofs(path.c_str(), std::ios::binary | std::ios::trunc);
+  ofs << data;
+}
+
+static void cleanup() {
+  const char* names[] = {"a.txt", "b.txt", "c.txt", "new.txt", "sub", NULL};
+  for (size_t i = 0; names[i] != NULL; ++i) {
+    std::string path = DIR_PATH + "/" + names[i];
+    unlink(path.c_str());
+    rmdir(path.c_str());
+  }
+  rmdir(DIR_PATH.c_str());
+}
+
+int main() {
+  std::cout << "=== Starting OpenFileCache Unit Test ===" << std::endl;
+
+  cleanup();
+  mkdir(DIR_PATH.c_str(), 0755);
+  mkdir((DIR_PATH + "/sub").c_str(), 0755);
+  writeFile(DIR_PATH + "/a.txt", "hello");
+  writeFile(DIR_PATH + "/b.txt", "bb");
+  writeFile(DIR_PATH + "/c.txt", "c");
+
+  // ---------------------------------------------------------
+  // TEST 1: miss → hit と stat 結果
+  // ---------------------------------------------------------
+  {
+    OpenFileCache cache(8, 60000);
+    OpenFileCache::Info first = cache.lookup(DIR_PATH + "/a.txt");
+    printResult("file exists", first.exists && !first.isDir);
+    printResult("file is readable", first.readable);
+    printResult("size from fstat", first.size == 5);
+    printResult("regular file keeps fd", first.fd >= 0);
+
+    OpenFileCache::Info second = cache.lookup(DIR_PATH + "/a.txt");
+    printResult("second lookup hits",
+                cache.stats().hits == 1 && cache.stats().misses == 1);
+    printResult("hit returns same fd", second.fd == first.fd);
+
+    char buf[8];
+    ssize_t n = pread(second.fd, buf, sizeof(buf), 0);
+    printResult("cached fd is readable",
+                n == 5 && std::string(buf, n) == "hello");
+
+    OpenFileCache::Info dir = cache.lookup(DIR_PATH + "/sub");
+    printResult("directory detected", dir.exists && dir.isDir);
+    printResult("directory has no fd", dir.fd == -1);
+
+    OpenFileCache::Info missing = cache.lookup(DIR_PATH + "/none.txt");
+    printResult("missing file", !missing.exists && missing.fd == -1);
+    printResult("entries counted", cache.size() == 3);
+  }
+
+  // ---------------------------------------------------------
+  // TEST 2: LRU で最も古いものから捨てる
+  // ---------------------------------------------------------
+  {
+    OpenFileCache cache(2, 60000);
+    cache.lookup(DIR_PATH + "/a.txt");
+    cache.lookup(DIR_PATH + "/b.txt");
+    cache.lookup(DIR_PATH + "/a.txt");  // a を最近使ったものにする
+    cache.lookup(DIR_PATH + "/c.txt");  // b が追い出される
+    printResult("size is bounded", cache.size() == 2);
+
+    unsigned long misses = cache.stats().misses;
+    cache.lookup(DIR_PATH + "/a.txt");
+    printResult("recently used entry kept", cache.stats().misses == misses);
+    cache.lookup(DIR_PATH + "/b.txt");
+    printResult("least recently used entry evicted",
+                cache.stats().misses == misses + 1);
+  }
+
+  // ---------------------------------------------------------
+  // TEST 3: valid 期限切れで開き直す
+  // ---------------------------------------------------------
+  {
+    OpenFileCache cache(8, 50);
+    cache.lookup(DIR_PATH + "/a.txt");
+    usleep(100 * 1000);
+    cache.lookup(DIR_PATH + "/a.txt");
+    printResult("expired entry is probed again", cache.stats().misses == 2);
+  }
+
+  // ---------------------------------------------------------
+  // TEST 4: inotify による無効化
+  // ---------------------------------------------------------
+  {
+    OpenFileCache cache(8, 60000);
+    if (cache.getWatchFd() < 0) {
+      std::cout << "inotify unavailable, skipping watch tests" << std::endl;
+    } else {
+      cache.lookup(DIR_PATH + "/a.txt");
+      cache.lookup(DIR_PATH + "/b.txt");
+      writeFile(DIR_PATH + "/a.txt", "changed!");
+      cache.processEvents();
+      printResult("modified entry dropped", cache.size() == 1);
+
+      OpenFileCache::Info info = cache.lookup(DIR_PATH + "/a.txt");
+      printResult("new size seen after change", info.size == 8);
+
+      OpenFileCache::Info missing = cache.lookup(DIR_PATH + "/new.txt");
+      printResult("negative entry cached", !missing.exists);
+      writeFile(DIR_PATH + "/new.txt", "new");
+      cache.processEvents();
+      OpenFileCache::Info created = cache.lookup(DIR_PATH + "/new.txt");
+      printResult("created file seen", created.exists && created.size == 3);
+
+      unlink((DIR_PATH + "/b.txt").c_str());
+      cache.processEvents();
+      printResult("deleted file seen",
+                  !cache.lookup(DIR_PATH + "/b.txt").exists);
+    }
+  }
+
+  // ---------------------------------------------------------
+  // TEST 5: 明示的な無効化と無効設定
+  // ---------------------------------------------------------
+  {
+    OpenFileCache cache(8, 60000);
+    cache.lookup(DIR_PATH + "/a.txt");
+    cache.invalidate(DIR_PATH + "/a.txt");
+    printResult("invalidate drops entry", cache.size() == 0);
+
+    OpenFileCache disabled(0, 60000);
+    OpenFileCache::Info info = disabled.lookup(DIR_PATH + "/a.txt");
+    printResult("disabled cache still probes", info.exists);
+    printResult("disabled cache keeps nothing",
+                disabled.size() == 0 && info.fd == -1 &&
+                    disabled.getWatchFd() == -1);
+  }
+
+  cleanup();
+  std::cout << "=== All OpenFileCache tests passed ===" << std::endl;
+  return 0;
+}
@@ -0,0 +1,136 @@
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include "../inc/Client.hpp"
+
+// 色付け用
+#define GREEN "\033[32m"
+#define RED "\033[31m"
+#define RESET "\033[0m"
+
+void printResult(const std::string& testName, bool success) {
+  if (success) {
+    std::cout << GREEN << "[PASS] " << testName << RESET << std::endl;
+  } else {
+    std::cout << RED << "[FAIL] " << testName << RESET << std::endl;
+    std::exit(1);
+  }
+}
+
+static std::string makeGet(const std::string& path) {
+  return "GET " + path + " HTTP/1.1\r\nHost: localhost\r\n\r\n";
+}
+
+// 受信データを main.cpp と同じ順序で Client に渡す
+static void receive(Client& client, const std::string& data) {
+  ConnState state = client.getState();
+  if (state == WAIT_REQUEST || state == READING_REQUEST) {
+    client.setState(READING_REQUEST);
+    client.req.feed(data.c_str(), data.size());
+  } else {
+    client.readAhead(data.c_str(), data.size());
+  }
+}
+
+// リクエストを処理したことにして応答送信中へ進める
+static void respond(Client& client) {
+  client.readAhead(NULL, 0);
+  client.readyToWrite();
+}
+
+int main() {
+  std::cout << "=== Starting Pipeline Unit Test ===" << std::endl;
+
+  // ---------------------------------------------------------
+  // TEST 1: 1回の受信に3件 → 順番に取り出せる
+  // ---------------------------------------------------------
+  {
+    Client client(-1, 8080, "127.0.0.1", NULL);
+    receive(client, makeGet("/a") + makeGet("/b") + makeGet("/c"));
+    printResult("First request complete", client.req.isComplete());
+    respond(client);
+    printResult("Two requests read ahead", client.getPipelineDepth() == 2);
+    printResult("Current request untouched",
+                client.req.getPath() == "/a" &&
+                    client.req.getUnparsedSize() == 0);
+
+    printResult("Advance to second",
+                client.nextRequest() && client.req.isComplete() &&
+                    client.req.getPath() == "/b");
+    respond(client);
+    printResult("Advance to third",
+                client.nextRequest() && client.req.getPath() == "/c");
+    respond(client);
+    printResult("Back to waiting",
+                client.nextRequest() && client.getState() == WAIT_REQUEST &&
+                    client.getPipelineDepth() == 0);
+  }
+
+  // ---------------------------------------------------------
+  // TEST 2: 応答中に届いた分割リクエスト
+  // ---------------------------------------------------------
+  {
+    Client client(-1, 8080, "127.0.0.1", NULL);
+    receive(client, makeGet("/a") + "GET /b HT");
+    respond(client);
+    printResult("Partial request queued", client.getPipelineDepth() == 1);
+    receive(client, "TP/1.1\r\nHost: x\r\n\r\n" + makeGet("/c"));
+    printResult("Completed while writing", client.getPipelineDepth() == 2);
+    printResult("Second request parsed",
+                client.nextRequest() && client.req.getPath() == "/b");
+  }
+
+  // ---------------------------------------------------------
+  // TEST 3: 先読みの上限を超えた分は後から切り出す
+  // ---------------------------------------------------------
+  {
+    Client client(-1, 8080, "127.0.0.1", NULL);
+    std::string data;
+    for (int i = 0; i < PIPELINE_MAX_DEPTH + 3; ++i) {
+      data += makeGet("/" + std::string(1, static_cast<char>('a' + i)));
+    }
+    receive(client, data);
+    respond(client);
+    printResult("Queue bounded",
+                client.getPipelineDepth() == PIPELINE_MAX_DEPTH);
+
+    std::string order;
+    order += client.req.getPath();
+    while (client.nextRequest() && client.req.isComplete()) {
+      order += client.req.getPath();
+      respond(client);
+    }
+    printResult("All responses in order", order == "/a/b/c/d/e/f/g/h/i/j/k");
+  }
+
+  // ---------------------------------------------------------
+  // TEST 4: 前のボディの後ろの CRLF は読み飛ばす
+  // ---------------------------------------------------------
+  {
+    Client client(-1, 8080, "127.0.0.1", NULL);
+    receive(client,
+            "POST /p HTTP/1.1\r\nHost: x\r\nContent-Length: 3\r\n\r\nabc\r\n" +
+                makeGet("/g"));
+    respond(client);
+    printResult("Empty line before request ignored",
+                client.nextRequest() && client.req.isComplete() &&
+                    !client.req.hasError() && client.req.getPath() == "/g");
+  }
+
+  // ---------------------------------------------------------
+  // TEST 5: 送信側が閉じられた後
+  // ---------------------------------------------------------
+  {
+    Client client(-1, 8080, "127.0.0.1", NULL);
+    receive(client, makeGet("/a") + makeGet("/b") + "GET /c");
+    respond(client);
+    client.closeInput();
+    printResult("Queued request still served",
+                client.nextRequest() && client.req.getPath() == "/b");
+    respond(client);
+    printResult("Incomplete request closes", !client.nextRequest());
+  }
+
+  std::cout << "=== All Pipeline tests passed ===" << std::endl;
+  return 0;
+}
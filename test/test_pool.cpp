@@ -0,0 +1,138 @@
+#include <cstdlib>
+#include <iostream>
+#include <set>
+#include <vector>
+#include "../inc/Client.hpp"
+#include "../inc/EpollContext.hpp"
+#include "../inc/Pool.hpp"
+
+// 色付け用
+#define GREEN "\033[32m"
+#define RED "\033[31m"
+#define RESET "\033[0m"
+
+void printResult(const std::string& testName, bool success) {
+  if (success) {
+    std::cout << GREEN << "[PASS] " << testName << RESET << std::endl;
+  } else {
+    std::cout << RED << "[FAIL] " << testName << RESET << std::endl;
+    std::exit(1);
+  }
+}
+
+int main() {
+  std::cout << "=== Starting Pool Unit Test ===" << std::endl;
+
+  // ---------------------------------------------------------
+  // TEST 1: スラブからの確保と再利用
+  // ---------------------------------------------------------
+  {
+    SlabPool pool(24, 4);
+    std::vector<void*> ptrs;
+    for (int i = 0; i < 4; ++i) {
+      ptrs.push_back(pool.allocate(24));
+    }
+    printResult("One slab for four objects", pool.slabCount() == 1);
+    printResult("First allocation is a miss",
+                pool.stats().misses == 1 && pool.stats().hits == 3);
+
+    std::set<void*> unique(ptrs.begin(), ptrs.end());
+    bool aligned = true;
+    for (size_t i = 0; i < ptrs.size(); ++i) {
+      if (reinterpret_cast<size_t>(ptrs[i]) % (2 * sizeof(void*)) != 0)
+        aligned = false;
+    }
+    printResult("Distinct and aligned", unique.size() == 4 && aligned);
+
+    void* extra = pool.allocate(24);
+    printResult("Grows a new slab when exhausted", pool.slabCount() == 2);
+
+    pool.deallocate(ptrs[2], 24);
+    void* reused = pool.allocate(24);
+    printResult("Freed block is reused", reused == ptrs[2]);
+    printResult("No new slab for reuse", pool.slabCount() == 2);
+
+    pool.deallocate(extra, 24);
+    for (size_t i = 0; i < ptrs.size(); ++i) {
+      pool.deallocate(ptrs[i], 24);
+    }
+  }
+
+  // ---------------------------------------------------------
+  // TEST 2: スロットより大きい要求はプールを通さない
+  // ---------------------------------------------------------
+  {
+    SlabPool pool(16, 8);
+    void* big = pool.allocate(1024);
+    printResult("Oversized request bypasses slabs", pool.slabCount() == 0);
+    pool.deallocate(big, 1024);
+  }
+
+  // ---------------------------------------------------------
+  // TEST 3: Client / EpollContext のクラス専用 operator new
+  // ---------------------------------------------------------
+  {
+    PoolStats before = Client::pool().stats();
+    Client* a = new Client(-1, 8080, "127.0.0.1", NULL);
+    delete a;
+    Client* b = new Client(-1, 8080, "127.0.0.1", NULL);
+    printResult("Client storage recycled", a == b);
+    printResult("Client pool hit counted",
+                Client::pool().stats().hits > before.hits);
+
+    EpollContext* c1 = EpollContext::createClient(b);
+    delete c1;
+    EpollContext* c2 = EpollContext::createCgiPipe(b, EpollContext::CGI_STDIN);
+    printResult("EpollContext storage recycled", c1 == c2);
+    delete c2;
+    delete b;
+  }
+
+  // ---------------------------------------------------------
+  // TEST 4: BufferPool による領域の引き継ぎ
+  // ---------------------------------------------------------
+  {
+    std::vector<char> buf;
+    buf.reserve(4096);
+    buf.push_back('x');
+    const char* storage = &buf[0];
+    BufferPool::release(buf);
+    printResult("Released buffer is emptied",
+                buf.empty() && buf.capacity() == 0);
+
+    PoolStats before = BufferPool::stats();
+    std::vector<char> next;
+    BufferPool::acquire(next);
+    printResult("Acquire hands over capacity",
+                next.empty() && next.capacity() >= 4096);
+    next.push_back('y');
+    printResult("Same storage reused", &next[0] == storage);
+    printResult("Buffer hit counted", BufferPool::stats().hits > before.hits);
+
+    std::vector<char> huge;
+    huge.reserve(1024 * 1024);
+    BufferPool::release(huge);
+    std::vector<char> other;
+    BufferPool::acquire(other);
+    printResult("Oversized buffer not retained",
+                other.capacity() < 1024 * 1024);
+  }
+
+  // ---------------------------------------------------------
+  // TEST 5: HttpRequest / HttpResponse の破棄で領域が戻る
+  // ---------------------------------------------------------
+  {
+    {
+      HttpRequest req;
+      std::string data(2048, 'a');
+      req.feed(data.c_str(), data.size());
+    }
+    PoolStats before = BufferPool::stats();
+    HttpRequest next;
+    printResult("Request buffer recycled",
+                BufferPool::stats().hits > before.hits);
+  }
+
+  std::cout << "=== All Tests Passed ===" << std::endl;
+  return 0;
+}
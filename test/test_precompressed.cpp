@@ -0,0 +1,153 @@
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include "../inc/Client.hpp"
+#include "../inc/Config.hpp"
+#include "../inc/Http.hpp"
+#include "../inc/RequestHandler.hpp"
+#include "TestUtil.hpp"
+
+// 色付け用
+#define GREEN "\033[32m"
+#define RED "\033[31m"
+#define RESET "\033[0m"
+
+void printResult(const std::string& testName, bool success) {
+  if (success) {
+    std::cout << GREEN << "[PASS] " << testName << RESET << std::endl;
+  } else {
+    std::cout << RED << "[FAIL] " << testName << RESET << std::endl;
+    std::exit(1);
+  }
+}
+
+static void writeFile(const std::string& path, const std::string& content) {
+  std::ofstream ofs(path.c_str());
+  ofs << content;
+}
+
+static void setupConfig(MainConfig& config) {
+  ServerConfig server;
+  server.listen_port = 8080;
+  server.server_names.push_back("localhost");
+  server.root = "./test_pre_www";
+
+  LocationConfig loc;
+  loc.path = "/";
+  loc.root = "./test_pre_www";
+  loc.allow_methods.push_back(GET);
+  loc.allow_methods.push_back(HEAD);
+  loc.precompressed.push_back("br");
+  loc.precompressed.push_back("gzip");
+  server.locations.push_back(loc);
+
+  LocationConfig plain;
+  plain.path = "/plain/";
+  plain.alias = "./test_pre_www/";
+  plain.allow_methods.push_back(GET);
+  server.locations.push_back(plain);
+  config.servers.push_back(server);
+}
+
+// extra はヘッダ行 ("Name: value\r\n") の並び
+static std::string request(RequestHandler& handler, const std::string& path,
+                           const std::string& extra) {
+  Client client(999, 8080, "127.0.0.1", NULL);
+  std::string raw = "GET " + path + " HTTP/1.1\r\n";
+  raw += "Host: localhost:8080\r\n" + extra + "\r\n";
+  client.req.feed(raw.c_str(), raw.size());
+  handler.handle(&client);
+
+  std::string out;
+  while (!client.res.isDone() && !client.res.isError()) {
+    size_t n = client.res.getRemainingSize();
+    if (n == 0)
+      break;
+    out.append(client.res.getData(), n);
+    client.res.advance(n);
+  }
+  return out;
+}
+
+int main() {
+  std::cout << "=== Starting Precompressed Asset Test ===" << std::endl;
+
+  mkdir("test_pre_www", 0755);
+  writeFile("test_pre_www/app.js", "console.log('original');");
+  writeFile("test_pre_www/app.js.gz", "GZIP-BYTES");
+  writeFile("test_pre_www/app.js.br", "BR");
+  writeFile("test_pre_www/style.css", "body{}");
+  writeFile("test_pre_www/style.css.gz", "GZ");
+
+  for (int pass = 0; pass < 2; ++pass) {
+    MainConfig config;
+    if (pass == 1)
+      config.asset_cache.max_bytes = 0;  // ファイルボディの経路
+    setupConfig(config);
+    RequestHandler handler(config);
+    std::string tag = pass == 0 ? " (asset cache)" : " (file body)";
+
+    std::string res =
+        request(handler, "/app.js", "Accept-Encoding: gzip, br\r\n");
+    printResult("br preferred by config order" + tag,
+                headerValue(res, "Content-Encoding") == "br" &&
+                    bodyOf(res) == "BR");
+    printResult("length from variant" + tag,
+                headerValue(res, "Content-Length") == "2");
+    printResult("type from original" + tag,
+                headerValue(res, "Content-Type") == "text/javascript");
+    printResult("Vary set" + tag,
+                headerValue(res, "Vary") == "Accept-Encoding");
+
+    res = request(handler, "/app.js", "Accept-Encoding: br;q=0.5, gzip\r\n");
+    printResult("q value wins" + tag,
+                headerValue(res, "Content-Encoding") == "gzip" &&
+                    bodyOf(res) == "GZIP-BYTES");
+
+    res = request(handler, "/style.css", "Accept-Encoding: br, gzip\r\n");
+    printResult("falls back to existing variant" + tag,
+                headerValue(res, "Content-Encoding") == "gzip" &&
+                    bodyOf(res) == "GZ");
+
+    res = request(handler, "/app.js", "Accept-Encoding: gzip;q=0, br;q=0\r\n");
+    printResult("q=0 refuses variant" + tag,
+                headerValue(res, "Content-Encoding").empty() &&
+                    bodyOf(res) == "console.log('original');" &&
+                    headerValue(res, "Vary") == "Accept-Encoding");
+
+    res = request(handler, "/app.js", "");
+    printResult("no Accept-Encoding sends original" + tag,
+                headerValue(res, "Content-Encoding").empty() &&
+                    bodyOf(res) == "console.log('original');");
+
+    res = request(handler, "/plain/app.js", "Accept-Encoding: gzip\r\n");
+    printResult("disabled location sends original" + tag,
+                headerValue(res, "Content-Encoding").empty() &&
+                    headerValue(res, "Vary").empty());
+
+    // 圧縮済みと元ファイルで ETag が異なる
+    std::string gz = request(handler, "/app.js", "Accept-Encoding: gzip\r\n");
+    std::string id = request(handler, "/app.js", "");
+    printResult("ETag differs per encoding" + tag,
+                headerValue(gz, "ETag") != headerValue(id, "ETag"));
+    res = request(handler, "/app.js",
+                  "Accept-Encoding: gzip\r\nIf-None-Match: " +
+                      headerValue(gz, "ETag") + "\r\n");
+    printResult("304 for variant keeps Vary" + tag,
+                res.find("HTTP/1.1 304") == 0 &&
+                    headerValue(res, "Vary") == "Accept-Encoding");
+  }
+
+  unlink("test_pre_www/app.js");
+  unlink("test_pre_www/app.js.gz");
+  unlink("test_pre_www/app.js.br");
+  unlink("test_pre_www/style.css");
+  unlink("test_pre_www/style.css.gz");
+  rmdir("test_pre_www");
+
+  std::cout << "=== All Precompressed Asset tests passed ===" << std::endl;
+  return 0;
+}
@@ -0,0 +1,180 @@
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include "../inc/Client.hpp"
+#include "../inc/Config.hpp"
+#include "../inc/Http.hpp"
+#include "../inc/RequestHandler.hpp"
+#include "TestUtil.hpp"
+
+// 色付け用
+#define GREEN "\033[32m"
+#define RED "\033[31m"
+#define RESET "\033[0m"
+
+void printResult(const std::string& testName, bool success) {
+  if (success) {
+    std::cout << GREEN << "[PASS] " << testName << RESET << std::endl;
+  } else {
+    std::cout << RED << "[FAIL] " << testName << RESET << std::endl;
+    std::exit(1);
+  }
+}
+
+static const char* const FILE_PATH = "test_range_www/data.txt";
+
+static void setupConfig(MainConfig& config) {
+  ServerConfig server;
+  server.listen_port = 8080;
+  server.server_names.push_back("localhost");
+  server.root = "./test_range_www";
+
+  LocationConfig loc;
+  loc.path = "/";
+  loc.root = "./test_range_www";
+  loc.allow_methods.push_back(GET);
+  loc.allow_methods.push_back(HEAD);
+  server.locations.push_back(loc);
+  config.servers.push_back(server);
+}
+
+// extra はヘッダ行 ("Name: value\r\n") の並び
+static std::string request(RequestHandler& handler, const std::string& method,
+                           const std::string& extra, bool sendfile) {
+  Client client(999, 8080, "127.0.0.1", NULL);
+  std::string raw = method + " /data.txt HTTP/1.1\r\n";
+  raw += "Host: localhost:8080\r\n" + extra + "\r\n";
+  client.req.feed(raw.c_str(), raw.size());
+  handler.handle(&client);
+  client.res.setSendfile(sendfile);
+  return drain(client.res);
+}
+
+int main() {
+  std::cout << "=== Starting Range Request Test ===" << std::endl;
+
+  mkdir("test_range_www", 0755);
+  {
+    std::ofstream ofs(FILE_PATH);
+    ofs << "0123456789abcdefghij";  // 20 bytes
+  }
+  MainConfig config;
+  config.asset_cache.max_bytes = 0;  // ファイルボディの経路を通す
+  setupConfig(config);
+  RequestHandler handler(config);
+
+  for (int mode = 0; mode < 2; ++mode) {
+    bool sendfile = (mode == 1);
+    std::string tag = sendfile ? " (sendfile)" : " (pread)";
+
+    // -------------------------------------------------------
+    // TEST 1: 単一区間
+    // -------------------------------------------------------
+    std::string res = request(handler, "GET", "Range: bytes=2-5\r\n", sendfile);
+    printResult("single range 206" + tag,
+                res.find("HTTP/1.1 206 Partial Content") == 0);
+    printResult("Content-Range" + tag,
+                headerValue(res, "Content-Range") == "bytes 2-5/20");
+    printResult("Content-Length" + tag,
+                headerValue(res, "Content-Length") == "4");
+    printResult("single range body" + tag, bodyOf(res) == "2345");
+
+    res = request(handler, "GET", "Range: bytes=-3\r\n", sendfile);
+    printResult("suffix range" + tag, bodyOf(res) == "hij" &&
+                                          headerValue(res, "Content-Range") ==
+                                              "bytes 17-19/20");
+
+    res = request(handler, "GET", "Range: bytes=15-100\r\n", sendfile);
+    printResult("open range clamped" + tag,
+                bodyOf(res) == "fghij" &&
+                    headerValue(res, "Content-Range") == "bytes 15-19/20");
+
+    // -------------------------------------------------------
+    // TEST 2: 複数区間 (multipart/byteranges)
+    // -------------------------------------------------------
+    res = request(handler, "GET", "Range: bytes=0-1, 10-12\r\n", sendfile);
+    std::string type = headerValue(res, "Content-Type");
+    std::string boundary =
+        type.substr(type.find("boundary=") + std::string("boundary=").size());
+    std::string expected = "\r\n--" + boundary +
+                           "\r\nContent-Type: text/plain\r\n"
+                           "Content-Range: bytes 0-1/20\r\n\r\n01"
+                           "\r\n--" +
+                           boundary +
+                           "\r\nContent-Type: text/plain\r\n"
+                           "Content-Range: bytes 10-12/20\r\n\r\nabc"
+                           "\r\n--" +
+                           boundary + "--\r\n";
+    printResult("multipart type" + tag,
+                type.find("multipart/byteranges; boundary=") == 0);
+    printResult("multipart body" + tag, bodyOf(res) == expected);
+    printResult("multipart length" + tag,
+                std::atoi(headerValue(res, "Content-Length").c_str()) ==
+                    static_cast<int>(expected.size()));
+  }
+
+  // ---------------------------------------------------------
+  // TEST 3: 416 と無視されるケース
+  // ---------------------------------------------------------
+  {
+    std::string res = request(handler, "GET", "Range: bytes=20-\r\n", false);
+    printResult("unsatisfiable gives 416",
+                res.find("HTTP/1.1 416 Range Not Satisfiable") == 0 &&
+                    headerValue(res, "Content-Range") == "bytes */20");
+
+    res = request(handler, "GET", "Range: bytes=5-2\r\n", false);
+    printResult("invalid range ignored", res.find("HTTP/1.1 200") == 0 &&
+                                             bodyOf(res).size() == 20);
+
+    res = request(handler, "GET", "Range: items=0-1\r\n", false);
+    printResult("other unit ignored", res.find("HTTP/1.1 200") == 0);
+
+    res = request(handler, "HEAD", "Range: bytes=0-1\r\n", false);
+    printResult("HEAD ignores Range", res.find("HTTP/1.1 200") == 0 &&
+                                          headerValue(res, "Content-Length") ==
+                                              "20");
+
+    std::string full = request(handler, "GET", "", false);
+    printResult("200 advertises Accept-Ranges",
+                headerValue(full, "Accept-Ranges") == "bytes");
+  }
+
+  // ---------------------------------------------------------
+  // TEST 4: If-Range
+  // ---------------------------------------------------------
+  {
+    std::string full = request(handler, "GET", "", false);
+    std::string etag = headerValue(full, "ETag");
+    std::string lastModified = headerValue(full, "Last-Modified");
+
+    std::string res = request(
+        handler, "GET", "Range: bytes=0-0\r\nIf-Range: " + etag + "\r\n",
+        false);
+    printResult("If-Range etag match gives 206",
+                res.find("HTTP/1.1 206") == 0 && bodyOf(res) == "0");
+
+    res = request(handler, "GET",
+                  "Range: bytes=0-0\r\nIf-Range: \"stale\"\r\n", false);
+    printResult("If-Range mismatch gives 200",
+                res.find("HTTP/1.1 200") == 0 && bodyOf(res).size() == 20);
+
+    res = request(handler, "GET",
+                  "Range: bytes=0-0\r\nIf-Range: W/" + etag + "\r\n", false);
+    printResult("weak If-Range never matches", res.find("HTTP/1.1 200") == 0);
+
+    res = request(handler, "GET",
+                  "Range: bytes=0-0\r\nIf-Range: " + lastModified + "\r\n",
+                  false);
+    printResult("If-Range date match gives 206", res.find("HTTP/1.1 206") == 0);
+  }
+
+  unlink(FILE_PATH);
+  rmdir("test_range_www");
+
+  std::cout << "=== All Range Request tests passed ===" << std::endl;
+  return 0;
+}
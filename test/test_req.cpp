@@ -58,7 +58,7 @@ void test_FragmentedRequest() {
   printResult("Fragmented: Chunk 2 Complete", done2 == true);
 
   // Bodyの検証 (vector<char> -> string変換)
-  std::vector<char> body = req.getBody();
+  std::vector<char> body = req.getBody().memory();
   std::string bodyStr(body.begin(), body.end());
 
   printResult("Fragmented: Method POST", req.getMethod() == POST);
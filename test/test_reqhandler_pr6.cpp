@@ -134,7 +134,7 @@ void assertCgiExecution(Client& client, const std::string& testName,
   // 3. パイプからの読み出し（CGI出力の確認）
 
   if (client.getCgiStdinFd() >= 0) {
-    const std::vector<char>& body = client.req.getBody();
+    const std::vector<char>& body = client.req.getBody().memory();
     if (!body.empty()) {
       write(client.getCgiStdinFd(), &body[0], body.size());
     }
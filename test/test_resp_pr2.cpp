@@ -6,7 +6,10 @@
 
 // 【重要】この関数のプロトタイプ宣言を Http.hpp に friend として追加します
 void inspectBuffer(const HttpResponse& res) {
-  const std::vector<char>& buffer = res._responseBuffer;
+  // ヘッダとボディは別セグメントなので、連結した送信データを表示する
+  std::vector<char> buffer;
+  if (res.getData() != NULL)
+    buffer.assign(res.getData(), res.getData() + res.getRemainingSize());
 
   std::cout << "--- [BUFFER START] ---" << std::endl;
   for (size_t i = 0; i < buffer.size(); ++i) {
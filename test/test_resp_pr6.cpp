@@ -13,9 +13,12 @@
 // ヘルパー関数
 // -----------------------------------------------------------------------------
 
-// バッファを文字列として取得（デバッグ用）
+// 送信データ全体を文字列として取得（デバッグ用）
+// ボディはセグメントとして別に持つので、連結した getData() から取る
 std::string getRawBuffer(const HttpResponse& res) {
-  return std::string(res._responseBuffer.begin(), res._responseBuffer.end());
+  if (res.getData() == NULL)
+    return "";
+  return std::string(res.getData(), res.getRemainingSize());
 }
 
 // チャンクレスポンスの妥当性をチェックする関数
@@ -47,7 +50,7 @@ void inspectChunkedResponse(const HttpResponse& res,
   }
 
   // 3. データサイズの簡易検証
-  if (res._responseBuffer.size() <= originalBodySize) {
+  if (res.getRemainingSize() <= originalBodySize) {
     std::cout << "\n  [NG] Buffer size too small (Chunks missing?)";
     ok = false;
   }
@@ -0,0 +1,134 @@
+#include <sys/uio.h>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include "../inc/Http.hpp"
+
+// 色付け用
+#define GREEN "\033[32m"
+#define RED "\033[31m"
+#define RESET "\033[0m"
+
+void printResult(const std::string& testName, bool success) {
+  if (success) {
+    std::cout << GREEN << "[PASS] " << testName << RESET << std::endl;
+  } else {
+    std::cout << RED << "[FAIL] " << testName << RESET << std::endl;
+    std::exit(1);
+  }
+}
+
+// 未送信のセグメントを全て連結する (writev で送られる内容)
+static std::string gather(const HttpResponse& res, int* count) {
+  struct iovec iov[256];
+  int n = res.getIovec(iov, 256);
+  std::string out;
+  for (int i = 0; i < n; ++i) {
+    out.append(static_cast<const char*>(iov[i].iov_base), iov[i].iov_len);
+  }
+  if (count)
+    *count = n;
+  return out;
+}
+
+static std::string headerPart(const std::string& raw) {
+  return raw.substr(0, raw.find("\r\n\r\n") + 4);
+}
+
+int main() {
+  std::cout << "=== Starting writev Response Unit Test ===" << std::endl;
+
+  // ---------------------------------------------------------
+  // TEST 1: ヘッダとボディは別セグメント
+  // ---------------------------------------------------------
+  {
+    HttpResponse res;
+    res.setBody("<h1>Hello</h1>");
+    res.build();
+    int count = 0;
+    std::string raw = gather(res, &count);
+    printResult("Header and body segments", count == 2);
+    printResult("Body follows header",
+                raw.substr(headerPart(raw).size()) == "<h1>Hello</h1>");
+    printResult("Remaining size covers all segments",
+                res.getRemainingSize() == raw.size());
+    printResult("getData() is the same bytes",
+                std::string(res.getData(), res.getRemainingSize()) == raw);
+  }
+
+  // ---------------------------------------------------------
+  // TEST 2: チャンク枠は静的 / 自前のセグメント
+  // ---------------------------------------------------------
+  {
+    HttpResponse res;
+    res.setBody(std::string(2500, 'x'));
+    res.setChunked(true);
+    res.build();
+    std::string raw = gather(res, NULL);
+    std::string expected = "400\r\n" + std::string(1024, 'x') + "\r\n400\r\n" +
+                           std::string(1024, 'x') + "\r\n1c4\r\n" +
+                           std::string(452, 'x') + "\r\n0\r\n\r\n";
+    printResult("Chunked framing", raw.substr(headerPart(raw).size()) ==
+                                       expected);
+  }
+
+  // ---------------------------------------------------------
+  // TEST 3: セグメントをまたぐ部分送信
+  // ---------------------------------------------------------
+  {
+    HttpResponse res;
+    res.setBody(std::string(100, 'b'));
+    res.build();
+    std::string all = gather(res, NULL);
+    size_t header = headerPart(all).size();
+
+    res.advance(header - 3);
+    std::string rest = gather(res, NULL);
+    printResult("Partial inside header", rest == all.substr(header - 3));
+
+    res.advance(13);  // ヘッダ末尾を越えてボディの途中へ
+    int count = 0;
+    rest = gather(res, &count);
+    printResult("Partial across segments",
+                count == 1 && rest == std::string(90, 'b'));
+    printResult("getData() follows progress",
+                std::string(res.getData(), res.getRemainingSize()) == rest);
+
+    res.advance(1000);  // 残りより多くても安全に完了する
+    printResult("Done after last segment",
+                res.isDone() && res.getRemainingSize() == 0 &&
+                    res.getData() == NULL);
+  }
+
+  // ---------------------------------------------------------
+  // TEST 4: HEAD はヘッダのみ
+  // ---------------------------------------------------------
+  {
+    HttpResponse res;
+    res.setRequestMethod(HEAD);
+    res.setBody("body");
+    res.build();
+    int count = 0;
+    std::string raw = gather(res, &count);
+    printResult("HEAD sends header segment only",
+                count == 1 && raw.find("Content-Length: 4") !=
+                                  std::string::npos &&
+                    raw.find("body") == std::string::npos);
+  }
+
+  // ---------------------------------------------------------
+  // TEST 5: コピーしたレスポンスは自分のバッファを指す
+  // ---------------------------------------------------------
+  {
+    HttpResponse* res = new HttpResponse();
+    res->setBody("copied body");
+    res->build();
+    std::string expected = gather(*res, NULL);
+    HttpResponse copy(*res);
+    delete res;
+    printResult("Copy keeps segments valid", gather(copy, NULL) == expected);
+  }
+
+  std::cout << "=== All writev Response tests passed ===" << std::endl;
+  return 0;
+}
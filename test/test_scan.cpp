@@ -0,0 +1,143 @@
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "../inc/Http.hpp"
+#include "../inc/Scan.hpp"
+
+// 色付け用
+#define GREEN "\033[32m"
+#define RED "\033[31m"
+#define RESET "\033[0m"
+
+void printResult(const std::string& testName, bool success) {
+  if (success) {
+    std::cout << GREEN << "[PASS] " << testName << RESET << std::endl;
+  } else {
+    std::cout << RED << "[FAIL] " << testName << RESET << std::endl;
+    std::exit(1);
+  }
+}
+
+// 比較用のリファレンス実装
+const char* refCrlf(const char* p, const char* end) {
+  for (; p + 1 < end; ++p) {
+    if (p[0] == '\r' && p[1] == '\n')
+      return p;
+  }
+  return end;
+}
+
+const char* refNonToken(const char* p, const char* end) {
+  static const char* tchars = "!#$%&'*+-.^_`|~";
+  for (; p < end; ++p) {
+    unsigned char c = static_cast<unsigned char>(*p);
+    bool ok = (c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') ||
+              (c >= 'A' && c <= 'Z') || (c != 0 && std::strchr(tchars, c));
+    if (!ok)
+      return p;
+  }
+  return end;
+}
+
+// ランダムなバイト列の各位置・各長さで全カーネルをリファレンスと比較する
+bool checkKernels() {
+  std::srand(42);
+  for (int round = 0; round < 300; ++round) {
+    size_t len = static_cast<size_t>(std::rand() % 100);
+    std::vector<char> buf(len + 1);
+    for (size_t i = 0; i < len; ++i) {
+      int r = std::rand() % 8;
+      if (r == 0)
+        buf[i] = '\r';
+      else if (r == 1)
+        buf[i] = '\n';
+      else if (r == 2)
+        buf[i] = ':';
+      else
+        buf[i] = static_cast<char>(std::rand() % 256);
+    }
+    for (size_t start = 0; start <= len; ++start) {
+      const char* b = &buf[0] + start;
+      const char* e = &buf[0] + len;
+      if (Scan::findCrlf(b, e) != refCrlf(b, e))
+        return false;
+      if (Scan::findChar(b, e, ':') != std::find(b, e, ':'))
+        return false;
+      if (Scan::findNonToken(b, e) != refNonToken(b, e))
+        return false;
+
+      std::string lower(b, e);
+      std::string expected(b, e);
+      for (size_t i = 0; i < expected.size(); ++i) {
+        if (expected[i] >= 'A' && expected[i] <= 'Z')
+          expected[i] = static_cast<char>(expected[i] + 32);
+      }
+      if (!lower.empty())
+        Scan::toLower(&lower[0], lower.size());
+      if (lower != expected)
+        return false;
+    }
+  }
+  return true;
+}
+
+int main() {
+  std::cout << "=== Starting Scan Unit Test ===" << std::endl;
+
+  // ---------------------------------------------------------
+  // TEST 1: 全実装がリファレンスと一致する
+  // ---------------------------------------------------------
+  Scan::Impl impls[] = {Scan::SCALAR, Scan::SSE2, Scan::AVX2};
+  for (size_t i = 0; i < 3; ++i) {
+    if (!Scan::setImpl(impls[i])) {
+      std::cout << "[SKIP] " << Scan::implName(impls[i])
+                << " not supported" << std::endl;
+      continue;
+    }
+    printResult(std::string("Kernels match reference: ") +
+                    Scan::implName(impls[i]),
+                Scan::impl() == impls[i] && checkKernels());
+  }
+  Scan::setImpl(Scan::bestImpl());
+
+  // ---------------------------------------------------------
+  // TEST 2: 32バイト境界を跨ぐ CRLF
+  // ---------------------------------------------------------
+  {
+    std::string s(31, 'a');
+    s += "\r\n";
+    const char* b = s.data();
+    printResult("CRLF across block boundary",
+                Scan::findCrlf(b, b + s.size()) == b + 31);
+    printResult("Lone CR at end is not CRLF",
+                Scan::findCrlf(b, b + 32) == b + 32);
+  }
+
+  // ---------------------------------------------------------
+  // TEST 3: ヘッダー名の token 検証
+  // ---------------------------------------------------------
+  {
+    HttpRequest ok;
+    const char* good = "GET / HTTP/1.1\r\nHost: x\r\nX-A_b.c~1: v\r\n\r\n";
+    ok.feed(good, std::strlen(good));
+    printResult("Token header name accepted",
+                ok.isComplete() && ok.getHeader("x-a_b.c~1") == "v");
+
+    HttpRequest ws;
+    const char* bad = "GET / HTTP/1.1\r\nHost : x\r\n\r\n";
+    ws.feed(bad, std::strlen(bad));
+    printResult("Whitespace before colon rejected",
+                ws.hasError() && ws.getErrorCode() == ERR_INVALID_HEADER);
+
+    HttpRequest empty;
+    const char* noName = "GET / HTTP/1.1\r\nHost: x\r\n: v\r\n\r\n";
+    empty.feed(noName, std::strlen(noName));
+    printResult("Empty header name rejected", empty.hasError());
+  }
+
+  std::cout << "=== All Tests Passed ===" << std::endl;
+  return 0;
+}
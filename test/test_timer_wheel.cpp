@@ -0,0 +1,187 @@
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+#include "../inc/Client.hpp"
+#include "../inc/TimerWheel.hpp"
+
+// 色付け用
+#define GREEN "\033[32m"
+#define RED "\033[31m"
+#define RESET "\033[0m"
+
+typedef TimerWheel::Timer Timer;
+typedef TimerWheel::Msec Msec;
+
+void printResult(const std::string& testName, bool success) {
+  if (success) {
+    std::cout << GREEN << "[PASS] " << testName << RESET << std::endl;
+  } else {
+    std::cout << RED << "[FAIL] " << testName << RESET << std::endl;
+    std::exit(1);
+  }
+}
+
+// now まで時刻を進め、期限切れになったタイマーを返す
+std::vector<Timer*> advanceTo(TimerWheel& wheel, Msec now) {
+  std::vector<Timer*> expired;
+  wheel.setNow(now);
+  wheel.expire(expired);
+  return expired;
+}
+
+int main() {
+  std::cout << "=== Starting TimerWheel Unit Test ===" << std::endl;
+
+  const Msec base = 1000000;
+
+  // ---------------------------------------------------------
+  // TEST 1: 空のホイール
+  // ---------------------------------------------------------
+  {
+    TimerWheel wheel(base);
+    printResult("Empty wheel has no timeout", wheel.nextTimeout() == -1);
+    printResult("Empty wheel expires nothing",
+                advanceTo(wheel, base + 60000).empty());
+  }
+
+  // ---------------------------------------------------------
+  // TEST 2: 期限前には発火せず、期限後に発火する
+  // ---------------------------------------------------------
+  {
+    TimerWheel wheel(base);
+    Timer t;
+    wheel.arm(&t, 500);
+    printResult("Armed", t.isArmed() && wheel.size() == 1);
+    int wait = wheel.nextTimeout();
+    printResult("nextTimeout covers deadline", wait >= 500 && wait <= 600);
+    printResult("Not fired early", advanceTo(wheel, base + 499).empty());
+    std::vector<Timer*> expired = advanceTo(wheel, base + 600);
+    printResult("Fired after deadline",
+                expired.size() == 1 && expired[0] == &t);
+    printResult("Unarmed after expire", !t.isArmed() && wheel.size() == 0);
+  }
+
+  // ---------------------------------------------------------
+  // TEST 3: 再設定とキャンセル
+  // ---------------------------------------------------------
+  {
+    TimerWheel wheel(base);
+    Timer a;
+    Timer b;
+    wheel.arm(&a, 1000);
+    wheel.arm(&b, 1000);
+    wheel.arm(&a, 5000);  // 延長
+    wheel.cancel(&b);
+    printResult("Cancel unarms", !b.isArmed() && wheel.size() == 1);
+    printResult("Re-armed timer not fired at old deadline",
+                advanceTo(wheel, base + 2000).empty());
+    std::vector<Timer*> expired = advanceTo(wheel, base + 5100);
+    printResult("Re-armed timer fired at new deadline",
+                expired.size() == 1 && expired[0] == &a);
+    wheel.cancel(&a);  // 解除済みでも安全
+    printResult("Double cancel is safe", wheel.size() == 0);
+  }
+
+  // ---------------------------------------------------------
+  // TEST 4: 上位レベルからのカスケード (長い期限)
+  // ---------------------------------------------------------
+  {
+    TimerWheel wheel(base);
+    Timer minute;
+    Timer hour;
+    wheel.arm(&minute, 75000);  // level 1
+    wheel.arm(&hour, 3600000);  // level 2
+    printResult("Minute timer not early",
+                advanceTo(wheel, base + 74000).empty());
+    std::vector<Timer*> expired = advanceTo(wheel, base + 75200);
+    printResult("Minute timer cascaded and fired",
+                expired.size() == 1 && expired[0] == &minute);
+    printResult("Hour timer not early",
+                advanceTo(wheel, base + 3599000).empty());
+    expired = advanceTo(wheel, base + 3600200);
+    printResult("Hour timer cascaded and fired",
+                expired.size() == 1 && expired[0] == &hour);
+  }
+
+  // ---------------------------------------------------------
+  // TEST 5: nextTimeout はカスケード地点で打ち切られる
+  // ---------------------------------------------------------
+  {
+    TimerWheel wheel(base);
+    Timer t;
+    wheel.arm(&t, 30000);
+    int wait = wheel.nextTimeout();
+    printResult("Wakes by next cascade", wait > 0 && wait <= 30100);
+
+    // 何度起きても期限前には発火しない
+    Msec now = base;
+    bool early = false;
+    while (t.isArmed()) {
+      now += static_cast<Msec>(wheel.nextTimeout());
+      std::vector<Timer*> expired = advanceTo(wheel, now);
+      if (!expired.empty() && now < base + 30000)
+        early = true;
+    }
+    printResult("Fired via nextTimeout steps", !early && now <= base + 30200);
+  }
+
+  // ---------------------------------------------------------
+  // TEST 6: 多数のタイマーが期限順に発火する
+  // ---------------------------------------------------------
+  {
+    TimerWheel wheel(base);
+    std::vector<Timer> timers(1000);
+    for (size_t i = 0; i < timers.size(); ++i) {
+      wheel.arm(&timers[i], (i + 1) * 100);
+    }
+    bool ordered = true;
+    for (size_t i = 0; i < timers.size(); ++i) {
+      std::vector<Timer*> expired =
+          advanceTo(wheel, base + (i + 1) * 100 + 100);
+      if (expired.size() != 1 || expired[0] != &timers[i])
+        ordered = false;
+    }
+    printResult("1000 timers fire in order", ordered && wheel.size() == 0);
+  }
+
+  // ---------------------------------------------------------
+  // TEST 7: Client のフェーズごとのタイマー
+  // ---------------------------------------------------------
+  {
+    TimerWheel wheel(base);
+    TimeoutConfig timeouts;
+    timeouts.client_header_timeout = 1000;
+    timeouts.keepalive_timeout = 2000;
+    timeouts.send_timeout = 3000;
+
+    Client* client = new Client(-1, 8080, "127.0.0.1", NULL);
+    client->setTimers(&wheel, &timeouts);
+    printResult("Client starts in header phase",
+                client->getTimeoutPhase() == TIMEOUT_HEADER);
+
+    // ヘッダー受信中の受信では延長しない
+    advanceTo(wheel, base + 500);
+    client->updateTimestamp();
+    std::vector<Timer*> expired = advanceTo(wheel, base + 1100);
+    printResult("Header timeout not extended by activity",
+                expired.size() == 1 && expired[0]->owner == client);
+
+    client->readyToWrite();
+    printResult("Send phase", client->getTimeoutPhase() == TIMEOUT_SEND);
+    client->reset();
+    client->readyToRead();
+    printResult("Keep-alive phase",
+                client->getTimeoutPhase() == TIMEOUT_KEEPALIVE);
+    printResult("Keep-alive not early", advanceTo(wheel, base + 3000).empty());
+    expired = advanceTo(wheel, base + 3200);
+    printResult("Keep-alive fired",
+                expired.size() == 1 && expired[0]->owner == client);
+
+    client->readyToWrite();
+    delete client;  // デストラクタでタイマーが外れる
+    printResult("Destructor cancels timer", wheel.size() == 0);
+  }
+
+  std::cout << "=== All Tests Passed ===" << std::endl;
+  return 0;
+}